@@ -29,6 +29,8 @@ else()
   set(LL_TESTS "" CACHE STRING "Build and run unit and integration tests (disable for build timing runs to reduce variation")
 endif()
 
+option(BUILD_BENCHMARKS "Build the benchmark executables in integration_tests" OFF)
+
 option(ENABLE_MEDIA_PLUGINS "Turn off building media plugins if they are imported by third-party library mechanism" ON)
 
 # Compiler and toolchain options
@@ -0,0 +1,193 @@
+/**
+ * @file llimage_benchmark.cpp
+ * @brief Times the LLImageRaw scaling, compositing, tint and emissive code
+ * with each instruction set LLImageKernels supports on this CPU.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+#include "llpointer.h"
+#include "lltimer.h"
+
+// Linden library includes
+#include "llimage.h"
+#include "llimagekernels.h"
+#include "llcleanup.h"
+#include "v3color.h"
+
+// system libraries
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\tllimage_benchmark [options]\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -n, --iterations <n>\n"
+"        Number of times each operation is timed. Default is 20.\n"
+"\n"
+"Every operation runs with the scalar code first, then with each SIMD\n"
+"instruction set the CPU supports. Their results are checked against the\n"
+"scalar one and reported as MISMATCH when they differ.\n"
+"\n";
+
+// One LLImageRaw operation to time
+struct Benchmark
+{
+    const char* mName;
+    U16 mSrcSize;       // 0 when the operation has no source image
+    S8 mSrcComponents;
+    U16 mDstSize;
+    S8 mDstComponents;
+    std::function<void(LLImageRaw* src, LLImageRaw* dst)> mOperation;
+};
+
+LLPointer<LLImageRaw> create_noise_image(U16 size, S8 components)
+{
+    LLPointer<LLImageRaw> image = new LLImageRaw(size, size, components);
+    U8* data = image->getData();
+    U32 seed = 0x9e3779b9;
+    for (S32 i = 0; i < image->getDataSize(); ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        data[i] = U8(seed >> 24);
+    }
+    return image;
+}
+
+void run_benchmark(const Benchmark& benchmark, S32 iterations)
+{
+    LLPointer<LLImageRaw> src;
+    if (benchmark.mSrcSize)
+    {
+        src = create_noise_image(benchmark.mSrcSize, benchmark.mSrcComponents);
+    }
+    LLPointer<LLImageRaw> initial_dst = create_noise_image(benchmark.mDstSize, benchmark.mDstComponents);
+    LLPointer<LLImageRaw> dst = new LLImageRaw(benchmark.mDstSize, benchmark.mDstSize, benchmark.mDstComponents);
+    std::vector<U8> reference;
+    F64 scalar_ms = 0.0;
+
+    std::cout << std::left << std::setw(18) << benchmark.mName << std::right;
+    if (src)
+    {
+        std::cout << std::setw(4) << benchmark.mSrcSize << " -> ";
+    }
+    else
+    {
+        std::cout << "        ";
+    }
+    std::cout << std::setw(4) << benchmark.mDstSize << " :";
+
+    for (S32 set = LLImageKernels::SCALAR; set < LLImageKernels::INSTRUCTION_SET_COUNT; ++set)
+    {
+        if (!LLImageKernels::isSupported((LLImageKernels::EInstructionSet)set))
+        {
+            continue;
+        }
+        LLImageKernels::setInstructionSet((LLImageKernels::EInstructionSet)set);
+
+        F64 total = 0.0;
+        for (S32 i = 0; i < iterations; ++i)
+        {
+            // in place operations start from the same pixels every time
+            memcpy(dst->getData(), initial_dst->getData(), dst->getDataSize());
+            LLTimer timer;
+            benchmark.mOperation(src, dst);
+            total += timer.getElapsedTimeF64();
+        }
+        const F64 ms = total * 1000.0 / iterations;
+
+        std::cout << "  " << LLImageKernels::getName((LLImageKernels::EInstructionSet)set)
+                  << " " << std::setprecision(3) << ms << " ms";
+        if (set == LLImageKernels::SCALAR)
+        {
+            scalar_ms = ms;
+            reference.assign(dst->getData(), dst->getData() + dst->getDataSize());
+        }
+        else
+        {
+            std::cout << " (" << std::setprecision(1) << scalar_ms / llmax(ms, 0.000001) << "x)";
+            if (memcmp(reference.data(), dst->getData(), reference.size()))
+            {
+                std::cout << " MISMATCH";
+            }
+        }
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    S32 iterations = 20;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+        {
+            std::cout << USAGE << std::endl;
+            return 0;
+        }
+        else if ((!strcmp(argv[arg], "--iterations") || !strcmp(argv[arg], "-n")) && arg < argc-1)
+        {
+            iterations = llmax(1, atoi(argv[++arg]));
+        }
+    }
+
+    ll_init_apr();
+    LLImage::initClass();
+
+    const LLColor3 tint_color(0.8f, 0.6f, 0.4f);
+    auto copy_scaled = [](LLImageRaw* src, LLImageRaw* dst) { dst->copyScaled(src); };
+    auto composite = [](LLImageRaw* src, LLImageRaw* dst) { dst->composite(src); };
+    auto tint = [&tint_color](LLImageRaw*, LLImageRaw* dst) { dst->tint(tint_color); };
+    auto emissive = [](LLImageRaw* src, LLImageRaw* dst) { dst->addEmissive(src); };
+
+    // Sizes the viewer deals with: texture downscaling for discard levels
+    // and thumbnails, and the 256 and 1024 terrain minimap composites
+    const Benchmark benchmarks[] =
+    {
+        { "scale down RGBA",  2048, 4, 1024, 4, copy_scaled },
+        { "scale down RGBA",  1024, 4,  256, 4, copy_scaled },
+        { "scale down RGB",   1024, 3,  512, 3, copy_scaled },
+        { "scale up RGBA",     256, 4, 1024, 4, copy_scaled },
+        { "scale up RGB",      512, 3, 1024, 3, copy_scaled },
+        { "composite",         256, 4,  256, 3, composite },
+        { "composite",        1024, 4, 1024, 3, composite },
+        { "composite scaled",  512, 4, 1024, 3, composite },
+        { "tint RGB",            0, 0, 1024, 3, tint },
+        { "tint RGBA",           0, 0, 1024, 4, tint },
+        { "emissive",          256, 4,  256, 3, emissive },
+        { "emissive",         1024, 4, 1024, 3, emissive },
+    };
+
+    std::cout << std::fixed;
+    for (const Benchmark& benchmark : benchmarks)
+    {
+        run_benchmark(benchmark, iterations);
+    }
+
+    SUBSYSTEM_CLEANUP(LLImage);
+    return 0;
+}
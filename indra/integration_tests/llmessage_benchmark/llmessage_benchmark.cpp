@@ -0,0 +1,339 @@
+/**
+ * @file llmessage_benchmark.cpp
+ * @brief Compares template message reads by name and by LLMessageField.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+#include "llfile.h"
+#include "llhost.h"
+#include "llmessagefield.h"
+#include "llmessagetemplate.h"
+#include "llmessagetemplateparser.h"
+#include "llrand.h"
+#include "lltemplatemessagebuilder.h"
+#include "lltemplatemessagereader.h"
+#include "lltimer.h"
+#include "message.h"
+
+// system libraries
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\tllmessage_benchmark [options] [capture ...]\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -t, --template <file>\n"
+"        Message template to decode with. Default is message_template.msg.\n"
+" -n, --iterations <n>\n"
+"        Number of times each packet is replayed. Default is 1000.\n"
+"\n"
+"Each capture holds UDP packets, each preceded by its size as a little\n"
+"endian U16. Zero coded packets are skipped, so expand them when capturing.\n"
+"Without captures, generated ObjectUpdate, ImprovedTerseObjectUpdate and\n"
+"ObjectUpdateCached packets are used.\n"
+"\n";
+
+typedef std::vector<U8> Packet;
+
+struct Replay
+{
+    std::string mName;
+    std::vector<Packet> mPackets;
+};
+
+// Every variable of a template, in template order, as fields
+typedef std::map<const LLMessageTemplate*, std::vector<LLMessageField> > fields_map_t;
+
+LLTemplateMessageBuilder::message_template_name_map_t sTemplatesByName;
+LLTemplateMessageReader::message_template_number_map_t sTemplatesByNumber;
+fields_map_t sFields;
+
+bool load_templates(const std::string& filename)
+{
+    llifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not open " << filename << std::endl;
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+
+    LLTemplateTokenizer tokens(contents.str());
+    LLTemplateParser parsed(tokens);
+    for (LLTemplateParser::message_iterator iter = parsed.getMessagesBegin();
+         iter != parsed.getMessagesEnd(); ++iter)
+    {
+        LLMessageTemplate* templatep = *iter;
+        sTemplatesByName[templatep->mName] = templatep;
+        sTemplatesByNumber[templatep->mMessageNumber] = templatep;
+
+        std::vector<LLMessageField>& fields = sFields[templatep];
+        for (const LLMessageBlock* block : templatep->mMemberBlocks)
+        {
+            for (const LLMessageVariable* variable : block->mMemberVariables)
+            {
+                fields.emplace_back(block->mName, variable->getName());
+            }
+        }
+    }
+    return !sTemplatesByNumber.empty();
+}
+
+// Builds a message with random contents, objects instances of each
+// variable block and 40 to 80 bytes in each variable length field
+Packet generate_packet(const char* name, S32 objects)
+{
+    Packet packet;
+    LLMessageTemplate* templatep = get_ptr_in_map(sTemplatesByName, LLMessageStringTable::getInstance()->getString(name));
+    if (!templatep)
+    {
+        return packet;
+    }
+
+    LLTemplateMessageBuilder builder(sTemplatesByName);
+    builder.newMessage(templatep->mName);
+    U8 data[256];
+    for (const LLMessageBlock* block : templatep->mMemberBlocks)
+    {
+        S32 count = block->mType == MBT_SINGLE ? 1 : block->mType == MBT_MULTIPLE ? block->mNumber : objects;
+        for (S32 i = 0; i < count; ++i)
+        {
+            builder.nextBlock(block->mName);
+            for (const LLMessageVariable* variable : block->mMemberVariables)
+            {
+                S32 size = variable->getType() == MVT_VARIABLE ? 40 + ll_rand(40) : variable->getSize();
+                for (S32 j = 0; j < size; ++j)
+                {
+                    data[j] = (U8)ll_rand();
+                }
+                builder.addBinaryData(variable->getName(), data, size);
+            }
+        }
+    }
+
+    packet.resize(MAX_BUFFER_SIZE);
+    memset(packet.data(), 0, LL_PACKET_ID_SIZE);
+    packet.resize(builder.buildMessage(packet.data(), (U32)packet.size(), 0));
+    return packet;
+}
+
+bool add_capture(std::vector<Replay>& replays, const std::string& filename)
+{
+    llifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not open " << filename << std::endl;
+        return false;
+    }
+
+    Replay replay;
+    replay.mName = filename;
+    S32 skipped = 0;
+    U8 size_bytes[2];
+    while (file.read((char*)size_bytes, 2))
+    {
+        Packet packet(size_bytes[0] | (size_bytes[1] << 8));
+        if (!file.read((char*)packet.data(), packet.size()))
+        {
+            break;
+        }
+        if (packet.size() < LL_MINIMUM_VALID_PACKET_SIZE || (packet[0] & LL_ZERO_CODE_FLAG))
+        {
+            ++skipped;
+            continue;
+        }
+        replay.mPackets.push_back(std::move(packet));
+    }
+    if (skipped)
+    {
+        std::cout << filename << ": skipped " << skipped << " zero coded or short packets" << std::endl;
+    }
+    replays.push_back(std::move(replay));
+    return true;
+}
+
+enum EReadMode
+{
+    DECODE_ONLY,
+    READ_BY_NAME,
+    READ_BY_FIELD
+};
+
+// Decodes every packet and reads each of its variables the way a handler
+// would. Returns a checksum of the bytes read.
+U32 replay_packets(LLTemplateMessageReader& reader, const Replay& replay, EReadMode mode)
+{
+    static const LLHost host;
+    U8 data[MAX_BUFFER_SIZE];
+    U32 checksum = 0;
+
+    for (const Packet& packet : replay.mPackets)
+    {
+        reader.clearMessage();
+        if (!reader.validateMessage(packet.data(), (S32)packet.size(), host, false, true)
+            || !reader.decodeData(packet.data(), host, true))
+        {
+            continue;
+        }
+        if (mode == DECODE_ONLY)
+        {
+            continue;
+        }
+
+        LLMessageTemplate* templatep = reader.getTemplate();
+        const std::vector<LLMessageField>& fields = sFields[templatep];
+        S32 field = 0;
+        for (const LLMessageBlock* block : templatep->mMemberBlocks)
+        {
+            const S32 count = reader.getNumberOfBlocks(block->mName);
+            for (S32 i = 0; i < count; ++i)
+            {
+                S32 variable_field = field;
+                for (const LLMessageVariable* variable : block->mMemberVariables)
+                {
+                    if (mode == READ_BY_NAME)
+                    {
+                        reader.getBinaryData(block->mName, variable->getName(), data, 0, i, MAX_BUFFER_SIZE);
+                        checksum += reader.getSize(block->mName, i, variable->getName());
+                    }
+                    else
+                    {
+                        reader.getBinaryData(fields[variable_field], data, 0, i, MAX_BUFFER_SIZE);
+                        checksum += reader.getSize(fields[variable_field], i);
+                    }
+                    checksum = checksum * 31 + data[0];
+                    ++variable_field;
+                }
+            }
+            field += (S32)block->mMemberVariables.size();
+        }
+    }
+    return checksum;
+}
+
+void run_benchmark(const Replay& replay, S32 iterations)
+{
+    LLTemplateMessageReader reader(sTemplatesByNumber);
+
+    F64 us[3];
+    U32 checksums[3];
+    for (S32 mode = DECODE_ONLY; mode <= READ_BY_FIELD; ++mode)
+    {
+        LLTimer timer;
+        for (S32 i = 0; i < iterations; ++i)
+        {
+            checksums[mode] = replay_packets(reader, replay, (EReadMode)mode);
+        }
+        us[mode] = timer.getElapsedTimeF64() * 1000000.0 / ((F64)iterations * llmax((size_t)1, replay.mPackets.size()));
+    }
+
+    // time spent reading, on top of decoding
+    const F64 by_name = llmax(us[READ_BY_NAME] - us[DECODE_ONLY], 0.0);
+    const F64 by_field = llmax(us[READ_BY_FIELD] - us[DECODE_ONLY], 0.0);
+    std::cout << std::left << std::setw(28) << replay.mName << std::right
+              << std::setw(7) << replay.mPackets.size() << " packets :"
+              << std::setprecision(2)
+              << "  decode " << us[DECODE_ONLY] << " us"
+              << "  read by name " << by_name << " us"
+              << "  by field " << by_field << " us"
+              << " (" << std::setprecision(1) << by_name / llmax(by_field, 0.001) << "x)";
+    if (checksums[READ_BY_NAME] != checksums[READ_BY_FIELD])
+    {
+        std::cout << " MISMATCH";
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    S32 iterations = 1000;
+    std::string template_file = "message_template.msg";
+    std::vector<std::string> captures;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+        {
+            std::cout << USAGE << std::endl;
+            return 0;
+        }
+        else if ((!strcmp(argv[arg], "--template") || !strcmp(argv[arg], "-t")) && arg < argc-1)
+        {
+            template_file = argv[++arg];
+        }
+        else if ((!strcmp(argv[arg], "--iterations") || !strcmp(argv[arg], "-n")) && arg < argc-1)
+        {
+            iterations = llmax(1, atoi(argv[++arg]));
+        }
+        else
+        {
+            captures.push_back(argv[arg]);
+        }
+    }
+
+    if (!load_templates(template_file))
+    {
+        std::cerr << "No message templates in " << template_file << std::endl;
+        return 1;
+    }
+
+    std::vector<Replay> replays;
+    for (const std::string& capture : captures)
+    {
+        if (!add_capture(replays, capture))
+        {
+            return 1;
+        }
+    }
+
+    if (replays.empty())
+    {
+        for (const char* name : { "ObjectUpdate", "ImprovedTerseObjectUpdate", "ObjectUpdateCached" })
+        {
+            Replay replay;
+            replay.mName = name;
+            for (S32 i = 0; i < 100; ++i)
+            {
+                Packet packet = generate_packet(name, 1 + i % 8);
+                if (!packet.empty())
+                {
+                    replay.mPackets.push_back(std::move(packet));
+                }
+            }
+            replays.push_back(std::move(replay));
+        }
+    }
+
+    std::cout << std::fixed;
+    for (const Replay& replay : replays)
+    {
+        run_benchmark(replay, iterations);
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+/**
+ * @file llsd_benchmark.cpp
+ * @brief Compares the istream and buffer binary LLSD parsers.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+#include "llfile.h"
+#include "llmemorystream.h"
+#include "llsdserialize.h"
+#include "llsdutil.h"
+#include "lltimer.h"
+
+// system libraries
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\tllsd_benchmark [options] [file ...]\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -n, --iterations <n>\n"
+"        Number of times each document is parsed. Default is 1000.\n"
+"\n"
+"Each file should start with a binary LLSD document, for example a mesh\n"
+"asset from the viewer cache or a saved application/llsd+binary capability\n"
+"response. Without files, generated documents shaped like a mesh header, a\n"
+"seed capability response and an inventory fetch response are used.\n"
+"\n";
+
+struct Document
+{
+    std::string mName;
+    std::string mData;
+};
+
+std::string to_binary(const LLSD& sd)
+{
+    std::ostringstream ostr;
+    LLSDSerialize::toBinary(sd, ostr);
+    return ostr.str();
+}
+
+void add_generated_documents(std::vector<Document>& documents)
+{
+    LLUUID id;
+    id.generate();
+
+    LLSD header;
+    header["version"] = 1;
+    header["creator"] = id;
+    header["date"] = LLDate::now();
+    S32 offset = 0;
+    for (const char* block : { "lowest_lod", "low_lod", "medium_lod", "high_lod",
+                               "physics_convex", "physics_mesh", "skin" })
+    {
+        header[block]["offset"] = offset;
+        header[block]["size"] = 4096;
+        offset += 4096;
+    }
+    documents.push_back({ "mesh header", to_binary(header) });
+
+    LLSD capabilities;
+    for (S32 i = 0; i < 120; ++i)
+    {
+        capabilities[llformat("Capability%d", i)] =
+            llformat("https://simhost-0123456789abcdef.agni.lindenlab.com:12043/cap/%s", id.asString().c_str());
+    }
+    documents.push_back({ "seed capabilities", to_binary(capabilities) });
+
+    LLSD items = LLSD::emptyArray();
+    for (S32 i = 0; i < 500; ++i)
+    {
+        LLSD item;
+        item["item_id"] = id;
+        item["parent_id"] = id;
+        item["name"] = llformat("Object %d", i);
+        item["desc"] = "(No Description)";
+        item["type"] = 6;
+        item["inv_type"] = 6;
+        item["flags"] = 0;
+        item["created_at"] = 1700000000 + i;
+        item["permissions"]["owner_mask"] = 0x7fffffff;
+        item["permissions"]["group_mask"] = 0;
+        item["permissions"]["owner_id"] = id;
+        items.append(item);
+    }
+    LLSD inventory;
+    inventory["folders"][0]["items"] = items;
+    documents.push_back({ "inventory fetch", to_binary(inventory) });
+}
+
+bool add_file(std::vector<Document>& documents, const std::string& filename)
+{
+    llifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not open " << filename << std::endl;
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    std::string data = contents.str();
+
+    llssize size = data.size();
+    char* start = strip_deprecated_header(data.data(), size);
+    documents.push_back({ filename, std::string(start, size) });
+    return true;
+}
+
+void run_benchmark(const Document& document, S32 iterations)
+{
+    const U8* data = (const U8*)document.mData.data();
+    const S32 size = (S32)document.mData.size();
+
+    LLSD stream_result;
+    S32 stream_count = 0;
+    LLTimer timer;
+    for (S32 i = 0; i < iterations; ++i)
+    {
+        LLMemoryStream stream(data, size);
+        stream_result.clear();
+        stream_count = LLSDSerialize::fromBinary(stream_result, stream, size);
+    }
+    const F64 stream_us = timer.getElapsedTimeF64() * 1000000.0 / iterations;
+
+    LLSD buffer_result;
+    S32 buffer_count = 0;
+    timer.reset();
+    for (S32 i = 0; i < iterations; ++i)
+    {
+        buffer_result.clear();
+        buffer_count = LLSDSerialize::fromBinary(buffer_result, data, size);
+    }
+    const F64 buffer_us = timer.getElapsedTimeF64() * 1000000.0 / iterations;
+
+    std::cout << std::left << std::setw(24) << document.mName << std::right
+              << std::setw(9) << size << " bytes " << std::setw(7) << stream_count << " values :"
+              << "  istream " << std::setprecision(2) << stream_us << " us"
+              << "  buffer " << buffer_us << " us"
+              << " (" << std::setprecision(1) << stream_us / llmax(buffer_us, 0.001) << "x)";
+    if (stream_count != buffer_count || !llsd_equals(stream_result, buffer_result))
+    {
+        std::cout << " MISMATCH";
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    S32 iterations = 1000;
+    std::vector<Document> documents;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+        {
+            std::cout << USAGE << std::endl;
+            return 0;
+        }
+        else if ((!strcmp(argv[arg], "--iterations") || !strcmp(argv[arg], "-n")) && arg < argc-1)
+        {
+            iterations = llmax(1, atoi(argv[++arg]));
+        }
+        else if (!add_file(documents, argv[arg]))
+        {
+            return 1;
+        }
+    }
+
+    if (documents.empty())
+    {
+        add_generated_documents(documents);
+    }
+
+    std::cout << std::fixed;
+    for (const Document& document : documents)
+    {
+        run_benchmark(document, iterations);
+    }
+    return 0;
+}
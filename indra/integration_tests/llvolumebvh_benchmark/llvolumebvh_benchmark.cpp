@@ -0,0 +1,320 @@
+/**
+ * @file llvolumebvh_benchmark.cpp
+ * @brief Compares raycasts against volume faces through LLVolumeOctree
+ *        and LLVolumeBVH.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+#include "llfile.h"
+#include "llrand.h"
+#include "llsdserialize.h"
+#include "lltimer.h"
+#include "llvolume.h"
+#include "llvolumebvh.h"
+#include "llvolumeoctree.h"
+
+// system libraries
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\tllvolumebvh_benchmark [options] [mesh ...]\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -n, --rays <n>\n"
+"        Number of segments cast at each volume. Default is 10000.\n"
+"\n"
+"Each mesh is a mesh asset, for example from the viewer cache, and is\n"
+"tested with its highest LOD. Without meshes, generated standard prims\n"
+"and a generated high poly mesh are used.\n"
+"\n";
+
+struct Subject
+{
+    std::string mName;
+    LLPointer<LLVolume> mVolume;
+};
+
+LLVolumeParams mesh_params()
+{
+    LLVolumeParams params;
+    params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+    LLUUID id;
+    id.generate();
+    params.setSculptID(id, LL_SCULPT_TYPE_MESH);
+    return params;
+}
+
+// A lumpy sphere of 2 * rings * rings triangles, shaped like a scanned
+// or sculpted mesh rather than a prim
+LLVolume* generate_mesh(S32 rings)
+{
+    LLVolume* volume = new LLVolume(mesh_params(), 1.f);
+    volume->getVolumeFaces().resize(1);
+    LLVolumeFace& face = volume->getVolumeFace(0);
+
+    const S32 num_verts = (rings + 1) * (rings + 1);
+    face.resizeVertices(num_verts);
+    face.resizeIndices(rings * rings * 6);
+
+    S32 v = 0;
+    for (S32 i = 0; i <= rings; ++i)
+    {
+        const F32 theta = F_PI * i / rings;
+        for (S32 j = 0; j <= rings; ++j, ++v)
+        {
+            const F32 phi = F_TWO_PI * j / rings;
+            const F32 radius = 0.45f + 0.05f * sinf(theta * 7.f) * cosf(phi * 5.f) + ll_frand(0.01f);
+            face.mPositions[v].set(radius * sinf(theta) * cosf(phi), radius * sinf(theta) * sinf(phi), radius * cosf(theta));
+            face.mNormals[v] = face.mPositions[v];
+            face.mNormals[v].normalize3fast();
+            face.mTexCoords[v].set((F32)j / rings, (F32)i / rings);
+        }
+    }
+
+    S32 index = 0;
+    for (S32 i = 0; i < rings; ++i)
+    {
+        for (S32 j = 0; j < rings; ++j)
+        {
+            const U16 v0 = (U16)(i * (rings + 1) + j);
+            const U16 v1 = v0 + 1;
+            const U16 v2 = (U16)(v0 + rings + 1);
+            const U16 v3 = v2 + 1;
+            face.mIndices[index++] = v0;
+            face.mIndices[index++] = v2;
+            face.mIndices[index++] = v1;
+            face.mIndices[index++] = v1;
+            face.mIndices[index++] = v2;
+            face.mIndices[index++] = v3;
+        }
+    }
+
+    face.mExtents[0].splat(-0.5f);
+    face.mExtents[1].splat(0.5f);
+    face.mCenter->clear();
+    return volume;
+}
+
+void add_generated_subjects(std::vector<Subject>& subjects)
+{
+    LLVolumeParams torus;
+    torus.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+    subjects.push_back({ "torus", new LLVolume(torus, 4.f) });
+
+    LLVolumeParams sphere;
+    sphere.setType(LL_PCODE_PROFILE_CIRCLE_HALF, LL_PCODE_PATH_CIRCLE);
+    subjects.push_back({ "sphere", new LLVolume(sphere, 4.f) });
+
+    // 256^2 * 2 triangles would overflow the U16 indices
+    subjects.push_back({ "mesh 32k triangles", generate_mesh(128) });
+    subjects.push_back({ "mesh 2k triangles", generate_mesh(32) });
+}
+
+bool add_mesh(std::vector<Subject>& subjects, const std::string& filename)
+{
+    llifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not open " << filename << std::endl;
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    const std::string data = contents.str();
+
+    LLSD header;
+    LLSDBinaryBufferParser parser((const U8*)data.data(), data.size());
+    if (parser.parse(header) <= 0 || !header.isMap())
+    {
+        std::cerr << filename << ": not a mesh asset" << std::endl;
+        return false;
+    }
+    const size_t header_size = parser.getBytesRead();
+
+    for (const char* lod : { "high_lod", "medium_lod", "low_lod", "lowest_lod" })
+    {
+        const size_t offset = header[lod]["offset"].asInteger();
+        const size_t size = header[lod]["size"].asInteger();
+        if (!size || header_size + offset + size > data.size())
+        {
+            continue;
+        }
+
+        LLPointer<LLVolume> volume = new LLVolume(mesh_params(), 1.f);
+        if (volume->unpackVolumeFaces((const U8*)data.data() + header_size + offset, (S32)size))
+        {
+            subjects.push_back({ filename + " " + lod, volume });
+            return true;
+        }
+    }
+    std::cerr << filename << ": no LOD could be unpacked" << std::endl;
+    return false;
+}
+
+struct Counter : public LLOctreeTraveler<LLVolumeTriangle, LLVolumeTriangle*>
+{
+    size_t mBytes = 0;
+
+    virtual void visit(const LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>* branch)
+    {
+        mBytes += sizeof(*branch) + sizeof(LLVolumeOctreeListener) + branch->getElementCount() * sizeof(LLVolumeTriangle*);
+    }
+};
+
+struct Hit
+{
+    S32 mFace;
+    LLVector4a mPoint;
+};
+
+// Casts each segment at the volume through whichever tree LLVolume uses
+F64 cast_segments(LLVolume* volume, const std::vector<LLVector4a>& segments, std::vector<Hit>& hits)
+{
+    hits.resize(segments.size() / 2);
+    LLTimer timer;
+    for (size_t i = 0; i < hits.size(); ++i)
+    {
+        LLVector2 tex_coord;
+        LLVector4a normal;
+        hits[i].mFace = volume->lineSegmentIntersect(segments[i * 2], segments[i * 2 + 1], -1,
+                                                     &hits[i].mPoint, &tex_coord, &normal);
+    }
+    return timer.getElapsedTimeF64() * 1000000.0 / llmax((size_t)1, hits.size());
+}
+
+void run_benchmark(const Subject& subject, S32 rays)
+{
+    LLVolume* volume = subject.mVolume;
+    const S32 num_faces = volume->getNumVolumeFaces();
+    U32 triangles = 0;
+    for (S32 i = 0; i < num_faces; ++i)
+    {
+        triangles += volume->getVolumeFace(i).mNumIndices / 3;
+    }
+
+    // Segments through the unit box from outside it
+    std::vector<LLVector4a> segments(rays * 2);
+    for (LLVector4a& point : segments)
+    {
+        point.set(ll_frand(4.f) - 2.f, ll_frand(4.f) - 2.f, ll_frand(4.f) - 2.f);
+    }
+
+    // Build times
+    LLTimer timer;
+    size_t octree_bytes = 0;
+    for (S32 i = 0; i < num_faces; ++i)
+    {
+        LLVolumeFace& face = volume->getVolumeFace(i);
+        face.createOctree();
+    }
+    const F64 octree_build_ms = timer.getElapsedTimeF64() * 1000.0;
+    for (S32 i = 0; i < num_faces; ++i)
+    {
+        const LLVolumeFace& face = volume->getVolumeFace(i);
+        Counter counter;
+        counter.traverse(face.getOctree());
+        octree_bytes += counter.mBytes + face.mNumIndices / 3 * sizeof(LLVolumeTriangle);
+    }
+
+    timer.reset();
+    size_t bvh_bytes = 0;
+    for (S32 i = 0; i < num_faces; ++i)
+    {
+        LLVolumeFace& face = volume->getVolumeFace(i);
+        face.createBVH();
+        bvh_bytes += face.getBVH()->getMemoryUsage();
+    }
+    const F64 bvh_build_ms = timer.getElapsedTimeF64() * 1000.0;
+
+    std::vector<Hit> octree_hits;
+    LLVolume::sUseBVH = false;
+    const F64 octree_us = cast_segments(volume, segments, octree_hits);
+
+    std::vector<Hit> bvh_hits;
+    LLVolume::sUseBVH = true;
+    const F64 bvh_us = cast_segments(volume, segments, bvh_hits);
+
+    S32 mismatches = 0;
+    S32 num_hits = 0;
+    for (size_t i = 0; i < octree_hits.size(); ++i)
+    {
+        num_hits += octree_hits[i].mFace >= 0;
+        if (octree_hits[i].mFace != bvh_hits[i].mFace
+            || (octree_hits[i].mFace >= 0 && !octree_hits[i].mPoint.equals3(bvh_hits[i].mPoint, 0.0001f)))
+        {
+            ++mismatches;
+        }
+    }
+
+    std::cout << std::left << std::setw(28) << subject.mName << std::right
+              << std::setw(8) << triangles << " tris " << std::setw(6) << num_hits << " hits :"
+              << std::setprecision(2)
+              << "  build octree " << octree_build_ms << " ms bvh " << bvh_build_ms << " ms"
+              << "  memory octree " << octree_bytes / 1024 << " KB bvh " << bvh_bytes / 1024 << " KB"
+              << "  cast octree " << octree_us << " us bvh " << bvh_us << " us"
+              << " (" << std::setprecision(1) << octree_us / llmax(bvh_us, 0.001) << "x)";
+    if (mismatches)
+    {
+        std::cout << " MISMATCH " << mismatches;
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    S32 rays = 10000;
+    std::vector<Subject> subjects;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+        {
+            std::cout << USAGE << std::endl;
+            return 0;
+        }
+        else if ((!strcmp(argv[arg], "--rays") || !strcmp(argv[arg], "-n")) && arg < argc-1)
+        {
+            rays = llmax(1, atoi(argv[++arg]));
+        }
+        else if (!add_mesh(subjects, argv[arg]))
+        {
+            return 1;
+        }
+    }
+
+    if (subjects.empty())
+    {
+        add_generated_subjects(subjects);
+    }
+
+    std::cout << std::fixed;
+    for (const Subject& subject : subjects)
+    {
+        run_benchmark(subject, rays);
+    }
+    return 0;
+}
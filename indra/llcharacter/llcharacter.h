@@ -155,8 +155,11 @@ class LLCharacter
     virtual void requestStopMotion( LLMotion* motion );
 
     // periodic update function, steps the motion controller
+    // with defer_blend, the new pose is applied by applyDeferredBlend()
     enum e_update_t { NORMAL_UPDATE, HIDDEN_UPDATE, FORCE_UPDATE };
-    void updateMotions(e_update_t update_type);
+    void updateMotions(e_update_t update_type, bool defer_blend = false);
+    void applyDeferredBlend() { mMotionController.applyDeferredBlend(); }
+    void cancelDeferredBlend() { mMotionController.cancelDeferredBlend(); }
 
     LLAnimPauseRequest requestPause();
     BOOL areAnimationsPaused() const { return mMotionController.isPaused(); }
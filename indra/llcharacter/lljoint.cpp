@@ -35,8 +35,8 @@
 #include "llcallstack.h"
 #include <boost/algorithm/string.hpp>
 
-S32 LLJoint::sNumUpdates = 0;
-S32 LLJoint::sNumTouches = 0;
+std::atomic<S32> LLJoint::sNumUpdates(0);
+std::atomic<S32> LLJoint::sNumTouches(0);
 
 template <class T>
 bool attachment_map_iter_compare_key(const T& a, const T& b)
@@ -200,7 +200,7 @@ void LLJoint::touch(U32 flags)
 {
     if ((flags | mDirtyFlags) != mDirtyFlags)
     {
-        sNumTouches++;
+        sNumTouches.fetch_add(1, std::memory_order_relaxed);
         mDirtyFlags |= flags;
         U32 child_flags = flags;
         if (flags & ROTATION_DIRTY)
@@ -1023,7 +1023,7 @@ void LLJoint::updateWorldMatrix()
 {
     if (mDirtyFlags & MATRIX_DIRTY)
     {
-        sNumUpdates++;
+        sNumUpdates.fetch_add(1, std::memory_order_relaxed);
         mXform.updateMatrix(FALSE);
         mWorldMatrix = mXform.getWorldMatrix();
         mDirtyFlags = 0x0;
@@ -30,6 +30,7 @@
 //-----------------------------------------------------------------------------
 // Header Files
 //-----------------------------------------------------------------------------
+#include <atomic>
 #include <string>
 #include <list>
 
@@ -158,9 +159,9 @@ class LLJoint
     typedef std::vector<LLJoint*> joints_t;
     joints_t mChildren;
 
-    // debug statics
-    static S32      sNumTouches;
-    static S32      sNumUpdates;
+    // debug statics, atomic as avatars may be posed in parallel
+    static std::atomic<S32> sNumTouches;
+    static std::atomic<S32> sNumUpdates;
     typedef std::set<std::string> debug_joint_name_t;
     static debug_joint_name_t s_debugJointNames;
     static void setDebugJointNames(const debug_joint_name_t& names);
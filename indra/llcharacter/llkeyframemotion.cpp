@@ -130,7 +130,34 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 //-----------------------------------------------------------------------------
 // JointMotion::update()
 //-----------------------------------------------------------------------------
-void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration)
+static void sample_vector_curve(LLKeyframeMotion::PositionCurve& curve, F32 time, U32& cursor,
+                                LLJointState* joint_state, U32 usage, LLKeyframeMotion::KeyframeSamples& samples)
+{
+    LLVector3 value;
+    if (!curve.mKeys.empty())
+    {
+        const LLKeyframeMotion::PositionKey* before = NULL;
+        const LLKeyframeMotion::PositionKey* after = NULL;
+        F32 u = 0.f;
+        if (curve.getKeys(time, curve.findKey(time, cursor), before, after, u))
+        {
+            samples.addVector(joint_state, usage, before->mValue, after->mValue, u);
+            return;
+        }
+        value = before->mValue;
+    }
+
+    if (usage == LLJointState::POS)
+    {
+        joint_state->setPosition(value);
+    }
+    else
+    {
+        joint_state->setScale(value);
+    }
+}
+
+void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration, U32 cursors[NUM_CURSORS], KeyframeSamples& samples)
 {
     // this value being 0 is the cause of https://jira.lindenlab.com/browse/SL-22678 but I haven't
     // managed to get a stack to see how it got here. Testing for 0 here will stop the crash.
@@ -146,7 +173,7 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
     //-------------------------------------------------------------------------
     if ((usage & LLJointState::SCALE) && mScaleCurve.mNumKeys)
     {
-        joint_state->setScale( mScaleCurve.getValue( time, duration ) );
+        sample_vector_curve(mScaleCurve, time, cursors[SCALE_CURSOR], joint_state, LLJointState::SCALE, samples);
     }
 
     //-------------------------------------------------------------------------
@@ -154,7 +181,21 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
     //-------------------------------------------------------------------------
     if ((usage & LLJointState::ROT) && mRotationCurve.mNumKeys)
     {
-        joint_state->setRotation( mRotationCurve.getValue( time, duration ) );
+        const RotationKey* before = NULL;
+        const RotationKey* after = NULL;
+        F32 u = 0.f;
+        if (mRotationCurve.mKeys.empty())
+        {
+            joint_state->setRotation(LLQuaternion());
+        }
+        else if (mRotationCurve.getKeys(time, mRotationCurve.findKey(time, cursors[ROTATION_CURSOR]), before, after, u))
+        {
+            samples.addRotation(joint_state, before->mValue, after->mValue, u);
+        }
+        else
+        {
+            joint_state->setRotation(before->mValue);
+        }
     }
 
     //-------------------------------------------------------------------------
@@ -162,10 +203,71 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
     //-------------------------------------------------------------------------
     if ((usage & LLJointState::POS) && mPositionCurve.mNumKeys)
     {
-        joint_state->setPosition( mPositionCurve.getValue( time, duration ) );
+        sample_vector_curve(mPositionCurve, time, cursors[POSITION_CURSOR], joint_state, LLJointState::POS, samples);
     }
 }
 
+//-----------------------------------------------------------------------------
+// KeyframeSamples
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::KeyframeSamples::clear()
+{
+    mVectorBefore.clear();
+    mVectorAfter.clear();
+    mVectorU.clear();
+    mVectorJointStates.clear();
+    mVectorUsage.clear();
+
+    mRotationBefore.clear();
+    mRotationAfter.clear();
+    mRotationU.clear();
+    mRotationJointStates.clear();
+}
+
+void LLKeyframeMotion::KeyframeSamples::addVector(LLJointState* joint_state, U32 usage, const LLVector3& before, const LLVector3& after, F32 u)
+{
+    mVectorBefore.emplace_back();
+    mVectorBefore.back().load3(before.mV);
+    mVectorAfter.emplace_back();
+    mVectorAfter.back().load3(after.mV);
+    mVectorU.push_back(u);
+    mVectorJointStates.push_back(joint_state);
+    mVectorUsage.push_back(usage);
+}
+
+void LLKeyframeMotion::KeyframeSamples::addRotation(LLJointState* joint_state, const LLQuaternion& before, const LLQuaternion& after, F32 u)
+{
+    mRotationBefore.emplace_back(before);
+    mRotationAfter.emplace_back(after);
+    mRotationU.push_back(u);
+    mRotationJointStates.push_back(joint_state);
+}
+
+void LLKeyframeMotion::KeyframeSamples::apply()
+{
+    LLVector4a vector;
+    for (size_t i = 0, count = mVectorU.size(); i < count; ++i)
+    {
+        vector.setLerp(mVectorBefore[i], mVectorAfter[i], mVectorU[i]);
+        if (mVectorUsage[i] == LLJointState::POS)
+        {
+            mVectorJointStates[i]->setPosition(LLVector3(vector.getF32ptr()));
+        }
+        else
+        {
+            mVectorJointStates[i]->setScale(LLVector3(vector.getF32ptr()));
+        }
+    }
+
+    LLQuaternion2 rotation;
+    for (size_t i = 0, count = mRotationU.size(); i < count; ++i)
+    {
+        rotation.setNlerp(mRotationU[i], mRotationBefore[i], mRotationAfter[i]);
+        mRotationJointStates[i]->setRotation(LLQuaternion(rotation.getVector4a().getF32ptr()));
+    }
+
+    clear();
+}
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -484,13 +586,22 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 //-----------------------------------------------------------------------------
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
-    llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
-    for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
+    const U32 num_joint_motions = mJointMotionList->getNumJointMotions();
+    llassert_always (num_joint_motions <= mJointStates.size());
+    if (mKeyCursors.size() < num_joint_motions * JointMotion::NUM_CURSORS)
+    {
+        mKeyCursors.resize(num_joint_motions * JointMotion::NUM_CURSORS, 0);
+    }
+
+    for (U32 i=0; i<num_joint_motions; i++)
     {
         mJointMotionList->getJointMotion(i)->update(mJointStates[i],
                                                       time,
-                                                      mJointMotionList->mDuration );
+                                                      mJointMotionList->mDuration,
+                                                      &mKeyCursors[i * JointMotion::NUM_CURSORS],
+                                                      mKeyframeSamples);
     }
+    mKeyframeSamples.apply();
 
     LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
     if (pose_priority)
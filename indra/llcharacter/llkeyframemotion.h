@@ -39,6 +39,7 @@
 #include "lljointstate.h"
 #include "llmotion.h"
 #include "llquaternion.h"
+#include "llvector4a.h"
 #include "v3dmath.h"
 #include "v3math.h"
 #include "llbvhconsts.h"
@@ -308,57 +309,95 @@ class LLKeyframeMotion :
             T           mValue;
         };
 
-        T interp(F32 u, Key& before, Key& after)
+        T getValue(F32 time, F32 duration)
         {
-            switch (mInterpolationType)
+            if (mKeys.empty())
             {
-            case IT_STEP:
-                return before.mValue;
-            default:
-            case IT_LINEAR:
-            case IT_SPLINE:
-                return LLKeyframeMotionLerp::lerp(u, before.mValue, after.mValue);
+                return T();
             }
+
+            typename key_map_t::iterator right = std::lower_bound(mKeys.begin(), mKeys.end(), time, [](const auto& a, const auto& b) { return a.first < b; });
+            return getValueAt(time, right - mKeys.begin());
         }
 
-        T getValue(F32 time, F32 duration)
+        // As above, starting the key search from cursor, the key found for
+        // the previous frame of the same playback, and updating it
+        T getValue(F32 time, F32 duration, U32& cursor)
         {
             if (mKeys.empty())
             {
                 return T();
             }
+            return getValueAt(time, findKey(time, cursor));
+        }
 
-            T value;
-            typename key_map_t::iterator right = std::lower_bound(mKeys.begin(), mKeys.end(), time, [](const auto& a, const auto& b) { return a.first < b; });
-            if (right == mKeys.end())
-            {
-                // Past last key
-                --right;
-                value = right->second.mValue;
-            }
-            else if (right == mKeys.begin() || right->first == time)
+        // Index of the first key at or after time, as std::lower_bound finds
+        // it. Playback mostly moves on by a key or none between frames, so
+        // this starts from cursor, the previous result, and stores the new
+        // one there.
+        size_t findKey(F32 time, U32& cursor) const
+        {
+            typename key_map_t::const_iterator first = mKeys.begin();
+            typename key_map_t::const_iterator last = mKeys.end();
+            typename key_map_t::const_iterator right = first + llmin((size_t)cursor, mKeys.size());
+            if (right != first && (right - 1)->first >= time)
             {
-                // Before first key or exactly on a key
-                value = right->second.mValue;
+                // went back, usually by looping
+                right = std::lower_bound(first, right, time, [](const auto& a, const auto& b) { return a.first < b; });
             }
             else
             {
-                // Between two keys
-                typename key_map_t::iterator left = right; --left;
-                F32 index_before = left->first;
-                F32 index_after = right->first;
-                Key& pos_before = left->second;
-                Key& pos_after = right->second;
-                if (right == mKeys.end())
+                for (S32 step = 0; step < 2 && right != last && right->first < time; ++step)
                 {
-                    pos_after = mLoopInKey;
-                    index_after = duration;
+                    ++right;
                 }
+                if (right != last && right->first < time)
+                {
+                    right = std::lower_bound(right, last, time, [](const auto& a, const auto& b) { return a.first < b; });
+                }
+            }
+            cursor = (U32)(right - first);
+            return cursor;
+        }
 
-                F32 u = (time - index_before) / (index_after - index_before);
-                value = interp(u, pos_before, pos_after);
+        // The keys around time, given the index of the first key at or after
+        // it. Returns false when the value is simply before's, otherwise it is
+        // interpolated u of the way from before to after.
+        bool getKeys(F32 time, size_t right, const Key*& before, const Key*& after, F32& u) const
+        {
+            typename key_map_t::const_iterator right_iter = mKeys.begin() + right;
+            if (right_iter == mKeys.end())
+            {
+                // Past last key
+                --right_iter;
+                before = &right_iter->second;
+                return false;
+            }
+            else if (right_iter == mKeys.begin() || right_iter->first == time)
+            {
+                // Before first key or exactly on a key
+                before = &right_iter->second;
+                return false;
             }
-            return value;
+
+            // Between two keys
+            typename key_map_t::const_iterator left_iter = right_iter - 1;
+            before = &left_iter->second;
+            after = &right_iter->second;
+            u = (time - left_iter->first) / (right_iter->first - left_iter->first);
+            return mInterpolationType != IT_STEP;
+        }
+
+        T getValueAt(F32 time, size_t right)
+        {
+            const Key* before = NULL;
+            const Key* after = NULL;
+            F32 u = 0.f;
+            if (!getKeys(time, right, before, after, u))
+            {
+                return before->mValue;
+            }
+            return LLKeyframeMotionLerp::lerp(u, before->mValue, after->mValue);
         }
 
         InterpolationType   mInterpolationType = LLKeyframeMotion::IT_LINEAR;
@@ -376,6 +415,8 @@ class LLKeyframeMotion :
     typedef Curve<LLVector3> PositionCurve;
     typedef PositionCurve::Key PositionKey;
 
+    class KeyframeSamples;
+
     //-------------------------------------------------------------------------
     // JointMotion
     //-------------------------------------------------------------------------
@@ -389,7 +430,35 @@ class LLKeyframeMotion :
         U32             mUsage;
         LLJoint::JointPriority  mPriority;
 
-        void update(LLJointState* joint_state, F32 time, F32 duration);
+        enum { POSITION_CURSOR, ROTATION_CURSOR, SCALE_CURSOR, NUM_CURSORS };
+
+        // Sets the joint state to the curves at time. Values between keys
+        // are left in samples to be interpolated with the other joints'.
+        void update(LLJointState* joint_state, F32 time, F32 duration, U32 cursors[NUM_CURSORS], KeyframeSamples& samples);
+    };
+
+    // Keyframes found by applyKeyframes() that still need interpolating,
+    // gathered into parallel arrays so that they can be interpolated in one
+    // pass per kind
+    class KeyframeSamples
+    {
+    public:
+        void clear();
+        void addVector(LLJointState* joint_state, U32 usage, const LLVector3& before, const LLVector3& after, F32 u);
+        void addRotation(LLJointState* joint_state, const LLQuaternion& before, const LLQuaternion& after, F32 u);
+        void apply();
+
+    private:
+        std::vector<LLVector4a> mVectorBefore;
+        std::vector<LLVector4a> mVectorAfter;
+        std::vector<F32>        mVectorU;
+        std::vector<LLJointState*> mVectorJointStates;
+        std::vector<U32>        mVectorUsage; // LLJointState::POS or SCALE
+
+        std::vector<LLQuaternion2> mRotationBefore;
+        std::vector<LLQuaternion2> mRotationAfter;
+        std::vector<F32>        mRotationU;
+        std::vector<LLJointState*> mRotationJointStates;
     };
 
     //-------------------------------------------------------------------------
@@ -434,6 +503,10 @@ class LLKeyframeMotion :
     F32                             mLastUpdateTime;
     F32                             mLastLoopedTime;
     AssetStatus                     mAssetStatus;
+    // the key each curve was at last update, JointMotion::NUM_CURSORS per
+    // joint motion
+    std::vector<U32>                mKeyCursors;
+    KeyframeSamples                 mKeyframeSamples;
 
 public:
     void setCharacter(LLCharacter* character) { mCharacter = character; }
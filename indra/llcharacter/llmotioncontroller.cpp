@@ -129,6 +129,7 @@ LLMotionController::LLMotionController()
       mTimeStep(0.f),
       mTimeStepCount(0),
       mLastInterp(0.f),
+      mBlendDeferred(false),
       mIsSelf(FALSE),
       mLastCountAfterPurge(0)
 {
@@ -808,7 +809,7 @@ void LLMotionController::updateLoadingMotions()
 //-----------------------------------------------------------------------------
 // updateMotion()
 //-----------------------------------------------------------------------------
-void LLMotionController::updateMotions(bool force_update)
+void LLMotionController::updateMotions(bool force_update, bool defer_blend)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
     // SL-763: "Distant animated objects run at super fast speed"
@@ -888,6 +889,10 @@ void LLMotionController::updateMotions(bool force_update)
         {
             mPoseBlender.blendAndCache(TRUE);
         }
+        else if (defer_blend)
+        {
+            mBlendDeferred = true;
+        }
         else
         {
             mPoseBlender.blendAndApply();
@@ -898,6 +903,19 @@ void LLMotionController::updateMotions(bool force_update)
 //  LL_INFOS() << "Motion controller time " << motionTimer.getElapsedTimeF32() << LL_ENDL;
 }
 
+//-----------------------------------------------------------------------------
+// applyDeferredBlend()
+//-----------------------------------------------------------------------------
+void LLMotionController::applyDeferredBlend()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    if (mBlendDeferred)
+    {
+        mBlendDeferred = false;
+        mPoseBlender.blendAndApply();
+    }
+}
+
 //-----------------------------------------------------------------------------
 // updateMotionsMinimal()
 // minimal update (e.g. while hidden)
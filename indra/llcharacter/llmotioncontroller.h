@@ -134,7 +134,18 @@ class LLMotionController
     // invokes the update handlers for each active motion
     // activates sequenced motions
     // deactivates terminated motions`
-    void updateMotions(bool force_update = false);
+    // with defer_blend, the new pose is only blended and applied to the
+    // joints by applyDeferredBlend()
+    void updateMotions(bool force_update = false, bool defer_blend = false);
+
+    // applies the pose of an updateMotions() that deferred it. Only touches
+    // the joints of this controller's character, so controllers of
+    // different characters may do this concurrently.
+    void applyDeferredBlend();
+
+    // drops the pose of an updateMotions() that deferred it, e.g. when the
+    // character goes away before it is applied
+    void cancelDeferredBlend() { mBlendDeferred = false; }
 
     // minimal update (e.g. while hidden)
     void updateMotionsMinimal();
@@ -230,6 +241,7 @@ class LLMotionController
     F32                 mTimeStep;
     S32                 mTimeStepCount;
     F32                 mLastInterp;
+    bool                mBlendDeferred;
 
     U8                  mJointSignature[2][LL_CHARACTER_MAX_ANIMATED_JOINTS];
 private:
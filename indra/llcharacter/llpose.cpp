@@ -169,6 +169,7 @@ S32 LLPose::getNumJointStates() const
 //-----------------------------------------------------------------------------
 
 LLJointStateBlender::LLJointStateBlender()
+    : mActive(false)
 {
     for(S32 i = 0; i < JSB_NUM_JOINT_STATES; i++)
     {
@@ -242,15 +243,21 @@ void LLJointStateBlender::blendJointStates(BOOL apply_now)
     F32             sum_weights[3];
     U32             sum_usage = 0;
 
-    LLVector3       blended_pos = target_joint->getPosition();
-    LLQuaternion    blended_rot = target_joint->getRotation();
-    LLVector3       blended_scale = target_joint->getScale();
+    // blended in SIMD registers, converted from and to the joint's values only once
+    LLVector4a      blended_pos;
+    LLQuaternion2   blended_rot(target_joint->getRotation());
+    LLVector4a      blended_scale;
+    blended_pos.load3(target_joint->getPosition().mV);
+    blended_scale.load3(target_joint->getScale().mV);
 
-    LLVector3       added_pos;
-    LLQuaternion    added_rot;
-    LLVector3       added_scale;
+    LLVector4a      added_pos;
+    LLQuaternion2   added_rot(LLQuaternion::DEFAULT);
+    LLVector4a      added_scale;
+    added_pos.clear();
+    added_scale.clear();
 
-    //S32               joint_state_index;
+    LLVector4a      value;
+    LLQuaternion2   rotation;
 
     sum_weights[POS_WEIGHT] = 0.f;
     sum_weights[ROT_WEIGHT] = 0.f;
@@ -276,7 +283,9 @@ void LLJointStateBlender::blendJointStates(BOOL apply_now)
                 F32 new_weight_sum = llmin(1.f, current_weight + sum_weights[POS_WEIGHT]);
 
                 // add in pos for this jointstate modulated by weight
-                added_pos += jsp->getPosition() * (new_weight_sum - sum_weights[POS_WEIGHT]);
+                value.load3(jsp->getPosition().mV);
+                value.mul(new_weight_sum - sum_weights[POS_WEIGHT]);
+                added_pos.add(value);
             }
 
             if(current_usage & LLJointState::SCALE)
@@ -284,7 +293,9 @@ void LLJointStateBlender::blendJointStates(BOOL apply_now)
                 F32 new_weight_sum = llmin(1.f, current_weight + sum_weights[SCALE_WEIGHT]);
 
                 // add in scale for this jointstate modulated by weight
-                added_scale += jsp->getScale() * (new_weight_sum - sum_weights[SCALE_WEIGHT]);
+                value.load3(jsp->getScale().mV);
+                value.mul(new_weight_sum - sum_weights[SCALE_WEIGHT]);
+                added_scale.add(value);
             }
 
             if (current_usage & LLJointState::ROT)
@@ -292,7 +303,9 @@ void LLJointStateBlender::blendJointStates(BOOL apply_now)
                 F32 new_weight_sum = llmin(1.f, current_weight + sum_weights[ROT_WEIGHT]);
 
                 // add in rotation for this jointstate modulated by weight
-                added_rot = nlerp((new_weight_sum - sum_weights[ROT_WEIGHT]), added_rot, jsp->getRotation()) * added_rot;
+                rotation.setNlerp((new_weight_sum - sum_weights[ROT_WEIGHT]), added_rot, LLQuaternion2(jsp->getRotation()));
+                rotation.mul(added_rot);
+                added_rot = rotation;
             }
         }
         else
@@ -302,18 +315,19 @@ void LLJointStateBlender::blendJointStates(BOOL apply_now)
             // blend position
             if(current_usage & LLJointState::POS)
             {
+                value.load3(jsp->getPosition().mV);
                 if(sum_usage & LLJointState::POS)
                 {
                     F32 new_weight_sum = llmin(1.f, current_weight + sum_weights[POS_WEIGHT]);
 
                     // blend positions from both
-                    blended_pos = lerp(jsp->getPosition(), blended_pos, sum_weights[POS_WEIGHT] / new_weight_sum);
+                    blended_pos.setLerp(value, blended_pos, sum_weights[POS_WEIGHT] / new_weight_sum);
                     sum_weights[POS_WEIGHT] = new_weight_sum;
                 }
                 else
                 {
                     // copy position from current
-                    blended_pos = jsp->getPosition();
+                    blended_pos = value;
                     sum_weights[POS_WEIGHT] = current_weight;
                 }
             }
@@ -321,18 +335,19 @@ void LLJointStateBlender::blendJointStates(BOOL apply_now)
             // now do scale
             if(current_usage & LLJointState::SCALE)
             {
+                value.load3(jsp->getScale().mV);
                 if(sum_usage & LLJointState::SCALE)
                 {
                     F32 new_weight_sum = llmin(1.f, current_weight + sum_weights[SCALE_WEIGHT]);
 
                     // blend scales from both
-                    blended_scale = lerp(jsp->getScale(), blended_scale, sum_weights[SCALE_WEIGHT] / new_weight_sum);
+                    blended_scale.setLerp(value, blended_scale, sum_weights[SCALE_WEIGHT] / new_weight_sum);
                     sum_weights[SCALE_WEIGHT] = new_weight_sum;
                 }
                 else
                 {
                     // copy scale from current
-                    blended_scale = jsp->getScale();
+                    blended_scale = value;
                     sum_weights[SCALE_WEIGHT] = current_weight;
                 }
             }
@@ -345,7 +360,8 @@ void LLJointStateBlender::blendJointStates(BOOL apply_now)
                     F32 new_weight_sum = llmin(1.f, current_weight + sum_weights[ROT_WEIGHT]);
 
                     // blend rotations from both
-                    blended_rot = nlerp(sum_weights[ROT_WEIGHT] / new_weight_sum, jsp->getRotation(), blended_rot);
+                    rotation.setNlerp(sum_weights[ROT_WEIGHT] / new_weight_sum, LLQuaternion2(jsp->getRotation()), blended_rot);
+                    blended_rot = rotation;
                     sum_weights[ROT_WEIGHT] = new_weight_sum;
                 }
                 else
@@ -361,21 +377,24 @@ void LLJointStateBlender::blendJointStates(BOOL apply_now)
         }
     }
 
-    if (!added_scale.isFinite())
+    if (!added_scale.isFinite3())
     {
-        added_scale.clearVec();
+        added_scale.clear();
     }
 
-    if (!blended_scale.isFinite())
+    if (!blended_scale.isFinite3())
     {
-        blended_scale.setVec(1,1,1);
+        blended_scale.splat(1.f);
     }
 
     // apply transforms
     // SL-315
-    target_joint->setPosition(blended_pos + added_pos);
-    target_joint->setScale(blended_scale + added_scale);
-    target_joint->setRotation(added_rot * blended_rot);
+    value.setAdd(blended_pos, added_pos);
+    target_joint->setPosition(LLVector3(value.getF32ptr()));
+    value.setAdd(blended_scale, added_scale);
+    target_joint->setScale(LLVector3(value.getF32ptr()));
+    added_rot.mul(blended_rot);
+    target_joint->setRotation(LLQuaternion(added_rot.getVector4a().getF32ptr()));
 
     if (apply_now)
     {
@@ -487,9 +506,10 @@ BOOL LLPoseBlender::addMotion(LLMotion* motion)
         }
 
         // add it to our list of active blenders
-        if (std::find(mActiveBlenders.begin(), mActiveBlenders.end(), joint_blender) == mActiveBlenders.end())
+        if (!joint_blender->mActive)
         {
-            mActiveBlenders.push_front(joint_blender);
+            joint_blender->mActive = true;
+            mActiveBlenders.push_back(joint_blender);
         }
     }
     return TRUE;
@@ -503,6 +523,7 @@ void LLPoseBlender::blendAndApply()
     for (LLJointStateBlender* jsbp : mActiveBlenders)
     {
         jsbp->blendJointStates();
+        jsbp->mActive = false;
     }
 
     // we're done now so there are no more active blenders for this frame
@@ -549,6 +570,7 @@ void LLPoseBlender::clearBlenders()
     {
         LLJointStateBlender* jsbp = *iter;
         jsbp->clear();
+        jsbp->mActive = false;
     }
 
     mActiveBlenders.clear();
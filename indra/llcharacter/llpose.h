@@ -101,6 +101,7 @@ class LLJointStateBlender
 
 public:
     LL_ALIGN_16(LLJoint mJointCache);
+    bool            mActive; // in LLPoseBlender's active blenders
 } LL_ALIGN_POSTFIX(16);
 
 class LLMotion;
@@ -108,7 +109,7 @@ class LLMotion;
 class LLPoseBlender
 {
 protected:
-    typedef std::list<LLJointStateBlender*> blender_list_t;
+    typedef std::vector<LLJointStateBlender*> blender_list_t;
     typedef boost::unordered_flat_map<LLJoint*,LLJointStateBlender*> blender_map_t;
     blender_map_t mJointStateBlenderPool;
     blender_list_t mActiveBlenders;
@@ -124,6 +124,7 @@ namespace
         eSSE4_1_Features = 38,
         eSSE4_2_Features = 39,
         eSSE4a_Features = 40,
+        eAVX2_Features = 41,
     };
 
     const char* cpu_feature_names[] =
@@ -171,6 +172,7 @@ namespace
         "SSE4.1 Instructions",
         "SSE4.2 Instructions",
         "SSE4a Instructions",
+        "AVX2 Instructions",
     };
 
     std::string intel_CPUFamilyName(int composed_family)
@@ -284,6 +286,11 @@ class LLProcessorInfoImpl
         return hasExtension(cpu_feature_names[eSSE4a_Features]);
     }
 
+    bool hasAVX2() const
+    {
+        return hasExtension(cpu_feature_names[eAVX2_Features]);
+    }
+
     bool hasAltivec() const
     {
         return hasExtension("Altivec");
@@ -620,6 +627,17 @@ class LLProcessorInfoWindowsImpl : public LLProcessorInfoImpl
                     setExtension(cpu_feature_names[index]);
                 }
             }
+
+            // AVX2 is only usable if the OS saves the ymm registers (OSXSAVE and XCR0)
+            const bool os_saves_ymm = (cpu_info[2] & 0x8000000) && ((_xgetbv(0) & 0x6) == 0x6);
+            if (os_saves_ymm && ids >= 7)
+            {
+                __cpuidex(cpu_info, 7, 0);
+                if (cpu_info[1] & 0x20)
+                {
+                    setExtension(cpu_feature_names[eAVX2_Features]);
+                }
+            }
         }
 
         // Get the brand string of the cpu.
@@ -815,6 +833,19 @@ class LLProcessorInfoDarwinImpl : public LLProcessorInfoImpl
             // Not supposed to happen?
             setExtension(cpu_feature_names[eSSE4a_Features]);
         }
+
+        char leaf7_features[1024];
+        len = sizeof(leaf7_features);
+        memset(leaf7_features, 0, len);
+        sysctlbyname("machdep.cpu.leaf7_features", (void*)leaf7_features, &len, NULL, 0);
+
+        std::string leaf7_features_str(leaf7_features);
+        leaf7_features_str = " " + leaf7_features_str + " ";
+
+        if (leaf7_features_str.find(" AVX2 ") != std::string::npos)
+        {
+            setExtension(cpu_feature_names[eAVX2_Features]);
+        }
     }
 };
 
@@ -951,6 +982,11 @@ class LLProcessorInfoLinuxImpl : public LLProcessorInfoImpl
             setExtension(cpu_feature_names[eSSE4a_Features]);
         }
 
+        if (flags.find(" avx2 ") != std::string::npos)
+        {
+            setExtension(cpu_feature_names[eAVX2_Features]);
+        }
+
 # endif // LL_X86
     }
 
@@ -1014,6 +1050,7 @@ bool LLProcessorInfo::hasSSE3S() const { return mImpl->hasSSE3S(); }
 bool LLProcessorInfo::hasSSE41() const { return mImpl->hasSSE41(); }
 bool LLProcessorInfo::hasSSE42() const { return mImpl->hasSSE42(); }
 bool LLProcessorInfo::hasSSE4a() const { return mImpl->hasSSE4a(); }
+bool LLProcessorInfo::hasAVX2() const { return mImpl->hasAVX2(); }
 bool LLProcessorInfo::hasAltivec() const { return mImpl->hasAltivec(); }
 std::string LLProcessorInfo::getCPUFamilyName() const { return mImpl->getCPUFamilyName(); }
 std::string LLProcessorInfo::getCPUBrandName() const { return mImpl->getCPUBrandName(); }
@@ -34,8 +34,6 @@
 #include <iostream>
 #include "apr_base64.h"
 
-#include <boost/iostreams/device/array.hpp>
-#include <boost/iostreams/stream.hpp>
 #include <boost/align/aligned_allocator.hpp>
 
 #if defined(LL_USESYSTEMLIBS) || defined(LL_LINUX)
@@ -1278,6 +1276,348 @@ bool LLSDBinaryParser::parseString(
 }
 
 
+/**
+ * LLSDBinaryBufferParser
+ */
+LLSDBinaryBufferParser::LLSDBinaryBufferParser(const U8* data, llssize size) :
+    mStart(data),
+    mCur(data),
+    mEnd(data + llmax(size, (llssize)0))
+{
+}
+
+S32 LLSDBinaryBufferParser::parse(LLSD& data, S32 max_depth)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD
+    S32 parse_count = parseValue(data, max_depth);
+    if (LLSDParser::PARSE_FAILURE == parse_count)
+    {
+        data.clear();
+    }
+    return parse_count;
+}
+
+// See LLSDBinaryParser::doParse() for the format
+S32 LLSDBinaryBufferParser::parseValue(LLSD& data, S32 max_depth)
+{
+    if (mCur >= mEnd)
+    {
+        return 0;
+    }
+    char c = (char)*mCur++;
+    if (max_depth == 0)
+    {
+        return LLSDParser::PARSE_FAILURE;
+    }
+    switch (c)
+    {
+    case '{':
+        return parseMap(data, max_depth - 1);
+
+    case '[':
+        return parseArray(data, max_depth - 1);
+
+    case '!':
+        data.clear();
+        break;
+
+    case '0':
+        data = false;
+        break;
+
+    case '1':
+        data = true;
+        break;
+
+    case 'i':
+    {
+        U32 value_nbo = 0;
+        if (!readBytes(&value_nbo, sizeof(U32)))
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+        data = (S32)ntohl(value_nbo);
+        break;
+    }
+
+    case 'r':
+    {
+        F64 real_nbo = 0.0;
+        if (!readBytes(&real_nbo, sizeof(F64)))
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+        data = ll_ntohd(real_nbo);
+        break;
+    }
+
+    case 'u':
+    {
+        LLUUID id;
+        if (!readBytes(id.mData, UUID_BYTES))
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+        data = id;
+        break;
+    }
+
+    case '\'':
+    case '"':
+    {
+        std::string value;
+        if (!parseDelimitedString(c, value))
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+        data = std::move(value);
+        break;
+    }
+
+    case 's':
+    {
+        std::string_view value;
+        if (!parseString(value))
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+        data = std::string(value);
+        break;
+    }
+
+    case 'l':
+    {
+        std::string_view value;
+        if (!parseString(value))
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+        data = LLURI(std::string(value));
+        break;
+    }
+
+    case 'd':
+    {
+        // dates are written in host byte order
+        F64 real = 0.0;
+        if (!readBytes(&real, sizeof(F64)))
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+        data = LLDate(real);
+        break;
+    }
+
+    case 'b':
+    {
+        S32 size = 0;
+        if (!readSize(size) || size > mEnd - mCur)
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+        if (size > 0)
+        {
+            data = LLSD::Binary(mCur, mCur + size);
+            mCur += size;
+        }
+        else
+        {
+            data = LLSD::Binary();
+        }
+        break;
+    }
+
+    default:
+        LL_INFOS() << "Unrecognized character while parsing: int(" << int(c)
+            << ")" << LL_ENDL;
+        return LLSDParser::PARSE_FAILURE;
+    }
+    return 1;
+}
+
+S32 LLSDBinaryBufferParser::parseMap(LLSD& map, S32 max_depth)
+{
+    map = LLSD::emptyMap();
+    S32 size = 0;
+    if (!readSize(size))
+    {
+        return LLSDParser::PARSE_FAILURE;
+    }
+    S32 parse_count = 1;
+    S32 count = 0;
+    std::string unescaped_name;
+    while ((count < size) && (mCur < mEnd) && (*mCur != '}'))
+    {
+        const char c = (char)*mCur++;
+        std::string_view name;
+        switch (c)
+        {
+        case 'k':
+            if (!parseString(name))
+            {
+                return LLSDParser::PARSE_FAILURE;
+            }
+            break;
+        case '\'':
+        case '"':
+            if (!parseDelimitedString(c, unescaped_name))
+            {
+                return LLSDParser::PARSE_FAILURE;
+            }
+            name = unescaped_name;
+            break;
+        }
+
+        // Parse straight into the new entry. Like LLSD::insert(), a
+        // repeated key keeps its first value.
+        const size_t map_size = map.size();
+        LLSD& child = map[name];
+        S32 child_count;
+        if (map.size() != map_size)
+        {
+            child_count = parseValue(child, max_depth);
+        }
+        else
+        {
+            LLSD ignored;
+            child_count = parseValue(ignored, max_depth);
+        }
+        if (child_count <= 0)
+        {
+            // There must be a value for every key
+            return LLSDParser::PARSE_FAILURE;
+        }
+        parse_count += child_count;
+        ++count;
+    }
+    if ((mCur >= mEnd) || (*mCur++ != '}') || (count < size))
+    {
+        // Make sure it is correctly terminated and we parsed as many
+        // as were said to be there.
+        return LLSDParser::PARSE_FAILURE;
+    }
+    return parse_count;
+}
+
+S32 LLSDBinaryBufferParser::parseArray(LLSD& array, S32 max_depth)
+{
+    array = LLSD::emptyArray();
+    S32 size = 0;
+    if (!readSize(size) || size > mEnd - mCur)
+    {
+        // Every element takes at least a byte, so this can not be
+        // valid and we would rather not allocate for it
+        return LLSDParser::PARSE_FAILURE;
+    }
+    if (size > 0)
+    {
+        array.set(size - 1, LLSD());
+    }
+
+    S32 parse_count = 1;
+    S32 count = 0;
+    LLSD::array_iterator element = array.beginArray();
+    while ((count < size) && (mCur < mEnd) && (*mCur != ']'))
+    {
+        S32 child_count = parseValue(*element++, max_depth);
+        if (child_count <= 0)
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+        parse_count += child_count;
+        ++count;
+    }
+    if ((mCur >= mEnd) || (*mCur++ != ']') || (count < size))
+    {
+        return LLSDParser::PARSE_FAILURE;
+    }
+    return parse_count;
+}
+
+bool LLSDBinaryBufferParser::parseString(std::string_view& value)
+{
+    S32 size = 0;
+    if (!readSize(size) || (size < 0) || (size > mEnd - mCur))
+    {
+        return false;
+    }
+    value = std::string_view((const char*)mCur, size);
+    mCur += size;
+    return true;
+}
+
+// Same escapes as deserialize_string_delim()
+bool LLSDBinaryBufferParser::parseDelimitedString(char delim, std::string& value)
+{
+    value.clear();
+    while (mCur < mEnd)
+    {
+        const U8* run = mCur;
+        while ((mCur < mEnd) && (*mCur != delim) && (*mCur != '\\'))
+        {
+            ++mCur;
+        }
+        value.append((const char*)run, mCur - run);
+        if (mCur >= mEnd)
+        {
+            break;
+        }
+        if (*mCur++ == delim)
+        {
+            return true;
+        }
+
+        if (mCur >= mEnd)
+        {
+            break;
+        }
+        const char next_char = (char)*mCur++;
+        switch (next_char)
+        {
+        case 'x':
+            if (mEnd - mCur < 2)
+            {
+                return false;
+            }
+            value.push_back((char)((hex_as_nybble(mCur[0]) << 4) | hex_as_nybble(mCur[1])));
+            mCur += 2;
+            break;
+        case 'a': value.push_back('\a'); break;
+        case 'b': value.push_back('\b'); break;
+        case 'f': value.push_back('\f'); break;
+        case 'n': value.push_back('\n'); break;
+        case 'r': value.push_back('\r'); break;
+        case 't': value.push_back('\t'); break;
+        case 'v': value.push_back('\v'); break;
+        default: value.push_back(next_char); break;
+        }
+    }
+    return false;
+}
+
+bool LLSDBinaryBufferParser::readSize(S32& size)
+{
+    U32 size_nbo = 0;
+    if (!readBytes(&size_nbo, sizeof(U32)))
+    {
+        return false;
+    }
+    size = (S32)ntohl(size_nbo);
+    return true;
+}
+
+bool LLSDBinaryBufferParser::readBytes(void* dst, size_t bytes)
+{
+    if ((size_t)(mEnd - mCur) < bytes)
+    {
+        return false;
+    }
+    memcpy(dst, mCur, bytes);
+    mCur += bytes;
+    return true;
+}
+
+
 /**
  * LLSDFormatter
  */
@@ -2342,9 +2682,7 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, const U8* in, S32
     {
         char* result_ptr = strip_deprecated_header((char*)result, cur_size);
 
-        boost::iostreams::stream<boost::iostreams::array_source> istrm(result_ptr, cur_size);
-
-        if (!LLSDSerialize::fromBinary(data, istrm, cur_size, UNZIP_LLSD_MAX_DEPTH))
+        if (LLSDSerialize::fromBinary(data, (const U8*)result_ptr, cur_size, UNZIP_LLSD_MAX_DEPTH) <= 0)
         {
             free(result);
             return ZR_PARSE_ERROR;
@@ -408,6 +408,64 @@ class LL_COMMON_API LLSDBinaryParser : public LLSDParser
     bool parseString(std::istream& istr, std::string& value) const;
 };
 
+/**
+ * @class LLSDBinaryBufferParser
+ * @brief Parser for binary formatted LLSD held in a contiguous buffer.
+ *
+ * Accepts the same input as LLSDBinaryParser, but reads straight out of
+ * memory instead of through an istream. Values are parsed in place into
+ * the caller's LLSD: arrays are sized once from their element count, map
+ * entries are created from keys that point into the buffer, and strings
+ * are only copied once into their final LLSD. Prefer this whenever the
+ * whole document is already in memory, e.g. mesh headers, decompressed
+ * assets and cache files.
+ *
+ * Unlike LLSDBinaryParser, a value cut short by the end of the buffer is
+ * always a parse failure.
+ */
+class LL_COMMON_API LLSDBinaryBufferParser
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param data The buffer to parse, which must outlive the parser.
+     * @param size The number of bytes in data.
+     */
+    LLSDBinaryBufferParser(const U8* data, llssize size);
+
+    /**
+     * @brief Parse one LLSD object from the current position.
+     *
+     * Can be called again to parse the next object in the buffer.
+     * @param data[out] The newly parsed structured data. Cleared on failure.
+     * @param max_depth Max depth parser will check before exiting
+     *  with parse error, -1 - unlimited.
+     * @return Returns the number of LLSD objects parsed into data,
+     * 0 at the end of the buffer and LLSDParser::PARSE_FAILURE on
+     * failure.
+     */
+    S32 parse(LLSD& data, S32 max_depth = -1);
+
+    /**
+     * @brief The number of bytes consumed so far.
+     */
+    llssize getBytesRead() const { return mCur - mStart; }
+
+private:
+    S32 parseValue(LLSD& data, S32 max_depth);
+    S32 parseMap(LLSD& map, S32 max_depth);
+    S32 parseArray(LLSD& array, S32 max_depth);
+    bool parseString(std::string_view& value);
+    bool parseDelimitedString(char delim, std::string& value);
+    bool readSize(S32& size);
+    bool readBytes(void* dst, size_t bytes);
+
+    const U8* mStart;
+    const U8* mCur;
+    const U8* mEnd;
+};
+
 
 /**
  * @class LLSDFormatter
@@ -847,6 +905,13 @@ class LL_COMMON_API LLSDSerialize
         (void)p->parse(str, sd, max_bytes, max_depth);
         return sd;
     }
+    // Parses a buffer holding the whole document without going through
+    // an istream, see LLSDBinaryBufferParser
+    static S32 fromBinary(LLSD& sd, const U8* data, llssize size, S32 max_depth = -1)
+    {
+        LLSDBinaryBufferParser p(data, size);
+        return p.parse(sd, max_depth);
+    }
 };
 
 class LL_COMMON_API LLUZipHelper : public LLRefCount
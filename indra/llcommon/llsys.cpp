@@ -613,6 +613,7 @@ LLCPUInfo::LLCPUInfo()
     mHasSSE41 = proc.hasSSE41();
     mHasSSE42 = proc.hasSSE42();
     mHasSSE4a = proc.hasSSE4a();
+    mHasAVX2 = proc.hasAVX2();
     mHasAltivec = proc.hasAltivec();
     mCPUMHz = (F64)proc.getCPUFrequency();
     mFamily = proc.getCPUFamilyName();
@@ -696,6 +697,11 @@ bool LLCPUInfo::hasSSE4a() const
     return mHasSSE4a;
 }
 
+bool LLCPUInfo::hasAVX2() const
+{
+    return mHasAVX2;
+}
+
 F64 LLCPUInfo::getMHz() const
 {
     return mCPUMHz;
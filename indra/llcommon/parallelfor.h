@@ -0,0 +1,120 @@
+/**
+ * @file   parallelfor.h
+ * @date   2024-06-03
+ * @brief  parallelFor() splits a loop between the calling thread and the
+ *         threads of a ThreadPool.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_PARALLELFOR_H)
+#define LL_PARALLELFOR_H
+
+#include "llcond.h"
+#include "threadpool.h"
+#include "workqueue.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace LL
+{
+
+    /**
+     * parallelFor() calls func(begin, end) for consecutive ranges of at most
+     * grain items covering [0, count), and returns once every range is done.
+     *
+     * Ranges are handed out to the calling thread and to the threads of the
+     * ThreadPool named pool as each of them asks for one. The calling thread
+     * keeps taking ranges until none are left, so it never waits for a range
+     * that a busy pool has not started, and with no such pool, a closed pool
+     * or a single range, the whole loop simply runs on the calling thread.
+     *
+     * func is called concurrently for different ranges, so whatever it
+     * writes must belong to its own range.
+     *
+     * If func throws, ranges not started yet are skipped, and the first
+     * exception is rethrown on the calling thread once every range is done.
+     */
+    template <typename FUNC>
+    void parallelFor(const std::string& pool, size_t count, size_t grain, FUNC&& func)
+    {
+        if (!count)
+        {
+            return;
+        }
+        grain = grain ? grain : 1;
+        const size_t ranges = (count + grain - 1) / grain;
+
+        struct Shared
+        {
+            std::atomic<size_t> mNext{ 0 };
+            LLScalarCond<size_t> mDone{ 0 };
+            std::atomic<bool> mFailed{ false };
+            std::mutex mExceptionMutex;
+            std::exception_ptr mException;
+        };
+        auto shared = std::make_shared<Shared>();
+
+        // Only called while some range is unfinished, so func is still alive
+        auto run_ranges = [shared, ranges, count, grain, &func]()
+        {
+            for (size_t range = shared->mNext++; range < ranges; range = shared->mNext++)
+            {
+                // A range that throws still counts as done, or the caller
+                // would wait for it forever
+                if (!shared->mFailed)
+                {
+                    try
+                    {
+                        const size_t begin = range * grain;
+                        func(begin, std::min(begin + grain, count));
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(shared->mExceptionMutex);
+                        if (!shared->mException)
+                        {
+                            shared->mException = std::current_exception();
+                        }
+                        shared->mFailed = true;
+                    }
+                }
+                shared->mDone.update_all([](size_t& done) { ++done; });
+            }
+        };
+
+        if (ranges > 1)
+        {
+            WorkQueue::ptr_t queue = WorkQueue::getInstance(pool);
+            if (queue)
+            {
+                const size_t helpers = std::min(ThreadPoolBase::getWidth(pool, 0), ranges - 1);
+                for (size_t i = 0; i < helpers; ++i)
+                {
+                    // A helper that starts late finds no ranges left and
+                    // returns without touching func
+                    if (!queue->post(run_ranges))
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+
+        run_ranges();
+        shared->mDone.wait_equal(ranges);
+        if (shared->mException)
+        {
+            std::rethrow_exception(shared->mException);
+        }
+    }
+
+} // namespace LL
+
+#endif /* ! defined(LL_PARALLELFOR_H) */
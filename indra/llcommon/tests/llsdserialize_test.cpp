@@ -1267,6 +1267,23 @@ namespace tut
     {
     public:
         TestLLSDBinaryParsing() {}
+
+        // Every case must give the same result with LLSDBinaryBufferParser
+        void ensureParse(
+            const std::string& msg,
+            const std::string& in,
+            const LLSD& expected_value,
+            S32 expected_count,
+            S32 depth_limit = -1)
+        {
+            TestLLSDParsing<LLSDBinaryParser>::ensureParse(msg, in, expected_value, expected_count, depth_limit);
+
+            LLSD parsed_result;
+            LLSDBinaryBufferParser parser((const U8*)in.data(), in.size());
+            S32 parsed_count = parser.parse(parsed_result, depth_limit);
+            ensure_equals(msg + " (buffer)", parsed_result, expected_value);
+            ensure_equals(msg + " (buffer count)", parsed_count, expected_count);
+        }
     };
 
     typedef tut::test_group<TestLLSDBinaryParsing> TestLLSDBinaryParsingGroup;
@@ -1584,12 +1601,86 @@ namespace tut
             1);
     }
 
-/*
     template<> template<>
     void TestLLSDBinaryParsingObject::test<11>()
     {
+        // notation style strings and keys with escapes
+        LLSD val;
+        val["a\nb"] = "quote ' and \x41";
+        std::vector<U8> vec;
+        vec.push_back('{');
+        vec.resize(vec.size() + 4);
+        uint32_t size = htonl(1);
+        memcpy(&vec[1], &size, sizeof(uint32_t));
+        std::string entry("'a\\nb'\"quote \\' and \\x41\"}");
+        vec.insert(vec.end(), entry.begin(), entry.end());
+        std::string str_good((char*)&vec[0], vec.size());
+        ensureParse("escaped strings", str_good, val, 2);
+
+        ensureParse("unterminated escape", "'abc\\", LLSD(), LLSDParser::PARSE_FAILURE);
+    }
+
+    template<> template<>
+    void TestLLSDBinaryParsingObject::test<12>()
+    {
+        // a map repeating a key keeps the first value
+        std::vector<U8> vec;
+        vec.push_back('{');
+        vec.resize(vec.size() + 4);
+        uint32_t size = htonl(2);
+        memcpy(&vec[1], &size, sizeof(uint32_t));
+        for (U8 value : { '1', '0' })
+        {
+            vec.push_back('k');
+            size = htonl(1);
+            vec.resize(vec.size() + 4);
+            memcpy(&vec[vec.size() - 4], &size, sizeof(uint32_t));
+            vec.push_back('a');
+            vec.push_back(value);
+        }
+        vec.push_back('}');
+        LLSD val;
+        val["a"] = true;
+        ensureParse("repeated key", std::string((char*)&vec[0], vec.size()), val, 3);
+
+        // an array claiming more elements than there are bytes left
+        ensureParse("oversized array", std::string("[\x7f\xff\xff\xff!]", 7), LLSD(), LLSDParser::PARSE_FAILURE);
+    }
+
+    template<> template<>
+    void TestLLSDBinaryParsingObject::test<13>()
+    {
+        // several documents back to back, like a cache file
+        LLSD first;
+        first["id"] = LLUUID::generateNewID();
+        first["values"].append(1.5);
+        first["values"].append(LLDate(12345.0));
+        first["values"].append(LLURI("http://sl.com"));
+        first["values"].append(LLSD::Binary(3, 7));
+        LLSD second = "second";
+
+        std::stringstream str;
+        LLSDSerialize::toBinary(first, str);
+        const size_t first_size = str.str().size();
+        LLSDSerialize::toBinary(second, str);
+        const std::string data = str.str();
+
+        LLSDBinaryBufferParser parser((const U8*)data.data(), data.size());
+        LLSD result;
+        ensure_equals("first count", parser.parse(result), 7);
+        ensure_equals("first", result, first);
+        ensure_equals("first size", parser.getBytesRead(), (llssize)first_size);
+        ensure_equals("second count", parser.parse(result), 1);
+        ensure_equals("second", result, second);
+        ensure_equals("end", parser.parse(result), 0);
+        ensure_equals("all read", parser.getBytesRead(), (llssize)data.size());
+
+        // and the truncated first document
+        LLSD truncated;
+        ensure_equals("truncated", LLSDSerialize::fromBinary(truncated, (const U8*)data.data(), first_size - 1),
+                      (S32)LLSDParser::PARSE_FAILURE);
+        ensure("truncated cleared", truncated.isUndefined());
     }
-*/
 
    /**
      * @class TestLLSDCrossCompatible
@@ -0,0 +1,148 @@
+/**
+ * @file   parallelfor_test.cpp
+ * @date   2024-06-03
+ * @brief  Test for parallelfor.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "parallelfor.h"
+// STL headers
+#include <atomic>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+// other Linden headers
+#include "../test/lltut.h"
+#include "llmutex.h"
+
+using namespace LL;
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct parallelfor_data
+    {
+        // Sets each item to one more than its index, so skipped or repeated
+        // items show up in the totals
+        static void check(const std::string& pool, size_t count, size_t grain)
+        {
+            std::vector<std::atomic<int>> items(count);
+            parallelFor(pool, count, grain, [&items, grain](size_t begin, size_t end)
+            {
+                ensure("range too long", end - begin <= std::max(grain, (size_t)1));
+                for (size_t i = begin; i < end; ++i)
+                {
+                    items[i] += (int)i + 1;
+                }
+            });
+            for (size_t i = 0; i < count; ++i)
+            {
+                ensure_equals("item visited wrongly", items[i].load(), (int)i + 1);
+            }
+        }
+    };
+    typedef test_group<parallelfor_data> parallelfor_group;
+    typedef parallelfor_group::object object;
+    parallelfor_group parallelforgrp("parallelfor");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("no pool");
+        check("nonexistent", 0, 4);
+        check("nonexistent", 1, 4);
+        check("nonexistent", 100, 7);
+        check("nonexistent", 100, 0);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("pool");
+        ThreadPool pool("parallelfor", 3);
+        pool.start();
+        check("parallelfor", 1000, 1);
+        check("parallelfor", 1000, 64);
+        check("parallelfor", 3, 1000);
+
+        // the pool threads share the work
+        LLMutex mutex;
+        std::set<std::thread::id> threads;
+        for (int attempt = 0; attempt < 100 && threads.size() < 2; ++attempt)
+        {
+            parallelFor("parallelfor", 64, 1, [&mutex, &threads](size_t, size_t)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                LLMutexLock lock(&mutex);
+                threads.insert(std::this_thread::get_id());
+            });
+        }
+        ensure("pool threads never helped", threads.size() > 1);
+        pool.close();
+
+        // a closed pool leaves everything to the caller
+        check("parallelfor", 100, 10);
+    }
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("throwing range");
+        ThreadPool pool("parallelfor", 3);
+        pool.start();
+
+        // whichever thread runs it, the caller gets the exception back
+        bool caught = false;
+        try
+        {
+            parallelFor("parallelfor", 64, 1, [](size_t begin, size_t)
+            {
+                if (begin == 5)
+                {
+                    throw std::runtime_error("range 5");
+                }
+            });
+        }
+        catch (const std::runtime_error& e)
+        {
+            caught = true;
+            ensure_equals("wrong exception", std::string(e.what()), std::string("range 5"));
+        }
+        ensure("exception lost", caught);
+
+        // thrown on a pool thread, rather than waiting forever for its range
+        const std::thread::id caller = std::this_thread::get_id();
+        bool helper_threw = false;
+        for (int attempt = 0; attempt < 100 && !helper_threw; ++attempt)
+        {
+            try
+            {
+                parallelFor("parallelfor", 64, 1, [caller](size_t, size_t)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    if (std::this_thread::get_id() != caller)
+                    {
+                        throw std::runtime_error("helper");
+                    }
+                });
+            }
+            catch (const std::runtime_error&)
+            {
+                helper_threw = true;
+            }
+        }
+        ensure("pool threads never threw", helper_threw);
+
+        // and the pool still works
+        check("parallelfor", 1000, 16);
+        pool.close();
+    }
+} // namespace tut
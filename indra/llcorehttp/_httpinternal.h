@@ -153,6 +153,15 @@ const int HTTP_CONNECTION_LIMIT_MAX = 256;
 const long HTTP_PIPELINING_DEFAULT = 0L;
 const long HTTP_PIPELINING_MAX = 20L;
 
+// HTTP/2 multiplexing limits, in streams per connection
+const long HTTP_MULTIPLEX_STREAMS_DEFAULT = 0L;
+const long HTTP_MULTIPLEX_STREAMS_MAX = 100L;
+
+// Largest response body given a single preallocated block from its
+// Content-Length.  Anything bigger, or claiming to be, is gathered in
+// ordinary BufferArray blocks.
+const size_t HTTP_REPLY_PREALLOCATE_MAX = 32 * 1024 * 1024;
+
 // Miscellaneous defaults
 const bool HTTP_USE_RETRY_AFTER_DEFAULT = true;
 const long HTTP_THROTTLE_RATE_DEFAULT = 0L;
@@ -163,6 +172,16 @@ const long HTTP_THROTTLE_RATE_DEFAULT = 0L;
 // request, ready and active queues.
 const int HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS = 2;
 
+// Longest time worker thread blocks on the sockets of active
+// requests when waiting on them (PO_SOCKET_WAIT) while requests
+// are also held back by retry or throttle timers.
+const int HTTP_SERVICE_LOOP_WAIT_NORMAL_MS = 10;
+
+// Longest time worker thread blocks with nothing to do when
+// waiting on sockets.  New requests wake it so this only bounds
+// the cost of a missed wakeup.
+const int HTTP_SERVICE_LOOP_WAIT_IDLE_MS = 1000;
+
 // Block allocation size (a tuning parameter) is found
 // in bufferarray.h.
 
@@ -32,6 +32,7 @@
 #include "_httppolicy.h"
 
 #include "llhttpconstants.h"
+#include "lltimer.h"
 
 namespace
 {
@@ -49,6 +50,11 @@ void check_curl_multi_setopt(CURLM* handle, CURLMoption option, ARG argument)
     check_curl_multi_code(code, option);
 }
 
+// Append the sockets a multi handle is waiting on to fds.  Returns
+// false if libcurl can't say which those are, or may have left some
+// out, so the caller has to poll.
+bool append_wait_fds(CURLM* handle, std::vector<curl_waitfd>& fds);
+
 static const char * const LOG_CORE("CoreHttp");
 
 } // end anonymous namespace
@@ -64,7 +70,10 @@ HttpLibcurl::HttpLibcurl(HttpService * service)
       mPolicyCount(0),
       mMultiHandles(NULL),
       mActiveHandles(NULL),
-      mDirtyPolicy(NULL)
+      mDirtyPolicy(NULL),
+      mMultiplexing(NULL),
+      mCanMultiplex(false),
+      mWaitHandle(NULL)
 {}
 
 
@@ -105,6 +114,15 @@ void HttpLibcurl::shutdown()
 
         delete [] mDirtyPolicy;
         mDirtyPolicy = NULL;
+
+        delete [] mMultiplexing;
+        mMultiplexing = NULL;
+    }
+
+    if (mWaitHandle)
+    {
+        curl_multi_cleanup(mWaitHandle);
+        mWaitHandle = NULL;
     }
 
     mPolicyCount = 0;
@@ -121,6 +139,10 @@ void HttpLibcurl::start(int policy_count)
     mMultiHandles = new CURLM * [mPolicyCount];
     mActiveHandles = new int [mPolicyCount];
     mDirtyPolicy = new bool [mPolicyCount];
+    mMultiplexing = new bool [mPolicyCount];
+
+    const curl_version_info_data * curl_info(curl_version_info(CURLVERSION_NOW));
+    mCanMultiplex = curl_info && (curl_info->features & CURL_VERSION_HTTP2);
 
     for (int policy_class(0); policy_class < mPolicyCount; ++policy_class)
     {
@@ -131,8 +153,20 @@ void HttpLibcurl::start(int policy_count)
         }
         mActiveHandles[policy_class] = 0;
         mDirtyPolicy[policy_class] = false;
+        mMultiplexing[policy_class] = false;
         policyUpdated(policy_class);
     }
+
+#if HTTP_CAN_WAIT_ON_SOCKETS
+    // Never given requests, this one only blocks on the sockets of the
+    // others and is woken by new requests.
+    mWaitHandle = curl_multi_init();
+    if (! mWaitHandle)
+    {
+        LL_WARNS(LOG_CORE) << "Failed to allocate wait handle in libcurl, polling instead."
+                           << LL_ENDL;
+    }
+#endif
 }
 
 
@@ -190,7 +224,7 @@ HttpService::ELoopSpeed HttpLibcurl::processTransport()
 
                     completeRequest(mMultiHandles[policy_class], handle, result);
                     handle = NULL;                  // No longer valid on return
-                    ret = HttpService::NORMAL;      // If anything completes, we may have a free slot.
+                    ret = HttpService::IMMEDIATE;   // If anything completes, we may have a free slot.
                                                     // Turning around quickly reduces connection gap by 7-10mS.
                 }
                 else if (CURLMSG_NONE == msg->msg)
@@ -211,12 +245,71 @@ HttpService::ELoopSpeed HttpLibcurl::processTransport()
 
     if (! mActiveOps.empty())
     {
-        ret = HttpService::NORMAL;
+        ret = (std::min)(ret, HttpService::NORMAL);
     }
     return ret;
 }
 
 
+void HttpLibcurl::waitTransport(int max_wait_ms)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
+#if HTTP_CAN_WAIT_ON_SOCKETS
+    if (! mWaitHandle)
+    {
+        ms_sleep(HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS);
+        return;
+    }
+
+    int wait_ms(max_wait_ms);
+    mWaitFds.clear();
+    for (int policy_class(0); policy_class < mPolicyCount; ++policy_class)
+    {
+        if (! mMultiHandles[policy_class] || ! mActiveHandles[policy_class])
+        {
+            continue;
+        }
+
+        long timeout_ms(-1L);
+        if (CURLM_OK == curl_multi_timeout(mMultiHandles[policy_class], &timeout_ms)
+            && timeout_ms >= 0L && timeout_ms < wait_ms)
+        {
+            wait_ms = int(timeout_ms);
+        }
+        if (! append_wait_fds(mMultiHandles[policy_class], mWaitFds))
+        {
+            // Busy without sockets we can see (e.g. resolving), so poll
+            wait_ms = (std::min)(wait_ms, HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS);
+        }
+    }
+
+    if (wait_ms > 0)
+    {
+        LL_PROFILE_ZONE_NAMED_CATEGORY_NETWORK("httppt - curl_multi_poll");
+        CURLMcode code = curl_multi_poll(mWaitHandle, mWaitFds.data(), (unsigned int) mWaitFds.size(), wait_ms, NULL);
+        if (CURLM_OK != code)
+        {
+            check_curl_multi_code(code);
+            ms_sleep(HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS);
+        }
+    }
+#else
+    ms_sleep(HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS);
+#endif
+}
+
+
+void HttpLibcurl::wakeup()
+{
+#if HTTP_CAN_WAIT_ON_SOCKETS
+    if (mWaitHandle)
+    {
+        curl_multi_wakeup(mWaitHandle);
+    }
+#endif
+}
+
+
 // Caller has provided us with a ref count on op.
 void HttpLibcurl::addOp(const HttpOpRequest::ptr_t &op)
 {
@@ -487,7 +580,35 @@ void HttpLibcurl::policyUpdated(int policy_class)
         policy.stallPolicy(policy_class, false);
         mDirtyPolicy[policy_class] = false;
 
-        if (options.mPipelining > 1)
+        if (options.mMultiplexStreams > 0 && ! mCanMultiplex)
+        {
+            LL_WARNS(LOG_CORE) << "HTTP/2 multiplexing requested for policy class "
+                               << policy_class << " but libcurl lacks HTTP/2 support.  Ignored."
+                               << LL_ENDL;
+        }
+        mMultiplexing[policy_class] = options.mMultiplexStreams > 0 && mCanMultiplex;
+
+        if (mMultiplexing[policy_class])
+        {
+            // Libcurl manages connections and, with CURLOPT_PIPEWAIT
+            // on the requests, fills the streams of one connection
+            // to a host before opening another.
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_PIPELINING,
+                                     CURLPIPE_MULTIPLEX);
+#if HTTP_CAN_LIMIT_STREAMS
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_CONCURRENT_STREAMS,
+                                     long(options.mMultiplexStreams));
+#endif
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_HOST_CONNECTIONS,
+                                     long(options.mPerHostConnectionLimit));
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                                     long(options.mConnectionLimit));
+        }
+        else if (options.mPipelining > 1)
         {
             // We'll try to do pipelining on this multihandle
             check_curl_multi_setopt(multi_handle,
@@ -654,4 +775,80 @@ void check_curl_multi_code(CURLMcode code)
     }
 }
 
+
+bool append_wait_fds(CURLM* handle, std::vector<curl_waitfd>& fds)
+{
+#if LIBCURL_VERSION_NUM >= 0x080800
+    // curl_multi_waitfds() has no FD_SETSIZE limit
+    const size_t used(fds.size());
+    unsigned int fd_count(0);
+    if (CURLM_OK != curl_multi_waitfds(handle, NULL, 0, &fd_count))
+    {
+        return false;
+    }
+    fds.resize(used + fd_count);
+    CURLMcode code(fd_count
+                   ? curl_multi_waitfds(handle, fds.data() + used, fd_count, &fd_count)
+                   : CURLM_OK);
+    if (CURLM_OK != code)
+    {
+        fds.resize(used);
+        return false;
+    }
+    fds.resize(used + fd_count);
+    return fd_count > 0;
+#else
+    fd_set read_fds, write_fds, except_fds;
+    FD_ZERO(&read_fds);
+    FD_ZERO(&write_fds);
+    FD_ZERO(&except_fds);
+    int max_fd(-1);
+    if (CURLM_OK != curl_multi_fdset(handle, &read_fds, &write_fds, &except_fds, &max_fd)
+        || max_fd < 0)
+    {
+        // Also what curl_multi_fdset() reports when a socket is beyond
+        // FD_SETSIZE, those are only ever seen by polling
+        return false;
+    }
+
+#if LL_WINDOWS
+    // Winsock fd_sets are arrays of sockets rather than bitmaps
+    for (u_int i(0); i < read_fds.fd_count; ++i)
+    {
+        fds.push_back({ read_fds.fd_array[i], CURL_WAIT_POLLIN, 0 });
+    }
+    for (u_int i(0); i < write_fds.fd_count; ++i)
+    {
+        fds.push_back({ write_fds.fd_array[i], CURL_WAIT_POLLOUT, 0 });
+    }
+    for (u_int i(0); i < except_fds.fd_count; ++i)
+    {
+        fds.push_back({ except_fds.fd_array[i], CURL_WAIT_POLLPRI, 0 });
+    }
+#else
+    for (int fd(0); fd <= max_fd; ++fd)
+    {
+        short events(0);
+        if (FD_ISSET(fd, &read_fds))
+        {
+            events |= CURL_WAIT_POLLIN;
+        }
+        if (FD_ISSET(fd, &write_fds))
+        {
+            events |= CURL_WAIT_POLLOUT;
+        }
+        if (FD_ISSET(fd, &except_fds))
+        {
+            events |= CURL_WAIT_POLLPRI;
+        }
+        if (events)
+        {
+            fds.push_back({ fd, events, 0 });
+        }
+    }
+#endif
+    return true;
+#endif  // LIBCURL_VERSION_NUM >= 0x080800
+}
+
 }  // end anonymous namespace
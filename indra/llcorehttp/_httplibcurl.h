@@ -33,12 +33,28 @@
 #include <curl/multi.h>
 
 #include <set>
+#include <vector>
 
 #include "httprequest.h"
 #include "_httpservice.h"
 #include "_httpinternal.h"
 
 
+// curl_multi_poll() and curl_multi_wakeup() first appear in libcurl 7.68.0
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define HTTP_CAN_WAIT_ON_SOCKETS 1
+#else
+#define HTTP_CAN_WAIT_ON_SOCKETS 0
+#endif
+
+// CURLMOPT_MAX_CONCURRENT_STREAMS first appears in libcurl 7.67.0
+#if LIBCURL_VERSION_NUM >= 0x074300
+#define HTTP_CAN_LIMIT_STREAMS 1
+#else
+#define HTTP_CAN_LIMIT_STREAMS 0
+#endif
+
+
 namespace LLCore
 {
 
@@ -75,6 +91,29 @@ class HttpLibcurl
     /// Threading:  called by worker thread.
     HttpService::ELoopSpeed processTransport();
 
+    /// Block until an active request of any policy class has
+    /// socket activity or a libcurl timeout expires, @wakeup()
+    /// is called or @max_wait_ms milliseconds pass.
+    ///
+    /// Threading:  called by worker thread.
+    void waitTransport(int max_wait_ms);
+
+    /// Make a @waitTransport() in progress, or else the next one,
+    /// return at once.
+    ///
+    /// Threading:  callable by any thread between @start() and
+    /// @shutdown().
+    void wakeup();
+
+    /// Whether @waitTransport() can wait on sockets in this build
+    /// and since @start().  If not, callers should keep polling.
+    ///
+    /// Threading:  called by worker thread.
+    bool canWait() const
+        {
+            return mWaitHandle != NULL;
+        }
+
     /// Add request to the active list.  Caller is expected to have
     /// provided us with a reference count on the op to hold the
     /// request.  (No additional references will be added.)
@@ -124,6 +163,17 @@ class HttpLibcurl
     /// Threading:  called by worker thread.
     void policyUpdated(int policy_class);
 
+    /// Whether requests of a policy class are currently being
+    /// multiplexed over HTTP/2 connections.  Follows the
+    /// PO_MULTIPLEX_STREAMS option once @policyUpdated() has
+    /// applied it and libcurl supports HTTP/2.
+    ///
+    /// Threading:  called by worker thread.
+    bool isMultiplexing(int policy_class) const
+        {
+            return mMultiplexing && mMultiplexing[policy_class];
+        }
+
     /// Allocate a curl handle for caller.  May be freed using
     /// either the freeHandle() method or calling curl_easy_cleanup()
     /// directly.
@@ -213,6 +263,10 @@ class HttpLibcurl
     CURLM **            mMultiHandles;      // One handle per policy class
     int *               mActiveHandles;     // Active count per policy class
     bool *              mDirtyPolicy;       // Dirty policy update waiting for stall (per pc)
+    bool *              mMultiplexing;      // HTTP/2 multiplexing applied (per pc)
+    bool                mCanMultiplex;      // libcurl has HTTP/2 support
+    CURLM *             mWaitHandle;        // Multi handle without requests to wait and wake on
+    std::vector<curl_waitfd> mWaitFds;      // Sockets of all policy classes for waitTransport()
 
 }; // end class HttpLibcurl
 
@@ -502,6 +502,7 @@ HttpStatus HttpOpRequest::prepareRequest(HttpService * service)
     // Get global and class policy options
     HttpPolicyGlobal & gpolicy(service->getPolicy().getGlobalOptions());
     HttpPolicyClass & cpolicy(service->getPolicy().getClassOptions(mReqPolicy));
+    const bool multiplexing(service->getTransport().isMultiplexing(mReqPolicy));
 
     mCurlHandle = service->getTransport().getHandle();
     if (! mCurlHandle)
@@ -562,6 +563,15 @@ HttpStatus HttpOpRequest::prepareRequest(HttpService * service)
 
     check_curl_easy_setopt(mCurlHandle, CURLOPT_NOBODY, nobody);
 
+    if (multiplexing)
+    {
+        // HTTP/2 by ALPN on https: and by upgrade on http:, falling
+        // back to HTTP/1.1.  Wait for a stream on a connection that is
+        // still being set up rather than racing it with a new one.
+        check_curl_easy_setopt(mCurlHandle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_0);
+        check_curl_easy_setopt(mCurlHandle, CURLOPT_PIPEWAIT, 1L);
+    }
+
     // The Linksys WRT54G V5 router has an issue with frequent
     // DNS lookups from LAN machines.  If they happen too often,
     // like for every HTTP request, the router gets annoyed after
@@ -723,7 +733,7 @@ HttpStatus HttpOpRequest::prepareRequest(HttpService * service)
     {
         xfer_timeout = timeout;
     }
-    if (cpolicy.mPipelining > 1L)
+    if (cpolicy.mPipelining > 1L || multiplexing)
     {
         // Pipelining affects both connection and transfer timeout values.
         // Requests that are added to a pipeling immediately have completed
@@ -750,6 +760,9 @@ HttpStatus HttpOpRequest::prepareRequest(HttpService * service)
         // (various libcurl callbacks) have the same problem TIMEOUT does.
         //
         // xfer_timeout *= cpolicy.mPipelining;
+        //
+        // Multiplexed requests queue the same way behind a connection
+        // whose streams are all in use (CURLOPT_PIPEWAIT).
         xfer_timeout *= 2L;
     }
     // *DEBUG:  Enable following override for timeout handling and "[curl:bugs] #1420" tests
@@ -791,6 +804,24 @@ size_t HttpOpRequest::writeCallback(void * data, size_t size, size_t nmemb, void
     if (! op->mReplyBody)
     {
         op->mReplyBody = new BufferArray();
+
+        // Headers are in by the first write so, if the length is
+        // known, receive the body into one block that consumers
+        // can take over without copying.
+#if LIBCURL_VERSION_NUM >= 0x073700
+        curl_off_t content_length(-1);
+        if (CURLE_OK == curl_easy_getinfo(op->mCurlHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length)
+            && content_length > 0
+            && content_length <= curl_off_t(HTTP_REPLY_PREALLOCATE_MAX))
+#else
+        double content_length(-1.0);
+        if (CURLE_OK == curl_easy_getinfo(op->mCurlHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &content_length)
+            && content_length > 0.0
+            && content_length <= double(HTTP_REPLY_PREALLOCATE_MAX))
+#endif
+        {
+            op->mReplyBody->preallocate(size_t(content_length));
+        }
     }
     const size_t req_size(size * nmemb);
     const size_t write_size(op->mReplyBody->append(static_cast<char *>(data), req_size));
@@ -254,10 +254,16 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
         }
 
         int active(transport.getActiveCountInClass(policy_class));
-        int active_limit(state.mOptions.mPipelining > 1L
-                         ? (state.mOptions.mPerHostConnectionLimit
-                            * state.mOptions.mPipelining)
-                         : state.mOptions.mConnectionLimit);
+        int active_limit(state.mOptions.mConnectionLimit);
+        if (transport.isMultiplexing(policy_class))
+        {
+            // Streams, not connections, bound the requests in flight
+            active_limit = state.mOptions.mPerHostConnectionLimit * state.mOptions.mMultiplexStreams;
+        }
+        else if (state.mOptions.mPipelining > 1L)
+        {
+            active_limit = state.mOptions.mPerHostConnectionLimit * state.mOptions.mPipelining;
+        }
         int needed(active_limit - active);      // Expect negatives here
 
         if (needed > 0)
@@ -37,6 +37,7 @@ HttpPolicyClass::HttpPolicyClass()
     : mConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
       mPerHostConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
       mPipelining(HTTP_PIPELINING_DEFAULT),
+      mMultiplexStreams(HTTP_MULTIPLEX_STREAMS_DEFAULT),
       mThrottleRate(HTTP_THROTTLE_RATE_DEFAULT)
 {}
 
@@ -57,6 +58,10 @@ HttpStatus HttpPolicyClass::set(HttpRequest::EPolicyOption opt, long value)
         mPipelining = llclamp(value, 0L, HTTP_PIPELINING_MAX);
         break;
 
+    case HttpRequest::PO_MULTIPLEX_STREAMS:
+        mMultiplexStreams = llclamp(value, 0L, HTTP_MULTIPLEX_STREAMS_MAX);
+        break;
+
     case HttpRequest::PO_THROTTLE_RATE:
         mThrottleRate = llclamp(value, 0L, 1000000L);
         break;
@@ -85,6 +90,10 @@ HttpStatus HttpPolicyClass::get(HttpRequest::EPolicyOption opt, long * value) co
         *value = mPipelining;
         break;
 
+    case HttpRequest::PO_MULTIPLEX_STREAMS:
+        *value = mMultiplexStreams;
+        break;
+
     case HttpRequest::PO_THROTTLE_RATE:
         *value = mThrottleRate;
         break;
@@ -63,6 +63,7 @@ class HttpPolicyClass
     long                        mConnectionLimit;
     long                        mPerHostConnectionLimit;
     long                        mPipelining;
+    long                        mMultiplexStreams;
     long                        mThrottleRate;
 };  // end class HttpPolicyClass
 
@@ -36,7 +36,8 @@ namespace LLCore
 HttpPolicyGlobal::HttpPolicyGlobal()
     : mConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
       mTrace(HTTP_TRACE_OFF),
-      mUseLLProxy(0)
+      mUseLLProxy(0),
+      mSocketWait(1)
 {}
 
 
@@ -51,6 +52,7 @@ HttpPolicyGlobal & HttpPolicyGlobal::operator=(const HttpPolicyGlobal & other)
         mUserAgent = other.mUserAgent;
         mTrace = other.mTrace;
         mUseLLProxy = other.mUseLLProxy;
+        mSocketWait = other.mSocketWait;
     }
     return *this;
 }
@@ -72,6 +74,10 @@ HttpStatus HttpPolicyGlobal::set(HttpRequest::EPolicyOption opt, long value)
         mUseLLProxy = llclamp(value, 0L, 1L);
         break;
 
+    case HttpRequest::PO_SOCKET_WAIT:
+        mSocketWait = llclamp(value, 0L, 1L);
+        break;
+
     default:
         return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
     }
@@ -142,6 +148,10 @@ HttpStatus HttpPolicyGlobal::get(HttpRequest::EPolicyOption opt, long * value) c
         *value = mUseLLProxy;
         break;
 
+    case HttpRequest::PO_SOCKET_WAIT:
+        *value = mSocketWait;
+        break;
+
     default:
         return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
     }
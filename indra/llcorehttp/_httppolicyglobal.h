@@ -73,6 +73,7 @@ class HttpPolicyGlobal
     std::string         mUserAgent;
     long                mTrace;
     long                mUseLLProxy;
+    long                mSocketWait;
     HttpRequest::policyCallback_t   mSslCtxCallback;
 };  // end class HttpPolicyGlobal
 
@@ -83,6 +83,10 @@ HttpStatus HttpRequestQueue::addOp(const HttpRequestQueue::opPtr_t &op, bool log
         if (loggable && sMessageLogFunc != nullptr ) { sMessageLogFunc(op); }
         wake = mQueue.empty();
         mQueue.push_back(op);
+        if (wake && mWakeupFunc)
+        {
+            mWakeupFunc();
+        }
     }
     if (wake)
     {
@@ -149,6 +153,10 @@ bool HttpRequestQueue::stopQueue()
     {
         HttpScopedLock lock(mQueueMutex);
 
+        if (mWakeupFunc)
+        {
+            mWakeupFunc();
+        }
         if (!mQueueStopped)
         {
             mQueueStopped = true;
@@ -161,4 +169,12 @@ bool HttpRequestQueue::stopQueue()
 }
 
 
+void HttpRequestQueue::setWakeupFunc(std::function<void()> func)
+{
+    HttpScopedLock lock(mQueueMutex);
+
+    mWakeupFunc = std::move(func);
+}
+
+
 } // end namespace LLCore
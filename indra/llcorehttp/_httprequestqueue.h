@@ -126,6 +126,16 @@ class HttpRequestQueue final : public LLCoreInt::RefCounted
     /// Threading:  callable by any thread.
     bool stopQueue();
 
+    /// Install a function to be called, with the queue locked,
+    /// whenever @addOp puts a request on an empty queue and when
+    /// the queue is stopped.  Lets a service thread that waits
+    /// somewhere other than @fetchAll learn of new requests.
+    /// Once this returns, the previous function will not be
+    /// called again.  An empty function removes it.
+    ///
+    /// Threading:  callable by any thread.
+    void setWakeupFunc(std::function<void()> func);
+
     static void setMessageLogFunc(std::function<void(const HttpRequestQueue::opPtr_t &)> func) { sMessageLogFunc = func;}
 
 protected:
@@ -137,6 +147,7 @@ class HttpRequestQueue final : public LLCoreInt::RefCounted
     LLCoreInt::HttpMutex                mQueueMutex;
     LLCoreInt::HttpConditionVariable    mQueueCV;
     bool                                mQueueStopped;
+    std::function<void()>               mWakeupFunc;
 
 }; // end class HttpRequestQueue
 
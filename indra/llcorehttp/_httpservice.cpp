@@ -64,7 +64,9 @@ const HttpService::OptionDescriptor HttpService::sOptionDesc[] =
     {   true,       true,       false,      true,       false   },      // PO_ENABLE_PIPELINING
     {   true,       true,       false,      true,       false   },      // PO_THROTTLE_RATE
     {   false,      false,      true,       false,      true    },      // PO_SSL_VERIFY_CALLBACK
-    {   false,      false,      true,       false,      false   }       // PO_USER_AGENT
+    {   false,      false,      true,       false,      false   },      // PO_USER_AGENT
+    {   true,       false,      true,       false,      false   },      // PO_SOCKET_WAIT
+    {   true,       true,       false,      true,       false   }       // PO_MULTIPLEX_STREAMS
 };
 HttpService * HttpService::sInstance(NULL);
 volatile HttpService::EState HttpService::sState(NOT_INITIALIZED);
@@ -268,17 +270,32 @@ void HttpService::shutdown()
 // layer pieces and then either sleeps for a small time
 // or waits for a request to come in.  Repeats until
 // requested to stop.
+//
+// With PO_SOCKET_WAIT, rather than sleeping, it blocks on
+// the sockets of active requests and the request queue
+// wakes it when a request comes in.
 void HttpService::threadRun(LLCoreInt::HttpThread * thread)
 {
     LL_PROFILER_SET_THREAD_NAME("HttpService");
 
+    long socket_wait(0L);
+    mPolicy->getGlobalOptions().get(HttpRequest::PO_SOCKET_WAIT, &socket_wait);
+    const bool wait_on_sockets(socket_wait && mTransport->canWait());
+    if (wait_on_sockets)
+    {
+        HttpLibcurl * transport(mTransport);
+        mRequestQueue->setWakeupFunc([transport]() { transport->wakeup(); });
+    }
+
     ELoopSpeed loop(REQUEST_SLEEP);
     while (! mExitRequested)
     {
         LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
         try
         {
-            loop = processRequestQueue(loop);
+            // When waiting on sockets, never block on the request queue
+            // itself.  New requests will end the wait instead.
+            loop = processRequestQueue(wait_on_sockets ? NORMAL : loop);
 
             // Process ready queue issuing new requests as needed
             ELoopSpeed new_loop = mPolicy->processReadyQueue();
@@ -289,7 +306,16 @@ void HttpService::threadRun(LLCoreInt::HttpThread * thread)
             loop = (std::min)(loop, new_loop);
 
             // Determine whether to spin, sleep briefly or sleep for next request
-            if (REQUEST_SLEEP != loop)
+            if (wait_on_sockets)
+            {
+                if (IMMEDIATE != loop)
+                {
+                    mTransport->waitTransport(REQUEST_SLEEP == loop
+                                              ? HTTP_SERVICE_LOOP_WAIT_IDLE_MS
+                                              : HTTP_SERVICE_LOOP_WAIT_NORMAL_MS);
+                }
+            }
+            else if (REQUEST_SLEEP != loop)
             {
                 ms_sleep(HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS);
             }
@@ -314,6 +340,8 @@ void HttpService::threadRun(LLCoreInt::HttpThread * thread)
         }
     }
 
+    // No wakeups from here on, the transport is going away
+    mRequestQueue->setWakeupFunc(nullptr);
     shutdown();
     sState = STOPPED;
 }
@@ -104,6 +104,7 @@ class HttpService
     // requests.
     enum ELoopSpeed
     {
+        IMMEDIATE,              ///< work is ready, go around again without sleeping
         NORMAL,                 ///< continuous polling of request, ready, active queues
         REQUEST_SLEEP           ///< can sleep indefinitely waiting for request queue write
     };
@@ -58,7 +58,7 @@ class BufferArray::Block
     void operator delete(void *, size_t len);
 
 protected:
-    Block(size_t len);
+    Block(size_t len, char * aligned);
 
     Block(const Block &);                       // Not defined
     void operator=(const Block &);              // Not defined
@@ -68,12 +68,26 @@ class BufferArray::Block
     void * operator new(size_t len, size_t addl_len);
 
 public:
-    // Only public entry to get a block.
+    // Only public entries to get a block.
     static Block * alloc(size_t len);
 
+    // Block whose buffer is a separate 16-byte aligned allocation,
+    // not zero-filled, which can be given away with detach().
+    static Block * allocAligned(size_t len);
+
+    bool isDetachable() const
+        {
+            return mBuffer != mData;
+        }
+
+    // Gives up the buffer of an allocAligned() block, leaving
+    // the block empty.
+    char * detach();
+
 public:
     size_t mUsed;
     size_t mAlloced;
+    char * mBuffer;                             // mData or separate buffer
 
     // *NOTE:  Must be last member of the object.  We'll
     // overallocate as requested via operator new and index
@@ -124,7 +138,7 @@ size_t BufferArray::append(const void * src, size_t len)
             // Some will fit...
             const size_t copy_len((std::min)(len, (last.mAlloced - last.mUsed)));
 
-            memcpy(&last.mData[last.mUsed], c_src, copy_len);
+            memcpy(&last.mBuffer[last.mUsed], c_src, copy_len);
             last.mUsed += copy_len;
             llassert_always(last.mUsed <= last.mAlloced);
             mLen += copy_len;
@@ -157,7 +171,7 @@ size_t BufferArray::append(const void * src, size_t len)
             LL_WARNS() << "Bad memory allocation in thrown by Block::alloc in read!" << LL_ENDL;
             break;
         }
-        memcpy(block->mData, c_src, copy_len);
+        memcpy(block->mBuffer, c_src, copy_len);
         block->mUsed = copy_len;
         llassert_always(block->mUsed <= block->mAlloced);
         mBlocks.push_back(block);
@@ -180,7 +194,59 @@ void * BufferArray::appendBufferAlloc(size_t len)
     block->mUsed = len;
     mBlocks.push_back(block);
     mLen += len;
-    return block->mData;
+    return block->mBuffer;
+}
+
+
+bool BufferArray::preallocate(size_t len)
+{
+    if (mLen || ! mBlocks.empty())
+    {
+        return false;
+    }
+
+    try
+    {
+        mBlocks.push_back(Block::allocAligned(len));
+    }
+    catch (const std::bad_alloc&)
+    {
+        LL_WARNS() << "Unable to preallocate " << len << " bytes for BufferArray" << LL_ENDL;
+        return false;
+    }
+    return true;
+}
+
+
+void * BufferArray::contiguousData()
+{
+    // A preallocated block may be followed by empty ones
+    if (! mLen || mBlocks.front()->mUsed != mLen)
+    {
+        return NULL;
+    }
+    return mBlocks.front()->mBuffer;
+}
+
+
+void * BufferArray::detachContiguous(size_t * len)
+{
+    if (! contiguousData() || ! mBlocks.front()->isDetachable())
+    {
+        return NULL;
+    }
+
+    *len = mLen;
+    void * data(mBlocks.front()->detach());
+    for (container_t::iterator it(mBlocks.begin());
+         it != mBlocks.end();
+         ++it)
+    {
+        delete *it;
+    }
+    mBlocks.clear();
+    mLen = 0;
+    return data;
 }
 
 
@@ -207,7 +273,7 @@ size_t BufferArray::read(size_t pos, void * dst, size_t len)
         size_t block_limit(block.mUsed - offset);
         size_t block_len((std::min)(block_limit, len));
 
-        memcpy(c_dst, &block.mData[offset], block_len);
+        memcpy(c_dst, &block.mBuffer[offset], block_len);
         result += block_len;
         len -= block_len;
         c_dst += block_len;
@@ -241,7 +307,7 @@ size_t BufferArray::write(size_t pos, const void * src, size_t len)
             size_t block_limit(block.mUsed - offset);
             size_t block_len((std::min)(block_limit, len));
 
-            memcpy(&block.mData[offset], c_src, block_len);
+            memcpy(&block.mBuffer[offset], c_src, block_len);
             result += block_len;
             c_src += block_len;
             len -= block_len;
@@ -261,7 +327,7 @@ size_t BufferArray::write(size_t pos, const void * src, size_t len)
             // Some will fit...
             const size_t copy_len((std::min)(len, (last.mAlloced - last.mUsed)));
 
-            memcpy(&last.mData[last.mUsed], c_src, copy_len);
+            memcpy(&last.mBuffer[last.mUsed], c_src, copy_len);
             last.mUsed += copy_len;
             result += copy_len;
             llassert_always(last.mUsed <= last.mAlloced);
@@ -312,8 +378,8 @@ bool BufferArray::getBlockStartEnd(int block, const char ** start, const char **
     }
 
     const Block & b(*mBlocks[block]);
-    *start = &b.mData[0];
-    *end = &b.mData[b.mUsed];
+    *start = &b.mBuffer[0];
+    *end = &b.mBuffer[b.mUsed];
     return true;
 }
 
@@ -323,21 +389,40 @@ bool BufferArray::getBlockStartEnd(int block, const char ** start, const char **
 // ==================================
 
 
-BufferArray::Block::Block(size_t len)
+BufferArray::Block::Block(size_t len, char * aligned)
     : mUsed(0),
-      mAlloced(len)
+      mAlloced(len),
+      mBuffer(aligned ? aligned : mData)
 {
-    memset(mData, 0, len);
+    if (! aligned)
+    {
+        memset(mData, 0, len);
+    }
 }
 
 
 BufferArray::Block::~Block()
 {
+    if (isDetachable())
+    {
+        ll_aligned_free_16(mBuffer);
+    }
+    mBuffer = NULL;
     mUsed = 0;
     mAlloced = 0;
 }
 
 
+char * BufferArray::Block::detach()
+{
+    char * buffer(mBuffer);
+    mBuffer = mData;
+    mUsed = 0;
+    mAlloced = 0;
+    return buffer;
+}
+
+
 void * BufferArray::Block::operator new(size_t len, size_t addl_len)
 {
     void * mem = new char[len + addl_len + sizeof(void *)];
@@ -360,9 +445,28 @@ void BufferArray::Block::operator delete(void * mem, size_t)
 
 BufferArray::Block * BufferArray::Block::alloc(size_t len)
 {
-    Block * block = new (len) Block(len);
+    Block * block = new (len) Block(len, NULL);
     return block;
 }
 
 
+BufferArray::Block * BufferArray::Block::allocAligned(size_t len)
+{
+    char * buffer = static_cast<char *>(ll_aligned_malloc_16((std::max)(len, size_t(1))));
+    if (! buffer)
+    {
+        throw std::bad_alloc();
+    }
+    try
+    {
+        return new (0) Block(len, buffer);
+    }
+    catch (...)
+    {
+        ll_aligned_free_16(buffer);
+        throw;
+    }
+}
+
+
 }  // end namespace LLCore
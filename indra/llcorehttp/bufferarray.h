@@ -104,6 +104,33 @@ class BufferArray final : public LLCoreInt::RefCounted
     ///                 of BufferArray of 'len' size.
     void * appendBufferAlloc(size_t len);
 
+    /// Prepares an empty BufferArray to take 'len' bytes of
+    /// appends or writes in a single contiguous, 16-byte aligned
+    /// block.  Nothing is added to the size.  Data beyond 'len'
+    /// goes into further blocks as usual.  Intended for response
+    /// bodies of known length, which can then be handed over with
+    /// @see detachContiguous() rather than copied out.
+    ///
+    /// @return         True if the block was allocated, false if
+    ///                 the instance isn't empty or memory ran out.
+    bool preallocate(size_t len);
+
+    /// Pointer to the data if it is all in one block, which may be
+    /// written through but stays owned by the BufferArray.
+    ///
+    /// @return         Pointer to size() bytes of contiguous data
+    ///                 or NULL if the data is empty or spans blocks.
+    void * contiguousData();
+
+    /// Hands ownership of the data to the caller if it is all in
+    /// a block from @see preallocate(), leaving the instance empty.
+    /// The caller must free it with ll_aligned_free_16().
+    ///
+    /// @param  len     Receives the byte count of the returned data.
+    /// @return         The data or NULL, with the instance unchanged,
+    ///                 if it is empty or not in a single such block.
+    void * detachContiguous(size_t * len);
+
     /// Current count of bytes in BufferArray instance.
     size_t size() const
         {
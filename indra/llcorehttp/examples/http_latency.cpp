@@ -0,0 +1,236 @@
+/**
+ * @file http_latency.cpp
+ * @brief Request latency example for core-http library
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "linden_common.h"
+
+#include "httpcommon.h"
+#include "httprequest.h"
+#include "httphandler.h"
+#include "httpresponse.h"
+#include "httpoptions.h"
+#include "httpheaders.h"
+
+#include <curl/curl.h>
+
+#include "lltimer.h"
+
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\thttp_latency [options]\n"
+"\n"
+"Issues GET requests one at a time, each queued only after the previous\n"
+"one completed, and reports the time from queueing a request to its\n"
+"completion being delivered.  This is dominated by how quickly the HTTP\n"
+"service thread notices new requests and finished transfers, so it is\n"
+"run once with the service sleeping between passes (PO_SOCKET_WAIT 0)\n"
+"and once with it waiting on the request sockets (PO_SOCKET_WAIT 1).\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -n, --requests <n>\n"
+"        Number of requests in each mode.  Default is 500.\n"
+" -u, --url <url>\n"
+"        URL to fetch.  Should be a local server so that the network\n"
+"        does not hide the service loop.  Default is the test server\n"
+"        started by test_llcorehttp_peer.py, using $LL_TEST_PORT.\n"
+"\n";
+
+
+// Records the completion of the request in flight
+class LatencyHandler : public LLCore::HttpHandler
+{
+public:
+    LatencyHandler()
+        : mDone(false),
+          mErrors(0)
+        {}
+
+    virtual void onCompleted(LLCore::HttpHandle handle, LLCore::HttpResponse * response)
+        {
+            if (! response->getStatus())
+            {
+                ++mErrors;
+            }
+            mDone = true;
+        }
+
+    bool mDone;
+    int mErrors;
+};
+
+
+namespace
+{
+    void NoOpDeletor(LLCore::HttpHandler *)
+    { /*NoOp*/ }
+
+    F64 percentile(const std::vector<F64> & sorted, F64 fraction)
+    {
+        size_t index(size_t(fraction * (sorted.size() - 1) + 0.5));
+        return sorted[(std::min)(index, sorted.size() - 1)];
+    }
+}
+
+
+// Runs the requests with the service configured for the given
+// socket wait mode.  Returns false if the service could not run.
+bool run_mode(long socket_wait, const std::string & url, int count)
+{
+    LLCore::HttpRequest::createService();
+    LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_SOCKET_WAIT,
+                                               LLCore::HttpRequest::GLOBAL_POLICY_ID,
+                                               socket_wait,
+                                               NULL);
+    LLCore::HttpRequest::startThread();
+
+    LLCore::HttpRequest * hr = new LLCore::HttpRequest();
+    LLCore::HttpOptions::ptr_t opt(new LLCore::HttpOptions());
+    LLCore::HttpHeaders::ptr_t headers(new LLCore::HttpHeaders());
+    LatencyHandler handler;
+    LLCore::HttpHandler::ptr_t handler_ptr(&handler, NoOpDeletor);
+
+    std::vector<F64> latencies;
+    latencies.reserve(count);
+    std::clock_t start_cpu(std::clock());
+    bool ok(true);
+
+    // One warm-up request to open the connection
+    for (int i(-1); i < count; ++i)
+    {
+        handler.mDone = false;
+        U64 start(totalTime());
+        LLCore::HttpHandle handle(hr->requestGet(LLCore::HttpRequest::DEFAULT_POLICY_ID,
+                                                 url, opt, headers, handler_ptr));
+        if (LLCORE_HTTP_HANDLE_INVALID == handle)
+        {
+            std::cerr << "Failed to queue request.  Reason:  "
+                      << hr->getStatus().toString() << std::endl;
+            ok = false;
+            break;
+        }
+
+        // Spin on the reply queue so the consumer adds no latency of
+        // its own and only the service loop is measured.
+        while (! handler.mDone)
+        {
+            hr->update(0);
+            std::this_thread::yield();
+        }
+        if (i >= 0)
+        {
+            latencies.push_back(F64(totalTime() - start) / 1000.0);
+        }
+    }
+
+    F64 cpu_ms(F64(std::clock() - start_cpu) * 1000.0 / CLOCKS_PER_SEC);
+
+    // Stop the service thread and wait for it to acknowledge
+    handler.mDone = false;
+    hr->requestStopThread(handler_ptr);
+    for (int i(0); i < 1000 && ! handler.mDone; ++i)
+    {
+        hr->update(0);
+        ms_sleep(2);
+    }
+    delete hr;
+    LLCore::HttpRequest::destroyService();
+
+    if (ok && ! latencies.empty())
+    {
+        std::sort(latencies.begin(), latencies.end());
+        F64 total(0.0);
+        for (F64 latency : latencies)
+        {
+            total += latency;
+        }
+        std::cout << "PO_SOCKET_WAIT " << socket_wait << ":  "
+                  << std::fixed << std::setprecision(3)
+                  << "mean " << total / latencies.size() << " ms  "
+                  << "median " << percentile(latencies, 0.5) << " ms  "
+                  << "p99 " << percentile(latencies, 0.99) << " ms  "
+                  << "errors " << handler.mErrors << "  "
+                  << "process CPU " << std::setprecision(1) << cpu_ms << " ms"
+                  << std::endl;
+    }
+    return ok;
+}
+
+
+int main(int argc, char** argv)
+{
+    int count(500);
+    std::string url;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+        {
+            std::cout << USAGE << std::endl;
+            return 0;
+        }
+        else if ((!strcmp(argv[arg], "--requests") || !strcmp(argv[arg], "-n")) && arg < argc-1)
+        {
+            count = (std::max)(1, atoi(argv[++arg]));
+        }
+        else if ((!strcmp(argv[arg], "--url") || !strcmp(argv[arg], "-u")) && arg < argc-1)
+        {
+            url = argv[++arg];
+        }
+        else
+        {
+            std::cerr << USAGE << std::endl;
+            return 1;
+        }
+    }
+
+    if (url.empty())
+    {
+        const char * port(getenv("LL_TEST_PORT"));
+        if (! port)
+        {
+            std::cerr << "No --url given and $LL_TEST_PORT is not set." << std::endl;
+            return 1;
+        }
+        url = std::string("http://127.0.0.1:") + port + "/";
+    }
+
+    curl_global_init(CURL_GLOBAL_ALL);
+    bool ok(run_mode(0, url, count) && run_mode(1, url, count));
+    curl_global_cleanup();
+
+    return ok ? 0 : 1;
+}
@@ -59,6 +59,7 @@ void usage(std::ostream & out);
 static int concurrency_limit(40);
 static int highwater(100);
 static int pipeline_depth(0);
+static int multiplex_streams(0);
 static int tracing(0);
 static char url_format[1024] = "http://example.com/some/path?texture_id=%s.texture";
 
@@ -166,7 +167,7 @@ int main(int argc, char** argv)
     bool do_verbose(false);
 
     int option(-1);
-    while (-1 != (option = getopt(argc, argv, "u:c:h?RwvH:p:t:")))
+    while (-1 != (option = getopt(argc, argv, "u:c:h?RwvH:p:m:t:")))
     {
         switch (option)
         {
@@ -220,6 +221,21 @@ int main(int argc, char** argv)
             }
             break;
 
+        case 'm':
+            {
+                unsigned long value;
+                char * end;
+
+                value = strtoul(optarg, &end, 10);
+                if (value > 100 || *end != '\0')
+                {
+                    usage(std::cerr);
+                    return 1;
+                }
+                multiplex_streams = value;
+            }
+            break;
+
         case '5':
             {
                 unsigned long value;
@@ -290,6 +306,13 @@ int main(int argc, char** argv)
                                                    pipeline_depth,
                                                    NULL);
     }
+    if (multiplex_streams)
+    {
+        LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_MULTIPLEX_STREAMS,
+                                                   LLCore::HttpRequest::DEFAULT_POLICY_ID,
+                                                   multiplex_streams,
+                                                   NULL);
+    }
     if (tracing)
     {
         LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_TRACE,
@@ -395,6 +418,10 @@ void usage(std::ostream & out)
         "                       Range:  [1..200]  Default:  " << highwater << "\n"
         " -p <depth>            If <depth> is positive, enables and sets pipelineing\n"
         "                       depth on HTTP requests.  Default:  " << pipeline_depth << "\n"
+        " -m <streams>          If <streams> is positive, enables HTTP/2 multiplexing\n"
+        "                       with up to <streams> requests per connection.  Try it\n"
+        "                       against a local h2c server (e.g. 'nghttpd --no-tls')\n"
+        "                       with a small -c.  Range:  [0..100]  Default:  " << multiplex_streams << "\n"
         " -t <level>            If <level> is positive ([1..3]), enables and sets HTTP\n"
         "                       tracing on HTTP requests.  Default:  " << tracing << "\n"
         " -v                    Verbose mode.  Issue some chatter while running\n"
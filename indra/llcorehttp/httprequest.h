@@ -236,6 +236,34 @@ class HttpRequest
         /// Global only
         PO_USER_AGENT,
 
+        /// Long value that if non-zero, the default, lets the worker
+        /// thread block on the sockets of active requests, waking
+        /// when they need service or a new request is made, rather
+        /// than polling every few milliseconds.  Needs libcurl 7.68.0
+        /// or later and is ignored with older ones.  Takes effect
+        /// when the worker thread starts.
+        ///
+        /// Global only
+        PO_SOCKET_WAIT,
+
+        /// If positive, requests in the class are made over HTTP/2
+        /// where the server offers it (ALPN for https:, an h2c
+        /// upgrade for http:) and several may share a connection.
+        /// Value gives the maximum number of concurrent streams on
+        /// a connection.  Zero, the default, disables multiplexing.
+        ///
+        /// When multiplexing, libcurl manages connections and
+        /// waits for a stream on an existing connection to a host
+        /// before opening another, up to PO_PER_HOST_CONNECTION_LIMIT
+        /// connections per host and PO_CONNECTION_LIMIT overall.
+        /// The class then allows up to PO_PER_HOST_CONNECTION_LIMIT
+        /// times this value requests in flight, which replaces
+        /// PO_PIPELINING_DEPTH.  Ignored, with a warning, when
+        /// libcurl is built without HTTP/2 support.
+        ///
+        /// Per-class only
+        PO_MULTIPLEX_STREAMS,
+
         PO_LAST  // Always at end
     };
 
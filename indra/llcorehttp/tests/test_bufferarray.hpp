@@ -27,6 +27,7 @@
 #define TEST_LLCORE_BUFFER_ARRAY_H_
 
 #include "bufferarray.h"
+#include "llmemory.h"
 
 #include <iostream>
 
@@ -374,6 +375,71 @@ void BufferArrayTestObjectType::test<8>()
     ba->release();
 }
 
+template <> template <>
+void BufferArrayTestObjectType::test<9>()
+{
+    set_test_name("BufferArray preallocate and detachContiguous");
+
+    // create a new ref counted object with an implicit reference
+    BufferArray * ba = new BufferArray();
+
+    char str1[] = "abcdefghij";
+    size_t str1_len(strlen(str1));
+    char str2[] = "ABCDEFGHIJKLMNOPQRST";
+    size_t str2_len(strlen(str2));
+    char buffer[256];
+
+    ensure("Empty BA has no contiguous data", NULL == ba->contiguousData());
+    ensure("Preallocate empty BA", ba->preallocate(str1_len + str2_len));
+    ensure("Preallocate doesn't change size", 0 == ba->size());
+    ensure("Preallocate only once", ! ba->preallocate(str1_len));
+
+    // fill the block with appends and a write
+    size_t len = ba->append(str1, str1_len);
+    len += ba->write(str1_len, str2, str2_len);
+    ensure("Data length correct", (str1_len + str2_len) == len);
+    ensure("BA length correct", (str1_len + str2_len) == ba->size());
+
+    const char * data(static_cast<const char *>(ba->contiguousData()));
+    ensure("Contiguous data available", NULL != data);
+    ensure("Contiguous content correct.1", 0 == strncmp(data, str1, str1_len));
+    ensure("Contiguous content correct.2", 0 == strncmp(data + str1_len, str2, str2_len));
+
+    // take the block
+    size_t detached_len(0);
+    char * detached(static_cast<char *>(ba->detachContiguous(&detached_len)));
+    ensure("Detached block is contiguous data", detached == data);
+    ensure("Detached length correct", (str1_len + str2_len) == detached_len);
+    ensure("Detached block aligned", 0 == (reinterpret_cast<uintptr_t>(detached) & 0xf));
+    ensure("BA empty after detach", 0 == ba->size());
+    ll_aligned_free_16(detached);
+
+    // still usable afterwards
+    len = ba->append(str1, str1_len);
+    ensure("Append after detach", str1_len == len && str1_len == ba->size());
+    ensure("Ordinary block is contiguous", NULL != ba->contiguousData());
+    ensure("Ordinary block can't be detached", NULL == ba->detachContiguous(&detached_len));
+    ba->release();
+
+    // overflowing the preallocated block spills into a new one
+    ba = new BufferArray();
+    ensure("Preallocate short block", ba->preallocate(str1_len));
+    len = ba->append(str1, str1_len);
+    len += ba->append(str2, str2_len);
+    ensure("Spilled length correct", (str1_len + str2_len) == ba->size());
+    ensure("Spilled data not contiguous", NULL == ba->contiguousData());
+    ensure("Spilled data can't be detached", NULL == ba->detachContiguous(&detached_len));
+
+    memset(buffer, 'X', sizeof(buffer));
+    len = ba->read(0, buffer, sizeof(buffer));
+    ensure("Spilled read length correct", (str1_len + str2_len) == len);
+    ensure("Spilled content correct.1", 0 == strncmp(buffer, str1, str1_len));
+    ensure("Spilled content correct.2", 0 == strncmp(buffer + str1_len, str2, str2_len));
+
+    // release the implicit reference, causing the object to be released
+    ba->release();
+}
+
 }  // end namespace tut
 
 
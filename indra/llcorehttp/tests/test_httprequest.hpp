@@ -3012,6 +3012,129 @@ void HttpRequestTestObjectType::test<23>()
 }
 
 
+template <> template <>
+void HttpRequestTestObjectType::test<24>()
+{
+    ScopedCurlInit ready;
+
+    std::string url_base(get_base_url());
+    // std::cerr << "Base:  "  << url_base << std::endl;
+
+    set_test_name("HttpRequest GETs with HTTP/2 multiplexing enabled");
+
+    // Handler can be stack-allocated *if* there are no dangling
+    // references to it after completion of this method.
+    TestHandler2 handler(this, "handler");
+    LLCore::HttpHandler::ptr_t handlerp(&handler, NoOpDeletor);
+    mHandlerCalls = 0;
+
+    HttpRequest * req = NULL;
+
+    try
+    {
+        // Get singletons created
+        HttpRequest::createService();
+
+        // Out of range values are clamped
+        long streams(0L);
+        HttpStatus status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_MULTIPLEX_STREAMS,
+                                                               HttpRequest::DEFAULT_POLICY_ID,
+                                                               1000L,
+                                                               &streams);
+        ensure("Multiplexing option accepted", bool(status));
+        ensure_equals("Stream count clamped", streams, 100L);
+
+        status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_MULTIPLEX_STREAMS,
+                                                    HttpRequest::GLOBAL_POLICY_ID,
+                                                    10L,
+                                                    NULL);
+        ensure("Multiplexing option is per-class only", ! status);
+
+        HttpRequest::setStaticPolicyOption(HttpRequest::PO_PER_HOST_CONNECTION_LIMIT,
+                                           HttpRequest::DEFAULT_POLICY_ID,
+                                           1L,
+                                           NULL);
+        HttpRequest::setStaticPolicyOption(HttpRequest::PO_MULTIPLEX_STREAMS,
+                                           HttpRequest::DEFAULT_POLICY_ID,
+                                           10L,
+                                           NULL);
+
+        // Start threading early so that thread memory is invariant
+        // over the test.
+        HttpRequest::startThread();
+
+        // create a new ref counted object with an implicit reference
+        req = new HttpRequest();
+
+        // The test server only speaks HTTP/1.1 so these share no
+        // connection but must still complete normally.
+        mStatus = HttpStatus(200);
+        const int request_count(5);
+        for (int i(0); i < request_count; ++i)
+        {
+            HttpHandle handle = req->requestGetByteRange(HttpRequest::DEFAULT_POLICY_ID,
+                                                         url_base,
+                                                         0,
+                                                         0,
+                                                         HttpOptions::ptr_t(),
+                                                         HttpHeaders::ptr_t(),
+                                                         handlerp);
+            ensure("Valid handle returned for ranged request", handle != LLCORE_HTTP_HANDLE_INVALID);
+        }
+
+        // Run the notification pump.
+        int count(0);
+        int limit(LOOP_COUNT_LONG);
+        while (count++ < limit && mHandlerCalls < request_count)
+        {
+            req->update(1000000);
+            usleep(LOOP_SLEEP_INTERVAL);
+        }
+        ensure("Requests executed in reasonable time", count < limit);
+        ensure("One handler invocation for each request", mHandlerCalls == request_count);
+
+        // Okay, request a shutdown of the servicing thread
+        mStatus = HttpStatus();
+        HttpHandle handle = req->requestStopThread(handlerp);
+        ensure("Valid handle returned for stop request", handle != LLCORE_HTTP_HANDLE_INVALID);
+
+        // Run the notification pump again
+        count = 0;
+        limit = LOOP_COUNT_LONG;
+        while (count++ < limit && mHandlerCalls < request_count + 1)
+        {
+            req->update(1000000);
+            usleep(LOOP_SLEEP_INTERVAL);
+        }
+        ensure("Stop request executed in reasonable time", count < limit);
+        ensure("Stop handler invocation", mHandlerCalls == request_count + 1);
+
+        // See that we actually shutdown the thread
+        count = 0;
+        limit = LOOP_COUNT_SHORT;
+        while (count++ < limit && ! HttpService::isStopped())
+        {
+            usleep(LOOP_SLEEP_INTERVAL);
+        }
+        ensure("Thread actually stopped running", HttpService::isStopped());
+
+        // release the request object
+        delete req;
+        req = NULL;
+
+        // Shut down service
+        HttpRequest::destroyService();
+    }
+    catch (...)
+    {
+        stop_thread(req);
+        delete req;
+        HttpRequest::destroyService();
+        throw;
+    }
+}
+
+
 }  // end namespace tut
 
 namespace
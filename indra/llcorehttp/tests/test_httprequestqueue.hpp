@@ -151,6 +151,37 @@ void HttpRequestqueueTestObjectType::test<4>()
     }
 }
 
+template <> template <>
+void HttpRequestqueueTestObjectType::test<5>()
+{
+    set_test_name("HttpRequestQueue wakeup function");
+
+    HttpRequestQueue::init();
+
+    HttpRequestQueue * rq = HttpRequestQueue::instanceOf();
+
+    int wakeups(0);
+    rq->setWakeupFunc([&wakeups]() { ++wakeups; });
+
+    HttpOperation::ptr_t op (new HttpOpNull());
+    rq->addOp(op);
+    ensure("Wakeup on add to empty queue", 1 == wakeups);
+
+    op.reset(new HttpOpNull());
+    rq->addOp(op);
+    ensure("No wakeup on add to non-empty queue", 1 == wakeups);
+
+    op = rq->fetchOp(false);
+    op = rq->fetchOp(false);
+    op.reset();
+
+    rq->stopQueue();
+    ensure("Wakeup on stop", 2 == wakeups);
+
+    rq->setWakeupFunc(nullptr);
+    HttpRequestQueue::term();
+}
+
 }  // end namespace tut
 
 
@@ -39,25 +39,76 @@
 #include <chrono>
 
 #include "lldiskcache.h"
+#include "llpackedfilestore.h"
 
 const std::string DISK_CACHE_DIR_NAME = "cache";
+const std::string DISK_CACHE_INDEX_NAME = "index.sl_index";
+
+// On-disk layout of the saved index: a header followed by mCount records
+// in no particular order. Bump the version whenever either struct changes.
+constexpr U32 DISK_CACHE_INDEX_MAGIC = 0x58444944; // 'DIDX'
+constexpr U32 DISK_CACHE_INDEX_VERSION = 1;
+
+struct IndexHeader
+{
+    U32 mMagic;
+    U32 mVersion;
+    U64 mCount;
+};
+
+struct IndexRecord
+{
+    LLUUID mID;
+    U64 mSize;
+    S64 mLastAccess;
+};
+static_assert(sizeof(IndexRecord) == 32, "Disk cache index records must be tightly packed");
 
 LLDiskCache::LLDiskCache()
 {
 }
 
-void LLDiskCache::init(ELLPath location, const uintmax_t max_size_bytes, const bool enable_cache_debug_info, const bool cache_version_mismatch)
+LLDiskCache::~LLDiskCache()
+{
+}
+
+void LLDiskCache::init(ELLPath location, const uintmax_t max_size_bytes, const bool enable_cache_debug_info, const bool cache_version_mismatch, const bool use_packed_store)
 {
     mMaxSizeBytes = max_size_bytes;
     mEnableCacheDebugInfo = enable_cache_debug_info;
     mCacheDir = gDirUtilp->getExpandedFilename(location, DISK_CACHE_DIR_NAME);
 
+    {
+        LLMutexLock lock(&mIndexMutex);
+        clearIndex();
+        mIndexValid = false;
+    }
+
     if (cache_version_mismatch)
     {
         clearCache(location, false);
     }
 
     createCache();
+
+    if (use_packed_store)
+    {
+        mPackedStore = std::make_unique<LLPackedFileStore>(mCacheDir, mReadOnly);
+        mPackedStore->init();
+
+        // Anything still in the per-file layout is moved over by the purge thread
+        mMigrationPending = !mReadOnly;
+    }
+    else if (!mReadOnly && LLPackedFileStore::hasPacks(mCacheDir))
+    {
+        LL_INFOS() << "Packed disk cache store is disabled, removing its packs" << LL_ENDL;
+        LLPackedFileStore::removePacks(mCacheDir);
+
+        // The saved index still lists everything that was in the packs
+        LLFile::remove(mCacheDir + gDirUtilp->getDirDelimiter() + DISK_CACHE_INDEX_NAME, ENOENT);
+    }
+
+    loadIndex();
 }
 
 
@@ -71,8 +122,9 @@ void LLDiskCache::createCache()
     }
 }
 
-// WARNING: purge() is called by LLPurgeDiskCacheThread. As such it must
-// NOT touch any LLDiskCache data without introducing and locking a mutex!
+// WARNING: purge() is called by LLPurgeDiskCacheThread. Index data is
+// shared with the threads reading and writing cache files, so it must only
+// be touched while holding mIndexMutex.
 
 // Interaction through the filesystem itself should be safe. Let’s say thread
 // A is accessing the cache file for reading/writing and thread B is trimming
@@ -99,19 +151,145 @@ void LLDiskCache::createCache()
 // will prevent this. B continues with the next file. If the file is already
 // gone before A finally gets to open it, this operation will fail and the
 // asset will have to be re-requested.
+
+// The index can drift from the directory in the same way (a file rewritten
+// while B removes it ends up indexed but missing). That only costs us an
+// entry that is evicted again later, removing a missing file is harmless.
 void LLDiskCache::purge()
 {
     if (mReadOnly) return;
 
+    bool index_valid = false;
+    {
+        LLMutexLock lock(&mIndexMutex);
+        index_valid = mIndexValid;
+    }
+
+    if (!index_valid)
+    {
+        rebuildIndex();
+        if (!LLApp::isRunning())
+        {
+            return;
+        }
+    }
+
+    if (mMigrationPending)
+    {
+        migrateToPackedStore();
+        if (!LLApp::isRunning())
+        {
+            return;
+        }
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    boost::system::error_code ec;
+    U32 removed_count = 0;
+    uintmax_t removed_bytes = 0;
+    size_t failed_count = 0;
+    while (LLApp::isRunning())
+    {
+        IndexEntry entry;
+        uintmax_t total_bytes = 0;
+
+        // Pop one file at a time so that readers and writers are never held
+        // up for longer than a single remove.
+        LLMutexLock lock(&mIndexMutex);
+        if (mIndexTotalBytes <= mMaxSizeBytes || mIndexLRU.empty()
+            || failed_count >= mIndexLRU.size())
+        {
+            break;
+        }
+
+        const LLUUID file_id = mIndexLRU.back();
+        const boost::filesystem::path file_path = metaDataToFilepath(file_id, LLAssetType::AT_UNKNOWN);
+        if (mPackedStore)
+        {
+            mPackedStore->remove(file_id);
+        }
+        if (!mPackedStore || mMigrationPending)
+        {
+            boost::filesystem::remove(file_path, ec);
+        }
+
+        if (ec.failed())
+        {
+            // Still on disk (in use on Windows), so it stays indexed and
+            // counted. Try the next one and come back to it on a later purge.
+            index_map_t::iterator iter = mIndex.find(file_id);
+            if (iter != mIndex.end())
+            {
+                mIndexLRU.splice(mIndexLRU.begin(), mIndexLRU, iter->second.mLRUIter);
+            }
+            else
+            {
+                mIndexLRU.pop_back();
+            }
+            ++failed_count;
+            lock.unlock();
+
+            LL_WARNS() << "Failed to delete cache file " << file_path << ": " << ec.message() << LL_ENDL;
+            ec.clear();
+            continue;
+        }
+
+        index_map_t::iterator iter = mIndex.find(file_id);
+        if (iter != mIndex.end())
+        {
+            entry = iter->second;
+            mIndex.erase(iter);
+        }
+        mIndexLRU.pop_back();
+        mIndexTotalBytes -= llmin(entry.mSize, mIndexTotalBytes);
+        total_bytes = mIndexTotalBytes;
+        lock.unlock();
+
+        ++removed_count;
+        removed_bytes += entry.mSize;
+
+        if (mEnableCacheDebugInfo)
+        {
+            // have to do this because of LL_INFO/LL_END weirdness
+            std::ostringstream line;
+
+            line << "DELETE:  ";
+            line << entry.mLastAccess << "  ";
+            line << entry.mSize << "  ";
+            line << file_path;
+            line << " (" << total_bytes << "/" << mMaxSizeBytes << ")";
+            LL_INFOS() << line.str() << LL_ENDL;
+        }
+    }
+
+    if (mEnableCacheDebugInfo && removed_count > 0)
+    {
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+
+        LL_INFOS() << "Purged cache to a maximum of " << mMaxSizeBytes << " bytes" << LL_ENDL;
+        LL_INFOS() << "Cache purge took " << execute_time << " ms to remove " << removed_count << " files (" << removed_bytes << " bytes)" << LL_ENDL;
+    }
+
+    if (mPackedStore && LLApp::isRunning())
+    {
+        // reclaim the space of whatever was just evicted or rewritten
+        mPackedStore->compact();
+    }
+}
+
+void LLDiskCache::rebuildIndex()
+{
     if (mEnableCacheDebugInfo)
     {
-        LL_INFOS() << "Total dir size before purge is " << dirFileSize(mCacheDir) << LL_ENDL;
+        LL_INFOS() << "Total dir size before index rebuild is " << dirFileSize(mCacheDir) << LL_ENDL;
     }
 
     boost::system::error_code ec;
     auto start_time = std::chrono::high_resolution_clock::now();
 
-    typedef std::pair<std::time_t, std::pair<uintmax_t, boost::filesystem::path>> file_info_t;
+    typedef std::pair<std::time_t, std::pair<uintmax_t, LLUUID>> file_info_t;
     std::vector<file_info_t> file_info;
 
 #if LL_WINDOWS
@@ -135,6 +313,15 @@ void LLDiskCache::purge()
                 {
                     if (entry.path().string().rfind(mCacheFilenameExt) != std::string::npos)
                     {
+                        LLUUID file_id;
+                        if (!file_id.set(entry.path().stem().string(), FALSE))
+                        {
+                            // Not a name metaDataToFilepath() can produce, so nothing
+                            // will ever read it again and it would never be purged.
+                            boost::filesystem::remove(entry, ec);
+                            continue;
+                        }
+
                         const uintmax_t file_size = boost::filesystem::file_size(entry, ec);
                         if (ec.failed())
                         {
@@ -148,88 +335,323 @@ void LLDiskCache::purge()
                             continue;
                         }
 
-                        file_info.push_back(file_info_t(file_time, { file_size, entry.path() }));
+                        file_info.push_back(file_info_t(file_time, { file_size, file_id }));
                     }
                 }
             }
         }
     }
 
-    std::sort(file_info.begin(), file_info.end(), [](const file_info_t& x, const file_info_t& y)
+    if (mPackedStore)
+    {
+        // The packs do not keep access times, so these are the first to go.
+        // A file that was not migrated yet has a real time and wins over a
+        // copy in the packs.
+        std::vector<std::pair<LLUUID, U32>> entries;
+        mPackedStore->getEntries(entries);
+        for (const auto& [file_id, file_size] : entries)
+        {
+            file_info.push_back(file_info_t(0, { file_size, file_id }));
+        }
+    }
+
+    std::stable_sort(file_info.begin(), file_info.end(), [](const file_info_t& x, const file_info_t& y)
     {
         return x.first > y.first;
     });
 
-    LL_INFOS() << "Purging cache to a maximum of " << mMaxSizeBytes << " bytes" << LL_ENDL;
+    {
+        // Anything already in the index was touched during this session and
+        // is more recent than what is on disk, so the scanned files go at the
+        // old end of the list, newest first.
+        LLMutexLock lock(&mIndexMutex);
+        for (const file_info_t& info : file_info)
+        {
+            const LLUUID& file_id = info.second.second;
+            if (mIndex.find(file_id) != mIndex.end())
+            {
+                continue;
+            }
 
-    // Extra accounting to track the retention of static assets
-    std::vector<bool> file_removed;
-    if (mEnableCacheDebugInfo)
+            IndexEntry& entry = mIndex[file_id];
+            entry.mSize = info.second.first;
+            entry.mLastAccess = info.first;
+            entry.mLRUIter = mIndexLRU.insert(mIndexLRU.end(), file_id);
+            mIndexTotalBytes += entry.mSize;
+        }
+        mIndexValid = true;
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+    LL_INFOS() << "Cache index rebuild took " << execute_time << " ms to execute for " << file_info.size() << " files" << LL_ENDL;
+}
+
+void LLDiskCache::loadIndex()
+{
+    const std::string index_path = mCacheDir + gDirUtilp->getDirDelimiter() + DISK_CACHE_INDEX_NAME;
+
+    LLFILE* file = LLFile::fopen(index_path, "rb");
+    if (!file)
     {
-        file_removed.reserve(file_info.size());
+        // Expected right after clearCache(), in which case the index is already valid
+        LL_INFOS() << "No disk cache index found" << LL_ENDL;
+        return;
     }
 
-    uintmax_t file_size_total = 0;
-    for (const file_info_t& entry : file_info)
+    std::vector<IndexRecord> records;
+    IndexHeader header;
+    bool success = fread(&header, sizeof(IndexHeader), 1, file) == 1
+        && header.mMagic == DISK_CACHE_INDEX_MAGIC
+        && header.mVersion == DISK_CACHE_INDEX_VERSION;
+    if (success)
     {
-        if (!LLApp::isRunning())
+        records.resize(header.mCount);
+        success = header.mCount == 0 || fread(records.data(), sizeof(IndexRecord), header.mCount, file) == header.mCount;
+    }
+    LLFile::close(file);
+
+    if (!mReadOnly)
+    {
+        // If we do not get to save it again on shutdown, rebuild it next time
+        LLFile::remove(index_path);
+    }
+
+    if (!success)
+    {
+        LL_WARNS() << "Disk cache index is invalid, it will be rebuilt in the background" << LL_ENDL;
+        return;
+    }
+
+    std::sort(records.begin(), records.end(), [](const IndexRecord& x, const IndexRecord& y)
+    {
+        return x.mLastAccess > y.mLastAccess;
+    });
+
+    LLMutexLock lock(&mIndexMutex);
+    clearIndex();
+    mIndex.reserve(records.size());
+    for (const IndexRecord& record : records)
+    {
+        IndexEntry& entry = mIndex[record.mID];
+        entry.mSize = record.mSize;
+        entry.mLastAccess = (std::time_t)record.mLastAccess;
+        entry.mLRUIter = mIndexLRU.insert(mIndexLRU.end(), record.mID);
+        mIndexTotalBytes += entry.mSize;
+    }
+    mIndexValid = true;
+
+    LL_INFOS() << "Loaded disk cache index of " << records.size() << " files (" << mIndexTotalBytes << " bytes)" << LL_ENDL;
+}
+
+void LLDiskCache::saveIndex()
+{
+    if (mReadOnly || mCacheDir.empty()) return;
+
+    std::vector<IndexRecord> records;
+    {
+        LLMutexLock lock(&mIndexMutex);
+        if (!mIndexValid)
         {
+            // Only part of the cache is known, let the next session rebuild it
             return;
         }
 
-        file_size_total += entry.second.first;
-
-        bool should_remove = file_size_total > mMaxSizeBytes;
-        if (mEnableCacheDebugInfo)
+        records.reserve(mIndex.size());
+        for (const auto& [file_id, entry] : mIndex)
         {
-            file_removed.push_back(should_remove);
+            IndexRecord record;
+            record.mID = file_id;
+            record.mSize = entry.mSize;
+            record.mLastAccess = entry.mLastAccess;
+            records.push_back(record);
         }
+    }
+
+    IndexHeader header;
+    header.mMagic = DISK_CACHE_INDEX_MAGIC;
+    header.mVersion = DISK_CACHE_INDEX_VERSION;
+    header.mCount = records.size();
+
+    // Write to a temporary file first so a partial write is never loaded
+    const std::string index_path = mCacheDir + gDirUtilp->getDirDelimiter() + DISK_CACHE_INDEX_NAME;
+    const std::string temp_path = index_path + ".tmp";
+    LLFILE* file = LLFile::fopen(temp_path, "wb");
+    if (!file)
+    {
+        LL_WARNS() << "Unable to open " << temp_path << " to save the disk cache index" << LL_ENDL;
+        return;
+    }
+
+    bool success = fwrite(&header, sizeof(IndexHeader), 1, file) == 1
+        && (records.empty() || fwrite(records.data(), sizeof(IndexRecord), records.size(), file) == records.size());
+    LLFile::close(file);
+
+    if (!success || LLFile::rename(temp_path, index_path) != 0)
+    {
+        LL_WARNS() << "Failed to save the disk cache index" << LL_ENDL;
+        LLFile::remove(temp_path, ENOENT);
+        return;
+    }
+
+    LL_INFOS() << "Saved disk cache index of " << records.size() << " files" << LL_ENDL;
+}
 
-        if (should_remove)
+void LLDiskCache::migrateToPackedStore()
+{
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // Collect first, removing files while iterating the directory is not safe
+    std::vector<LLUUID> file_ids;
+    boost::system::error_code ec;
+#if LL_WINDOWS
+    boost::filesystem::path cache_path(ll_convert_string_to_wide(mCacheDir));
+#else
+    boost::filesystem::path cache_path(mCacheDir);
+#endif
+    if (boost::filesystem::is_directory(cache_path, ec) && !ec.failed())
+    {
+        boost::filesystem::recursive_directory_iterator dir_iter(cache_path, ec);
+        if (!ec.failed())
         {
-            boost::filesystem::remove(entry.second.second, ec);
-            if (ec.failed())
+            for (auto& entry : boost::make_iterator_range(dir_iter, {}))
             {
-                LL_WARNS() << "Failed to delete cache file " << entry.second.second << ": " << ec.message() << LL_ENDL;
-                continue;
+                if (!LLApp::isRunning())
+                {
+                    return;
+                }
+
+                if (boost::filesystem::is_regular_file(entry, ec) && !ec.failed()
+                    && entry.path().string().rfind(mCacheFilenameExt) != std::string::npos)
+                {
+                    LLUUID file_id;
+                    if (file_id.set(entry.path().stem().string(), FALSE))
+                    {
+                        file_ids.push_back(file_id);
+                    }
+                }
             }
         }
     }
 
-    if (mEnableCacheDebugInfo)
+    U32 migrated = 0;
+    for (const LLUUID& file_id : file_ids)
+    {
+        if (!LLApp::isRunning())
+        {
+            return;
+        }
+
+        if (migrateFile(file_id))
+        {
+            ++migrated;
+        }
+    }
+
+    mMigrationPending = false;
+
+    if (!file_ids.empty())
     {
         auto end_time = std::chrono::high_resolution_clock::now();
         auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        LL_INFOS() << "Moved " << migrated << " of " << file_ids.size() << " cache files into the pack store in " << execute_time << " ms" << LL_ENDL;
+    }
+}
+
+bool LLDiskCache::migrateFile(const LLUUID& file_id)
+{
+    if (!mPackedStore || !mMigrationPending)
+    {
+        return false;
+    }
+
+    const boost::filesystem::path file_path = metaDataToFilepath(file_id, LLAssetType::AT_UNKNOWN);
+    LLFILE* file = LLFile::fopen(file_path, TEXT("rb"));
+    if (!file)
+    {
+        return false;
+    }
 
-        // Log afterward so it doesn't affect the time measurement
-        // Logging thousands of file results can take hundreds of milliseconds
-        for (size_t i = 0; i < file_info.size(); ++i)
+    std::vector<U8> data;
+    bool success = fseek(file, 0, SEEK_END) == 0;
+    if (success)
+    {
+        const long file_size = ftell(file);
+        success = file_size >= 0 && file_size <= S32_MAX && fseek(file, 0, SEEK_SET) == 0;
+        if (success)
         {
-            if (!LLApp::isRunning())
-            {
-                return;
-            }
+            data.resize(file_size);
+            success = data.empty() || fread(data.data(), 1, data.size(), file) == data.size();
+        }
+    }
+    fclose(file);
 
-            const file_info_t& entry = file_info[i];
-            const bool removed = file_removed[i];
-            const std::string action = removed ? "DELETE:" : "KEEP:";
+    // Never clobber something written to the store since the file was read
+    success = success && mPackedStore->import(file_id, data.data(), (S32)data.size());
+    LLFile::remove(file_path, ENOENT);
+    return success;
+}
 
-            // have to do this because of LL_INFO/LL_END weirdness
-            std::ostringstream line;
+void LLDiskCache::clearIndex()
+{
+    mIndex.clear();
+    mIndexLRU.clear();
+    mIndexTotalBytes = 0;
+}
 
-            line << action << "  ";
-            line << entry.first << "  ";
-            line << entry.second.first << "  ";
-            line << entry.second.second;
-            line << " (" << file_size_total << "/" << mMaxSizeBytes << ")";
-            LL_INFOS() << line.str() << LL_ENDL;
-        }
+void LLDiskCache::updateFileEntry(const LLUUID& file_id, uintmax_t file_size)
+{
+    const std::time_t cur_time = std::time(nullptr);
 
-        LL_INFOS() << "Total dir size after purge is " << dirFileSize(mCacheDir) << LL_ENDL;
-        LL_INFOS() << "Cache purge took " << execute_time << " ms to execute for " << file_info.size() << " files" << LL_ENDL;
+    LLMutexLock lock(&mIndexMutex);
+    index_map_t::iterator iter = mIndex.find(file_id);
+    if (iter == mIndex.end())
+    {
+        IndexEntry& entry = mIndex[file_id];
+        entry.mSize = file_size;
+        entry.mLastAccess = cur_time;
+        entry.mLRUIter = mIndexLRU.insert(mIndexLRU.begin(), file_id);
+        mIndexTotalBytes += file_size;
+    }
+    else
+    {
+        IndexEntry& entry = iter->second;
+        mIndexTotalBytes -= llmin(entry.mSize, mIndexTotalBytes);
+        mIndexTotalBytes += file_size;
+        entry.mSize = file_size;
+        entry.mLastAccess = cur_time;
+        mIndexLRU.splice(mIndexLRU.begin(), mIndexLRU, entry.mLRUIter);
+    }
+}
+
+void LLDiskCache::removeFileEntry(const LLUUID& file_id)
+{
+    LLMutexLock lock(&mIndexMutex);
+    index_map_t::iterator iter = mIndex.find(file_id);
+    if (iter != mIndex.end())
+    {
+        mIndexTotalBytes -= llmin(iter->second.mSize, mIndexTotalBytes);
+        mIndexLRU.erase(iter->second.mLRUIter);
+        mIndex.erase(iter);
     }
 }
 
+void LLDiskCache::renameFileEntry(const LLUUID& old_file_id, const LLUUID& new_file_id)
+{
+    // LLMutex is recursive, so the entry moves atomically with respect to purge()
+    LLMutexLock lock(&mIndexMutex);
+    index_map_t::iterator iter = mIndex.find(old_file_id);
+    if (iter == mIndex.end())
+    {
+        removeFileEntry(new_file_id);
+        return;
+    }
+
+    const uintmax_t file_size = iter->second.mSize;
+    removeFileEntry(old_file_id);
+    updateFileEntry(new_file_id, file_size);
+}
+
 //static
 const std::string LLDiskCache::assetTypeToString(LLAssetType::EType at)
 {
@@ -292,8 +714,7 @@ const boost::filesystem::path LLDiskCache::metaDataToFilepath(const LLUUID& id,
 #endif
 }
 
-// static
-void LLDiskCache::updateFileAccessTime(const boost::filesystem::path& file_path)
+void LLDiskCache::updateFileAccessTime(const LLUUID& file_id, const boost::filesystem::path& file_path)
 {
     /**
      * Threshold in time_t units that is used to decide if the last access time
@@ -309,6 +730,22 @@ void LLDiskCache::updateFileAccessTime(const boost::filesystem::path& file_path)
     // current time
     const std::time_t cur_time = std::time(nullptr);
 
+    {
+        LLMutexLock lock(&mIndexMutex);
+        index_map_t::iterator iter = mIndex.find(file_id);
+        if (iter != mIndex.end())
+        {
+            iter->second.mLastAccess = cur_time;
+            mIndexLRU.splice(mIndexLRU.begin(), mIndexLRU, iter->second.mLRUIter);
+        }
+    }
+
+    if (mPackedStore)
+    {
+        // no file to touch, the index is all there is
+        return;
+    }
+
     boost::system::error_code ec;
 
     // file last write time
@@ -337,7 +774,22 @@ void LLDiskCache::updateFileAccessTime(const boost::filesystem::path& file_path)
 
 const std::string LLDiskCache::getCacheInfo()
 {
-    uintmax_t cache_used_mb = dirFileSize(mCacheDir) / (1024U * 1024U);
+    uintmax_t cache_used_bytes = 0;
+    bool index_valid = false;
+    {
+        LLMutexLock lock(&mIndexMutex);
+        index_valid = mIndexValid;
+        cache_used_bytes = mIndexTotalBytes;
+    }
+    if (!index_valid)
+    {
+        cache_used_bytes = dirFileSize(mCacheDir);
+        if (mPackedStore)
+        {
+            cache_used_bytes += mPackedStore->getPacksSize();
+        }
+    }
+    uintmax_t cache_used_mb = cache_used_bytes / (1024U * 1024U);
 
     uintmax_t max_in_mb = mMaxSizeBytes / (1024U * 1024U);
     F64 percent_used = ((F64)cache_used_mb / (F64)max_in_mb) * 100.0;
@@ -351,6 +803,12 @@ void LLDiskCache::clearCache(ELLPath location, bool recreate_cache)
     {
         std::string disk_cache_dir = gDirUtilp->getExpandedFilename(location, DISK_CACHE_DIR_NAME);
 
+        if (mPackedStore)
+        {
+            mPackedStore->clear();
+        }
+        mMigrationPending = false;
+
         const char* subdirs = "0123456789abcdef";
         std::string delem = gDirUtilp->getDirDelimiter();
         std::string mask = "*";
@@ -367,6 +825,14 @@ void LLDiskCache::clearCache(ELLPath location, bool recreate_cache)
 #endif
         }
         gDirUtilp->deleteFilesInDir(disk_cache_dir, mask);
+
+        {
+            // Nothing left, so the (empty) index is valid again
+            LLMutexLock lock(&mIndexMutex);
+            clearIndex();
+            mIndexValid = true;
+        }
+
         if (recreate_cache)
         {
             createCache();
@@ -462,7 +928,9 @@ LLPurgeDiskCacheThread::LLPurgeDiskCacheThread() :
 
 void LLPurgeDiskCacheThread::run()
 {
-    constexpr std::chrono::seconds CHECK_INTERVAL{60};
+    // With a valid index a purge that has nothing to evict is just a size
+    // check, so keep the cache trimmed continuously rather than in bursts.
+    constexpr std::chrono::seconds CHECK_INTERVAL{10};
 
     while (LLApp::instance()->sleep(CHECK_INTERVAL))
     {
@@ -24,13 +24,24 @@
                     identify this as a Viewer asset file
  * 2/ The time of last access for a file can be updated instantly
  *    for file reads and automatically as part of the file writes.
- * 3/ The purge algorithm collects a list of all files in the
- *    directory, sorts them by date of last access (write) and then
- *    deletes any files based on age until the total size of all
- *    the files is less than the maximum size specified.
- * 4/ An LLSingleton idiom is used since there will only ever be
+ * 3/ An in-memory index of every file in the cache (id, size and
+ *    time of last access) is kept in least recently used order and
+ *    updated as files are read, written, renamed and removed. The
+ *    purge algorithm evicts files from the old end of that list until
+ *    the total size of all the files is less than the maximum size
+ *    specified, so the cost of a purge is proportional to the number
+ *    of files removed rather than the number of files in the cache.
+ *    The index is saved when the viewer shuts down and loaded at the
+ *    next startup. If it is missing (first run, crash) it is rebuilt
+ *    once by walking the cache directory on the purge thread.
+ * 4/ Optionally (see LLPackedFileStore) the files are not stored one
+ *    per asset but as records in a few large pack files. The index and
+ *    purge work the same way, LLFileSystem talks to the pack store
+ *    instead of the filesystem. Files left over from the per-file layout
+ *    are moved into the packs by the purge thread.
+ * 5/ An LLSingleton idiom is used since there will only ever be
  *    a single cache and we want to access it from numerous places.
- * 5/ Performance on my modest system seems very acceptable. For
+ * 6/ Performance on my modest system seems very acceptable. For
  *    example, in testing, I was able to purge a directory of
  *    10,000 files, deleting about half of them in ~ 1700ms. For
  *    the same sized directory of files, writing the last updated
@@ -65,9 +76,16 @@
 #include "llsingleton.h"
 #include "lluuid.h"
 #include "lldir.h"
+#include "llmutex.h"
 
+#include "boost/unordered/unordered_flat_map.hpp"
 #include "boost/unordered/unordered_flat_set.hpp"
 
+#include <atomic>
+#include <list>
+
+class LLPackedFileStore;
+
 class LLDiskCache final :
     public LLSimpleton<LLDiskCache>
 {
@@ -80,7 +98,7 @@ class LLDiskCache final :
          * the class via a call in LLAppViewer.
          */
         LLDiskCache();
-        virtual ~LLDiskCache() = default;
+        virtual ~LLDiskCache();
 public:
         void init(
             /**
@@ -101,7 +119,25 @@ class LLDiskCache final :
             /**
              * Cache version mismatch purge
              */
-            const bool cache_version_mismatch);
+            const bool cache_version_mismatch,
+            /**
+             * Store assets in pack files rather than one file per
+             * asset - Based on the setting at 'DiskCachePackedStore'
+             */
+            const bool use_packed_store);
+
+        /**
+         * The pack store used by LLFileSystem, nullptr when assets are
+         * stored one file per asset
+         */
+        LLPackedFileStore* getPackedStore() const { return mPackedStore.get(); }
+
+        /**
+         * Move the file for file_id from the per-file layout into the pack
+         * store, if there is one. Returns true if the asset was moved.
+         * Only does any work while a migration is pending.
+         */
+        bool migrateFile(const LLUUID& file_id);
 
         /**
          * Construct a filename and path to it based on the file meta data
@@ -114,25 +150,52 @@ class LLDiskCache final :
                                              LLAssetType::EType at);
 
         /**
-         * Update the "last write time" of a file to "now". This must be called whenever a
+         * Update the "last access time" of a file to "now". This must be called whenever a
          * file in the cache is read (not written) so that the last time the file was
-         * accessed is up to date (This is used in the mechanism for purging the cache)
+         * accessed is up to date (This is used in the mechanism for purging the cache).
+         * The index entry is always updated, the "last write time" of the file on disk
+         * only occasionally so that a rebuilt index still has a sensible ordering.
+         */
+        void updateFileAccessTime(const LLUUID& file_id, const boost::filesystem::path& file_path);
+
+        /**
+         * Record in the index that the file for file_id was just written and
+         * is now file_size bytes long. Called by LLFileSystem after each write.
+         */
+        void updateFileEntry(const LLUUID& file_id, uintmax_t file_size);
+
+        /**
+         * Forget the index entry for a file that was removed from the cache
+         */
+        void removeFileEntry(const LLUUID& file_id);
+
+        /**
+         * Move the index entry for a file that was renamed in the cache
          */
-        static void updateFileAccessTime(const boost::filesystem::path& file_path);
+        void renameFileEntry(const LLUUID& old_file_id, const LLUUID& new_file_id);
 
         /**
-         * Purge the oldest items in the cache so that the combined size of all files
-         * is no bigger than mMaxSizeBytes.
+         * Purge the least recently used items in the cache so that the combined
+         * size of all files is no bigger than mMaxSizeBytes.
          *
-         * WARNING: purge() is called by LLPurgeDiskCacheThread. As such it must
-         * NOT touch any LLDiskCache data without introducing and locking a mutex!
+         * WARNING: purge() is called by LLPurgeDiskCacheThread. Index data
+         * must only be touched while holding mIndexMutex, and the mutex must
+         * not be held while doing filesystem work other than removing a file.
          *
-         * Purging the disk cache involves nontrivial work on the viewer's
-         * filesystem. If called on the main thread, this causes a noticeable
-         * freeze.
+         * When the index is valid, this only removes files and is cheap enough
+         * to run often. When it is not (no saved index at startup), the first
+         * call walks the cache directory to rebuild it, which is nontrivial work
+         * on the viewer's filesystem. If called on the main thread, this causes
+         * a noticeable freeze.
          */
         void purge();
 
+        /**
+         * Write the index out so the next session does not have to rebuild it.
+         * Must be called after the purge thread has stopped.
+         */
+        void saveIndex();
+
         /**
          * Clear the cache by removing all the files in the specified cache
          * directory individually. Only the files that contain a prefix defined
@@ -168,6 +231,30 @@ class LLDiskCache final :
          */
         void createCache();
 
+        /**
+         * Load the index saved by the previous session. The file is removed
+         * once it has been read so that if the viewer does not shut down
+         * cleanly, the index is rebuilt rather than trusted.
+         */
+        void loadIndex();
+
+        /**
+         * Walk the cache directory and add every file not already known to
+         * the index. Called by purge() when no saved index was available.
+         */
+        void rebuildIndex();
+
+        /**
+         * Drop every index entry. Caller must hold mIndexMutex.
+         */
+        void clearIndex();
+
+        /**
+         * Move every file from the per-file layout into the pack store.
+         * Called by purge() until it completes.
+         */
+        void migrateToPackedStore();
+
 
     private:
         /**
@@ -202,6 +289,45 @@ class LLDiskCache final :
         bool mEnableCacheDebugInfo = false;
 
         bool mReadOnly = false;
+
+        /**
+         * The index of files in the cache. mIndexLRU holds the ids with the
+         * most recently used at the front, each entry in mIndex keeps its own
+         * position in that list so that touching a file is O(1). All of these
+         * are guarded by mIndexMutex since the purge thread consumes them.
+         */
+        struct IndexEntry
+        {
+            uintmax_t mSize = 0;
+            std::time_t mLastAccess = 0;
+            std::list<LLUUID>::iterator mLRUIter;
+        };
+        typedef std::list<LLUUID> index_lru_t;
+        typedef boost::unordered_flat_map<LLUUID, IndexEntry> index_map_t;
+
+        LLMutex mIndexMutex;
+        index_map_t mIndex;
+        index_lru_t mIndexLRU;
+        uintmax_t mIndexTotalBytes = 0;
+
+        /**
+         * False until the index has been loaded from disk or rebuilt from
+         * a directory walk. Until then, the index only knows about files
+         * touched in this session and must not be used to size the cache.
+         */
+        bool mIndexValid = false;
+
+        /**
+         * The pack store, when enabled. Created in init() and destroyed
+         * with the cache, which saves its index.
+         */
+        std::unique_ptr<LLPackedFileStore> mPackedStore;
+
+        /**
+         * Set while files from the per-file layout may still need to be
+         * moved into the pack store
+         */
+        std::atomic<bool> mMigrationPending{ false };
 };
 
 class LLPurgeDiskCacheThread : public LLThread
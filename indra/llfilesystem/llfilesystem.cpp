@@ -33,6 +33,7 @@
 #include "llfilesystem.h"
 #include "llfasttimer.h"
 #include "lldiskcache.h"
+#include "llpackedfilestore.h"
 
 const S32 LLFileSystem::READ        = 0x00000001;
 const S32 LLFileSystem::WRITE       = 0x00000002;
@@ -48,6 +49,7 @@ LLFileSystem::LLFileSystem(const LLUUID& file_id, const LLAssetType::EType file_
     mPosition = 0;
     mBytesRead = 0;
     mMode = mode;
+    mPackedStore = LLDiskCache::getInstance()->getPackedStore();
 
     // This block of code was originally called in the read() method but after comments here:
     // https://bitbucket.org/lindenlab/viewer/commits/e28c1b46e9944f0215a13cab8ee7dded88d7fc90#comment-10537114
@@ -58,11 +60,21 @@ LLFileSystem::LLFileSystem(const LLUUID& file_id, const LLAssetType::EType file_
         // even though we are reading and not writing because this is the
         // way the cache works - it relies on a valid "last accessed time" for
         // each file so it knows how to remove the oldest, unused files
+        if (mPackedStore)
+        {
+            // pick up files from the per-file layout that were not moved over yet
+            if (mPackedStore->exists(mFileID) || LLDiskCache::getInstance()->migrateFile(mFileID))
+            {
+                LLDiskCache::getInstance()->updateFileAccessTime(mFileID, mFilePath);
+            }
+            return;
+        }
+
         boost::system::error_code ec;
         bool exists = boost::filesystem::exists(mFilePath, ec);
         if (exists && !ec.failed())
         {
-            LLDiskCache::updateFileAccessTime(mFilePath);
+            LLDiskCache::getInstance()->updateFileAccessTime(mFileID, mFilePath);
         }
     }
 }
@@ -74,6 +86,11 @@ LLFileSystem::~LLFileSystem()
 // static
 bool LLFileSystem::getExists(const LLUUID& file_id, const LLAssetType::EType file_type)
 {
+    if (LLPackedFileStore* store = LLDiskCache::getInstance()->getPackedStore())
+    {
+        return store->exists(file_id) || LLDiskCache::getInstance()->migrateFile(file_id);
+    }
+
     const boost::filesystem::path filename = LLDiskCache::getInstance()->metaDataToFilepath(file_id, file_type);
     boost::system::error_code ec;
     return boost::filesystem::exists(filename, ec) && !ec.failed();
@@ -82,9 +99,17 @@ bool LLFileSystem::getExists(const LLUUID& file_id, const LLAssetType::EType fil
 // static
 bool LLFileSystem::removeFile(const LLUUID& file_id, const LLAssetType::EType file_type, int suppress_error /*= 0*/)
 {
-    const boost::filesystem::path filename = LLDiskCache::getInstance()->metaDataToFilepath(file_id, file_type);
+    if (LLPackedFileStore* store = LLDiskCache::getInstance()->getPackedStore())
+    {
+        store->remove(file_id);
+    }
+    else
+    {
+        const boost::filesystem::path filename = LLDiskCache::getInstance()->metaDataToFilepath(file_id, file_type);
 
-    LLFile::remove(filename, suppress_error);
+        LLFile::remove(filename, suppress_error);
+    }
+    LLDiskCache::getInstance()->removeFileEntry(file_id);
 
     return true;
 }
@@ -100,6 +125,11 @@ bool LLFileSystem::renameFile(const LLUUID& old_file_id, const LLAssetType::ETyp
 // static
 S32 LLFileSystem::getFileSize(const LLUUID& file_id, const LLAssetType::EType file_type)
 {
+    if (LLPackedFileStore* store = LLDiskCache::getInstance()->getPackedStore())
+    {
+        return store->getSize(file_id);
+    }
+
     const boost::filesystem::path filename = LLDiskCache::getInstance()->metaDataToFilepath(file_id, file_type);
     boost::system::error_code ec;
     S32 file_size = boost::filesystem::file_size(filename, ec);
@@ -114,6 +144,13 @@ BOOL LLFileSystem::read(U8* buffer, S32 bytes)
 {
     BOOL success = FALSE;
 
+    if (mPackedStore)
+    {
+        mBytesRead = mPackedStore->read(mFileID, mPosition, buffer, bytes);
+        mPosition += mBytesRead;
+        return mBytesRead ? TRUE : FALSE;
+    }
+
     LLFILE* file = LLFile::fopen(mFilePath, TEXT("rb"));
     if (file)
     {
@@ -136,6 +173,36 @@ BOOL LLFileSystem::read(U8* buffer, S32 bytes)
     return success;
 }
 
+LLMappedFileView LLFileSystem::mapView(S32 bytes)
+{
+    mBytesRead = 0;
+
+    if (mPackedStore)
+    {
+        LLMappedFileView view = mPackedStore->mapView(mFileID, mPosition, bytes);
+        if (view.isValid())
+        {
+            mBytesRead = view.getSize();
+            mPosition += mBytesRead;
+            return view;
+        }
+    }
+
+    bytes = llmin(bytes, getSize() - mPosition);
+    if (bytes <= 0)
+    {
+        return LLMappedFileView();
+    }
+
+    std::vector<U8> buffer(bytes);
+    if (!read(buffer.data(), bytes))
+    {
+        return LLMappedFileView();
+    }
+    buffer.resize(mBytesRead);
+    return LLMappedFileView(std::move(buffer));
+}
+
 S32 LLFileSystem::getLastBytesRead()
 {
     return mBytesRead;
@@ -149,14 +216,37 @@ BOOL LLFileSystem::eof()
 BOOL LLFileSystem::write(const U8* buffer, S32 bytes)
 {
     BOOL success = FALSE;
+    S32 file_size = 0;
 
-    if (mMode == APPEND)
+    if (mPackedStore)
+    {
+        // Same semantics as the file modes below: APPEND adds to the end,
+        // READ_WRITE writes at the current position and WRITE replaces
+        S32 offset = 0;
+        if (mMode == APPEND)
+        {
+            offset = mPackedStore->getSize(mFileID);
+        }
+        else if (mMode == READ_WRITE)
+        {
+            offset = mPosition;
+        }
+
+        file_size = mPackedStore->write(mFileID, offset, buffer, bytes, mMode != APPEND && mMode != READ_WRITE);
+        if (file_size >= 0)
+        {
+            mPosition = offset + bytes;
+            success = TRUE;
+        }
+    }
+    else if (mMode == APPEND)
     {
         LLFILE* ofs = LLFile::fopen(mFilePath, TEXT("a+b"));
         if (ofs)
         {
             S32 bytes_written = fwrite(buffer, 1, bytes, ofs);
             mPosition = ftell(ofs);
+            file_size = mPosition;
             fclose(ofs);
             success = (bytes_written == bytes);
         }
@@ -170,6 +260,9 @@ BOOL LLFileSystem::write(const U8* buffer, S32 bytes)
             {
                 S32 bytes_written = fwrite(buffer, 1, bytes, ofs);
                 mPosition = ftell(ofs);
+                // we may have written into the middle of the file
+                fseek(ofs, 0, SEEK_END);
+                file_size = ftell(ofs);
                 fclose(ofs);
                 success = (bytes_written == bytes);
             }
@@ -181,6 +274,7 @@ BOOL LLFileSystem::write(const U8* buffer, S32 bytes)
             {
                 S32 bytes_written = fwrite(buffer, 1, bytes, ofs);
                 mPosition = ftell(ofs);
+                file_size = mPosition;
                 fclose(ofs);
                 success = (bytes_written == bytes);
             }
@@ -193,11 +287,17 @@ BOOL LLFileSystem::write(const U8* buffer, S32 bytes)
         {
             S32 bytes_written = fwrite(buffer, 1, bytes, ofs);
             mPosition = ftell(ofs);
+            file_size = mPosition;
             fclose(ofs);
             success = (bytes_written == bytes);
         }
     }
 
+    if (success)
+    {
+        // keep the cache index up to date so purging never has to walk the directory
+        LLDiskCache::getInstance()->updateFileEntry(mFileID, file_size);
+    }
 
     return success;
 }
@@ -239,6 +339,11 @@ S32 LLFileSystem::tell() const
 
 S32 LLFileSystem::getSize()
 {
+    if (mPackedStore)
+    {
+        return mPackedStore->getSize(mFileID);
+    }
+
     boost::system::error_code ec;
     S32 file_size = boost::filesystem::file_size(mFilePath, ec);
     if(ec.failed())
@@ -258,6 +363,23 @@ BOOL LLFileSystem::rename(const LLUUID& new_id, const LLAssetType::EType new_typ
 {
     const boost::filesystem::path new_filename = LLDiskCache::getInstance()->metaDataToFilepath(new_id, new_type);
 
+    if (mPackedStore)
+    {
+        if (mPackedStore->rename(mFileID, new_id))
+        {
+            LLDiskCache::getInstance()->renameFileEntry(mFileID, new_id);
+        }
+        else
+        {
+            LL_WARNS() << "Failed to rename " << mFileID << " to " << new_id << LL_ENDL;
+        }
+
+        mFileID = new_id;
+        mFileType = new_type;
+        mFilePath = new_filename;
+        return TRUE;
+    }
+
     // Rename needs the new file to not exist.
     boost::system::error_code ec;
     boost::filesystem::remove(new_filename, ec);
@@ -277,6 +399,11 @@ BOOL LLFileSystem::rename(const LLUUID& new_id, const LLAssetType::EType new_typ
         LL_WARNS() << "Failed to rename " << mFileID << " to " << new_id << " reason: "  << ec.what() << LL_ENDL;
     }
 
+    else
+    {
+        LLDiskCache::getInstance()->renameFileEntry(mFileID, new_id);
+    }
+
     mFileID = new_id;
     mFileType = new_type;
     mFilePath = new_filename;
@@ -286,7 +413,15 @@ BOOL LLFileSystem::rename(const LLUUID& new_id, const LLAssetType::EType new_typ
 
 BOOL LLFileSystem::remove()
 {
+    if (mPackedStore)
+    {
+        mPackedStore->remove(mFileID);
+        LLDiskCache::getInstance()->removeFileEntry(mFileID);
+        return TRUE;
+    }
+
     boost::system::error_code ec;
     boost::filesystem::remove(mFilePath, ec);
+    LLDiskCache::getInstance()->removeFileEntry(mFileID);
     return TRUE;
 }
@@ -33,6 +33,9 @@
 #include "lluuid.h"
 #include "llassettype.h"
 #include "lldiskcache.h"
+#include "llmappedfile.h"
+
+class LLPackedFileStore;
 
 class LLFileSystem
 {
@@ -41,6 +44,16 @@ class LLFileSystem
         ~LLFileSystem();
 
         BOOL read(U8* buffer, S32 bytes);
+
+        /**
+         * Like read() but returns a read-only view of the bytes instead of
+         * copying them into a buffer. Assets in the packed store are viewed
+         * in place through a mapping; an asset in its own file is copied
+         * into the view since the file may be rewritten at any time. The
+         * view stays valid after this object is gone. Returns an invalid
+         * view if nothing could be read.
+         */
+        LLMappedFileView mapView(S32 bytes);
         S32  getLastBytesRead();
         BOOL eof();
 
@@ -72,6 +85,7 @@ class LLFileSystem
         S32     mPosition;
         S32     mMode;
         S32     mBytesRead;
+        LLPackedFileStore* mPackedStore;    // owned by LLDiskCache, nullptr for the per-file layout
 //private:
 //    static const std::string idToFilepath(const std::string id, LLAssetType::EType at);
 };
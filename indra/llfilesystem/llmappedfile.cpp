@@ -0,0 +1,220 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief Memory mapping of a whole file.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmappedfile.h"
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+LLMappedFile::~LLMappedFile()
+{
+    unmap();
+}
+
+bool LLMappedFile::map(const std::string& filename)
+{
+    return mapFile(filename, 0, false);
+}
+
+bool LLMappedFile::mapWritable(const std::string& filename, size_t size)
+{
+    return mapFile(filename, size, true);
+}
+
+#if LL_WINDOWS
+
+bool LLMappedFile::mapFile(const std::string& filename, size_t size, bool writable)
+{
+    unmap();
+
+    // Share everything so the owner can keep writing to (and eventually
+    // delete) the file while it is mapped.
+    HANDLE file = CreateFileW(ll_convert_string_to_wide(filename).c_str(),
+                              writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    size = llmax(size, (size_t)file_size.QuadPart);
+    if (size == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // A writable mapping bigger than the file grows the file to match
+    HANDLE mapping = CreateFileMappingW(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                       (DWORD)((U64)size >> 32), (DWORD)((U64)size & 0xffffffff), nullptr);
+    if (!mapping)
+    {
+        LL_WARNS() << "CreateFileMapping failed for " << filename << ": " << GetLastError() << LL_ENDL;
+        CloseHandle(file);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        LL_WARNS() << "MapViewOfFile failed for " << filename << ": " << GetLastError() << LL_ENDL;
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mFileHandle = file;
+    mMappingHandle = mapping;
+    mData = (const U8*)data;
+    mSize = size;
+    mWritable = writable;
+    return true;
+}
+
+void LLMappedFile::unmap()
+{
+    if (mData)
+    {
+        UnmapViewOfFile(mData);
+        mData = nullptr;
+    }
+    if (mMappingHandle)
+    {
+        CloseHandle((HANDLE)mMappingHandle);
+        mMappingHandle = nullptr;
+    }
+    if (mFileHandle)
+    {
+        CloseHandle((HANDLE)mFileHandle);
+        mFileHandle = nullptr;
+    }
+    mSize = 0;
+    mWritable = false;
+}
+
+void LLMappedFile::flush()
+{
+    if (mData && mWritable)
+    {
+        FlushViewOfFile(mData, 0);
+    }
+}
+
+#else // LL_WINDOWS
+
+bool LLMappedFile::mapFile(const std::string& filename, size_t size, bool writable)
+{
+    unmap();
+
+    int fd = writable ? ::open(filename.c_str(), O_RDWR | O_CREAT, 0644) : ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    size = llmax(size, (size_t)file_status.st_size);
+    if (size == 0 || (writable && (size_t)file_status.st_size < size && ::ftruncate(fd, (off_t)size) != 0))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping keeps its own reference to the file, no need to hold on to fd
+    void* data = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        LL_WARNS() << "mmap failed for " << filename << ": " << errno << LL_ENDL;
+        return false;
+    }
+
+    mData = (const U8*)data;
+    mSize = size;
+    mWritable = writable;
+    return true;
+}
+
+void LLMappedFile::unmap()
+{
+    if (mData)
+    {
+        ::munmap((void*)mData, mSize);
+        mData = nullptr;
+    }
+    mSize = 0;
+    mWritable = false;
+}
+
+void LLMappedFile::flush()
+{
+    if (mData && mWritable)
+    {
+        ::msync((void*)mData, mSize, MS_ASYNC);
+    }
+}
+
+#endif // LL_WINDOWS
+
+LLMappedFileView::LLMappedFileView(std::shared_ptr<const LLMappedFile> file, size_t offset, S32 size)
+{
+    if (file && file->isMapped() && size > 0 && offset + (size_t)size <= file->getSize())
+    {
+        mData = file->getData() + offset;
+        mSize = size;
+        mFile = std::move(file);
+    }
+}
+
+LLMappedFileView::LLMappedFileView(std::vector<U8>&& buffer)
+    : mBuffer(std::move(buffer))
+{
+    if (!mBuffer.empty())
+    {
+        mData = mBuffer.data();
+        mSize = (S32)mBuffer.size();
+    }
+}
@@ -0,0 +1,123 @@
+/**
+ * @file llmappedfile.h
+ * @brief Memory mapping of a whole file.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include "linden_common.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * Class LLMappedFile
+ *
+ * Maps a whole file into memory, read-only or for reading and writing.
+ * The mapping covers the size of the file at the time it was mapped; data
+ * written to the file afterwards within that range is visible through the
+ * mapping, anything appended past it is not.
+ *
+ * Typically held through a std::shared_ptr so that readers can keep the
+ * mapping alive while its owner moves on to a new one.
+ */
+class LLMappedFile
+{
+public:
+    LLMappedFile() = default;
+    ~LLMappedFile();
+
+    LLMappedFile(const LLMappedFile&) = delete;
+    LLMappedFile& operator=(const LLMappedFile&) = delete;
+
+    /**
+     * Map the whole of filename read-only. Returns false (and leaves the
+     * object unmapped) if the file does not exist, is empty or cannot be
+     * mapped.
+     */
+    bool map(const std::string& filename);
+
+    /**
+     * Map filename for reading and writing, creating it if needed and
+     * growing it to at least size bytes first. Stores through
+     * getWritableData() end up in the file without any explicit write.
+     */
+    bool mapWritable(const std::string& filename, size_t size);
+    void unmap();
+
+    /**
+     * Start writing out whatever was changed through a writable mapping
+     */
+    void flush();
+
+    bool isMapped() const   { return mData != nullptr; }
+    bool isWritable() const { return mWritable; }
+    const U8* getData() const { return mData; }
+    U8* getWritableData() const { return mWritable ? const_cast<U8*>(mData) : nullptr; }
+    size_t getSize() const  { return mSize; }
+
+private:
+    bool mapFile(const std::string& filename, size_t size, bool writable);
+
+    const U8* mData = nullptr;
+    size_t mSize = 0;
+    bool mWritable = false;
+#if LL_WINDOWS
+    void* mFileHandle = nullptr;    // HANDLE
+    void* mMappingHandle = nullptr; // HANDLE
+#endif
+};
+
+/**
+ * Class LLMappedFileView
+ *
+ * A read-only window onto part of a cached asset. Either points straight
+ * into a shared LLMappedFile, which it keeps alive for as long as the view
+ * exists, or owns a copy of the bytes when the asset could not be mapped.
+ * The bytes must not be written to. Movable, not copyable.
+ */
+class LLMappedFileView
+{
+public:
+    LLMappedFileView() = default;
+    LLMappedFileView(std::shared_ptr<const LLMappedFile> file, size_t offset, S32 size);
+    explicit LLMappedFileView(std::vector<U8>&& buffer);
+
+    LLMappedFileView(LLMappedFileView&&) = default;
+    LLMappedFileView& operator=(LLMappedFileView&&) = default;
+
+    bool isValid() const    { return mData != nullptr; }
+    bool isMapped() const   { return mFile != nullptr; }
+    const U8* getData() const { return mData; }
+    S32 getSize() const     { return mSize; }
+
+private:
+    std::shared_ptr<const LLMappedFile> mFile;
+    std::vector<U8> mBuffer;
+    const U8* mData = nullptr;
+    S32 mSize = 0;
+};
+
+#endif // LL_LLMAPPEDFILE_H
@@ -0,0 +1,919 @@
+/**
+ * @file llpackedfilestore.cpp
+ * @brief Storage of cached assets in a few large pack files.
+ *
+ * See the header for a description of how this works.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpackedfilestore.h"
+
+#include "lldir.h"
+#include <boost/filesystem.hpp>
+#include <chrono>
+
+const std::string PACK_FILENAME_PREFIX = "pack_";
+const std::string PACK_FILENAME_EXT = ".sl_pack";
+const std::string PACK_INDEX_FILENAME = "packs.sl_index";
+
+// Packs are sealed (and mapped) once they grow past this size
+constexpr U64 PACK_SEAL_SIZE = 256ull * 1024ull * 1024ull;
+
+// Sealed packs with less than this fraction of live data get compacted
+constexpr F64 PACK_COMPACT_RATIO = 0.5;
+
+constexpr U32 RECORD_MAGIC = 0x52504C53; // 'SLPR'
+constexpr U32 RECORD_FLAG_DEAD = 0x1;
+
+struct RecordHeader
+{
+    U32 mMagic;
+    U32 mFlags;
+    LLUUID mID;
+    U32 mSize;
+    U32 mCapacity;
+};
+static_assert(sizeof(RecordHeader) == 32, "Pack record headers must be tightly packed");
+
+constexpr U32 PACK_INDEX_MAGIC = 0x58444950; // 'PIDX'
+constexpr U32 PACK_INDEX_VERSION = 1;
+
+struct PackIndexHeader
+{
+    U32 mMagic;
+    U32 mVersion;
+    U64 mCount;
+};
+
+struct PackIndexRecord
+{
+    LLUUID mID;
+    U32 mPack;
+    U32 mSize;
+    U32 mCapacity;
+    U32 mPad;
+    U64 mOffset;
+};
+static_assert(sizeof(PackIndexRecord) == 40, "Pack index records must be tightly packed");
+
+// Returns the pack number for a pack filename, 0 if it is not one
+static U32 pack_number_from_filename(const std::string& filename)
+{
+    if (filename.size() <= PACK_FILENAME_PREFIX.size() + PACK_FILENAME_EXT.size()
+        || filename.compare(0, PACK_FILENAME_PREFIX.size(), PACK_FILENAME_PREFIX) != 0
+        || filename.compare(filename.size() - PACK_FILENAME_EXT.size(), PACK_FILENAME_EXT.size(), PACK_FILENAME_EXT) != 0)
+    {
+        return 0;
+    }
+
+    const std::string number = filename.substr(PACK_FILENAME_PREFIX.size(),
+                                               filename.size() - PACK_FILENAME_PREFIX.size() - PACK_FILENAME_EXT.size());
+    if (number.empty() || number.find_first_not_of("0123456789") != std::string::npos)
+    {
+        return 0;
+    }
+    return (U32)std::stoul(number);
+}
+
+LLPackedFileStore::LLPackedFileStore(const std::string& cache_dir, bool read_only)
+:   mCacheDir(cache_dir),
+    mReadOnly(read_only)
+{
+}
+
+LLPackedFileStore::~LLPackedFileStore()
+{
+    close();
+}
+
+std::string LLPackedFileStore::getPackFilename(U32 number) const
+{
+    return fmt::format("{}{}{}{:04d}{}", mCacheDir, gDirUtilp->getDirDelimiter(), PACK_FILENAME_PREFIX, number, PACK_FILENAME_EXT);
+}
+
+// static
+std::string LLPackedFileStore::getIndexFilename(const std::string& cache_dir)
+{
+    return cache_dir + gDirUtilp->getDirDelimiter() + PACK_INDEX_FILENAME;
+}
+
+void LLPackedFileStore::init()
+{
+    LLMutexLock lock(&mMutex);
+
+    openPacks();
+
+    if (!loadIndex())
+    {
+        auto start_time = std::chrono::high_resolution_clock::now();
+
+        mRecords.clear();
+        for (auto& [number, pack] : mPacks)
+        {
+            scanPack(pack);
+        }
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        LL_INFOS() << "Rebuilt pack index of " << mRecords.size() << " assets in " << execute_time << " ms" << LL_ENDL;
+    }
+
+    for (auto& [number, pack] : mPacks)
+    {
+        pack.mLiveBytes = 0;
+    }
+    for (const auto& [id, record] : mRecords)
+    {
+        mPacks[record.mPack].mLiveBytes += sizeof(RecordHeader) + record.mCapacity;
+    }
+
+    // Keep appending to the newest pack unless it is already full
+    mActivePack = 0;
+    for (auto& [number, pack] : mPacks)
+    {
+        if (number == mPacks.rbegin()->first && pack.mSize < PACK_SEAL_SIZE && !mReadOnly)
+        {
+            mActivePack = number;
+        }
+        else
+        {
+            sealPack(pack);
+        }
+    }
+}
+
+bool LLPackedFileStore::openPacks()
+{
+    boost::system::error_code ec;
+#if LL_WINDOWS
+    boost::filesystem::path cache_path(ll_convert_string_to_wide(mCacheDir));
+#else
+    boost::filesystem::path cache_path(mCacheDir);
+#endif
+    if (!boost::filesystem::is_directory(cache_path, ec) || ec.failed())
+    {
+        return false;
+    }
+
+    boost::filesystem::directory_iterator iter(cache_path, ec);
+    while (iter != boost::filesystem::directory_iterator() && !ec.failed())
+    {
+        if (boost::filesystem::is_regular_file(*iter, ec) && !ec.failed())
+        {
+            const U32 number = pack_number_from_filename(iter->path().filename().string());
+            if (number)
+            {
+                openPack(number, false);
+            }
+        }
+        iter.increment(ec);
+    }
+
+    return !mPacks.empty();
+}
+
+LLPackedFileStore::Pack* LLPackedFileStore::openPack(U32 number, bool create)
+{
+    const std::string filename = getPackFilename(number);
+    LLFILE* file = LLFile::fopen(filename, mReadOnly ? "rb" : (create ? "w+b" : "r+b"));
+    if (!file)
+    {
+        LL_WARNS() << "Unable to open cache pack " << filename << LL_ENDL;
+        return nullptr;
+    }
+
+    Pack& pack = mPacks[number];
+    pack.mNumber = number;
+    pack.mFile = file;
+    fseek(file, 0, SEEK_END);
+    pack.mSize = (U64)ftell(file);
+    return &pack;
+}
+
+void LLPackedFileStore::closePack(Pack& pack)
+{
+    if (pack.mFile)
+    {
+        LLFile::close(pack.mFile);
+        pack.mFile = nullptr;
+    }
+    // Readers may still hold on to the mapping, they keep it alive
+    pack.mMapping.reset();
+}
+
+void LLPackedFileStore::sealPack(Pack& pack)
+{
+    if (pack.mFile)
+    {
+        fflush(pack.mFile);
+    }
+
+    pack.mSealed = true;
+    std::shared_ptr<LLMappedFile> mapping = std::make_shared<LLMappedFile>();
+    if (mapping->map(getPackFilename(pack.mNumber)))
+    {
+        pack.mMapping = mapping;
+    }
+}
+
+LLPackedFileStore::Pack* LLPackedFileStore::getActivePack(U64 bytes_needed)
+{
+    pack_map_t::iterator iter = mPacks.find(mActivePack);
+    if (iter != mPacks.end())
+    {
+        Pack& pack = iter->second;
+        if (pack.mSize == 0 || pack.mSize + bytes_needed <= PACK_SEAL_SIZE)
+        {
+            return &pack;
+        }
+        sealPack(pack);
+    }
+
+    const U32 number = mPacks.empty() ? 1 : mPacks.rbegin()->first + 1;
+    Pack* pack = openPack(number, true);
+    mActivePack = pack ? number : 0;
+    return pack;
+}
+
+bool LLPackedFileStore::loadIndex()
+{
+    const std::string index_path = getIndexFilename(mCacheDir);
+    LLFILE* file = LLFile::fopen(index_path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::vector<PackIndexRecord> records;
+    PackIndexHeader header;
+    bool success = fread(&header, sizeof(PackIndexHeader), 1, file) == 1
+        && header.mMagic == PACK_INDEX_MAGIC
+        && header.mVersion == PACK_INDEX_VERSION;
+    if (success)
+    {
+        records.resize(header.mCount);
+        success = header.mCount == 0 || fread(records.data(), sizeof(PackIndexRecord), header.mCount, file) == header.mCount;
+    }
+    LLFile::close(file);
+
+    if (!mReadOnly)
+    {
+        // If we do not get to save it again on shutdown, rebuild it next time
+        LLFile::remove(index_path);
+    }
+
+    if (!success)
+    {
+        LL_WARNS() << "Cache pack index is invalid, rebuilding it" << LL_ENDL;
+        return false;
+    }
+
+    mRecords.clear();
+    mRecords.reserve(records.size());
+    for (const PackIndexRecord& index_record : records)
+    {
+        pack_map_t::iterator iter = mPacks.find(index_record.mPack);
+        if (iter == mPacks.end()
+            || index_record.mSize > index_record.mCapacity
+            || index_record.mOffset + sizeof(RecordHeader) + index_record.mCapacity > iter->second.mSize)
+        {
+            LL_WARNS() << "Cache pack index does not match the packs, rebuilding it" << LL_ENDL;
+            mRecords.clear();
+            return false;
+        }
+
+        Record& record = mRecords[index_record.mID];
+        record.mPack = index_record.mPack;
+        record.mSize = index_record.mSize;
+        record.mCapacity = index_record.mCapacity;
+        record.mOffset = index_record.mOffset;
+    }
+
+    LL_INFOS() << "Loaded cache pack index of " << mRecords.size() << " assets" << LL_ENDL;
+    return true;
+}
+
+void LLPackedFileStore::saveIndex()
+{
+    if (mReadOnly) return;
+
+    std::vector<PackIndexRecord> records;
+    records.reserve(mRecords.size());
+    for (const auto& [id, record] : mRecords)
+    {
+        PackIndexRecord index_record;
+        index_record.mID = id;
+        index_record.mPack = record.mPack;
+        index_record.mSize = record.mSize;
+        index_record.mCapacity = record.mCapacity;
+        index_record.mPad = 0;
+        index_record.mOffset = record.mOffset;
+        records.push_back(index_record);
+    }
+
+    PackIndexHeader header;
+    header.mMagic = PACK_INDEX_MAGIC;
+    header.mVersion = PACK_INDEX_VERSION;
+    header.mCount = records.size();
+
+    // Write to a temporary file first so a partial write is never loaded
+    const std::string index_path = getIndexFilename(mCacheDir);
+    const std::string temp_path = index_path + ".tmp";
+    LLFILE* file = LLFile::fopen(temp_path, "wb");
+    if (!file)
+    {
+        LL_WARNS() << "Unable to open " << temp_path << " to save the cache pack index" << LL_ENDL;
+        return;
+    }
+
+    bool success = fwrite(&header, sizeof(PackIndexHeader), 1, file) == 1
+        && (records.empty() || fwrite(records.data(), sizeof(PackIndexRecord), records.size(), file) == records.size());
+    LLFile::close(file);
+
+    if (!success || LLFile::rename(temp_path, index_path) != 0)
+    {
+        LL_WARNS() << "Failed to save the cache pack index" << LL_ENDL;
+        LLFile::remove(temp_path, ENOENT);
+    }
+}
+
+void LLPackedFileStore::scanPack(Pack& pack)
+{
+    U64 offset = 0;
+    RecordHeader header;
+    while (offset + sizeof(RecordHeader) <= pack.mSize)
+    {
+        if (fseek(pack.mFile, (long)offset, SEEK_SET) != 0
+            || fread(&header, sizeof(RecordHeader), 1, pack.mFile) != 1
+            || header.mMagic != RECORD_MAGIC
+            || header.mSize > header.mCapacity
+            || offset + sizeof(RecordHeader) + header.mCapacity > pack.mSize)
+        {
+            // Most likely a record that was being appended when the viewer
+            // went away. Everything from here on is lost, new records will
+            // overwrite it if this is the active pack.
+            LL_WARNS() << "Truncated or corrupt record in cache pack " << pack.mNumber << " at offset " << offset << LL_ENDL;
+            pack.mSize = offset;
+            break;
+        }
+
+        if (!(header.mFlags & RECORD_FLAG_DEAD))
+        {
+            // A later live record for the same id supersedes this one
+            Record& record = mRecords[header.mID];
+            record.mPack = pack.mNumber;
+            record.mSize = header.mSize;
+            record.mCapacity = header.mCapacity;
+            record.mOffset = offset;
+        }
+
+        offset += sizeof(RecordHeader) + header.mCapacity;
+    }
+}
+
+bool LLPackedFileStore::readRecord(const Record& record, U32 offset, U8* buffer, U32 bytes)
+{
+    pack_map_t::iterator iter = mPacks.find(record.mPack);
+    if (iter == mPacks.end() || !iter->second.mFile)
+    {
+        return false;
+    }
+
+    Pack& pack = iter->second;
+    const U64 data_offset = record.mOffset + sizeof(RecordHeader) + offset;
+    if (pack.mMapping && data_offset + bytes <= pack.mMapping->getSize())
+    {
+        memcpy(buffer, pack.mMapping->getData() + data_offset, bytes);
+        return true;
+    }
+
+    return fseek(pack.mFile, (long)data_offset, SEEK_SET) == 0
+        && fread(buffer, 1, bytes, pack.mFile) == bytes;
+}
+
+bool LLPackedFileStore::writeHeader(Pack& pack, U64 offset, const LLUUID& id, U32 size, U32 capacity, U32 flags)
+{
+    RecordHeader header;
+    header.mMagic = RECORD_MAGIC;
+    header.mFlags = flags;
+    header.mID = id;
+    header.mSize = size;
+    header.mCapacity = capacity;
+
+    return fseek(pack.mFile, (long)offset, SEEK_SET) == 0
+        && fwrite(&header, sizeof(RecordHeader), 1, pack.mFile) == 1;
+}
+
+bool LLPackedFileStore::appendRecord(const LLUUID& id, const U8* buffer, U32 bytes, Record& record)
+{
+    Pack* pack = getActivePack(sizeof(RecordHeader) + bytes);
+    if (!pack)
+    {
+        return false;
+    }
+
+    const U64 offset = pack->mSize;
+    bool success = writeHeader(*pack, offset, id, bytes, bytes, 0)
+        && (bytes == 0 || fwrite(buffer, 1, bytes, pack->mFile) == bytes);
+    fflush(pack->mFile);
+    if (!success)
+    {
+        LL_WARNS() << "Failed to append " << id << " to cache pack " << pack->mNumber << LL_ENDL;
+        return false;
+    }
+
+    pack->mSize = offset + sizeof(RecordHeader) + bytes;
+    pack->mLiveBytes += sizeof(RecordHeader) + bytes;
+
+    record.mPack = pack->mNumber;
+    record.mSize = bytes;
+    record.mCapacity = bytes;
+    record.mOffset = offset;
+    return true;
+}
+
+void LLPackedFileStore::killRecord(const LLUUID& id, const Record& record)
+{
+    pack_map_t::iterator iter = mPacks.find(record.mPack);
+    if (iter == mPacks.end() || !iter->second.mFile)
+    {
+        return;
+    }
+
+    Pack& pack = iter->second;
+    writeHeader(pack, record.mOffset, id, record.mSize, record.mCapacity, RECORD_FLAG_DEAD);
+    fflush(pack.mFile);
+    pack.mLiveBytes -= llmin(pack.mLiveBytes, (U64)(sizeof(RecordHeader) + record.mCapacity));
+}
+
+bool LLPackedFileStore::exists(const LLUUID& id)
+{
+    LLMutexLock lock(&mMutex);
+    return mRecords.find(id) != mRecords.end();
+}
+
+S32 LLPackedFileStore::getSize(const LLUUID& id)
+{
+    LLMutexLock lock(&mMutex);
+    record_map_t::iterator iter = mRecords.find(id);
+    return iter != mRecords.end() ? (S32)iter->second.mSize : 0;
+}
+
+S32 LLPackedFileStore::read(const LLUUID& id, S32 offset, U8* buffer, S32 bytes)
+{
+    if (offset < 0 || bytes <= 0)
+    {
+        return 0;
+    }
+
+    std::shared_ptr<LLMappedFile> mapping;
+    U64 data_offset = 0;
+    {
+        LLMutexLock lock(&mMutex);
+        record_map_t::iterator iter = mRecords.find(id);
+        if (iter == mRecords.end() || (U32)offset >= iter->second.mSize)
+        {
+            return 0;
+        }
+
+        const Record& record = iter->second;
+        bytes = llmin(bytes, (S32)(record.mSize - offset));
+
+        // Copy out of a mapping without holding the lock, the shared_ptr
+        // keeps it alive if the pack is compacted in the meantime.
+        const Pack& pack = mPacks[record.mPack];
+        data_offset = record.mOffset + sizeof(RecordHeader) + offset;
+        if (pack.mMapping && data_offset + bytes <= pack.mMapping->getSize())
+        {
+            mapping = pack.mMapping;
+        }
+        else if (!readRecord(record, offset, buffer, bytes))
+        {
+            return 0;
+        }
+    }
+
+    if (mapping)
+    {
+        memcpy(buffer, mapping->getData() + data_offset, bytes);
+    }
+    return bytes;
+}
+
+LLMappedFileView LLPackedFileStore::mapView(const LLUUID& id, S32 offset, S32 bytes)
+{
+    if (offset < 0 || bytes <= 0)
+    {
+        return LLMappedFileView();
+    }
+
+    LLMutexLock lock(&mMutex);
+    record_map_t::iterator iter = mRecords.find(id);
+    if (iter == mRecords.end() || (U32)offset >= iter->second.mSize)
+    {
+        return LLMappedFileView();
+    }
+
+    const Record& record = iter->second;
+    bytes = llmin(bytes, (S32)(record.mSize - offset));
+
+    pack_map_t::iterator pack_iter = mPacks.find(record.mPack);
+    if (pack_iter == mPacks.end() || !pack_iter->second.mFile)
+    {
+        return LLMappedFileView();
+    }
+
+    Pack& pack = pack_iter->second;
+    const U64 data_offset = record.mOffset + sizeof(RecordHeader) + offset;
+    if (!pack.mMapping || data_offset + bytes > pack.mMapping->getSize())
+    {
+        // Only the active pack gets here: it is still growing, so map it
+        // again to take in what was appended since. Every write is flushed,
+        // so the new mapping sees all of it. Older views hold on to the
+        // previous mapping.
+        std::shared_ptr<LLMappedFile> mapping = std::make_shared<LLMappedFile>();
+        if (!mapping->map(getPackFilename(pack.mNumber)) || data_offset + bytes > mapping->getSize())
+        {
+            return LLMappedFileView();
+        }
+        pack.mMapping = mapping;
+    }
+
+    return LLMappedFileView(pack.mMapping, (size_t)data_offset, bytes);
+}
+
+S32 LLPackedFileStore::write(const LLUUID& id, S32 offset, const U8* buffer, S32 bytes, bool truncate)
+{
+    if (mReadOnly || offset < 0 || bytes < 0)
+    {
+        return -1;
+    }
+
+    const U64 end = (U64)offset + (U64)bytes;
+    if (end > (U64)S32_MAX)
+    {
+        return -1;
+    }
+
+    LLMutexLock lock(&mMutex);
+
+    record_map_t::iterator iter = mRecords.find(id);
+    if (iter == mRecords.end())
+    {
+        Record record;
+        bool success = false;
+        if (offset == 0)
+        {
+            success = appendRecord(id, buffer, bytes, record);
+        }
+        else
+        {
+            std::vector<U8> data((size_t)end, 0);
+            memcpy(data.data() + offset, buffer, bytes);
+            success = appendRecord(id, data.data(), (U32)end, record);
+        }
+
+        if (!success)
+        {
+            return -1;
+        }
+        mRecords[id] = record;
+        return (S32)end;
+    }
+
+    Record& record = iter->second;
+    Pack& pack = mPacks[record.mPack];
+    const U32 new_size = truncate ? (U32)end : llmax(record.mSize, (U32)end);
+    const bool fits = new_size <= record.mCapacity;
+
+    // The last record in the active pack can simply grow, this is what keeps
+    // chunked downloads that APPEND piece by piece from moving every time.
+    const bool at_tail = !fits
+        && record.mPack == mActivePack
+        && record.mOffset + sizeof(RecordHeader) + record.mCapacity == pack.mSize
+        && record.mOffset + sizeof(RecordHeader) + new_size <= PACK_SEAL_SIZE;
+
+    if (fits || at_tail)
+    {
+        // Writing past the current end leaves a gap that still holds whatever
+        // the previous occupant of this space left behind, zero it first.
+        const U32 gap_start = llmin(record.mSize, (U32)offset);
+        const U32 gap = (U32)offset - gap_start;
+        bool success = fseek(pack.mFile, (long)(record.mOffset + sizeof(RecordHeader) + gap_start), SEEK_SET) == 0;
+        if (success && gap)
+        {
+            std::vector<U8> zeros(gap, 0);
+            success = fwrite(zeros.data(), 1, gap, pack.mFile) == gap;
+        }
+        success = success
+            && (bytes == 0 || fwrite(buffer, 1, bytes, pack.mFile) == (size_t)bytes);
+        if (success && at_tail)
+        {
+            pack.mLiveBytes += new_size - record.mCapacity;
+            pack.mSize = record.mOffset + sizeof(RecordHeader) + new_size;
+            record.mCapacity = new_size;
+        }
+        if (success && (new_size != record.mSize || at_tail))
+        {
+            record.mSize = new_size;
+            success = writeHeader(pack, record.mOffset, id, record.mSize, record.mCapacity, 0);
+        }
+        fflush(pack.mFile);
+        return success ? (S32)new_size : -1;
+    }
+
+    // Move the asset to the end of the active pack, keeping whatever is not
+    // being overwritten.
+    std::vector<U8> data(new_size, 0);
+    const U32 keep = truncate ? llmin(record.mSize, (U32)offset) : record.mSize;
+    if (keep && !readRecord(record, 0, data.data(), keep))
+    {
+        return -1;
+    }
+    if (bytes)
+    {
+        memcpy(data.data() + offset, buffer, bytes);
+    }
+
+    Record new_record;
+    if (!appendRecord(id, data.data(), new_size, new_record))
+    {
+        return -1;
+    }
+
+    killRecord(id, record);
+    record = new_record;
+    return (S32)new_size;
+}
+
+bool LLPackedFileStore::import(const LLUUID& id, const U8* buffer, S32 bytes)
+{
+    if (mReadOnly || bytes < 0)
+    {
+        return false;
+    }
+
+    LLMutexLock lock(&mMutex);
+    if (mRecords.find(id) != mRecords.end())
+    {
+        return false;
+    }
+
+    Record record;
+    if (!appendRecord(id, buffer, bytes, record))
+    {
+        return false;
+    }
+    mRecords[id] = record;
+    return true;
+}
+
+bool LLPackedFileStore::remove(const LLUUID& id)
+{
+    if (mReadOnly) return false;
+
+    LLMutexLock lock(&mMutex);
+    record_map_t::iterator iter = mRecords.find(id);
+    if (iter == mRecords.end())
+    {
+        return false;
+    }
+
+    killRecord(id, iter->second);
+    mRecords.erase(iter);
+    return true;
+}
+
+bool LLPackedFileStore::rename(const LLUUID& old_id, const LLUUID& new_id)
+{
+    if (mReadOnly) return false;
+
+    LLMutexLock lock(&mMutex);
+    record_map_t::iterator iter = mRecords.find(old_id);
+    if (iter == mRecords.end())
+    {
+        return false;
+    }
+
+    const Record record = iter->second;
+    mRecords.erase(iter);
+
+    // Rename needs the new asset to not exist
+    remove(new_id);
+
+    // Only the id in the header changes, the data stays where it is
+    Pack& pack = mPacks[record.mPack];
+    writeHeader(pack, record.mOffset, new_id, record.mSize, record.mCapacity, 0);
+    fflush(pack.mFile);
+    mRecords[new_id] = record;
+    return true;
+}
+
+bool LLPackedFileStore::compact()
+{
+    if (mReadOnly) return false;
+
+    U32 number = 0;
+    std::vector<LLUUID> ids;
+    {
+        LLMutexLock lock(&mMutex);
+
+        for (std::vector<std::string>::iterator iter = mPendingRemovals.begin(); iter != mPendingRemovals.end();)
+        {
+            if (LLFile::remove(*iter, ENOENT) == 0)
+            {
+                iter = mPendingRemovals.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+
+        F64 lowest_ratio = PACK_COMPACT_RATIO;
+        for (const auto& [pack_number, pack] : mPacks)
+        {
+            if (!pack.mSealed || pack_number == mActivePack || pack.mSize == 0)
+            {
+                continue;
+            }
+
+            const F64 ratio = (F64)pack.mLiveBytes / (F64)pack.mSize;
+            if (ratio < lowest_ratio)
+            {
+                lowest_ratio = ratio;
+                number = pack_number;
+            }
+        }
+
+        if (!number)
+        {
+            return false;
+        }
+
+        for (const auto& [id, record] : mRecords)
+        {
+            if (record.mPack == number)
+            {
+                ids.push_back(id);
+            }
+        }
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // Move one record at a time so readers and writers only ever wait for
+    // a single copy.
+    std::vector<U8> data;
+    for (const LLUUID& id : ids)
+    {
+        LLMutexLock lock(&mMutex);
+        record_map_t::iterator iter = mRecords.find(id);
+        if (iter == mRecords.end() || iter->second.mPack != number)
+        {
+            // removed or moved since we looked
+            continue;
+        }
+
+        Record& record = iter->second;
+        data.resize(record.mSize);
+        Record new_record;
+        if (!readRecord(record, 0, data.data(), record.mSize)
+            || !appendRecord(id, data.data(), record.mSize, new_record))
+        {
+            LL_WARNS() << "Failed to compact cache pack " << number << LL_ENDL;
+            return false;
+        }
+        record = new_record;
+    }
+
+    LLMutexLock lock(&mMutex);
+    pack_map_t::iterator iter = mPacks.find(number);
+    if (iter != mPacks.end())
+    {
+        closePack(iter->second);
+        mPacks.erase(iter);
+    }
+
+    const std::string filename = getPackFilename(number);
+    if (LLFile::remove(filename, ENOENT) != 0)
+    {
+        mPendingRemovals.push_back(filename);
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+    LL_INFOS() << "Compacted cache pack " << number << " (" << ids.size() << " assets) in " << execute_time << " ms" << LL_ENDL;
+    return true;
+}
+
+void LLPackedFileStore::close()
+{
+    LLMutexLock lock(&mMutex);
+    if (mPacks.empty() && mRecords.empty())
+    {
+        return;
+    }
+
+    saveIndex();
+    for (auto& [number, pack] : mPacks)
+    {
+        closePack(pack);
+    }
+    mPacks.clear();
+    mRecords.clear();
+    mActivePack = 0;
+}
+
+void LLPackedFileStore::clear()
+{
+    LLMutexLock lock(&mMutex);
+    for (auto& [number, pack] : mPacks)
+    {
+        closePack(pack);
+    }
+    mPacks.clear();
+    mRecords.clear();
+    mActivePack = 0;
+
+    if (!mReadOnly)
+    {
+        removePacks(mCacheDir);
+    }
+}
+
+void LLPackedFileStore::getEntries(std::vector<std::pair<LLUUID, U32>>& entries)
+{
+    LLMutexLock lock(&mMutex);
+    entries.reserve(entries.size() + mRecords.size());
+    for (const auto& [id, record] : mRecords)
+    {
+        entries.emplace_back(id, record.mSize);
+    }
+}
+
+U64 LLPackedFileStore::getPacksSize()
+{
+    LLMutexLock lock(&mMutex);
+    U64 total = 0;
+    for (const auto& [number, pack] : mPacks)
+    {
+        total += pack.mSize;
+    }
+    return total;
+}
+
+// static
+bool LLPackedFileStore::hasPacks(const std::string& cache_dir)
+{
+    boost::system::error_code ec;
+#if LL_WINDOWS
+    boost::filesystem::path cache_path(ll_convert_string_to_wide(cache_dir));
+#else
+    boost::filesystem::path cache_path(cache_dir);
+#endif
+    if (!boost::filesystem::is_directory(cache_path, ec) || ec.failed())
+    {
+        return false;
+    }
+
+    boost::filesystem::directory_iterator iter(cache_path, ec);
+    while (iter != boost::filesystem::directory_iterator() && !ec.failed())
+    {
+        if (pack_number_from_filename(iter->path().filename().string()))
+        {
+            return true;
+        }
+        iter.increment(ec);
+    }
+    return false;
+}
+
+// static
+void LLPackedFileStore::removePacks(const std::string& cache_dir)
+{
+    gDirUtilp->deleteFilesInDir(cache_dir, PACK_FILENAME_PREFIX + "*" + PACK_FILENAME_EXT);
+    LLFile::remove(getIndexFilename(cache_dir), ENOENT);
+}
@@ -0,0 +1,207 @@
+/**
+ * @file llpackedfilestore.h
+ * @brief Storage of cached assets in a few large pack files.
+ *
+ * @Description:
+ * An alternative to one file per asset for the disk cache, used by
+ * LLFileSystem when LLDiskCache is initialized with the packed store
+ * enabled.
+ * 1/ Assets are stored as records in pack files named pack_NNNN.sl_pack
+ *    in the cache directory. Each record is a RecordHeader (id, size,
+ *    capacity, flags) followed by capacity bytes of payload.
+ * 2/ New records are only ever appended to the active pack. Once it grows
+ *    past PACK_SEAL_SIZE it is sealed, memory mapped for reading and a new
+ *    active pack is started. Writes that fit in a record's capacity are
+ *    done in place, anything bigger moves the record to the end of the
+ *    active pack and marks the old copy dead.
+ * 3/ An in-memory index maps asset ids to records. It is saved next to the
+ *    packs on shutdown and removed once loaded, so after a crash it is
+ *    rebuilt by walking the record headers in every pack.
+ *    The active pack is also mapped, on demand, for mapView() and is
+ *    mapped again whenever a view is asked for past the end of the last
+ *    mapping.
+ * 4/ Dead records are reclaimed by compact(), which copies the live
+ *    records out of the emptiest sealed pack and deletes it. It is run
+ *    from LLPurgeDiskCacheThread.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKEDFILESTORE_H
+#define LL_LLPACKEDFILESTORE_H
+
+#include "lluuid.h"
+#include "llmutex.h"
+#include "llmappedfile.h"
+
+#include "boost/unordered/unordered_flat_map.hpp"
+
+#include <map>
+
+class LLPackedFileStore
+{
+public:
+    LLPackedFileStore(const std::string& cache_dir, bool read_only);
+    ~LLPackedFileStore();
+
+    LLPackedFileStore(const LLPackedFileStore&) = delete;
+    LLPackedFileStore& operator=(const LLPackedFileStore&) = delete;
+
+    /**
+     * Open the packs in the cache directory and load or rebuild the index
+     */
+    void init();
+
+    bool exists(const LLUUID& id);
+
+    /**
+     * Size of the asset in bytes, 0 if it is not in the store
+     */
+    S32 getSize(const LLUUID& id);
+
+    /**
+     * Copy up to bytes of the asset starting at offset into buffer.
+     * Returns the number of bytes copied.
+     */
+    S32 read(const LLUUID& id, S32 offset, U8* buffer, S32 bytes);
+
+    /**
+     * View up to bytes of the asset starting at offset without copying
+     * them. The view stays readable even if the asset is removed, moved or
+     * compacted away afterwards, though an in place overwrite of the same
+     * record shows through. Returns an invalid view if the asset is not in
+     * the store or its pack cannot be mapped.
+     */
+    LLMappedFileView mapView(const LLUUID& id, S32 offset, S32 bytes);
+
+    /**
+     * Write bytes at offset into the asset, creating it if needed. When
+     * truncate is set, the asset ends after the written bytes, otherwise it
+     * only ever grows. Returns the new size of the asset, or -1 on failure.
+     */
+    S32 write(const LLUUID& id, S32 offset, const U8* buffer, S32 bytes, bool truncate);
+
+    /**
+     * Add an asset that is not in the store yet. Used to move files over
+     * from the per-file layout; returns false if the id is already present
+     * since whatever is there is newer.
+     */
+    bool import(const LLUUID& id, const U8* buffer, S32 bytes);
+
+    bool remove(const LLUUID& id);
+    bool rename(const LLUUID& old_id, const LLUUID& new_id);
+
+    /**
+     * Reclaim the space held by dead records in the emptiest sealed pack.
+     * Returns true if a pack was compacted, so the caller can decide
+     * whether to keep going.
+     */
+    bool compact();
+
+    /**
+     * Save the index so the next session does not need to rebuild it.
+     * Closes every pack, the store is unusable afterwards.
+     */
+    void close();
+
+    /**
+     * Close and delete every pack and the saved index
+     */
+    void clear();
+
+    /**
+     * Ids and sizes of all the assets in the store
+     */
+    void getEntries(std::vector<std::pair<LLUUID, U32>>& entries);
+
+    /**
+     * Total size of the packs, live and dead records included
+     */
+    U64 getPacksSize();
+
+    /**
+     * True if there are pack files in cache_dir. Used to find leftovers
+     * when the packed store is turned off.
+     */
+    static bool hasPacks(const std::string& cache_dir);
+
+    /**
+     * Delete the pack files and saved index in cache_dir
+     */
+    static void removePacks(const std::string& cache_dir);
+
+private:
+    struct Pack
+    {
+        U32 mNumber = 0;
+        LLFILE* mFile = nullptr;
+        U64 mSize = 0;
+        U64 mLiveBytes = 0;
+        bool mSealed = false;
+        std::shared_ptr<LLMappedFile> mMapping;
+    };
+
+    struct Record
+    {
+        U32 mPack = 0;
+        U32 mSize = 0;
+        U32 mCapacity = 0;
+        U64 mOffset = 0;    // of the RecordHeader within the pack
+    };
+
+    typedef boost::unordered_flat_map<LLUUID, Record> record_map_t;
+    typedef std::map<U32, Pack> pack_map_t;
+
+    std::string getPackFilename(U32 number) const;
+    static std::string getIndexFilename(const std::string& cache_dir);
+
+    bool openPacks();
+    Pack* openPack(U32 number, bool create);
+    void closePack(Pack& pack);
+    void sealPack(Pack& pack);
+    Pack* getActivePack(U64 bytes_needed);
+
+    bool loadIndex();
+    void saveIndex();
+    void scanPack(Pack& pack);
+
+    bool readRecord(const Record& record, U32 offset, U8* buffer, U32 bytes);
+    bool writeHeader(Pack& pack, U64 offset, const LLUUID& id, U32 size, U32 capacity, U32 flags);
+    bool appendRecord(const LLUUID& id, const U8* buffer, U32 bytes, Record& record);
+    void killRecord(const LLUUID& id, const Record& record);
+
+    std::string mCacheDir;
+    bool mReadOnly = false;
+
+    // Guards everything below. LLMutex is recursive which keeps the helpers
+    // above simple, none of them lock on their own.
+    LLMutex mMutex;
+    record_map_t mRecords;
+    pack_map_t mPacks;
+    U32 mActivePack = 0;
+
+    // Packs compacted while still mapped by a reader on a platform that
+    // does not allow deleting a mapped file. Retried on the next compact().
+    std::vector<std::string> mPendingRemovals;
+};
+
+#endif // LL_LLPACKEDFILESTORE_H
@@ -0,0 +1,260 @@
+/**
+ * @file llpackedfilestore_test.cpp
+ * @brief LLPackedFileStore test cases.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpackedfilestore.h"
+#include "../lldir.h"
+
+#include "lltut.h"
+
+namespace tut
+{
+    struct LLPackedFileStoreFixture
+    {
+        LLPackedFileStoreFixture()
+        {
+            LLUUID dir_id;
+            dir_id.generate();
+            mDir = gDirUtilp->add(LLFile::tmpdir(), "packedstore_" + dir_id.asString());
+            LLFile::mkdir(mDir);
+        }
+
+        ~LLPackedFileStoreFixture()
+        {
+            LLPackedFileStore::removePacks(mDir);
+            LLFile::rmdir(mDir);
+        }
+
+        std::string readAll(LLPackedFileStore& store, const LLUUID& id)
+        {
+            std::string result(store.getSize(id), '\0');
+            S32 bytes = store.read(id, 0, (U8*)result.data(), (S32)result.size());
+            result.resize(bytes);
+            return result;
+        }
+
+        S32 writeString(LLPackedFileStore& store, const LLUUID& id, S32 offset, const std::string& data, bool truncate)
+        {
+            return store.write(id, offset, (const U8*)data.data(), (S32)data.size(), truncate);
+        }
+
+        std::string mDir;
+    };
+    typedef test_group<LLPackedFileStoreFixture> LLPackedFileStoreTest_factory;
+    typedef LLPackedFileStoreTest_factory::object LLPackedFileStoreTest_t;
+    LLPackedFileStoreTest_factory tf("LLPackedFileStore");
+
+    template<> template<>
+    void LLPackedFileStoreTest_t::test<1>()
+    {
+        set_test_name("write, append, overwrite and read back");
+
+        LLPackedFileStore store(mDir, false);
+        store.init();
+
+        LLUUID id;
+        id.generate();
+        ensure("empty store", !store.exists(id));
+
+        ensure_equals("write", writeString(store, id, 0, "hello", true), 5);
+        ensure_equals("append", writeString(store, id, 5, " world", false), 11);
+        ensure_equals("appended contents", readAll(store, id), std::string("hello world"));
+
+        ensure_equals("overwrite in place", writeString(store, id, 0, "HELLO", false), 11);
+        ensure_equals("overwritten contents", readAll(store, id), std::string("HELLO world"));
+
+        ensure_equals("truncating write", writeString(store, id, 0, "bye", true), 3);
+        ensure_equals("truncated contents", readAll(store, id), std::string("bye"));
+
+        U8 buffer[2];
+        ensure_equals("partial read", store.read(id, 1, buffer, 8), 2);
+        ensure("partial read contents", buffer[0] == 'y' && buffer[1] == 'e');
+    }
+
+    template<> template<>
+    void LLPackedFileStoreTest_t::test<2>()
+    {
+        set_test_name("growing a record that is not last moves it");
+
+        LLPackedFileStore store(mDir, false);
+        store.init();
+
+        LLUUID first, second;
+        first.generate();
+        second.generate();
+
+        writeString(store, first, 0, "first", true);
+        writeString(store, second, 0, "second", true);
+        ensure_equals("grow", writeString(store, first, 5, " grown", false), 11);
+        ensure_equals("moved contents", readAll(store, first), std::string("first grown"));
+        ensure_equals("neighbour untouched", readAll(store, second), std::string("second"));
+    }
+
+    template<> template<>
+    void LLPackedFileStoreTest_t::test<3>()
+    {
+        set_test_name("rename and remove");
+
+        LLPackedFileStore store(mDir, false);
+        store.init();
+
+        LLUUID old_id, new_id;
+        old_id.generate();
+        new_id.generate();
+
+        writeString(store, old_id, 0, "asset", true);
+        writeString(store, new_id, 0, "replaced", true);
+        ensure("rename", store.rename(old_id, new_id));
+        ensure("old id gone", !store.exists(old_id));
+        ensure_equals("renamed contents", readAll(store, new_id), std::string("asset"));
+
+        ensure("remove", store.remove(new_id));
+        ensure("removed", !store.exists(new_id));
+        ensure("remove missing", !store.remove(new_id));
+    }
+
+    template<> template<>
+    void LLPackedFileStoreTest_t::test<4>()
+    {
+        set_test_name("reopen with and without the saved index");
+
+        LLUUID kept, removed, other;
+        kept.generate();
+        removed.generate();
+        other.generate();
+        {
+            LLPackedFileStore store(mDir, false);
+            store.init();
+            writeString(store, kept, 0, "kept", true);
+            writeString(store, removed, 0, "removed", true);
+            writeString(store, other, 0, "first", true);
+            writeString(store, kept, 4, " and grown", false);
+            store.remove(removed);
+        }
+
+        {
+            // the destructor saved the index
+            LLPackedFileStore store(mDir, false);
+            store.init();
+            ensure_equals("indexed contents", readAll(store, kept), std::string("kept and grown"));
+            ensure("indexed removal", !store.exists(removed));
+            ensure_equals("indexed other", readAll(store, other), std::string("first"));
+        }
+        // as if the viewer crashed and never saved it
+        LLFile::remove(gDirUtilp->add(mDir, "packs.sl_index"), ENOENT);
+
+        {
+            // no index, rebuilt from the record headers
+            LLPackedFileStore store(mDir, false);
+            store.init();
+            ensure_equals("scanned contents", readAll(store, kept), std::string("kept and grown"));
+            ensure("scanned removal", !store.exists(removed));
+            ensure_equals("scanned other", readAll(store, other), std::string("first"));
+        }
+    }
+
+    template<> template<>
+    void LLPackedFileStoreTest_t::test<5>()
+    {
+        set_test_name("import does not replace newer data");
+
+        LLPackedFileStore store(mDir, false);
+        store.init();
+
+        LLUUID id;
+        id.generate();
+        std::string data("imported");
+        ensure("import", store.import(id, (const U8*)data.data(), (S32)data.size()));
+        ensure("import again", !store.import(id, (const U8*)"stale", 5));
+        ensure_equals("imported contents", readAll(store, id), data);
+    }
+
+    template<> template<>
+    void LLPackedFileStoreTest_t::test<6>()
+    {
+        set_test_name("read only store does not write");
+
+        LLUUID id;
+        id.generate();
+        {
+            LLPackedFileStore store(mDir, false);
+            store.init();
+            writeString(store, id, 0, "data", true);
+        }
+
+        LLPackedFileStore store(mDir, true);
+        store.init();
+        ensure_equals("readable", readAll(store, id), std::string("data"));
+        ensure_equals("write fails", writeString(store, id, 0, "x", true), -1);
+        ensure("remove fails", !store.remove(id));
+    }
+
+    template<> template<>
+    void LLPackedFileStoreTest_t::test<7>()
+    {
+        set_test_name("mapped views");
+
+        LLPackedFileStore store(mDir, false);
+        store.init();
+
+        LLUUID first, second;
+        first.generate();
+        second.generate();
+
+        writeString(store, first, 0, "mapped data", true);
+        LLMappedFileView view = store.mapView(first, 7, 100);
+        ensure("mapped", view.isValid() && view.isMapped());
+        ensure_equals("clamped view", std::string((const char*)view.getData(), view.getSize()), std::string("data"));
+
+        // appended after the active pack was mapped
+        writeString(store, second, 0, "appended", true);
+        LLMappedFileView later = store.mapView(second, 0, 8);
+        ensure("remapped", later.isValid());
+        ensure_equals("remapped contents", std::string((const char*)later.getData(), later.getSize()), std::string("appended"));
+
+        store.remove(first);
+        ensure("no view of a removed asset", !store.mapView(first, 0, 1).isValid());
+        ensure_equals("view outlives removal", std::string((const char*)view.getData(), view.getSize()), std::string("data"));
+    }
+
+    template<> template<>
+    void LLPackedFileStoreTest_t::test<8>()
+    {
+        set_test_name("writing past the end of a shrunk record zero fills the gap");
+
+        LLPackedFileStore store(mDir, false);
+        store.init();
+
+        LLUUID id;
+        id.generate();
+
+        writeString(store, id, 0, "0123456789", true);
+        ensure_equals("shrink", writeString(store, id, 0, "ab", true), 2);
+        ensure_equals("gap write", writeString(store, id, 5, "X", false), 6);
+        ensure_equals("gap contents", readAll(store, id), std::string("ab\0\0\0X", 6));
+    }
+}
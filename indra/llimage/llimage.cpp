@@ -40,6 +40,7 @@
 #include "llimagepng.h"
 #include "llimagewebp.h"
 #include "llimagedxt.h"
+#include "llimagekernels.h"
 #include "llmemory.h"
 
 #include <boost/preprocessor.hpp>
@@ -223,6 +224,66 @@ struct scale_info
 };
 
 
+// Same result as the scale up branch of bilinear_scale(), blending each pair
+// of source rows first and then interpolating along the blended row, so
+// both passes can use the vector kernels
+template<U8 ch>
+void bilinear_scale_up_rows(const scale_info<ch>& info, U32 srcW, U32 srcStride, U8 *dst, U32 dstW, U32 dstH, U32 dstStride)
+{
+    std::vector<U16> row(srcW * ch + LLImageKernels::ROW_PADDING);
+    // bilinear_scale() does not interpolate horizontally on rows without a
+    // vertical weight either, it weights the left pixel twice
+    const std::vector<S32> no_xapoints(dstW, 0);
+
+    for(U32 y = 0; y < dstH; ++y)
+    {
+        const U8 *top = info.ystrides[y];
+        const S32 yap = info.yapoints[y];
+        // the row below is only read when it has a weight, top may be the last row
+        LLImageKernels::blendRows(top, yap > 0 ? top + srcStride : top, row.data(), srcW * ch, yap);
+        LLImageKernels::interpolateRow(row.data(), dst + (y * dstStride), dstW, ch, info.xpoints.data(),
+                                       yap > 0 ? info.xapoints.data() : no_xapoints.data());
+    }
+}
+
+// Same result as the scale x/y down branch of bilinear_scale(), one source
+// row at a time
+template<U8 ch>
+void box_scale_down_rows(const scale_info<ch>& info, U32 srcStride, U8 *dst, U32 dstW, U32 dstH, U32 dstStride)
+{
+    const S32 count = dstW * ch;
+    std::vector<S32> row(count);
+    std::vector<S32> comp(count);
+
+    for(U32 y = 0; y < dstH; ++y)
+    {
+        const S32 Cy = info.yapoints[y] >> 16;
+        const S32 yap = info.yapoints[y] & 0xffff;
+        const U8 *sptr = info.ystrides[y];
+
+        std::fill(comp.begin(), comp.end(), 0);
+        LLImageKernels::boxRow(sptr, row.data(), dstW, ch, info.xpoints.data(), info.xapoints.data());
+        LLImageKernels::accumulateRow(row.data(), comp.data(), count, yap);
+
+        S32 j;
+        for(j = (1 << 14) - yap; j > Cy; j -= Cy)
+        {
+            sptr += srcStride;
+            LLImageKernels::boxRow(sptr, row.data(), dstW, ch, info.xpoints.data(), info.xapoints.data());
+            LLImageKernels::accumulateRow(row.data(), comp.data(), count, Cy);
+        }
+
+        if(j > 0)
+        {
+            sptr += srcStride;
+            LLImageKernels::boxRow(sptr, row.data(), dstW, ch, info.xpoints.data(), info.xapoints.data());
+            LLImageKernels::accumulateRow(row.data(), comp.data(), count, j);
+        }
+
+        LLImageKernels::packRow(comp.data(), dst + (y * dstStride), count, 23);
+    }
+}
+
 template<U8 ch>
 inline void bilinear_scale(
     const U8 *src, U32 srcW, U32 srcH, U32 srcStride
@@ -233,6 +294,22 @@ inline void bilinear_scale(
 
     scale_info_t info(src, srcW, srcH, dstW, dstH, srcStride);
 
+    if (LLImageKernels::getInstructionSet() != LLImageKernels::SCALAR)
+    {
+        // Scaling down along only one axis stays on the code below, and so
+        // does scaling down fewer than 4 components which is faster there
+        if(3 == info.xup_yup)
+        {
+            bilinear_scale_up_rows(info, srcW, srcStride, dst, dstW, dstH, dstStride);
+            return;
+        }
+        if(0 == info.xup_yup && 4 == ch)
+        {
+            box_scale_down_rows(info, srcStride, dst, dstW, dstH, dstStride);
+            return;
+        }
+    }
+
     const U8 *sptr;
     U8 *dptr;
     U32 x, y;
@@ -597,6 +674,7 @@ void LLImage::initClass(bool use_new_byte_range, S32 minimal_reverse_byte_range_
 {
     sUseNewByteRange = use_new_byte_range;
     sMinimalReverseByteRangePercent = minimal_reverse_byte_range_percent;
+    LLImageKernels::initClass();
 }
 
 //static
@@ -1142,14 +1220,6 @@ void LLImageRaw::biasedScaleToPowerOfTwo(S32 max_dim)
     scale( new_width, new_height );
 }
 
-// Calculates (U8)(255*(a/255.f)*(b/255.f) + 0.5f).  Thanks, Jim Blinn!
-inline U8 LLImageRaw::fastFractionalMult( U8 a, U8 b )
-{
-    U32 i = a * b + 128;
-    return U8((i + (i>>8)) >> 8);
-}
-
-
 void LLImageRaw::composite( LLImageRaw* src )
 {
     LLImageRaw* dst = this;  // Just for clarity.
@@ -1194,27 +1264,15 @@ void LLImageRaw::composite( LLImageRaw* src )
 // Src and dst can be any size.  Src has 4 components.  Dst has 3 components.
 void LLImageRaw::compositeScaled4onto3(LLImageRaw* src)
 {
-    LL_INFOS() << "compositeScaled4onto3" << LL_ENDL;
-
     LLImageRaw* dst = this;  // Just for clarity.
 
     llassert( (4 == src->getComponents()) && (3 == dst->getComponents()) );
 
-    S32 temp_data_size = src->getWidth() * dst->getHeight() * src->getComponents();
-    llassert(temp_data_size > 0);
-    std::vector<U8> temp_buffer(temp_data_size);
-
-    // Vertical: scale but no composite
-    for( S32 col = 0; col < src->getWidth(); col++ )
-    {
-        copyLineScaled( src->getData() + (src->getComponents() * col), &temp_buffer[0] + (src->getComponents() * col), src->getHeight(), dst->getHeight(), src->getWidth(), src->getWidth() );
-    }
+    LLImageRaw temp(dst->getWidth(), dst->getHeight(), src->getComponents());
+    llassert_always(temp.getDataSize() > 0);
+    temp.copyScaled(src);
 
-    // Horizontal: scale and composite
-    for( S32 row = 0; row < dst->getHeight(); row++ )
-    {
-        compositeRowScaled4onto3( &temp_buffer[0] + (src->getComponents() * src->getWidth() * row), dst->getData() + (dst->getComponents() * dst->getWidth() * row), src->getWidth(), dst->getWidth() );
-    }
+    dst->compositeUnscaled4onto3(&temp);
 }
 
 
@@ -1248,30 +1306,7 @@ void LLImageRaw::compositeUnscaled4onto3( LLImageRaw* src )
         return;
     }
 
-    while( pixels-- )
-    {
-        U8 alpha = src_data[3];
-        if( alpha )
-        {
-            if( 255 == alpha )
-            {
-                dst_data[0] = src_data[0];
-                dst_data[1] = src_data[1];
-                dst_data[2] = src_data[2];
-            }
-            else
-            {
-
-                U8 transparency = 255 - alpha;
-                dst_data[0] = fastFractionalMult( dst_data[0], transparency ) + fastFractionalMult( src_data[0], alpha );
-                dst_data[1] = fastFractionalMult( dst_data[1], transparency ) + fastFractionalMult( src_data[1], alpha );
-                dst_data[2] = fastFractionalMult( dst_data[2], transparency ) + fastFractionalMult( src_data[2], alpha );
-            }
-        }
-
-        src_data += 4;
-        dst_data += 3;
-    }
+    LLImageKernels::compositeRow4onto3(src_data, dst_data, pixels);
 }
 
 
@@ -1345,19 +1380,7 @@ void LLImageRaw::tint( const LLColor3& color )
         return;
     }
 
-    S32 pixels = getWidth() * getHeight();
-    const S32 components = getComponents();
-    U8* data = getData();
-    for( S32 i = 0; i < pixels; i++ )
-    {
-        const float c0 = data[0] * color.mV[0];
-        const float c1 = data[1] * color.mV[1];
-        const float c2 = data[2] * color.mV[2];
-        data[0] = llclamp((U8)c0, 0, 255);
-        data[1] = llclamp((U8)c1, 0, 255);
-        data[2] = llclamp((U8)c2, 0, 255);
-        data += components;
-    }
+    LLImageKernels::tintRow(getData(), getComponents(), getWidth() * getHeight(), color.mV);
 }
 
 LLPointer<LLImageRaw> LLImageRaw::duplicate()
@@ -1526,24 +1549,6 @@ void LLImageRaw::copyScaled( LLImageRaw* src )
             src->getData(), src->getWidth(), src->getHeight(), src->getComponents(), src->getWidth()*src->getComponents()
         ,   dst->getData(), dst->getWidth(), dst->getHeight(), dst->getComponents(), dst->getWidth()*dst->getComponents()
     );
-
-    /*
-    S32 temp_data_size = src->getWidth() * dst->getHeight() * getComponents();
-    llassert_always(temp_data_size > 0);
-    std::vector<U8> temp_buffer(temp_data_size);
-
-    // Vertical
-    for( S32 col = 0; col < src->getWidth(); col++ )
-    {
-        copyLineScaled( src->getData() + (getComponents() * col), &temp_buffer[0] + (getComponents() * col), src->getHeight(), dst->getHeight(), src->getWidth(), src->getWidth() );
-    }
-
-    // Horizontal
-    for( S32 row = 0; row < dst->getHeight(); row++ )
-    {
-        copyLineScaled( &temp_buffer[0] + (getComponents() * src->getWidth() * row), dst->getData() + (getComponents() * dst->getWidth() * row), src->getWidth(), dst->getWidth(), 1, 1 );
-    }
-    */
 }
 
 
@@ -1683,218 +1688,6 @@ LLPointer<LLImageRaw> LLImageRaw::scaled(S32 new_width, S32 new_height)
     return result;
 }
 
-void LLImageRaw::copyLineScaled( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step )
-{
-    const S32 components = getComponents();
-    llassert( components >= 1 && components <= 4 );
-
-    const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
-    const F32 norm_factor = 1.f / ratio;
-
-    S32 goff = components >= 2 ? 1 : 0;
-    S32 boff = components >= 3 ? 2 : 0;
-    for( S32 x = 0; x < out_pixel_len; x++ )
-    {
-        // Sample input pixels in range from sample0 to sample1.
-        // Avoid floating point accumulation error... don't just add ratio each time.  JC
-        const F32 sample0 = x * ratio;
-        const F32 sample1 = (x+1) * ratio;
-        const S32 index0 = llfloor(sample0);            // left integer (floor)
-        const S32 index1 = llfloor(sample1);            // right integer (floor)
-        const F32 fract0 = 1.f - (sample0 - F32(index0));   // spill over on left
-        const F32 fract1 = sample1 - F32(index1);           // spill-over on right
-
-        if( index0 == index1 )
-        {
-            // Interval is embedded in one input pixel
-            S32 t0 = x * out_pixel_step * components;
-            S32 t1 = index0 * in_pixel_step * components;
-            U8* outp = out + t0;
-            U8* inp = in + t1;
-            for (S32 i = 0; i < components; ++i)
-            {
-                *outp = *inp;
-                ++outp;
-                ++inp;
-            }
-        }
-        else
-        {
-            // Left straddle
-            S32 t1 = index0 * in_pixel_step * components;
-            F32 r = in[t1 + 0] * fract0;
-            F32 g = in[t1 + goff] * fract0;
-            F32 b = in[t1 + boff] * fract0;
-            F32 a = 0;
-            if( components == 4)
-            {
-                a = in[t1 + 3] * fract0;
-            }
-
-            // Central interval
-            if (components < 4)
-            {
-                for( S32 u = index0 + 1; u < index1; u++ )
-                {
-                    S32 t2 = u * in_pixel_step * components;
-                    r += in[t2 + 0];
-                    g += in[t2 + goff];
-                    b += in[t2 + boff];
-                }
-            }
-            else
-            {
-                for( S32 u = index0 + 1; u < index1; u++ )
-                {
-                    S32 t2 = u * in_pixel_step * components;
-                    r += in[t2 + 0];
-                    g += in[t2 + 1];
-                    b += in[t2 + 2];
-                    a += in[t2 + 3];
-                }
-            }
-
-            // right straddle
-            // Watch out for reading off of end of input array.
-            if( fract1 && index1 < in_pixel_len )
-            {
-                S32 t3 = index1 * in_pixel_step * components;
-                if (components < 4)
-                {
-                    U8 in0 = in[t3 + 0];
-                    U8 in1 = in[t3 + goff];
-                    U8 in2 = in[t3 + boff];
-                    r += in0 * fract1;
-                    g += in1 * fract1;
-                    b += in2 * fract1;
-                }
-                else
-                {
-                    U8 in0 = in[t3 + 0];
-                    U8 in1 = in[t3 + 1];
-                    U8 in2 = in[t3 + 2];
-                    U8 in3 = in[t3 + 3];
-                    r += in0 * fract1;
-                    g += in1 * fract1;
-                    b += in2 * fract1;
-                    a += in3 * fract1;
-                }
-            }
-
-            r *= norm_factor;
-            g *= norm_factor;
-            b *= norm_factor;
-            a *= norm_factor;  // skip conditional
-
-            S32 t4 = x * out_pixel_step * components;
-            out[t4 + 0] = U8(ll_round(r));
-            if (components >= 2)
-                out[t4 + 1] = U8(ll_round(g));
-            if (components >= 3)
-                out[t4 + 2] = U8(ll_round(b));
-            if( components == 4)
-                out[t4 + 3] = U8(ll_round(a));
-        }
-    }
-}
-
-void LLImageRaw::compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len )
-{
-    llassert( getComponents() == 3 );
-
-    const S32 IN_COMPONENTS = 4;
-    const S32 OUT_COMPONENTS = 3;
-
-    const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
-    const F32 norm_factor = 1.f / ratio;
-
-    for( S32 x = 0; x < out_pixel_len; x++ )
-    {
-        // Sample input pixels in range from sample0 to sample1.
-        // Avoid floating point accumulation error... don't just add ratio each time.  JC
-        const F32 sample0 = x * ratio;
-        const F32 sample1 = (x+1) * ratio;
-        const S32 index0 = S32(sample0);            // left integer (floor)
-        const S32 index1 = S32(sample1);            // right integer (floor)
-        const F32 fract0 = 1.f - (sample0 - F32(index0));   // spill over on left
-        const F32 fract1 = sample1 - F32(index1);           // spill-over on right
-
-        U8 in_scaled_r;
-        U8 in_scaled_g;
-        U8 in_scaled_b;
-        U8 in_scaled_a;
-
-        if( index0 == index1 )
-        {
-            // Interval is embedded in one input pixel
-            S32 t1 = index0 * IN_COMPONENTS;
-            in_scaled_r = in[t1 + 0];
-            in_scaled_g = in[t1 + 0];
-            in_scaled_b = in[t1 + 0];
-            in_scaled_a = in[t1 + 0];
-        }
-        else
-        {
-            // Left straddle
-            S32 t1 = index0 * IN_COMPONENTS;
-            F32 r = in[t1 + 0] * fract0;
-            F32 g = in[t1 + 1] * fract0;
-            F32 b = in[t1 + 2] * fract0;
-            F32 a = in[t1 + 3] * fract0;
-
-            // Central interval
-            for( S32 u = index0 + 1; u < index1; u++ )
-            {
-                S32 t2 = u * IN_COMPONENTS;
-                r += in[t2 + 0];
-                g += in[t2 + 1];
-                b += in[t2 + 2];
-                a += in[t2 + 3];
-            }
-
-            // right straddle
-            // Watch out for reading off of end of input array.
-            if( fract1 && index1 < in_pixel_len )
-            {
-                S32 t3 = index1 * IN_COMPONENTS;
-                r += in[t3 + 0] * fract1;
-                g += in[t3 + 1] * fract1;
-                b += in[t3 + 2] * fract1;
-                a += in[t3 + 3] * fract1;
-            }
-
-            r *= norm_factor;
-            g *= norm_factor;
-            b *= norm_factor;
-            a *= norm_factor;
-
-            in_scaled_r = U8(ll_round(r));
-            in_scaled_g = U8(ll_round(g));
-            in_scaled_b = U8(ll_round(b));
-            in_scaled_a = U8(ll_round(a));
-        }
-
-        if( in_scaled_a )
-        {
-            if( 255 == in_scaled_a )
-            {
-                out[0] = in_scaled_r;
-                out[1] = in_scaled_g;
-                out[2] = in_scaled_b;
-            }
-            else
-            {
-                U8 transparency = 255 - in_scaled_a;
-                out[0] = fastFractionalMult( out[0], transparency ) + fastFractionalMult( in_scaled_r, in_scaled_a );
-                out[1] = fastFractionalMult( out[1], transparency ) + fastFractionalMult( in_scaled_g, in_scaled_a );
-                out[2] = fastFractionalMult( out[2], transparency ) + fastFractionalMult( in_scaled_b, in_scaled_a );
-            }
-        }
-        out += OUT_COMPONENTS;
-    }
-}
-
-
 void LLImageRaw::addEmissive(LLImageRaw* src)
 {
     LLImageRaw* dst = this;  // Just for clarity.
@@ -1928,23 +1721,8 @@ void LLImageRaw::addEmissiveUnscaled(LLImageRaw* src)
     llassert((3 == dst->getComponents()) || (4 == dst->getComponents()));
     llassert( (src->getWidth() == dst->getWidth()) && (src->getHeight() == dst->getHeight()) );
 
-    U8* const src_data = src->getData();
-    U8* const dst_data = dst->getData();
-    for(S32 y = 0; y < dst->getHeight(); ++y)
-    {
-        const S32 src_row_offset = src->getComponents() * src->getWidth() * y;
-        const S32 dst_row_offset = dst->getComponents() * dst->getWidth() * y;
-        for (S32 x = 0; x < dst->getWidth(); ++x)
-        {
-            const S32 src_offset = src_row_offset + (x * src->getComponents());
-            const S32 dst_offset = dst_row_offset + (x * dst->getComponents());
-            U8* const src_pixel = src_data + src_offset;
-            U8* const dst_pixel = dst_data + dst_offset;
-            dst_pixel[0] = llmin(255, dst_pixel[0] + src_pixel[0]);
-            dst_pixel[1] = llmin(255, dst_pixel[1] + src_pixel[1]);
-            dst_pixel[2] = llmin(255, dst_pixel[2] + src_pixel[2]);
-        }
-    }
+    // Rows are packed, so the whole image is one long row
+    LLImageKernels::addRow(src->getData(), src->getComponents(), dst->getData(), dst->getComponents(), dst->getWidth() * dst->getHeight());
 }
 
 void LLImageRaw::addEmissiveScaled(LLImageRaw* src)
@@ -0,0 +1,773 @@
+/**
+ * @file llimagekernels.cpp
+ * @brief Scalar, SSE4.1 and AVX2 row kernels for LLImageRaw.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llimagekernels.h"
+#include "llmath.h"
+#include "llprocessor.h"
+
+// Every x86 configuration we build for targets SSE4.1 except 32 bit Windows,
+// which only gets the scalar kernels. MSVC allows the intrinsics regardless
+// of /arch, GCC and clang need the AVX2 functions marked for that target.
+#if LL_MSVC && ADDRESS_SIZE == 64
+#   define LL_IMAGE_SIMD_KERNELS 1
+#   define LL_AVX2_TARGET
+#elif defined(__SSE4_1__)
+#   define LL_IMAGE_SIMD_KERNELS 1
+#   define LL_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#   define LL_IMAGE_SIMD_KERNELS 0
+#endif
+
+#if LL_IMAGE_SIMD_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // Calculates (U8)(255*(a/255.f)*(b/255.f) + 0.5f), like LLImageRaw::composite() always did
+    inline U8 fractional_mult(U8 a, U8 b)
+    {
+        U32 i = a * b + 128;
+        return U8((i + (i >> 8)) >> 8);
+    }
+
+    //-----------------------------------------------------------------------
+    // Scalar kernels
+    //-----------------------------------------------------------------------
+
+    void composite_4onto3_scalar(const U8* src, U8* dst, S32 pixels)
+    {
+        while (pixels-- > 0)
+        {
+            U8 alpha = src[3];
+            if (alpha)
+            {
+                if (255 == alpha)
+                {
+                    dst[0] = src[0];
+                    dst[1] = src[1];
+                    dst[2] = src[2];
+                }
+                else
+                {
+                    U8 transparency = 255 - alpha;
+                    dst[0] = fractional_mult(dst[0], transparency) + fractional_mult(src[0], alpha);
+                    dst[1] = fractional_mult(dst[1], transparency) + fractional_mult(src[1], alpha);
+                    dst[2] = fractional_mult(dst[2], transparency) + fractional_mult(src[2], alpha);
+                }
+            }
+
+            src += 4;
+            dst += 3;
+        }
+    }
+
+    void add_scalar(const U8* src, S32 src_components, U8* dst, S32 dst_components, S32 pixels)
+    {
+        for (S32 i = 0; i < pixels; ++i)
+        {
+            dst[0] = llmin(255, dst[0] + src[0]);
+            dst[1] = llmin(255, dst[1] + src[1]);
+            dst[2] = llmin(255, dst[2] + src[2]);
+            src += src_components;
+            dst += dst_components;
+        }
+    }
+
+    void tint_scalar(U8* data, S32 components, S32 pixels, const F32* color)
+    {
+        for (S32 i = 0; i < pixels; ++i)
+        {
+            const float c0 = data[0] * color[0];
+            const float c1 = data[1] * color[1];
+            const float c2 = data[2] * color[2];
+            data[0] = llclamp((U8)c0, 0, 255);
+            data[1] = llclamp((U8)c1, 0, 255);
+            data[2] = llclamp((U8)c2, 0, 255);
+            data += components;
+        }
+    }
+
+    void blend_rows_scalar(const U8* top, const U8* bottom, U16* dst, S32 count, S32 weight)
+    {
+        for (S32 i = 0; i < count; ++i)
+        {
+            dst[i] = U16(top[i] * (256 - weight) + bottom[i] * weight);
+        }
+    }
+
+    void interpolate_row_scalar(const U16* src, U8* dst, S32 width, S32 components, const S32* xpoints, const S32* xapoints)
+    {
+        for (S32 x = 0; x < width; ++x)
+        {
+            const U16* pix = src + xpoints[x] * components;
+            const S32 xap = xapoints[x];
+            for (S32 c = 0; c < components; ++c)
+            {
+                *dst++ = U8(((pix[c] * (256 - xap) + pix[c + components] * xap) >> 16) & 0xff);
+            }
+        }
+    }
+
+    void box_row_scalar(const U8* src, S32* dst, S32 width, S32 components, const S32* xpoints, const S32* xapoints)
+    {
+        S32 cx[4];
+        for (S32 x = 0; x < width; ++x)
+        {
+            const S32 Cx = xapoints[x] >> 16;
+            const S32 xap = xapoints[x] & 0xffff;
+            const U8* pix = src + xpoints[x] * components;
+
+            for (S32 c = 0; c < components; ++c)
+            {
+                cx[c] = pix[c] * xap;
+            }
+            pix += components;
+
+            S32 i;
+            for (i = (1 << 14) - xap; i > Cx; i -= Cx)
+            {
+                for (S32 c = 0; c < components; ++c)
+                {
+                    cx[c] += pix[c] * Cx;
+                }
+                pix += components;
+            }
+
+            if (i > 0)
+            {
+                for (S32 c = 0; c < components; ++c)
+                {
+                    cx[c] += pix[c] * i;
+                }
+            }
+
+            for (S32 c = 0; c < components; ++c)
+            {
+                *dst++ = cx[c] >> 5;
+            }
+        }
+    }
+
+    void accumulate_row_scalar(const S32* src, S32* dst, S32 count, S32 weight)
+    {
+        for (S32 i = 0; i < count; ++i)
+        {
+            dst[i] += src[i] * weight;
+        }
+    }
+
+    void pack_row_scalar(const S32* src, U8* dst, S32 count, S32 shift)
+    {
+        for (S32 i = 0; i < count; ++i)
+        {
+            dst[i] = U8((src[i] >> shift) & 0xff);
+        }
+    }
+
+    // Tails of rows the vector loops stop short of
+
+    void add_bytes_tail(const U8* src, U8* dst, S32 start, S32 bytes, S32 components)
+    {
+        for (S32 i = start; i < bytes; ++i)
+        {
+            if (components == 3 || (i & 3) != 3)
+            {
+                dst[i] = llmin(255, dst[i] + src[i]);
+            }
+        }
+    }
+
+    void tint_bytes_tail(U8* data, S32 start, S32 bytes, S32 components, const F32* color)
+    {
+        for (S32 i = start; i < bytes; ++i)
+        {
+            const S32 c = i % components;
+            if (c < 3)
+            {
+                data[i] = (U8)(data[i] * color[c]);
+            }
+        }
+    }
+
+#if LL_IMAGE_SIMD_KERNELS
+    //-----------------------------------------------------------------------
+    // SSE4.1 kernels
+    //-----------------------------------------------------------------------
+
+    // fractional_mult() on 16 bit lanes. a * b + 128 and the sum after it
+    // both fit in 16 unsigned bits.
+    inline __m128i fractional_mult_epi16(__m128i a, __m128i b)
+    {
+        const __m128i i = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(i, _mm_srli_epi16(i, 8)), 8);
+    }
+
+    // src * alpha + dst * (255 - alpha) on bytes. Without the branches of
+    // the scalar code, which gives the same result: alpha 0 keeps dst and
+    // alpha 255 gives src.
+    inline __m128i blend_epu8(__m128i src, __m128i dst, __m128i alpha)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i transparency = _mm_sub_epi8(_mm_set1_epi8(-1), alpha);
+        const __m128i lo = _mm_add_epi16(
+            fractional_mult_epi16(_mm_unpacklo_epi8(dst, zero), _mm_unpacklo_epi8(transparency, zero)),
+            fractional_mult_epi16(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(alpha, zero)));
+        const __m128i hi = _mm_add_epi16(
+            fractional_mult_epi16(_mm_unpackhi_epi8(dst, zero), _mm_unpackhi_epi8(transparency, zero)),
+            fractional_mult_epi16(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(alpha, zero)));
+        return _mm_packus_epi16(lo, hi);
+    }
+
+    // Shuffles between 4 RGB pixels and 4 RGBA ones
+    inline __m128i expand_rgb_mask()  { return _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1); }
+    inline __m128i splat_alpha_mask() { return _mm_setr_epi8(3, 3, 3, -1, 7, 7, 7, -1, 11, 11, 11, -1, 15, 15, 15, -1); }
+    inline __m128i pack_rgb_mask()    { return _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1); }
+    inline __m128i rgb_tail_mask()    { return _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1); }
+
+    void composite_4onto3_sse41(const U8* src, U8* dst, S32 pixels)
+    {
+        const __m128i expand_rgb = expand_rgb_mask();
+        const __m128i splat_alpha = splat_alpha_mask();
+        const __m128i pack_rgb = pack_rgb_mask();
+        const __m128i rgb_tail = rgb_tail_mask();
+
+        // 16 bytes of dst are read and written back for every 4 pixels,
+        // the 4 past them unchanged, so stop while those are in the row
+        S32 x = 0;
+        for (; x + 6 <= pixels; x += 4)
+        {
+            const __m128i s = _mm_loadu_si128((const __m128i*)(src + x * 4));
+            const __m128i d = _mm_loadu_si128((const __m128i*)(dst + x * 3));
+            const __m128i blended = blend_epu8(s, _mm_shuffle_epi8(d, expand_rgb), _mm_shuffle_epi8(s, splat_alpha));
+            const __m128i result = _mm_or_si128(_mm_shuffle_epi8(blended, pack_rgb), _mm_and_si128(d, rgb_tail));
+            _mm_storeu_si128((__m128i*)(dst + x * 3), result);
+        }
+        composite_4onto3_scalar(src + x * 4, dst + x * 3, pixels - x);
+    }
+
+    void add_sse41(const U8* src, S32 src_components, U8* dst, S32 dst_components, S32 pixels)
+    {
+        if (src_components == dst_components)
+        {
+            // Same layout, add whole rows at once with the alpha of src masked off
+            const __m128i mask = dst_components == 4 ? _mm_set1_epi32(0x00ffffff) : _mm_set1_epi8(-1);
+            const S32 bytes = pixels * dst_components;
+            S32 i = 0;
+            for (; i + 16 <= bytes; i += 16)
+            {
+                const __m128i s = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i)), mask);
+                const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+                _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(d, s));
+            }
+            add_bytes_tail(src, dst, i, bytes, dst_components);
+        }
+        else if (src_components == 4 && dst_components == 3)
+        {
+            const __m128i pack_rgb = pack_rgb_mask();
+
+            // Same bounds as composite_4onto3_sse41(), the last 4 bytes get 0 added
+            S32 x = 0;
+            for (; x + 6 <= pixels; x += 4)
+            {
+                const __m128i s = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + x * 4)), pack_rgb);
+                const __m128i d = _mm_loadu_si128((const __m128i*)(dst + x * 3));
+                _mm_storeu_si128((__m128i*)(dst + x * 3), _mm_adds_epu8(d, s));
+            }
+            add_scalar(src + x * 4, src_components, dst + x * 3, dst_components, pixels - x);
+        }
+        else
+        {
+            add_scalar(src, src_components, dst, dst_components, pixels);
+        }
+    }
+
+    // Multipliers for every byte of a 3 or 4 component row, starting at
+    // each of the components. Alpha is multiplied by 1.
+    struct TintTable
+    {
+        TintTable(S32 components, const F32* color)
+        {
+            for (S32 phase = 0; phase < 3; ++phase)
+            {
+                for (S32 i = 0; i < 32; ++i)
+                {
+                    const S32 c = (phase + i) % components;
+                    mMult[phase][i] = c < 3 ? color[c] : 1.f;
+                }
+            }
+        }
+
+        alignas(32) F32 mMult[3][32];
+    };
+
+    // Multiply 4 bytes by 4 floats, truncating
+    inline __m128i tint4_epi32(__m128i bytes, const F32* mult)
+    {
+        return _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(bytes)), _mm_load_ps(mult)));
+    }
+
+    void tint_sse41(U8* data, S32 components, S32 pixels, const F32* color)
+    {
+        if (components != 3 && components != 4)
+        {
+            tint_scalar(data, components, pixels, color);
+            return;
+        }
+
+        const TintTable table(components, color);
+        const S32 bytes = pixels * components;
+        S32 i = 0;
+        for (; i + 16 <= bytes; i += 16)
+        {
+            const F32* mult = table.mMult[i % components];
+            const __m128i d = _mm_loadu_si128((const __m128i*)(data + i));
+            const __m128i q0 = tint4_epi32(d, mult);
+            const __m128i q1 = tint4_epi32(_mm_srli_si128(d, 4), mult + 4);
+            const __m128i q2 = tint4_epi32(_mm_srli_si128(d, 8), mult + 8);
+            const __m128i q3 = tint4_epi32(_mm_srli_si128(d, 12), mult + 12);
+            const __m128i result = _mm_packus_epi16(_mm_packus_epi32(q0, q1), _mm_packus_epi32(q2, q3));
+            _mm_storeu_si128((__m128i*)(data + i), result);
+        }
+        tint_bytes_tail(data, i, bytes, components, color);
+    }
+
+    void blend_rows_sse41(const U8* top, const U8* bottom, U16* dst, S32 count, S32 weight)
+    {
+        // Both products and their sum fit in 16 unsigned bits
+        const __m128i top_weight = _mm_set1_epi16(S16(256 - weight));
+        const __m128i bottom_weight = _mm_set1_epi16(S16(weight));
+        const __m128i zero = _mm_setzero_si128();
+        S32 i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i t = _mm_loadu_si128((const __m128i*)(top + i));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(bottom + i));
+            const __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(t, zero), top_weight),
+                                             _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), bottom_weight));
+            const __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(t, zero), top_weight),
+                                             _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), bottom_weight));
+            _mm_storeu_si128((__m128i*)(dst + i), lo);
+            _mm_storeu_si128((__m128i*)(dst + i + 8), hi);
+        }
+        blend_rows_scalar(top + i, bottom + i, dst + i, count - i, weight);
+    }
+
+    // (left * (256 - xap) + right * xap) >> 16 on 32 bit lanes, which cannot
+    // overflow since both are at most 255 * 256
+    inline __m128i interpolate_epi32(__m128i left, __m128i right, S32 xap)
+    {
+        const __m128i sum = _mm_add_epi32(_mm_mullo_epi32(left, _mm_set1_epi32(256 - xap)),
+                                          _mm_mullo_epi32(right, _mm_set1_epi32(xap)));
+        const __m128i result = _mm_srli_epi32(sum, 16);
+        return _mm_packus_epi16(_mm_packus_epi32(result, result), result);
+    }
+
+    void interpolate_row_sse41(const U16* src, U8* dst, S32 width, S32 components, const S32* xpoints, const S32* xapoints)
+    {
+        // Each load picks up a pixel and its right neighbour, reading into
+        // the padding past the end of the row for the last pixel
+        if (components == 4)
+        {
+            for (S32 x = 0; x < width; ++x)
+            {
+                const __m128i v = _mm_loadu_si128((const __m128i*)(src + xpoints[x] * 4));
+                const __m128i result = interpolate_epi32(_mm_cvtepu16_epi32(v), _mm_cvtepu16_epi32(_mm_srli_si128(v, 8)), xapoints[x]);
+                const U32 pixel = (U32)_mm_cvtsi128_si32(result);
+                memcpy(dst + x * 4, &pixel, 4);
+            }
+        }
+        else if (components == 3)
+        {
+            for (S32 x = 0; x < width; ++x)
+            {
+                const __m128i v = _mm_loadu_si128((const __m128i*)(src + xpoints[x] * 3));
+                const __m128i result = interpolate_epi32(_mm_cvtepu16_epi32(v), _mm_cvtepu16_epi32(_mm_srli_si128(v, 6)), xapoints[x]);
+                const U32 pixel = (U32)_mm_cvtsi128_si32(result);
+                memcpy(dst + x * 3, &pixel, 3);
+            }
+        }
+        else
+        {
+            interpolate_row_scalar(src, dst, width, components, xpoints, xapoints);
+        }
+    }
+
+    inline __m128i load_pixel_epi32(const U8* pix, S32 components)
+    {
+        U32 value = pix[0] | (pix[1] << 8) | (pix[2] << 16);
+        if (components == 4)
+        {
+            value |= (U32)pix[3] << 24;
+        }
+        return _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)value));
+    }
+
+    void box_row_sse41(const U8* src, S32* dst, S32 width, S32 components, const S32* xpoints, const S32* xapoints)
+    {
+        if (components != 3 && components != 4)
+        {
+            box_row_scalar(src, dst, width, components, xpoints, xapoints);
+            return;
+        }
+
+        for (S32 x = 0; x < width; ++x)
+        {
+            const S32 Cx = xapoints[x] >> 16;
+            const S32 xap = xapoints[x] & 0xffff;
+            const U8* pix = src + xpoints[x] * components;
+
+            __m128i cx = _mm_mullo_epi32(load_pixel_epi32(pix, components), _mm_set1_epi32(xap));
+            pix += components;
+
+            // The pixels in the middle all have the same weight, sum them
+            // first and multiply once
+            __m128i middle = _mm_setzero_si128();
+            S32 i;
+            for (i = (1 << 14) - xap; i > Cx; i -= Cx)
+            {
+                middle = _mm_add_epi32(middle, load_pixel_epi32(pix, components));
+                pix += components;
+            }
+            cx = _mm_add_epi32(cx, _mm_mullo_epi32(middle, _mm_set1_epi32(Cx)));
+
+            if (i > 0)
+            {
+                cx = _mm_add_epi32(cx, _mm_mullo_epi32(load_pixel_epi32(pix, components), _mm_set1_epi32(i)));
+            }
+
+            cx = _mm_srai_epi32(cx, 5);
+            if (components == 4)
+            {
+                _mm_storeu_si128((__m128i*)dst, cx);
+            }
+            else
+            {
+                _mm_storel_epi64((__m128i*)dst, cx);
+                dst[2] = _mm_extract_epi32(cx, 2);
+            }
+            dst += components;
+        }
+    }
+
+    void accumulate_row_sse41(const S32* src, S32* dst, S32 count, S32 weight)
+    {
+        const __m128i w = _mm_set1_epi32(weight);
+        S32 i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+            const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi32(d, _mm_mullo_epi32(s, w)));
+        }
+        accumulate_row_scalar(src + i, dst + i, count - i, weight);
+    }
+
+    void pack_row_sse41(const S32* src, U8* dst, S32 count, S32 shift)
+    {
+        const __m128i shift_count = _mm_cvtsi32_si128(shift);
+        const __m128i low_byte = _mm_set1_epi32(0xff);
+        S32 i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i q[4];
+            for (S32 k = 0; k < 4; ++k)
+            {
+                q[k] = _mm_and_si128(_mm_sra_epi32(_mm_loadu_si128((const __m128i*)(src + i + k * 4)), shift_count), low_byte);
+            }
+            const __m128i result = _mm_packus_epi16(_mm_packus_epi32(q[0], q[1]), _mm_packus_epi32(q[2], q[3]));
+            _mm_storeu_si128((__m128i*)(dst + i), result);
+        }
+        pack_row_scalar(src + i, dst + i, count - i, shift);
+    }
+
+    //-----------------------------------------------------------------------
+    // AVX2 kernels
+    // The kernels without an AVX2 version here use the SSE4.1 one, AVX2
+    // hardware always has SSE4.1.
+    //-----------------------------------------------------------------------
+
+    LL_AVX2_TARGET inline __m256i combine_m128i(__m128i lo, __m128i hi)
+    {
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    }
+
+    LL_AVX2_TARGET inline __m256i fractional_mult_epi16_avx2(__m256i a, __m256i b)
+    {
+        const __m256i i = _mm256_add_epi16(_mm256_mullo_epi16(a, b), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(i, _mm256_srli_epi16(i, 8)), 8);
+    }
+
+    LL_AVX2_TARGET inline __m256i blend_epu8_avx2(__m256i src, __m256i dst, __m256i alpha)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i transparency = _mm256_sub_epi8(_mm256_set1_epi8(-1), alpha);
+        const __m256i lo = _mm256_add_epi16(
+            fractional_mult_epi16_avx2(_mm256_unpacklo_epi8(dst, zero), _mm256_unpacklo_epi8(transparency, zero)),
+            fractional_mult_epi16_avx2(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(alpha, zero)));
+        const __m256i hi = _mm256_add_epi16(
+            fractional_mult_epi16_avx2(_mm256_unpackhi_epi8(dst, zero), _mm256_unpackhi_epi8(transparency, zero)),
+            fractional_mult_epi16_avx2(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(alpha, zero)));
+        return _mm256_packus_epi16(lo, hi);
+    }
+
+    LL_AVX2_TARGET void composite_4onto3_avx2(const U8* src, U8* dst, S32 pixels)
+    {
+        // Byte shuffles only work within each 128 bit half, so each half
+        // gets 4 pixels laid out like in composite_4onto3_sse41()
+        const __m256i expand_rgb = _mm256_broadcastsi128_si256(expand_rgb_mask());
+        const __m256i splat_alpha = _mm256_broadcastsi128_si256(splat_alpha_mask());
+        const __m256i pack_rgb = _mm256_broadcastsi128_si256(pack_rgb_mask());
+        const __m256i rgb_tail = _mm256_broadcastsi128_si256(rgb_tail_mask());
+
+        S32 x = 0;
+        for (; x + 10 <= pixels; x += 8)
+        {
+            U8* out = dst + x * 3;
+            const __m256i s = _mm256_loadu_si256((const __m256i*)(src + x * 4));
+            const __m256i d = combine_m128i(_mm_loadu_si128((const __m128i*)out), _mm_loadu_si128((const __m128i*)(out + 12)));
+            const __m256i blended = blend_epu8_avx2(s, _mm256_shuffle_epi8(d, expand_rgb), _mm256_shuffle_epi8(s, splat_alpha));
+            const __m256i result = _mm256_or_si256(_mm256_shuffle_epi8(blended, pack_rgb), _mm256_and_si256(d, rgb_tail));
+            // The low half carries 4 stale bytes the high half overwrites, store it first
+            _mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(result));
+            _mm_storeu_si128((__m128i*)(out + 12), _mm256_extracti128_si256(result, 1));
+        }
+        composite_4onto3_sse41(src + x * 4, dst + x * 3, pixels - x);
+    }
+
+    LL_AVX2_TARGET void add_avx2(const U8* src, S32 src_components, U8* dst, S32 dst_components, S32 pixels)
+    {
+        if (src_components != dst_components)
+        {
+            add_sse41(src, src_components, dst, dst_components, pixels);
+            return;
+        }
+
+        const __m256i mask = dst_components == 4 ? _mm256_set1_epi32(0x00ffffff) : _mm256_set1_epi8(-1);
+        const S32 bytes = pixels * dst_components;
+        S32 i = 0;
+        for (; i + 32 <= bytes; i += 32)
+        {
+            const __m256i s = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(src + i)), mask);
+            const __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_adds_epu8(d, s));
+        }
+        add_bytes_tail(src, dst, i, bytes, dst_components);
+    }
+
+    LL_AVX2_TARGET inline __m256i tint8_epi32(__m128i bytes, const F32* mult)
+    {
+        return _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)), _mm256_load_ps(mult)));
+    }
+
+    LL_AVX2_TARGET void tint_avx2(U8* data, S32 components, S32 pixels, const F32* color)
+    {
+        if (components != 3 && components != 4)
+        {
+            tint_scalar(data, components, pixels, color);
+            return;
+        }
+
+        const TintTable table(components, color);
+        // The packs below interleave the 128 bit halves, put them back in order
+        const __m256i unshuffle = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        const S32 bytes = pixels * components;
+        S32 i = 0;
+        for (; i + 32 <= bytes; i += 32)
+        {
+            const F32* mult = table.mMult[i % components];
+            const __m128i lo = _mm_loadu_si128((const __m128i*)(data + i));
+            const __m128i hi = _mm_loadu_si128((const __m128i*)(data + i + 16));
+            const __m256i q0 = tint8_epi32(lo, mult);
+            const __m256i q1 = tint8_epi32(_mm_srli_si128(lo, 8), mult + 8);
+            const __m256i q2 = tint8_epi32(hi, mult + 16);
+            const __m256i q3 = tint8_epi32(_mm_srli_si128(hi, 8), mult + 24);
+            const __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(q0, q1), _mm256_packus_epi32(q2, q3));
+            _mm256_storeu_si256((__m256i*)(data + i), _mm256_permutevar8x32_epi32(packed, unshuffle));
+        }
+        tint_bytes_tail(data, i, bytes, components, color);
+    }
+
+    LL_AVX2_TARGET void blend_rows_avx2(const U8* top, const U8* bottom, U16* dst, S32 count, S32 weight)
+    {
+        const __m256i top_weight = _mm256_set1_epi16(S16(256 - weight));
+        const __m256i bottom_weight = _mm256_set1_epi16(S16(weight));
+        S32 i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m256i t = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(top + i)));
+            const __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(bottom + i)));
+            const __m256i result = _mm256_add_epi16(_mm256_mullo_epi16(t, top_weight), _mm256_mullo_epi16(b, bottom_weight));
+            _mm256_storeu_si256((__m256i*)(dst + i), result);
+        }
+        blend_rows_scalar(top + i, bottom + i, dst + i, count - i, weight);
+    }
+
+    LL_AVX2_TARGET void interpolate_row_avx2(const U16* src, U8* dst, S32 width, S32 components, const S32* xpoints, const S32* xapoints)
+    {
+        if (components != 4)
+        {
+            interpolate_row_sse41(src, dst, width, components, xpoints, xapoints);
+            return;
+        }
+
+        // Two output pixels at a time, one per 128 bit half
+        S32 x = 0;
+        for (; x + 2 <= width; x += 2)
+        {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(src + xpoints[x] * 4));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(src + xpoints[x + 1] * 4));
+            const __m256i left = _mm256_cvtepu16_epi32(_mm_unpacklo_epi64(a, b));
+            const __m256i right = _mm256_cvtepu16_epi32(_mm_unpackhi_epi64(a, b));
+            const S32 xa = xapoints[x];
+            const S32 xb = xapoints[x + 1];
+            const __m256i left_weight = _mm256_setr_epi32(256 - xa, 256 - xa, 256 - xa, 256 - xa, 256 - xb, 256 - xb, 256 - xb, 256 - xb);
+            const __m256i right_weight = _mm256_setr_epi32(xa, xa, xa, xa, xb, xb, xb, xb);
+            __m256i result = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(left, left_weight), _mm256_mullo_epi32(right, right_weight)), 16);
+            result = _mm256_packus_epi16(_mm256_packus_epi32(result, result), result);
+            const U32 first = (U32)_mm_cvtsi128_si32(_mm256_castsi256_si128(result));
+            const U32 second = (U32)_mm_cvtsi128_si32(_mm256_extracti128_si256(result, 1));
+            memcpy(dst + x * 4, &first, 4);
+            memcpy(dst + x * 4 + 4, &second, 4);
+        }
+        interpolate_row_sse41(src, dst + x * 4, width - x, components, xpoints + x, xapoints + x);
+    }
+
+    LL_AVX2_TARGET void accumulate_row_avx2(const S32* src, S32* dst, S32 count, S32 weight)
+    {
+        const __m256i w = _mm256_set1_epi32(weight);
+        S32 i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+            const __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_add_epi32(d, _mm256_mullo_epi32(s, w)));
+        }
+        accumulate_row_scalar(src + i, dst + i, count - i, weight);
+    }
+#endif // LL_IMAGE_SIMD_KERNELS
+}
+
+const LLImageKernels::Kernels LLImageKernels::sKernelTable[INSTRUCTION_SET_COUNT] =
+{
+    {
+        composite_4onto3_scalar,
+        add_scalar,
+        tint_scalar,
+        blend_rows_scalar,
+        interpolate_row_scalar,
+        box_row_scalar,
+        accumulate_row_scalar,
+        pack_row_scalar
+    },
+#if LL_IMAGE_SIMD_KERNELS
+    {
+        composite_4onto3_sse41,
+        add_sse41,
+        tint_sse41,
+        blend_rows_sse41,
+        interpolate_row_sse41,
+        box_row_sse41,
+        accumulate_row_sse41,
+        pack_row_sse41
+    },
+    {
+        composite_4onto3_avx2,
+        add_avx2,
+        tint_avx2,
+        blend_rows_avx2,
+        interpolate_row_avx2,
+        box_row_sse41,
+        accumulate_row_avx2,
+        pack_row_sse41
+    }
+#else
+    // never selected, see isSupported()
+    {},
+    {}
+#endif
+};
+
+const LLImageKernels::Kernels* LLImageKernels::sKernels = &LLImageKernels::sKernelTable[LLImageKernels::SCALAR];
+LLImageKernels::EInstructionSet LLImageKernels::sInstructionSet = LLImageKernels::SCALAR;
+
+//static
+void LLImageKernels::initClass()
+{
+    EInstructionSet set = setInstructionSet(AVX2);
+    LL_INFOS("Image") << "Using " << getName(set) << " image kernels" << LL_ENDL;
+}
+
+//static
+LLImageKernels::EInstructionSet LLImageKernels::setInstructionSet(EInstructionSet set)
+{
+    while (set > SCALAR && !isSupported(set))
+    {
+        set = EInstructionSet(set - 1);
+    }
+    sInstructionSet = set;
+    sKernels = &sKernelTable[set];
+    return set;
+}
+
+//static
+bool LLImageKernels::isSupported(EInstructionSet set)
+{
+#if LL_IMAGE_SIMD_KERNELS
+    static const LLProcessorInfo proc;
+    switch (set)
+    {
+    case SCALAR:
+        return true;
+    case SSE41:
+        return proc.hasSSE41();
+    case AVX2:
+        return proc.hasAVX2();
+    default:
+        return false;
+    }
+#else
+    return set == SCALAR;
+#endif
+}
+
+//static
+const char* LLImageKernels::getName(EInstructionSet set)
+{
+    switch (set)
+    {
+    case SCALAR:
+        return "scalar";
+    case SSE41:
+        return "SSE4.1";
+    case AVX2:
+        return "AVX2";
+    default:
+        return "unknown";
+    }
+}
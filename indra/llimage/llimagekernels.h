@@ -0,0 +1,162 @@
+/**
+ * @file llimagekernels.h
+ * @brief Row kernels used by LLImageRaw for scaling, compositing, tinting
+ * and emissive blending, with SIMD versions picked at runtime.
+ *
+ * @Description:
+ * Every kernel has a scalar version and, where it pays off, SSE4.1 and AVX2
+ * versions. initClass() picks the widest instruction set the CPU supports;
+ * setInstructionSet() lets tests and benchmarks force a narrower one.
+ * All versions of a kernel produce the same bytes.
+ *
+ * The scaling kernels split LLImageRaw's bilinear_scale into a vertical and
+ * a horizontal pass over rows. Both passes keep full precision and only
+ * round once at the end, so the result matches the one pass scalar code.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLIMAGEKERNELS_H
+#define LL_LLIMAGEKERNELS_H
+
+class LLImageKernels
+{
+public:
+    enum EInstructionSet
+    {
+        SCALAR = 0,
+        SSE41,
+        AVX2,
+        INSTRUCTION_SET_COUNT
+    };
+
+    // Extra elements blendRows() callers must allocate past the end of the
+    // row they hand to interpolateRow(), which reads whole vectors
+    static const S32 ROW_PADDING = 8;
+
+    /**
+     * Use the widest instruction set the CPU supports
+     */
+    static void initClass();
+
+    /**
+     * Use the given instruction set, or the widest supported one below it.
+     * Returns the instruction set now in use.
+     */
+    static EInstructionSet setInstructionSet(EInstructionSet set);
+    static EInstructionSet getInstructionSet() { return sInstructionSet; }
+    static bool isSupported(EInstructionSet set);
+    static const char* getName(EInstructionSet set);
+
+    /**
+     * Blend pixels of 4 component src over 3 component dst using src alpha
+     */
+    static void compositeRow4onto3(const U8* src, U8* dst, S32 pixels)
+    {
+        sKernels->mComposite4onto3(src, dst, pixels);
+    }
+
+    /**
+     * Add the color of src to the color of dst, saturating at 255.
+     * Either can have 3 or 4 components, the alpha of dst is left alone.
+     */
+    static void addRow(const U8* src, S32 src_components, U8* dst, S32 dst_components, S32 pixels)
+    {
+        sKernels->mAdd(src, src_components, dst, dst_components, pixels);
+    }
+
+    /**
+     * Multiply the color of 3 or 4 component pixels by color[0..2],
+     * truncating. Alpha is left alone.
+     */
+    static void tintRow(U8* data, S32 components, S32 pixels, const F32* color)
+    {
+        sKernels->mTint(data, components, pixels, color);
+    }
+
+    /**
+     * Vertical pass of bilinear upscaling:
+     * dst[i] = top[i] * (256 - weight) + bottom[i] * weight
+     * with weight in [0, 256], unrounded.
+     */
+    static void blendRows(const U8* top, const U8* bottom, U16* dst, S32 count, S32 weight)
+    {
+        sKernels->mBlendRows(top, bottom, dst, count, weight);
+    }
+
+    /**
+     * Horizontal pass of bilinear upscaling. For each output pixel x,
+     * interpolates the blendRows() output between pixels xpoints[x] and
+     * xpoints[x] + 1 by xapoints[x] / 256 and rounds down to 8 bits.
+     * src must have ROW_PADDING elements past its last pixel.
+     */
+    static void interpolateRow(const U16* src, U8* dst, S32 width, S32 components, const S32* xpoints, const S32* xapoints)
+    {
+        sKernels->mInterpolateRow(src, dst, width, components, xpoints, xapoints);
+    }
+
+    /**
+     * Horizontal pass of box downscaling: for each output pixel x, the sum
+     * of the src pixels from xpoints[x] weighted by xapoints[x], which holds
+     * the per pixel weight in its top 16 bits and the weight of the first
+     * pixel in its bottom 16, shifted down by 5.
+     */
+    static void boxRow(const U8* src, S32* dst, S32 width, S32 components, const S32* xpoints, const S32* xapoints)
+    {
+        sKernels->mBoxRow(src, dst, width, components, xpoints, xapoints);
+    }
+
+    /**
+     * Vertical pass of box downscaling: dst[i] += src[i] * weight
+     */
+    static void accumulateRow(const S32* src, S32* dst, S32 count, S32 weight)
+    {
+        sKernels->mAccumulateRow(src, dst, count, weight);
+    }
+
+    /**
+     * dst[i] = (src[i] >> shift) & 0xff
+     */
+    static void packRow(const S32* src, U8* dst, S32 count, S32 shift)
+    {
+        sKernels->mPackRow(src, dst, count, shift);
+    }
+
+private:
+    struct Kernels
+    {
+        void (*mComposite4onto3)(const U8* src, U8* dst, S32 pixels);
+        void (*mAdd)(const U8* src, S32 src_components, U8* dst, S32 dst_components, S32 pixels);
+        void (*mTint)(U8* data, S32 components, S32 pixels, const F32* color);
+        void (*mBlendRows)(const U8* top, const U8* bottom, U16* dst, S32 count, S32 weight);
+        void (*mInterpolateRow)(const U16* src, U8* dst, S32 width, S32 components, const S32* xpoints, const S32* xapoints);
+        void (*mBoxRow)(const U8* src, S32* dst, S32 width, S32 components, const S32* xpoints, const S32* xapoints);
+        void (*mAccumulateRow)(const S32* src, S32* dst, S32 count, S32 weight);
+        void (*mPackRow)(const S32* src, U8* dst, S32 count, S32 shift);
+    };
+
+    static const Kernels sKernelTable[INSTRUCTION_SET_COUNT];
+    static const Kernels* sKernels;
+    static EInstructionSet sInstructionSet;
+};
+
+#endif // LL_LLIMAGEKERNELS_H
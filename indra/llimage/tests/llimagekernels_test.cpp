@@ -0,0 +1,241 @@
+/**
+ * @file llimagekernels_test.cpp
+ * @brief Checks every SIMD image kernel against the scalar one.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llimagekernels.h"
+
+#include "../test/lltut.h"
+
+#include <functional>
+#include <vector>
+
+namespace tut
+{
+    struct LLImageKernelsFixture
+    {
+        LLImageKernelsFixture()
+        : mSeed(12345)
+        {
+        }
+
+        ~LLImageKernelsFixture()
+        {
+            LLImageKernels::initClass();
+        }
+
+        std::vector<U8> noise(S32 size)
+        {
+            std::vector<U8> data(size);
+            for (U8& value : data)
+            {
+                mSeed = mSeed * 1664525 + 1013904223;
+                value = U8(mSeed >> 24);
+            }
+            // make sure the fully opaque and fully transparent cases show up
+            if (size > 8)
+            {
+                data[3] = 0;
+                data[7] = 255;
+            }
+            return data;
+        }
+
+        // Runs kernel with every supported instruction set and checks the
+        // output matches the scalar one
+        template<typename T>
+        void compare(const std::string& name, const std::vector<T>& initial, std::function<void(std::vector<T>&)> kernel)
+        {
+            LLImageKernels::setInstructionSet(LLImageKernels::SCALAR);
+            std::vector<T> expected(initial);
+            kernel(expected);
+
+            for (S32 set = LLImageKernels::SCALAR + 1; set < LLImageKernels::INSTRUCTION_SET_COUNT; ++set)
+            {
+                if (!LLImageKernels::isSupported((LLImageKernels::EInstructionSet)set))
+                {
+                    continue;
+                }
+                LLImageKernels::setInstructionSet((LLImageKernels::EInstructionSet)set);
+                std::vector<T> result(initial);
+                kernel(result);
+                ensure(name + " " + LLImageKernels::getName((LLImageKernels::EInstructionSet)set), result == expected);
+            }
+        }
+
+        U32 mSeed;
+    };
+    typedef test_group<LLImageKernelsFixture> LLImageKernelsTest_factory;
+    typedef LLImageKernelsTest_factory::object LLImageKernelsTest_t;
+    LLImageKernelsTest_factory tf("LLImageKernels");
+
+    // Odd sizes so the vector loops have tails
+    const S32 PIXEL_COUNTS[] = { 1, 5, 17, 67, 256 };
+
+    template<> template<>
+    void LLImageKernelsTest_t::test<1>()
+    {
+        set_test_name("setInstructionSet falls back to a supported set");
+
+        LLImageKernels::EInstructionSet set = LLImageKernels::setInstructionSet(LLImageKernels::AVX2);
+        ensure("supported", LLImageKernels::isSupported(set));
+        ensure_equals("in use", LLImageKernels::getInstructionSet(), set);
+        ensure_equals("scalar", LLImageKernels::setInstructionSet(LLImageKernels::SCALAR), LLImageKernels::SCALAR);
+    }
+
+    template<> template<>
+    void LLImageKernelsTest_t::test<2>()
+    {
+        set_test_name("composite, add and tint");
+
+        for (S32 pixels : PIXEL_COUNTS)
+        {
+            const std::vector<U8> src = noise(pixels * 4);
+            const std::vector<U8> src3 = noise(pixels * 3);
+
+            compare<U8>("composite", noise(pixels * 3), [&](std::vector<U8>& dst)
+                {
+                    LLImageKernels::compositeRow4onto3(src.data(), dst.data(), pixels);
+                });
+            compare<U8>("add 4 onto 3", noise(pixels * 3), [&](std::vector<U8>& dst)
+                {
+                    LLImageKernels::addRow(src.data(), 4, dst.data(), 3, pixels);
+                });
+            compare<U8>("add 3 onto 3", noise(pixels * 3), [&](std::vector<U8>& dst)
+                {
+                    LLImageKernels::addRow(src3.data(), 3, dst.data(), 3, pixels);
+                });
+            compare<U8>("add 4 onto 4", noise(pixels * 4), [&](std::vector<U8>& dst)
+                {
+                    LLImageKernels::addRow(src.data(), 4, dst.data(), 4, pixels);
+                });
+
+            const F32 color[3] = { 0.9f, 0.5f, 0.25f };
+            compare<U8>("tint 3", noise(pixels * 3), [&](std::vector<U8>& data)
+                {
+                    LLImageKernels::tintRow(data.data(), 3, pixels, color);
+                });
+            compare<U8>("tint 4", noise(pixels * 4), [&](std::vector<U8>& data)
+                {
+                    LLImageKernels::tintRow(data.data(), 4, pixels, color);
+                });
+        }
+    }
+
+    template<> template<>
+    void LLImageKernelsTest_t::test<3>()
+    {
+        set_test_name("bilinear upscaling rows");
+
+        for (S32 src_width : PIXEL_COUNTS)
+        {
+            for (S32 components = 1; components <= 4; ++components)
+            {
+                const S32 count = src_width * components;
+                const std::vector<U8> top = noise(count);
+                const std::vector<U8> bottom = noise(count);
+
+                for (S32 weight : { 0, 1, 128, 255, 256 })
+                {
+                    compare<U16>("blend rows", std::vector<U16>(count), [&](std::vector<U16>& dst)
+                        {
+                            LLImageKernels::blendRows(top.data(), bottom.data(), dst.data(), count, weight);
+                        });
+                }
+
+                // the points LLImageRaw uses to scale up 3 times, interpolating
+                // between neighbouring pixels except at the right edge
+                const S32 dst_width = src_width * 3;
+                std::vector<S32> xpoints(dst_width);
+                std::vector<S32> xapoints(dst_width);
+                S32 val = 0x8000 * src_width / dst_width - 0x8000;
+                const S32 inc = (src_width << 16) / dst_width;
+                for (S32 x = 0; x < dst_width; ++x, val += inc)
+                {
+                    xpoints[x] = llmax(0, val >> 16);
+                    xapoints[x] = (val >> 16) >= src_width - 1 ? 0 : (val >> 8) & 0xff;
+                }
+
+                std::vector<U16> row(count + LLImageKernels::ROW_PADDING);
+                LLImageKernels::setInstructionSet(LLImageKernels::SCALAR);
+                LLImageKernels::blendRows(top.data(), bottom.data(), row.data(), count, 100);
+                compare<U8>("interpolate row", std::vector<U8>(dst_width * components), [&](std::vector<U8>& dst)
+                    {
+                        LLImageKernels::interpolateRow(row.data(), dst.data(), dst_width, components, xpoints.data(), xapoints.data());
+                    });
+            }
+        }
+    }
+
+    template<> template<>
+    void LLImageKernelsTest_t::test<4>()
+    {
+        set_test_name("box downscaling rows");
+
+        for (S32 dst_width : PIXEL_COUNTS)
+        {
+            for (S32 components = 1; components <= 4; ++components)
+            {
+                for (S32 factor : { 2, 3, 4 })
+                {
+                    // the points LLImageRaw uses to scale down by factor
+                    const S32 src_width = dst_width * factor + 1;
+                    std::vector<S32> xpoints(dst_width);
+                    std::vector<S32> xapoints(dst_width);
+                    const S32 inc = (src_width << 16) / dst_width;
+                    const S32 Cp = ((dst_width << 14) / src_width) + 1;
+                    S32 val = 0;
+                    for (S32 x = 0; x < dst_width; ++x, val += inc)
+                    {
+                        xpoints[x] = val >> 16;
+                        xapoints[x] = (((0x100 - ((val >> 8) & 0xff)) * Cp) >> 8) | (Cp << 16);
+                    }
+
+                    const std::vector<U8> src = noise(src_width * components + 4 * factor);
+                    compare<S32>("box row", std::vector<S32>(dst_width * components), [&](std::vector<S32>& dst)
+                        {
+                            LLImageKernels::boxRow(src.data(), dst.data(), dst_width, components, xpoints.data(), xapoints.data());
+                        });
+                }
+
+                const S32 count = dst_width * components;
+                std::vector<S32> sums(count);
+                for (S32 i = 0; i < count; ++i)
+                {
+                    sums[i] = (S32)(noise(2)[0] << 9);
+                }
+                compare<S32>("accumulate row", sums, [&](std::vector<S32>& dst)
+                    {
+                        LLImageKernels::accumulateRow(sums.data(), dst.data(), count, 3000);
+                    });
+                compare<U8>("pack row", std::vector<U8>(count), [&](std::vector<U8>& dst)
+                    {
+                        LLImageKernels::packRow(sums.data(), dst.data(), count, 9);
+                    });
+            }
+        }
+    }
+}
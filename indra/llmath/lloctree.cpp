@@ -22,8 +22,141 @@
  * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
  * $/LicenseInfo$
  */
-#include "stdtypes.h"
+#include "linden_common.h"
+
+#include "lloctree.h"
 
 U32 gOctreeMaxCapacity;
 F32 gOctreeMinSize;
 
+LLOctreePool::LLOctreePool()
+:   mCursor(nullptr),
+    mChunkEnd(nullptr),
+    mNextChunkSize(MIN_CHUNK_SIZE),
+    mBytesInUse(0),
+    mBytesReserved(0),
+    mNumAllocations(0)
+{
+    memset(mFreeLists, 0, sizeof(mFreeLists));
+}
+
+LLOctreePool::~LLOctreePool()
+{
+    if (mNumAllocations)
+    {   // leak the chunks rather than pull them from under live nodes
+        OCT_ERRS << "Octree pool destroyed with " << mNumAllocations << " blocks in use" << LL_ENDL;
+        return;
+    }
+    reset();
+}
+
+//static
+U32 LLOctreePool::getSizeClass(size_t size)
+{
+    if (size <= SMALL_LIMIT)
+    {
+        return size ? (U32)((size + ALIGNMENT - 1) / ALIGNMENT - 1) : 0;
+    }
+
+    U32 size_class = NUM_SMALL_CLASSES;
+    for (size_t block = SMALL_LIMIT * 2; block < size; block *= 2)
+    {
+        ++size_class;
+    }
+    return size_class;
+}
+
+//static
+size_t LLOctreePool::getClassSize(U32 size_class)
+{
+    if (size_class < NUM_SMALL_CLASSES)
+    {
+        return (size_class + 1) * ALIGNMENT;
+    }
+    return (size_t)SMALL_LIMIT << (size_class - NUM_SMALL_CLASSES + 1);
+}
+
+void* LLOctreePool::allocate(size_t size)
+{
+    ++mNumAllocations;
+
+    if (size > LARGE_LIMIT)
+    {
+        mBytesInUse += size;
+        mBytesReserved += size;
+        return ll_aligned_malloc_16(size);
+    }
+
+    const U32 size_class = getSizeClass(size);
+    const size_t block_size = getClassSize(size_class);
+    mBytesInUse += block_size;
+
+    FreeBlock* block = mFreeLists[size_class];
+    if (block)
+    {
+        mFreeLists[size_class] = block->mNext;
+        return block;
+    }
+
+    if ((size_t)(mChunkEnd - mCursor) < block_size)
+    {   // the tail of the old chunk is lost, at most LARGE_LIMIT bytes
+        U8* chunk = (U8*)ll_aligned_malloc_16(mNextChunkSize);
+        mChunks.push_back(chunk);
+        mBytesReserved += mNextChunkSize;
+        mCursor = chunk;
+        mChunkEnd = chunk + mNextChunkSize;
+        mNextChunkSize = llmin(mNextChunkSize * 2, (size_t)MAX_CHUNK_SIZE);
+    }
+
+    void* ptr = mCursor;
+    mCursor += block_size;
+    return ptr;
+}
+
+void LLOctreePool::deallocate(void* ptr, size_t size)
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    llassert(mNumAllocations > 0);
+    --mNumAllocations;
+
+    if (size > LARGE_LIMIT)
+    {
+        mBytesInUse -= size;
+        mBytesReserved -= size;
+        ll_aligned_free_16(ptr);
+        return;
+    }
+
+    const U32 size_class = getSizeClass(size);
+    mBytesInUse -= getClassSize(size_class);
+
+    FreeBlock* block = (FreeBlock*)ptr;
+    block->mNext = mFreeLists[size_class];
+    mFreeLists[size_class] = block;
+}
+
+void LLOctreePool::reset()
+{
+    if (mNumAllocations)
+    {
+        OCT_ERRS << "Octree pool reset with " << mNumAllocations << " blocks in use" << LL_ENDL;
+        return;
+    }
+
+    for (U8* chunk : mChunks)
+    {
+        ll_aligned_free_16(chunk);
+    }
+    mChunks.clear();
+    memset(mFreeLists, 0, sizeof(mFreeLists));
+    mCursor = nullptr;
+    mChunkEnd = nullptr;
+    mNextChunkSize = MIN_CHUNK_SIZE;
+    mBytesInUse = 0;
+    mBytesReserved = 0;
+}
+
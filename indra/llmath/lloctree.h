@@ -59,6 +59,107 @@ extern float gOctreeMinSize;
 // the tree.
 template <class T, typename T_PTR> class LLOctreeNode;
 
+// Arena for the nodes and element arrays of an octree. Blocks are carved
+// from chunks that grow with the tree and recycled through free lists per
+// size class, so a tree that keeps splitting and collapsing as its elements
+// move stops calling the heap once it is warm, and its nodes stay close
+// together. Not thread safe: each pool belongs to one owner's tree(s).
+class LLOctreePool
+{
+public:
+    LLOctreePool();
+    ~LLOctreePool();
+
+    LLOctreePool(const LLOctreePool&) = delete;
+    LLOctreePool& operator=(const LLOctreePool&) = delete;
+
+    void* allocate(size_t size);
+    void deallocate(void* ptr, size_t size);
+
+    // Returns every chunk to the heap at once. Only allowed when nothing is
+    // allocated any more, e.g. after the tree has been deleted.
+    void reset();
+
+    size_t getBytesInUse() const    { return mBytesInUse; }
+    size_t getBytesReserved() const { return mBytesReserved; }
+    U32 getNumAllocations() const   { return mNumAllocations; }
+    U32 getNumChunks() const        { return (U32)mChunks.size(); }
+
+private:
+    enum
+    {
+        ALIGNMENT = 16,
+        SMALL_LIMIT = 256,      // sizes up to this come in steps of ALIGNMENT
+        LARGE_LIMIT = 4096,     // then in powers of two, then from the heap
+        NUM_SMALL_CLASSES = SMALL_LIMIT / ALIGNMENT,
+        NUM_CLASSES = NUM_SMALL_CLASSES + 4,
+        MIN_CHUNK_SIZE = 4096,
+        MAX_CHUNK_SIZE = 65536
+    };
+
+    struct FreeBlock
+    {
+        FreeBlock* mNext;
+    };
+
+    static U32 getSizeClass(size_t size);
+    static size_t getClassSize(U32 size_class);
+
+    FreeBlock* mFreeLists[NUM_CLASSES];
+    std::vector<U8*> mChunks;
+    U8* mCursor;
+    U8* mChunkEnd;
+    size_t mNextChunkSize;
+    size_t mBytesInUse;
+    size_t mBytesReserved;
+    U32 mNumAllocations;
+};
+
+// Standard allocator for element arrays, taking memory from an LLOctreePool
+// or from the heap when there is none
+template <typename T>
+class LLOctreePoolAllocator
+{
+public:
+    typedef T value_type;
+
+    LLOctreePoolAllocator(LLOctreePool* pool = nullptr) noexcept : mPool(pool) {}
+
+    template <typename U>
+    LLOctreePoolAllocator(const LLOctreePoolAllocator<U>& other) noexcept : mPool(other.getPool()) {}
+
+    T* allocate(size_t count)
+    {
+        if (mPool)
+        {
+            return (T*)mPool->allocate(count * sizeof(T));
+        }
+        return (T*)::operator new(count * sizeof(T));
+    }
+
+    void deallocate(T* ptr, size_t count)
+    {
+        if (mPool)
+        {
+            mPool->deallocate(ptr, count * sizeof(T));
+        }
+        else
+        {
+            ::operator delete(ptr);
+        }
+    }
+
+    LLOctreePool* getPool() const { return mPool; }
+
+    template <typename U>
+    bool operator==(const LLOctreePoolAllocator<U>& other) const { return mPool == other.getPool(); }
+    template <typename U>
+    bool operator!=(const LLOctreePoolAllocator<U>& other) const { return mPool != other.getPool(); }
+
+private:
+    LLOctreePool* mPool;
+};
+
 template <class T, typename T_PTR>
 class LLOctreeListener: public LLTreeListener<T>
 {
@@ -94,7 +195,7 @@ class alignas(16) LLOctreeNode : public LLTreeNode<T>
 
     typedef LLOctreeTraveler<T, T_PTR>                          oct_traveler;
     typedef LLTreeTraveler<T>                                   tree_traveler;
-    typedef std::vector<T_PTR>                                  element_list;
+    typedef std::vector<T_PTR, LLOctreePoolAllocator<T_PTR>>    element_list;
     typedef typename element_list::iterator                     element_iter;
     typedef typename element_list::const_iterator               const_element_iter;
     typedef typename std::vector<LLTreeListener<T>*>::iterator  tree_listener_iter;
@@ -110,12 +211,16 @@ class alignas(16) LLOctreeNode : public LLTreeNode<T>
         NO_CHILD_NODES = 255 // Note: This is an U8 to match the max value in mChildMap[]
     };
 
+    // Nodes take their pool from their parent unless given one
     LLOctreeNode(   const LLVector4a& center,
                     const LLVector4a& size,
                     BaseType* parent,
-                    U8 octant = NO_CHILD_NODES)
+                    U8 octant = NO_CHILD_NODES,
+                    LLOctreePool* pool = nullptr)
     :   mParent((oct_node*)parent),
-        mOctant(octant)
+        mOctant(octant),
+        mPool(pool ? pool : (mParent ? mParent->mPool : nullptr)),
+        mData(LLOctreePoolAllocator<T_PTR>(mPool))
     {
         llassert(size[0] >= gOctreeMinSize*0.5f);
 
@@ -146,7 +251,32 @@ class alignas(16) LLOctreeNode : public LLTreeNode<T>
 
         for (U32 i = 0; i < getChildCount(); i++)
         {
-            delete getChild(i);
+            deleteNode(getChild(i));
+        }
+    }
+
+    // Creates a child node in this node's pool, without adding it
+    oct_node* createChild(const LLVector4a& center, const LLVector4a& size)
+    {
+        if (mPool)
+        {
+            return ::new (mPool->allocate(sizeof(oct_node))) oct_node(center, size, this);
+        }
+        return new oct_node(center, size, this);
+    }
+
+    // Deletes a node made by createChild
+    static void deleteNode(oct_node* node)
+    {
+        LLOctreePool* pool = node->mPool;
+        if (pool)
+        {
+            node->~oct_node();
+            pool->deallocate(node, sizeof(oct_node));
+        }
+        else
+        {
+            delete node;
         }
     }
 
@@ -158,6 +288,7 @@ class alignas(16) LLOctreeNode : public LLTreeNode<T>
     inline void setSize(const LLVector4a& size)         { mSize = size; }
     inline oct_node* getNodeAt(T* data)                 { return getNodeAt(data->getPositionGroup(), data->getBinRadius()); }
     inline U8 getOctant() const                         { return mOctant; }
+    inline LLOctreePool* getPool() const                { return mPool; }
     inline const oct_node*  getOctParent() const        { return (const oct_node*) getParent(); }
     inline oct_node* getOctParent()                     { return (oct_node*) getParent(); }
 
@@ -392,7 +523,7 @@ class alignas(16) LLOctreeNode : public LLTreeNode<T>
 
                 llassert(size[0] >= gOctreeMinSize*0.5f);
                 //make the new kid
-                child = new oct_node(center, size, this);
+                child = createChild(center, size);
                 addChild(child);
 
                 child->insert(data);
@@ -525,7 +656,7 @@ class alignas(16) LLOctreeNode : public LLTreeNode<T>
         for (U32 i = 0; i < getChildCount(); i++)
         {
             mChild[i]->destroy();
-            delete mChild[i];
+            deleteNode(mChild[i]);
         }
     }
 
@@ -583,7 +714,7 @@ class alignas(16) LLOctreeNode : public LLTreeNode<T>
         if (destroy)
         {
             mChild[index]->destroy();
-            delete mChild[index];
+            deleteNode(mChild[index]);
         }
 
         --mChildCount;
@@ -643,6 +774,7 @@ class alignas(16) LLOctreeNode : public LLTreeNode<T>
 
     oct_node* mParent;
     U8 mOctant;
+    LLOctreePool* mPool;
 
     oct_node* mChild[8];
     U8 mChildMap[8];
@@ -659,10 +791,12 @@ class LLOctreeRoot : public LLOctreeNode<T, T_PTR>
     typedef LLOctreeNode<T, T_PTR> BaseType;
     typedef LLOctreeNode<T, T_PTR> oct_node;
 
+    // The pool, if any, must outlive the tree
     LLOctreeRoot(const LLVector4a& center,
                  const LLVector4a& size,
-                 BaseType* parent)
-    :   BaseType(center, size, parent)
+                 BaseType* parent,
+                 LLOctreePool* pool = nullptr)
+    :   BaseType(center, size, parent, BaseType::NO_CHILD_NODES, pool)
     {
     }
 
@@ -693,7 +827,7 @@ class LLOctreeRoot : public LLOctreeNode<T, T_PTR>
 
             //destroy child
             child->clearChildren();
-            delete child;
+            oct_node::deleteNode(child);
 
             return false;
         }
@@ -786,7 +920,7 @@ class LLOctreeRoot : public LLOctreeNode<T, T_PTR>
                 llassert(size[0] >= gOctreeMinSize);
 
                 //copy our children to a new branch
-                oct_node* newnode = new oct_node(center, size, this);
+                oct_node* newnode = this->createChild(center, size);
 
                 for (U32 i = 0; i < this->getChildCount(); i++)
                 {
@@ -86,6 +86,10 @@ class LLQuaternion2
 
     inline void mul(const LLQuaternion2& b);
 
+    // Set this quaternion to nlerp(t, p, q) as LLQuaternion computes it:
+    // a normalized lerp, or a slerp when p and q are in opposite hemispheres
+    inline void setNlerp(F32 t, const LLQuaternion2& p, const LLQuaternion2& q);
+
     /////////////////////////
     // Quaternion inspection
     /////////////////////////
@@ -80,6 +80,33 @@ inline void LLQuaternion2::mul(const LLQuaternion2& b)
     mQ.setAdd(sum1,sum2);
 }
 
+inline void LLQuaternion2::setNlerp(F32 t, const LLQuaternion2& p, const LLQuaternion2& q)
+{
+    if (p.mQ.dot4(q.mQ).getF32() < 0.f)
+    {
+        // rare for neighbouring keys and blends, not worth vectorizing
+        LLQuaternion r = slerp(t, LLQuaternion(p.mQ.getF32ptr()), LLQuaternion(q.mQ.getF32ptr()));
+        mQ.loadua(r.mQ);
+        return;
+    }
+
+    LLVector4a scaled_q;
+    scaled_q.setMul(q.mQ, LLVector4a(t));
+    mQ.setMul(p.mQ, LLVector4a(1.f - t));
+    mQ.add(scaled_q);
+
+    // same thresholds as LLQuaternion::normalize()
+    const F32 mag = sqrtf(mQ.dot4(mQ).getF32());
+    if (mag <= FP_MAG_THRESHOLD)
+    {
+        mQ.set(0.f, 0.f, 0.f, 1.f);
+    }
+    else if (fabsf(1.f - mag) > ONE_PART_IN_A_MILLION)
+    {
+        mQ.mul(1.f / mag);
+    }
+}
+
 /////////////////////////
 // Quaternion modification
 /////////////////////////
@@ -54,6 +54,7 @@
 #include "llmeshoptimizer.h"
 #include "lltimer.h"
 #include "llvolumeoctree.h"
+#include "llvolumebvh.h"
 
 #include "mikktspace/mikktspace.hh"
 
@@ -1964,7 +1965,8 @@ void LLPathParams::copyParams(const LLPathParams &params)
     setSkew(params.getSkew());
 }
 
-S32 LLVolume::sNumMeshPoints = 0;
+std::atomic<S32> LLVolume::sNumMeshPoints(0);
+bool LLVolume::sUseBVH = false;
 
 LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face, const BOOL is_unique)
     : mParams(params)
@@ -2025,7 +2027,7 @@ void LLVolume::genTangents(S32 face)
 
 LLVolume::~LLVolume()
 {
-    sNumMeshPoints -= mMesh.size();
+    sNumMeshPoints -= (S32)mMesh.size();
     delete mPathp;
 
     delete mProfilep;
@@ -2095,9 +2097,9 @@ BOOL LLVolume::generate()
         S32 sizeS = mPathp->mPath.size();
         S32 sizeT = mProfilep->mProfile.size();
 
-        sNumMeshPoints -= mMesh.size();
+        sNumMeshPoints -= (S32)mMesh.size();
         mMesh.resize(sizeT * sizeS);
-        sNumMeshPoints += mMesh.size();
+        sNumMeshPoints += (S32)mMesh.size();
 
         //generate vertex positions
 
@@ -2319,7 +2321,7 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
     return unpackVolumeFacesInternal(mdl);
 }
 
-bool LLVolume::unpackVolumeFaces(U8* in_data, S32 size)
+bool LLVolume::unpackVolumeFaces(const U8* in_data, S32 size)
 {
     //input data is now pointing at a zlib compressed block of LLSD
     //decompress block
@@ -2731,6 +2733,263 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
 }
 
 
+namespace
+{
+    // Layout written by LLVolume::packDecodedFaces.  The file header is
+    // followed by each face's header, vertex block, optional tangents and
+    // weights, then indices.  Every part is a multiple of 16 bytes so that
+    // vector arrays stay aligned when the buffer is.  Bump the version when
+    // the layout or the unpacking that produces the faces changes.
+    const U32 DECODED_FACES_MAGIC = 0x46564c4c; // "LLVF"
+    const U32 DECODED_FACES_VERSION = 1;
+
+    const U32 DECODED_FACE_TANGENTS = 0x1;
+    const U32 DECODED_FACE_WEIGHTS = 0x2;
+
+    struct DecodedFacesHeader
+    {
+        U32 mMagic;
+        U32 mVersion;
+        U32 mSculptFlags;
+        U32 mNumFaces;
+    };
+
+    struct DecodedFaceHeader
+    {
+        LLVector4a mExtents[2];
+        LLVector2 mTexCoordExtents[2];
+        F32 mNormalizedScale[3];
+        S32 mNumVertices;
+        S32 mNumIndices;
+        U32 mFlags;
+        U32 mPad[2];
+    };
+
+    static_assert(sizeof(DecodedFacesHeader) % 16 == 0, "decoded faces header must keep alignment");
+    static_assert(sizeof(DecodedFaceHeader) % 16 == 0, "decoded face header must keep alignment");
+
+    // Texture coordinates and indices are padded as resizeVertices and
+    // resizeIndices pad them
+    size_t decoded_tc_bytes(S32 num_verts)
+    {
+        return ((num_verts * sizeof(LLVector2)) + 0xF) & ~0xF;
+    }
+
+    size_t decoded_index_bytes(S32 num_indices)
+    {
+        return ((num_indices * sizeof(U16)) + 0xF) & ~0xF;
+    }
+
+    size_t decoded_face_bytes(S32 num_verts, S32 num_indices, U32 flags)
+    {
+        size_t vector_bytes = sizeof(LLVector4a) * num_verts;
+        size_t bytes = sizeof(DecodedFaceHeader) + vector_bytes * 2 + decoded_tc_bytes(num_verts) + decoded_index_bytes(num_indices);
+        if (flags & DECODED_FACE_TANGENTS)
+        {
+            bytes += vector_bytes;
+        }
+        if (flags & DECODED_FACE_WEIGHTS)
+        {
+            bytes += vector_bytes;
+        }
+        return bytes;
+    }
+
+    U32 decoded_sculpt_flags(const LLVolumeParams& params)
+    {
+        return params.getSculptType() & (LL_SCULPT_FLAG_MIRROR | LL_SCULPT_FLAG_INVERT);
+    }
+}
+
+void LLVolume::packDecodedFaces(std::vector<U8>& out) const
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
+
+    std::vector<U32> flags(mVolumeFaces.size());
+    size_t size = sizeof(DecodedFacesHeader);
+    for (size_t i = 0; i < mVolumeFaces.size(); ++i)
+    {
+        const LLVolumeFace& face = mVolumeFaces[i];
+        flags[i] = (face.mTangents ? DECODED_FACE_TANGENTS : 0) | (face.mWeights ? DECODED_FACE_WEIGHTS : 0);
+        size += decoded_face_bytes(face.mNumVertices, face.mNumIndices, flags[i]);
+    }
+
+    out.assign(size, 0);
+    U8* cur = out.data();
+
+    DecodedFacesHeader header;
+    header.mMagic = DECODED_FACES_MAGIC;
+    header.mVersion = DECODED_FACES_VERSION;
+    header.mSculptFlags = decoded_sculpt_flags(mParams);
+    header.mNumFaces = (U32)mVolumeFaces.size();
+    memcpy(cur, &header, sizeof(header));
+    cur += sizeof(header);
+
+    for (size_t i = 0; i < mVolumeFaces.size(); ++i)
+    {
+        const LLVolumeFace& face = mVolumeFaces[i];
+        const size_t vector_bytes = sizeof(LLVector4a) * face.mNumVertices;
+
+        DecodedFaceHeader face_header = {};
+        face_header.mExtents[0] = face.mExtents[0];
+        face_header.mExtents[1] = face.mExtents[1];
+        face_header.mTexCoordExtents[0] = face.mTexCoordExtents[0];
+        face_header.mTexCoordExtents[1] = face.mTexCoordExtents[1];
+        memcpy(face_header.mNormalizedScale, face.mNormalizedScale.mV, sizeof(face_header.mNormalizedScale));
+        face_header.mNumVertices = face.mNumVertices;
+        face_header.mNumIndices = face.mNumIndices;
+        face_header.mFlags = flags[i];
+        memcpy(cur, &face_header, sizeof(face_header));
+        cur += sizeof(face_header);
+
+        if (face.mNumVertices)
+        {
+            memcpy(cur, face.mPositions, vector_bytes);
+            cur += vector_bytes;
+            memcpy(cur, face.mNormals, vector_bytes);
+            cur += vector_bytes;
+            memcpy(cur, face.mTexCoords, face.mNumVertices * sizeof(LLVector2));
+        }
+        cur += decoded_tc_bytes(face.mNumVertices);
+
+        if (face.mTangents)
+        {
+            memcpy(cur, face.mTangents, vector_bytes);
+            cur += vector_bytes;
+        }
+        if (face.mWeights)
+        {
+            memcpy(cur, face.mWeights, vector_bytes);
+            cur += vector_bytes;
+        }
+
+        if (face.mNumIndices)
+        {
+            memcpy(cur, face.mIndices, face.mNumIndices * sizeof(U16));
+        }
+        cur += decoded_index_bytes(face.mNumIndices);
+    }
+    llassert(cur == out.data() + out.size());
+}
+
+bool LLVolume::unpackDecodedFaces(const U8* in_data, S32 size)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
+
+    DecodedFacesHeader header;
+    if (!in_data || size < (S32)sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, in_data, sizeof(header));
+
+    const U8* cur = in_data + sizeof(header);
+    const U8* end = in_data + size;
+
+    if (header.mMagic != DECODED_FACES_MAGIC
+        || header.mVersion != DECODED_FACES_VERSION
+        || header.mSculptFlags != decoded_sculpt_flags(mParams)
+        || header.mNumFaces == 0
+        || header.mNumFaces > (size_t)(end - cur) / sizeof(DecodedFaceHeader))
+    {
+        LL_DEBUGS("MeshStreaming") << "Decoded faces are from another version or for other sculpt flags" << LL_ENDL;
+        return false;
+    }
+
+    face_list_t faces(header.mNumFaces);
+    for (LLVolumeFace& face : faces)
+    {
+        DecodedFaceHeader face_header;
+        if ((size_t)(end - cur) < sizeof(face_header))
+        {
+            return false;
+        }
+        memcpy(&face_header, cur, sizeof(face_header));
+
+        const S32 num_verts = face_header.mNumVertices;
+        const S32 num_indices = face_header.mNumIndices;
+        if (num_verts < 0 || num_verts > 65536
+            || num_indices < 0 || num_indices % 3 != 0
+            || (size_t)(end - cur) < decoded_face_bytes(num_verts, num_indices, face_header.mFlags))
+        {
+            LL_WARNS() << "Truncated or corrupt decoded face" << LL_ENDL;
+            return false;
+        }
+        cur += sizeof(face_header);
+
+        const size_t vector_bytes = sizeof(LLVector4a) * num_verts;
+
+        face.resizeVertices(num_verts);
+        if (num_verts && !face.mPositions)
+        {
+            LL_WARNS() << "Failed to allocate " << num_verts << " vertices" << LL_ENDL;
+            return false;
+        }
+        if (num_verts)
+        {
+            memcpy(face.mPositions, cur, vector_bytes);
+            cur += vector_bytes;
+            memcpy(face.mNormals, cur, vector_bytes);
+            cur += vector_bytes;
+            memcpy(face.mTexCoords, cur, num_verts * sizeof(LLVector2));
+        }
+        cur += decoded_tc_bytes(num_verts);
+
+        if (face_header.mFlags & DECODED_FACE_TANGENTS)
+        {
+            face.allocateTangents(num_verts);
+            if (num_verts && !face.mTangents)
+            {
+                return false;
+            }
+            memcpy(face.mTangents, cur, vector_bytes);
+            cur += vector_bytes;
+        }
+        if (face_header.mFlags & DECODED_FACE_WEIGHTS)
+        {
+            face.allocateWeights(num_verts);
+            if (num_verts && !face.mWeights)
+            {
+                return false;
+            }
+            memcpy(face.mWeights, cur, vector_bytes);
+            cur += vector_bytes;
+        }
+
+        face.resizeIndices(num_indices);
+        if (num_indices && !face.mIndices)
+        {
+            LL_WARNS() << "Failed to allocate " << num_indices << " indices" << LL_ENDL;
+            return false;
+        }
+        if (num_indices)
+        {
+            memcpy(face.mIndices, cur, num_indices * sizeof(U16));
+            for (S32 i = 0; i < num_indices; ++i)
+            {
+                if (face.mIndices[i] >= num_verts)
+                {
+                    LL_WARNS() << "Decoded face index out of range" << LL_ENDL;
+                    return false;
+                }
+            }
+        }
+        cur += decoded_index_bytes(num_indices);
+
+        face.mExtents[0] = face_header.mExtents[0];
+        face.mExtents[1] = face_header.mExtents[1];
+        face.mTexCoordExtents[0] = face_header.mTexCoordExtents[0];
+        face.mTexCoordExtents[1] = face_header.mTexCoordExtents[1];
+        face.mNormalizedScale.set(face_header.mNormalizedScale);
+        face.mOptimized = TRUE;
+    }
+
+    mVolumeFaces.swap(faces);
+    mSculptLevel = 0;  // success!
+
+    return true;
+}
+
 bool LLVolume::isMeshAssetLoaded()
 {
     return mIsMeshAssetLoaded;
@@ -3226,9 +3485,9 @@ void LLVolume::sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
         LL_WARNS() << "sculpt bad mesh size " << sizeS << " " << sizeT << LL_ENDL;
     }
 
-    sNumMeshPoints -= mMesh.size();
+    sNumMeshPoints -= (S32)mMesh.size();
     mMesh.resize(sizeS * sizeT);
-    sNumMeshPoints += mMesh.size();
+    sNumMeshPoints += (S32)mMesh.size();
 
     //generate vertex positions
     if (!data_is_empty)
@@ -4037,6 +4296,71 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
     }
 }
 
+// Fills in the hit outputs the caller asked for at the barycentric
+// coordinates a, b of the triangle idx0, idx1, idx2, hit at t
+static void interpolate_hit(const LLVolumeFace& face, U16 idx0, U16 idx1, U16 idx2, F32 a, F32 b,
+                            const LLVector4a& start, const LLVector4a& dir, F32 t,
+                            LLVector4a* intersection, LLVector2* tex_coord, LLVector4a* normal, LLVector4a* tangent_out)
+{
+    if (intersection != NULL)
+    {
+        LLVector4a intersect = dir;
+        intersect.mul(t);
+        intersect.add(start);
+        *intersection = intersect;
+    }
+
+
+    if (tex_coord != NULL)
+    {
+        LLVector2* tc = (LLVector2*) face.mTexCoords;
+        *tex_coord = ((1.f - a - b)  * tc[idx0] +
+            a              * tc[idx1] +
+            b              * tc[idx2]);
+
+    }
+
+    if (normal!= NULL)
+    {
+        LLVector4a* norm = face.mNormals;
+
+        LLVector4a n1,n2,n3;
+        n1 = norm[idx0];
+        n1.mul(1.f-a-b);
+
+        n2 = norm[idx1];
+        n2.mul(a);
+
+        n3 = norm[idx2];
+        n3.mul(b);
+
+        n1.add(n2);
+        n1.add(n3);
+
+        *normal     = n1;
+    }
+
+    if (tangent_out != NULL)
+    {
+        LLVector4a* tangents = face.mTangents;
+
+        LLVector4a t1,t2,t3;
+        t1 = tangents[idx0];
+        t1.mul(1.f-a-b);
+
+        t2 = tangents[idx1];
+        t2.mul(a);
+
+        t3 = tangents[idx2];
+        t3.mul(b);
+
+        t1.add(t2);
+        t1.add(t3);
+
+        *tangent_out = t1;
+    }
+}
+
 S32 LLVolume::lineSegmentIntersect(const LLVector4a& start, const LLVector4a& end,
                                    S32 face_idx,
                                    LLVector4a* intersection,LLVector2* tex_coord, LLVector4a* normal, LLVector4a* tangent_out)
@@ -4108,67 +4432,28 @@ S32 LLVolume::lineSegmentIntersect(const LLVector4a& start, const LLVector4a& en
                             closest_t = t;
                             hit_face = i;
 
-                            if (intersection != NULL)
-                            {
-                                LLVector4a intersect = dir;
-                                intersect.mul(closest_t);
-                                intersect.add(start);
-                                *intersection = intersect;
-                            }
-
-
-                            if (tex_coord != NULL)
-                            {
-                                LLVector2* tc = (LLVector2*) face.mTexCoords;
-                                *tex_coord = ((1.f - a - b)  * tc[idx0] +
-                                    a              * tc[idx1] +
-                                    b              * tc[idx2]);
-
-                            }
-
-                            if (normal!= NULL)
-                            {
-                                LLVector4a* norm = face.mNormals;
-
-                                LLVector4a n1,n2,n3;
-                                n1 = norm[idx0];
-                                n1.mul(1.f-a-b);
-
-                                n2 = norm[idx1];
-                                n2.mul(a);
-
-                                n3 = norm[idx2];
-                                n3.mul(b);
-
-                                n1.add(n2);
-                                n1.add(n3);
-
-                                *normal     = n1;
-                            }
-
-                            if (tangent_out != NULL)
-                            {
-                                LLVector4a* tangents = face.mTangents;
-
-                                LLVector4a t1,t2,t3;
-                                t1 = tangents[idx0];
-                                t1.mul(1.f-a-b);
-
-                                t2 = tangents[idx1];
-                                t2.mul(a);
-
-                                t3 = tangents[idx2];
-                                t3.mul(b);
-
-                                t1.add(t2);
-                                t1.add(t3);
-
-                                *tangent_out = t1;
-                            }
+                            interpolate_hit(face, idx0, idx1, idx2, a, b, start, dir, closest_t,
+                                            intersection, tex_coord, normal, tangent_out);
                         }
                     }
                 }
             }
+            else if (sUseBVH)
+            {
+                if (!face.getBVH())
+                {
+                    face.createBVH();
+                }
+
+                F32 a, b;
+                U16 idx[3];
+                if (face.getBVH()->lineSegmentIntersect(face, start, dir, closest_t, a, b, idx))
+                {
+                    hit_face = i;
+                    interpolate_hit(face, idx[0], idx[1], idx[2], a, b, start, dir, closest_t,
+                                    intersection, tex_coord, normal, tangent_out);
+                }
+            }
             else
             {
                 if (!face.getOctree())
@@ -4727,6 +5012,7 @@ LLVolumeFace::LLVolumeFace() :
     mWeightsScrubbed(FALSE),
     mOctree(NULL),
     mOctreeTriangles(NULL),
+    mBVH(NULL),
     mOptimized(FALSE)
 {
     mExtents = (LLVector4a*) ll_aligned_malloc_16(sizeof(LLVector4a)*3);
@@ -4754,6 +5040,7 @@ LLVolumeFace::LLVolumeFace(const LLVolumeFace& src)
     mWeightsScrubbed(FALSE),
     mOctree(NULL),
     mOctreeTriangles(NULL),
+    mBVH(NULL),
     mOptimized(FALSE)
 {
     mExtents = (LLVector4a*) ll_aligned_malloc_16(sizeof(LLVector4a)*3);
@@ -4897,6 +5184,7 @@ void LLVolumeFace::freeData()
 #endif
 
     destroyOctree();
+    destroyBVH();
 }
 
 BOOL LLVolumeFace::create(LLVolume* volume, BOOL partial_build)
@@ -4905,6 +5193,7 @@ BOOL LLVolumeFace::create(LLVolume* volume, BOOL partial_build)
 
     //tree for this face is no longer valid
     destroyOctree();
+    destroyBVH();
 
     LL_CHECK_MEMORY
     BOOL ret = FALSE ;
@@ -5673,6 +5962,20 @@ const LLVolumeOctree* LLVolumeFace::getOctree() const
     return mOctree;
 }
 
+void LLVolumeFace::createBVH()
+{
+    if (!mBVH)
+    {
+        mBVH = new LLVolumeBVH(*this);
+    }
+}
+
+void LLVolumeFace::destroyBVH()
+{
+    delete mBVH;
+    mBVH = nullptr;
+}
+
 
 void LLVolumeFace::swapData(LLVolumeFace& rhs)
 {
@@ -5683,6 +5986,9 @@ void LLVolumeFace::swapData(LLVolumeFace& rhs)
     llswap(rhs.mIndices,mIndices);
     llswap(rhs.mNumVertices, mNumVertices);
     llswap(rhs.mNumIndices, mNumIndices);
+
+    // the BVHs only hold indices, which now belong to the other face
+    llswap(rhs.mBVH, mBVH);
 }
 
 void    LerpPlanarVertex(LLVolumeFace::VertexData& v0,
@@ -27,6 +27,7 @@
 #ifndef LL_LLVOLUME_H
 #define LL_LLVOLUME_H
 
+#include <atomic>
 #include <iostream>
 
 class LLProfileParams;
@@ -42,6 +43,7 @@ class LLVolumeFace;
 class LLVolume;
 class LLVolumeTriangle;
 class LLVolumeOctree;
+class LLVolumeBVH;
 
 #include "lluuid.h"
 #include "v4color.h"
@@ -919,6 +921,11 @@ class LLVolumeFace
     // Get a reference to the octree, which may be null
     const LLVolumeOctree* getOctree() const;
 
+    void createBVH();
+    void destroyBVH();
+    // Get a reference to the BVH, which may be null
+    const LLVolumeBVH* getBVH() const { return mBVH; }
+
     enum
     {
         SINGLE_MASK =   0x0001,
@@ -988,6 +995,7 @@ class LLVolumeFace
 private:
     LLVolumeOctree* mOctree;
     LLVolumeTriangle* mOctreeTriangles;
+    LLVolumeBVH* mBVH;
 
     BOOL createUnCutCubeCap(LLVolume* volume, BOOL partial_build = FALSE);
     BOOL createCap(LLVolume* volume, BOOL partial_build = FALSE);
@@ -1069,7 +1077,9 @@ class LLVolume : public LLRefCount
     LLFaceID generateFaceMask();
 
     BOOL isFaceMaskValid(LLFaceID face_mask);
-    static S32 sNumMeshPoints;
+    static std::atomic<S32> sNumMeshPoints; // volumes may be generated on worker threads
+    // lineSegmentIntersect() uses each face's LLVolumeBVH instead of its LLVolumeOctree
+    static bool sUseBVH;
 
     friend std::ostream& operator<<(std::ostream &s, const LLVolume &volume);
     friend std::ostream& operator<<(std::ostream &s, const LLVolume *volumep);      // HACK to bypass Windoze confusion over
@@ -1105,7 +1115,15 @@ class LLVolume : public LLRefCount
     void createVolumeFaces();
 public:
     bool unpackVolumeFaces(std::istream& is, S32 size);
-    bool unpackVolumeFaces(U8* in_data, S32 size);
+    bool unpackVolumeFaces(const U8* in_data, S32 size);
+
+    // Saves the faces of an unpacked mesh LOD as they are in memory, after
+    // dequantizing and cacheOptimize, so that unpackDecodedFaces can restore
+    // them with a copy per array.  The data is only for this build's
+    // unpacking on this machine; it is rejected when the layout version or
+    // the mirror and invert sculpt flags differ.
+    void packDecodedFaces(std::vector<U8>& out) const;
+    bool unpackDecodedFaces(const U8* in_data, S32 size);
 private:
     bool unpackVolumeFacesInternal(const LLSD& mdl);
 
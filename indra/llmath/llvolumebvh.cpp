@@ -0,0 +1,382 @@
+/**
+ * @file llvolumebvh.cpp
+ * @brief Flattened bounding volume hierarchy over the triangles of an
+ *        LLVolumeFace, for raycasts.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvolumebvh.h"
+#include "llvolume.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+    // Centroid bins per axis when looking for the cheapest split
+    const U32 BVH_BINS = 12;
+    // Ranges this small always become leaves
+    const U32 BVH_MIN_SPLIT = 3;
+    // Ranges larger than this are split even if the heuristic disagrees
+    const U32 BVH_MAX_LEAF = 8;
+    // Deeper ranges become leaves, which bounds the traversal stack
+    const S32 BVH_MAX_DEPTH = 60;
+    // Cost of visiting a node, relative to testing a triangle
+    const F32 BVH_TRAVERSAL_COST = 1.f;
+
+    struct Bounds
+    {
+        LL_ALIGN_16(LLVector4a mMin);
+        LL_ALIGN_16(LLVector4a mMax);
+
+        Bounds()
+        {
+            mMin.splat(FLT_MAX);
+            mMax.splat(-FLT_MAX);
+        }
+
+        void add(const LLVector4a& point)
+        {
+            mMin.setMin(mMin, point);
+            mMax.setMax(mMax, point);
+        }
+
+        void add(const Bounds& bounds)
+        {
+            mMin.setMin(mMin, bounds.mMin);
+            mMax.setMax(mMax, bounds.mMax);
+        }
+
+        // Half the surface area, which is all the heuristic needs
+        F32 getArea() const
+        {
+            LLVector4a size;
+            size.setSub(mMax, mMin);
+            if (size[0] < 0.f || size[1] < 0.f || size[2] < 0.f)
+            {
+                return 0.f;
+            }
+            return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+        }
+    };
+
+    struct Triangle
+    {
+        Bounds mBounds;
+        LL_ALIGN_16(LLVector4a mCenter);
+    };
+
+    // Slab test of the segment against the box. Returns the entry distance
+    // in near if the segment enters the box before max_t.
+    inline bool segment_box_intersect(const LLVector4a& box_min, const LLVector4a& box_max,
+                                      const LLVector4a& start, const LLVector4a& inv_dir,
+                                      F32 max_t, F32& near_t)
+    {
+        LLVector4a t0;
+        t0.setSub(box_min, start);
+        t0.mul(inv_dir);
+
+        LLVector4a t1;
+        t1.setSub(box_max, start);
+        t1.mul(inv_dir);
+
+        LLVector4a t_enter;
+        t_enter.setMin(t0, t1);
+        LLVector4a t_exit;
+        t_exit.setMax(t0, t1);
+
+        near_t = llmax(llmax(t_enter[0], t_enter[1]), llmax(t_enter[2], 0.f));
+        const F32 far_t = llmin(llmin(t_exit[0], t_exit[1]), llmin(t_exit[2], max_t));
+        return near_t <= far_t;
+    }
+}
+
+LLVolumeBVH::LLVolumeBVH(const LLVolumeFace& face)
+{
+    build(face);
+}
+
+void LLVolumeBVH::build(const LLVolumeFace& face)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+    llassert(face.mNumIndices % 3 == 0);
+    const U32 num_triangles = face.mNumIndices / 3;
+    if (!num_triangles)
+    {
+        return;
+    }
+
+    std::vector<Triangle> triangles(num_triangles);
+    std::vector<U32> order(num_triangles);
+    for (U32 i = 0; i < num_triangles; ++i)
+    {
+        Triangle& tri = triangles[i];
+        tri.mBounds.add(face.mPositions[face.mIndices[i * 3]]);
+        tri.mBounds.add(face.mPositions[face.mIndices[i * 3 + 1]]);
+        tri.mBounds.add(face.mPositions[face.mIndices[i * 3 + 2]]);
+        tri.mCenter.setAdd(tri.mBounds.mMin, tri.mBounds.mMax);
+        tri.mCenter.mul(0.5f);
+        order[i] = i;
+    }
+
+    struct Range
+    {
+        U32 mNode;
+        U32 mBegin;
+        U32 mEnd;
+        S32 mDepth;
+    };
+    std::vector<Range> ranges;
+    ranges.push_back({ 0, 0, num_triangles, 0 });
+    mNodes.reserve(num_triangles * 2 / BVH_MIN_SPLIT + 1);
+    mNodes.emplace_back();
+
+    while (!ranges.empty())
+    {
+        const Range range = ranges.back();
+        ranges.pop_back();
+        const U32 count = range.mEnd - range.mBegin;
+
+        Bounds bounds;
+        Bounds centers;
+        for (U32 i = range.mBegin; i < range.mEnd; ++i)
+        {
+            bounds.add(triangles[order[i]].mBounds);
+            centers.add(triangles[order[i]].mCenter);
+        }
+        mNodes[range.mNode].mMin = bounds.mMin;
+        mNodes[range.mNode].mMax = bounds.mMax;
+
+        // Find the cheapest split between centroid bins on any axis
+        S32 best_axis = -1;
+        U32 best_bin = 0;
+        F32 best_cost = FLT_MAX;
+        if (count >= BVH_MIN_SPLIT && range.mDepth < BVH_MAX_DEPTH)
+        {
+            for (S32 axis = 0; axis < 3; ++axis)
+            {
+                const F32 extent = centers.mMax[axis] - centers.mMin[axis];
+                if (extent <= 0.f)
+                {
+                    continue;
+                }
+                const F32 scale = BVH_BINS / extent;
+
+                Bounds bins[BVH_BINS];
+                U32 bin_counts[BVH_BINS] = {};
+                for (U32 i = range.mBegin; i < range.mEnd; ++i)
+                {
+                    const Triangle& tri = triangles[order[i]];
+                    const U32 bin = llmin(BVH_BINS - 1, (U32)((tri.mCenter[axis] - centers.mMin[axis]) * scale));
+                    bins[bin].add(tri.mBounds);
+                    ++bin_counts[bin];
+                }
+
+                // Costs of everything right of each split, then sweep left
+                F32 right_costs[BVH_BINS];
+                Bounds right;
+                U32 right_count = 0;
+                for (U32 bin = BVH_BINS - 1; bin > 0; --bin)
+                {
+                    right.add(bins[bin]);
+                    right_count += bin_counts[bin];
+                    right_costs[bin] = right_count * right.getArea();
+                }
+
+                Bounds left;
+                U32 left_count = 0;
+                for (U32 bin = 1; bin < BVH_BINS; ++bin)
+                {
+                    left.add(bins[bin - 1]);
+                    left_count += bin_counts[bin - 1];
+                    if (!left_count || left_count == count)
+                    {
+                        continue;
+                    }
+                    const F32 cost = left_count * left.getArea() + right_costs[bin];
+                    if (cost < best_cost)
+                    {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_bin = bin;
+                    }
+                }
+            }
+        }
+
+        const F32 area = bounds.getArea();
+        const bool split_pays = best_axis >= 0 && BVH_TRAVERSAL_COST * area + best_cost < count * area;
+        if (count < BVH_MIN_SPLIT || range.mDepth >= BVH_MAX_DEPTH || (!split_pays && count <= BVH_MAX_LEAF))
+        {
+            mNodes[range.mNode].mFirst = range.mBegin;
+            mNodes[range.mNode].mCount = count;
+            continue;
+        }
+
+        U32 mid = range.mBegin + count / 2;
+        if (best_axis >= 0)
+        {
+            const F32 scale = BVH_BINS / (centers.mMax[best_axis] - centers.mMin[best_axis]);
+            const F32 axis_min = centers.mMin[best_axis];
+            std::vector<U32>::iterator split = std::partition(order.begin() + range.mBegin, order.begin() + range.mEnd,
+                [&triangles, best_axis, best_bin, scale, axis_min](U32 i)
+                {
+                    return llmin(BVH_BINS - 1, (U32)((triangles[i].mCenter[best_axis] - axis_min) * scale)) < best_bin;
+                });
+            const U32 split_index = (U32)(split - order.begin());
+            if (split_index > range.mBegin && split_index < range.mEnd)
+            {
+                mid = split_index;
+            }
+        }
+        // else the centroids all coincide and any split of the range will do
+
+        const U32 first_child = (U32)mNodes.size();
+        mNodes.emplace_back();
+        mNodes.emplace_back();
+        mNodes[range.mNode].mFirst = first_child;
+        mNodes[range.mNode].mCount = 0;
+        ranges.push_back({ first_child, range.mBegin, mid, range.mDepth + 1 });
+        ranges.push_back({ first_child + 1, mid, range.mEnd, range.mDepth + 1 });
+    }
+
+    // Copy the triangles in leaf order, so leaves read contiguous indices
+    mIndices.resize(num_triangles * 3);
+    for (U32 i = 0; i < num_triangles; ++i)
+    {
+        mIndices[i * 3] = face.mIndices[order[i] * 3];
+        mIndices[i * 3 + 1] = face.mIndices[order[i] * 3 + 1];
+        mIndices[i * 3 + 2] = face.mIndices[order[i] * 3 + 2];
+    }
+}
+
+bool LLVolumeBVH::lineSegmentIntersect(const LLVolumeFace& face, const LLVector4a& start, const LLVector4a& dir,
+                                       F32& closest_t, F32& a, F32& b, U16 indices[3]) const
+{
+    if (mNodes.empty())
+    {
+        return false;
+    }
+
+    // Axes the segment runs parallel to get a huge but finite inverse, so
+    // the slab test never sees 0 * infinity
+    F32 inv[3];
+    for (S32 i = 0; i < 3; ++i)
+    {
+        const F32 d = dir[i];
+        inv[i] = 1.f / (fabsf(d) > 1e-20f ? d : (d < 0.f ? -1e-20f : 1e-20f));
+    }
+    LLVector4a inv_dir;
+    inv_dir.set(inv[0], inv[1], inv[2]);
+
+    F32 max_t = llmin(closest_t, 1.f);
+
+    struct Entry
+    {
+        U32 mNode;
+        F32 mNear;
+    };
+    // Each level pops one entry and pushes at most two
+    Entry stack[BVH_MAX_DEPTH + 2];
+    S32 depth = 0;
+
+    F32 near_t;
+    if (!segment_box_intersect(mNodes[0].mMin, mNodes[0].mMax, start, inv_dir, max_t, near_t))
+    {
+        return false;
+    }
+    stack[depth++] = { 0, near_t };
+
+    bool hit = false;
+    while (depth > 0)
+    {
+        const Entry entry = stack[--depth];
+        if (entry.mNear > max_t)
+        {
+            // a closer hit was found since this node was pushed
+            continue;
+        }
+
+        const Node& node = mNodes[entry.mNode];
+        if (node.mCount)
+        {
+            const U16* tri = &mIndices[node.mFirst * 3];
+            for (U32 i = 0; i < node.mCount; ++i, tri += 3)
+            {
+                F32 tri_a, tri_b, t;
+                if (LLTriangleRayIntersect(face.mPositions[tri[0]], face.mPositions[tri[1]], face.mPositions[tri[2]],
+                                           start, dir, tri_a, tri_b, t)
+                    && t >= 0.f && t <= 1.f && t < closest_t)
+                {
+                    closest_t = t;
+                    max_t = t;
+                    a = tri_a;
+                    b = tri_b;
+                    indices[0] = tri[0];
+                    indices[1] = tri[1];
+                    indices[2] = tri[2];
+                    hit = true;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first, so its hits prune the other one
+        const Node& left = mNodes[node.mFirst];
+        const Node& right = mNodes[node.mFirst + 1];
+        F32 left_t, right_t;
+        const bool hit_left = segment_box_intersect(left.mMin, left.mMax, start, inv_dir, max_t, left_t);
+        const bool hit_right = segment_box_intersect(right.mMin, right.mMax, start, inv_dir, max_t, right_t);
+        if (hit_left && hit_right)
+        {
+            if (left_t <= right_t)
+            {
+                stack[depth++] = { node.mFirst + 1, right_t };
+                stack[depth++] = { node.mFirst, left_t };
+            }
+            else
+            {
+                stack[depth++] = { node.mFirst, left_t };
+                stack[depth++] = { node.mFirst + 1, right_t };
+            }
+        }
+        else if (hit_left)
+        {
+            stack[depth++] = { node.mFirst, left_t };
+        }
+        else if (hit_right)
+        {
+            stack[depth++] = { node.mFirst + 1, right_t };
+        }
+    }
+
+    return hit;
+}
+
+size_t LLVolumeBVH::getMemoryUsage() const
+{
+    return sizeof(*this) + mNodes.capacity() * sizeof(Node) + mIndices.capacity() * sizeof(U16);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file llvolumebvh.h
+ * @brief Flattened bounding volume hierarchy over the triangles of an
+ *        LLVolumeFace, for raycasts.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOLUMEBVH_H
+#define LL_LLVOLUMEBVH_H
+
+#include "llmath.h"
+#include "llvector4a.h"
+
+#include <vector>
+
+class LLVolumeFace;
+
+// Binary BVH built with the surface area heuristic and stored as one
+// array of nodes, children next to each other, and one array of triangle
+// indices in leaf order. Unlike LLVolumeOctree it holds no pointers into
+// the face, so it stays valid as long as the face's indices and positions
+// do not change.
+class LLVolumeBVH
+{
+public:
+    LLVolumeBVH(const LLVolumeFace& face);
+
+    // Finds the triangle of face nearest to start along the segment
+    // start + t * dir, 0 <= t <= 1, closer than closest_t. On a hit, sets
+    // closest_t, the barycentric coordinates a and b, and the 3 vertex
+    // indices of the triangle, and returns true.
+    bool lineSegmentIntersect(const LLVolumeFace& face, const LLVector4a& start, const LLVector4a& dir,
+                              F32& closest_t, F32& a, F32& b, U16 indices[3]) const;
+
+    U32 getNumNodes() const { return (U32)mNodes.size(); }
+    U32 getNumTriangles() const { return (U32)mIndices.size() / 3; }
+    size_t getMemoryUsage() const;
+
+private:
+    // Inner nodes have mCount == 0 and their children at mFirst and
+    // mFirst + 1. Leaves hold mCount triangles from triangle mFirst.
+    struct Node
+    {
+        LL_ALIGN_16(LLVector4a mMin);
+        LL_ALIGN_16(LLVector4a mMax);
+        U32 mFirst;
+        U32 mCount;
+    };
+
+    void build(const LLVolumeFace& face);
+
+    std::vector<Node> mNodes;
+    std::vector<U16> mIndices;
+};
+
+#endif // LL_LLVOLUMEBVH_H
@@ -27,6 +27,11 @@
 
 #include "llvolumemgr.h"
 #include "llvolume.h"
+#include "workqueue.h"
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
 
 
 const F32 BASE_THRESHOLD = 0.03f;
@@ -41,10 +46,233 @@ F32 LLVolumeLODGroup::mDetailThresholds[NUM_LODS] = {BASE_THRESHOLD,
 F32 LLVolumeLODGroup::mDetailScales[NUM_LODS] = {1.f, 1.5f, 2.5f, 4.f};
 
 
+//============================================================================
+
+// Standard prim LODs that no LLVolumeLODGroup holds any more, most recently
+// used first, plus the LODs being generated on the generation queue.
+//
+// LLVolume's reference count is not thread safe, so a worker only ever
+// touches the volume it generates, and hands it over under mMutex. Volumes
+// are only released by the threads calling LLVolumeMgr.
+class LLVolumeCache : public std::enable_shared_from_this<LLVolumeCache>
+{
+public:
+    LLVolumeCache()
+    :   mSize(0),
+        mHits(0),
+        mMisses(0)
+    {
+    }
+
+    void setSize(U32 size);
+    void setQueueName(const std::string& queue_name);
+
+    // Removes the LOD from the cache, waiting for it if a worker is
+    // generating it. Returns NULL when it has to be generated.
+    LLPointer<LLVolume> take(const LLVolumeParams& params, S32 detail);
+    void add(const LLVolumeParams& params, S32 detail, LLVolume* volumep);
+    void prefetch(const LLVolumeParams& params, S32 detail);
+    void clear();
+    void dump();
+
+private:
+    typedef std::pair<LLVolumeParams, S32> key_t;
+    typedef std::list<key_t> lru_list_t;
+
+    enum EState
+    {
+        QUEUED,
+        GENERATING,
+        READY
+    };
+
+    struct Entry
+    {
+        EState mState = QUEUED;
+        LLPointer<LLVolume> mVolume;
+        lru_list_t::iterator mLRU;  // only READY entries are in mLRU
+    };
+    typedef std::map<key_t, Entry> entry_map_t;
+
+    // Runs on the generation queue
+    void generate(const key_t& key);
+    // Moves the least recently used volumes beyond mSize to evicted, so
+    // they can be released after unlocking
+    void trim(std::vector<LLPointer<LLVolume> >& evicted);
+
+    std::mutex mMutex;
+    std::condition_variable mGenerated;
+    entry_map_t mEntries;
+    lru_list_t mLRU;
+    U32 mSize;
+    std::string mQueueName;
+    U32 mHits;
+    U32 mMisses;
+};
+
+void LLVolumeCache::setSize(U32 size)
+{
+    std::vector<LLPointer<LLVolume> > evicted;
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSize = size;
+    trim(evicted);
+}
+
+void LLVolumeCache::setQueueName(const std::string& queue_name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQueueName = queue_name;
+}
+
+LLPointer<LLVolume> LLVolumeCache::take(const LLVolumeParams& params, S32 detail)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+    LLPointer<LLVolume> volumep;
+    std::unique_lock<std::mutex> lock(mMutex);
+    entry_map_t::iterator iter = mEntries.find(key_t(params, detail));
+    if (iter == mEntries.end())
+    {
+        ++mMisses;
+    }
+    else if (iter->second.mState == QUEUED)
+    {
+        // Cheaper to generate it right here than to wait for the queue to
+        // get to it, and the job finds nothing left to do
+        ++mMisses;
+        mEntries.erase(iter);
+    }
+    else
+    {
+        // A GENERATING entry stays put until its worker marks it READY
+        mGenerated.wait(lock, [iter]() { return iter->second.mState == READY; });
+        ++mHits;
+        volumep = iter->second.mVolume;
+        mLRU.erase(iter->second.mLRU);
+        mEntries.erase(iter);
+    }
+    return volumep;
+}
+
+void LLVolumeCache::add(const LLVolumeParams& params, S32 detail, LLVolume* volumep)
+{
+    std::vector<LLPointer<LLVolume> > evicted;
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mSize)
+    {
+        return;
+    }
+    std::pair<entry_map_t::iterator, bool> result = mEntries.emplace(key_t(params, detail), Entry());
+    if (!result.second)
+    {
+        // already cached or being generated
+        return;
+    }
+    Entry& entry = result.first->second;
+    entry.mState = READY;
+    entry.mVolume = volumep;
+    mLRU.push_front(result.first->first);
+    entry.mLRU = mLRU.begin();
+    trim(evicted);
+}
+
+void LLVolumeCache::prefetch(const LLVolumeParams& params, S32 detail)
+{
+    std::vector<LLPointer<LLVolume> > evicted;
+    key_t key(params, detail);
+    LL::WorkQueue::ptr_t queue;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // workers add volumes without trimming, so keep up with them here
+        trim(evicted);
+        if (!mSize || mQueueName.empty())
+        {
+            return;
+        }
+        queue = LL::WorkQueue::getInstance(mQueueName);
+        if (!queue || !mEntries.emplace(key, Entry()).second)
+        {
+            return;
+        }
+    }
+
+    std::shared_ptr<LLVolumeCache> self(shared_from_this());
+    if (!queue->post([self, key]() { self->generate(key); }))
+    {
+        // the queue is closed
+        std::lock_guard<std::mutex> lock(mMutex);
+        entry_map_t::iterator iter = mEntries.find(key);
+        if (iter != mEntries.end() && iter->second.mState == QUEUED)
+        {
+            mEntries.erase(iter);
+        }
+    }
+}
+
+void LLVolumeCache::generate(const key_t& key)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+    entry_map_t::iterator iter;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        iter = mEntries.find(key);
+        if (iter == mEntries.end() || iter->second.mState != QUEUED)
+        {
+            // taken over by refVolume() in the meantime
+            return;
+        }
+        iter->second.mState = GENERATING;
+    }
+
+    // Not held in an LLPointer here: the first reference is the entry's
+    LLVolume* volumep = new LLVolume(key.first, LLVolumeLODGroup::getVolumeScaleFromDetail(key.second));
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        iter->second.mVolume = volumep;
+        iter->second.mState = READY;
+        mLRU.push_front(key);
+        iter->second.mLRU = mLRU.begin();
+    }
+    mGenerated.notify_all();
+}
+
+void LLVolumeCache::trim(std::vector<LLPointer<LLVolume> >& evicted)
+{
+    while (mLRU.size() > mSize)
+    {
+        entry_map_t::iterator iter = mEntries.find(mLRU.back());
+        evicted.push_back(iter->second.mVolume);
+        mEntries.erase(iter);
+        mLRU.pop_back();
+    }
+}
+
+void LLVolumeCache::clear()
+{
+    std::vector<LLPointer<LLVolume> > evicted;
+    std::lock_guard<std::mutex> lock(mMutex);
+    // entries still being generated are left to their workers
+    for (const key_t& key : mLRU)
+    {
+        entry_map_t::iterator iter = mEntries.find(key);
+        evicted.push_back(iter->second.mVolume);
+        mEntries.erase(iter);
+    }
+    mLRU.clear();
+}
+
+void LLVolumeCache::dump()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    LL_INFOS() << "Volume cache holds " << mLRU.size() << " of " << mSize << " LODs, "
+               << mHits << " hits, " << mMisses << " misses" << LL_ENDL;
+}
+
 //============================================================================
 
 LLVolumeMgr::LLVolumeMgr()
-:   mDataMutex(NULL)
+:   mDataMutex(NULL),
+    mVolumeCache(std::make_shared<LLVolumeCache>())
 {
     // the LLMutex magic interferes with easy unit testing,
     // so you now must manually call useMutex() to use it
@@ -78,6 +306,7 @@ BOOL LLVolumeMgr::cleanup()
         delete volgroupp;
     }
     mVolumeLODGroups.clear();
+    mVolumeCache->clear();
     if (mDataMutex)
     {
         mDataMutex->unlock();
@@ -109,6 +338,26 @@ LLVolume* LLVolumeMgr::refVolume(const LLVolumeParams &volume_params, const S32
     {
         mDataMutex->unlock();
     }
+
+    if (!volgroupp->getLOD(lod) && isCacheable(volume_params))
+    {
+        LLPointer<LLVolume> volumep = mVolumeCache->take(volume_params, lod);
+        if (volumep.isNull())
+        {
+            volumep = new LLVolume(volume_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
+        }
+        volgroupp->setLOD(lod, volumep);
+
+        // LOD changes as the camera moves are usually a single step
+        if (lod > 0 && !volgroupp->getLOD(lod - 1))
+        {
+            mVolumeCache->prefetch(volume_params, lod - 1);
+        }
+        if (lod < LLVolumeLODGroup::NUM_LODS - 1 && !volgroupp->getLOD(lod + 1))
+        {
+            mVolumeCache->prefetch(volume_params, lod + 1);
+        }
+    }
     return volgroupp->refLOD(lod);
 }
 
@@ -161,6 +410,17 @@ void LLVolumeMgr::unrefVolume(LLVolume *volumep)
         volgroupp->derefLOD(volumep);
         if (volgroupp->getNumRefs() == 0)
         {
+            const LLVolumeParams& group_params = *volgroupp->getVolumeParams();
+            if (isCacheable(group_params))
+            {
+                for (S32 i = 0; i < LLVolumeLODGroup::NUM_LODS; i++)
+                {
+                    if (volgroupp->getLOD(i))
+                    {
+                        mVolumeCache->add(group_params, i, volgroupp->getLOD(i));
+                    }
+                }
+            }
             mVolumeLODGroups.erase(params);
             delete volgroupp;
         }
@@ -208,6 +468,7 @@ void LLVolumeMgr::dump()
         mDataMutex->unlock();
     }
     LL_INFOS() << "Average usage of LODs " << avg << LL_ENDL;
+    mVolumeCache->dump();
 }
 
 void LLVolumeMgr::useMutex()
@@ -218,6 +479,33 @@ void LLVolumeMgr::useMutex()
     }
 }
 
+void LLVolumeMgr::setCacheSize(U32 size)
+{
+    mVolumeCache->setSize(size);
+}
+
+void LLVolumeMgr::setGenerationQueue(const std::string& queue_name)
+{
+    mVolumeCache->setQueueName(queue_name);
+}
+
+void LLVolumeMgr::prefetchVolume(const LLVolumeParams& volume_params, const S32 detail)
+{
+    if (isCacheable(volume_params))
+    {
+        mVolumeCache->prefetch(volume_params, detail);
+    }
+}
+
+// static
+bool LLVolumeMgr::isCacheable(const LLVolumeParams& volume_params)
+{
+    // the LLVolume constructor creates the faces of exactly these
+    return volume_params.getSculptID().isNull()
+        && volume_params.getSculptType() == LL_SCULPT_TYPE_NONE
+        && volume_params.getPathParams().getCurveType() != LL_PCODE_PATH_FLEXIBLE;
+}
+
 std::ostream& operator<<(std::ostream& s, const LLVolumeMgr& volume_mgr)
 {
     s << "{ numLODgroups=" << volume_mgr.mVolumeLODGroups.size() << ", ";
@@ -301,6 +589,13 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 lod)
     return mVolumeLODs[lod];
 }
 
+void LLVolumeLODGroup::setLOD(const S32 lod, LLVolume* volumep)
+{
+    llassert(lod >= 0 && lod < NUM_LODS);
+    llassert(mVolumeLODs[lod].isNull());
+    mVolumeLODs[lod] = volumep;
+}
+
 BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 {
     llassert_always(mRefs > 0);
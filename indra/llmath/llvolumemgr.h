@@ -28,6 +28,8 @@
 #define LL_LLVOLUMEMGR_H
 
 #include <map>
+#include <memory>
+#include <string>
 
 #include "llvolume.h"
 #include "llpointer.h"
@@ -35,6 +37,7 @@
 
 class LLVolumeParams;
 class LLVolumeLODGroup;
+class LLVolumeCache;
 
 class LLVolumeLODGroup
 {
@@ -57,6 +60,10 @@ class LLVolumeLODGroup
 
     LLVolume* refLOD(const S32 detail);
     BOOL derefLOD(LLVolume *volumep);
+    // The LOD volume, or NULL when it has not been generated yet
+    LLVolume* getLOD(const S32 detail) const { return mVolumeLODs[detail]; }
+    // Supplies the LOD volume so that refLOD() does not generate it
+    void setLOD(const S32 detail, LLVolume* volumep);
     S32 getNumRefs() const { return mRefs; }
 
     const LLVolumeParams* getVolumeParams() const { return &mVolumeParams; };
@@ -95,6 +102,21 @@ class LLVolumeMgr
     // manually call this for mutex magic
     void useMutex();
 
+    // Keeps up to size LOD volumes of standard prims around after their
+    // last reference goes away, so the same params do not get generated
+    // again. 0, the default, disables the cache.
+    void setCacheSize(U32 size);
+    // Generates the LODs next to each newly referenced one ahead of time
+    // on the threads of the named WorkQueue. Needs a cache size.
+    void setGenerationQueue(const std::string& queue_name);
+    // Starts generating the LOD on the generation queue unless it is
+    // already cached or being generated
+    void prefetchVolume(const LLVolumeParams& volume_params, const S32 detail);
+
+    // Only volumes generated from their params alone are cached; sculpts,
+    // meshes and flexible prims get their geometry from elsewhere.
+    static bool isCacheable(const LLVolumeParams& volume_params);
+
     friend std::ostream& operator<<(std::ostream& s, const LLVolumeMgr& volume_mgr);
 
 protected:
@@ -107,6 +129,10 @@ class LLVolumeMgr
     volume_lod_group_map_t mVolumeLODGroups;
 
     LLMutex* mDataMutex;
+
+    // Queued generation jobs hold a reference too, so the cache outlives
+    // the manager until they are done
+    std::shared_ptr<LLVolumeCache> mVolumeCache;
 };
 
 #endif // LL_LLVOLUMEMGR_H
@@ -217,19 +217,26 @@ class LLVolumeOctreeRebound : public LLOctreeTravelerDepthFirst<LLVolumeTriangle
     }
 };
 
-class LLVolumeOctree : public LLOctreeRoot<LLVolumeTriangle, LLVolumeTriangle*>, public LLRefCount
+// Pool of an LLVolumeOctree's nodes. A base class rather than a member so
+// that it is constructed before and destroyed after the nodes.
+struct LLVolumeOctreePool
+{
+    LLOctreePool mOctreePool;
+};
+
+class LLVolumeOctree : private LLVolumeOctreePool, public LLOctreeRoot<LLVolumeTriangle, LLVolumeTriangle*>, public LLRefCount
 {
 public:
     LLVolumeOctree(const LLVector4a& center, const LLVector4a& size)
         :
-        LLOctreeRoot<LLVolumeTriangle, LLVolumeTriangle*>(center, size, nullptr),
+        LLOctreeRoot<LLVolumeTriangle, LLVolumeTriangle*>(center, size, nullptr, &mOctreePool),
         LLRefCount()
     {
         new LLVolumeOctreeListener(this);
     }
 
     LLVolumeOctree()
-        : LLOctreeRoot<LLVolumeTriangle, LLVolumeTriangle*>(LLVector4a::getZero(), LLVector4a(1.f,1.f,1.f), nullptr),
+        : LLOctreeRoot<LLVolumeTriangle, LLVolumeTriangle*>(LLVector4a::getZero(), LLVector4a(1.f,1.f,1.f), nullptr, &mOctreePool),
         LLRefCount()
     {
         new LLVolumeOctreeListener(this);
@@ -0,0 +1,222 @@
+/**
+ * @file   lloctree_test.cpp
+ * @date   2024-06-17
+ * @brief  Test for lloctree.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "llmath.h"
+#include "llrand.h"
+#include "../lloctree.h"
+
+namespace tut
+{
+    class alignas(16) TestElement : public LLRefCount
+    {
+        LL_ALIGN_NEW
+    public:
+        TestElement(const LLVector4a& position, F32 radius)
+        :   mPosition(position),
+            mRadius(radius),
+            mBinIndex(-1)
+        {
+        }
+
+        const LLVector4a& getPositionGroup() const  { return mPosition; }
+        const F32& getBinRadius() const             { return mRadius; }
+        S32 getBinIndex() const                     { return mBinIndex; }
+        void setBinIndex(S32 index) const           { mBinIndex = index; }
+
+    private:
+        LL_ALIGN_16(LLVector4a mPosition);
+        F32 mRadius;
+        mutable S32 mBinIndex;
+    };
+
+    typedef LLOctreeNode<TestElement, LLPointer<TestElement>> TestNode;
+    typedef LLOctreeRoot<TestElement, LLPointer<TestElement>> TestRoot;
+
+    // Checks that every node below the root uses the given pool
+    class PoolChecker : public LLOctreeTraveler<TestElement, LLPointer<TestElement>>
+    {
+    public:
+        PoolChecker(LLOctreePool* pool) : mPool(pool), mNodes(0) {}
+
+        virtual void visit(const TestNode* node)
+        {
+            ensure("node in wrong pool", node->getPool() == mPool);
+            ensure_equals("node misaligned", (size_t)node % 16, (size_t)0);
+            ++mNodes;
+        }
+
+        LLOctreePool* mPool;
+        U32 mNodes;
+    };
+
+    struct LLOctreeData
+    {
+        U32 mSavedMaxCapacity;
+        F32 mSavedMinSize;
+        std::vector<LLPointer<TestElement>> mElements;
+
+        LLOctreeData()
+        :   mSavedMaxCapacity(gOctreeMaxCapacity),
+            mSavedMinSize(gOctreeMinSize)
+        {
+            // small nodes so the tree grows deep
+            gOctreeMaxCapacity = 4;
+            gOctreeMinSize = 0.01f;
+
+            for (S32 i = 0; i < 2000; ++i)
+            {
+                LLVector4a position(ll_frand(256.f), ll_frand(256.f), ll_frand(256.f));
+                mElements.push_back(new TestElement(position, ll_frand(2.f) + 0.01f));
+            }
+        }
+
+        ~LLOctreeData()
+        {
+            gOctreeMaxCapacity = mSavedMaxCapacity;
+            gOctreeMinSize = mSavedMinSize;
+        }
+
+        // Fills, checks and empties a tree, returning its node count
+        U32 exercise(TestRoot* root, LLOctreePool* pool)
+        {
+            for (TestElement* element : mElements)
+            {
+                root->insert(element);
+            }
+            for (TestElement* element : mElements)
+            {
+                ensure("element not inserted", element->getBinIndex() != -1);
+            }
+
+            PoolChecker checker(pool);
+            checker.traverse(root);
+            ensure("pool unused", !pool || pool->getBytesInUse() > 0);
+
+            for (size_t i = 0; i < mElements.size(); i += 2)
+            {
+                root->remove(mElements[i]);
+                ensure_equals("element not removed", mElements[i]->getBinIndex(), -1);
+            }
+            while (!root->balance()) { }
+            for (size_t i = 0; i < mElements.size(); i += 2)
+            {
+                root->insert(mElements[i]);
+            }
+            for (TestElement* element : mElements)
+            {
+                root->remove(element);
+            }
+            return checker.mNodes;
+        }
+    };
+
+    typedef test_group<LLOctreeData> factory;
+    typedef factory::object object;
+}
+
+namespace
+{
+    tut::factory lloctree_test_factory("LLOctree");
+}
+
+namespace tut
+{
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("pool blocks are recycled");
+        LLOctreePool pool;
+        std::vector<void*> blocks;
+        for (S32 i = 0; i < 100; ++i)
+        {
+            blocks.push_back(pool.allocate(40));
+            ensure_equals("block misaligned", (size_t)blocks.back() % 16, (size_t)0);
+        }
+        void* large = pool.allocate(10000);
+        ensure_equals("wrong allocation count", pool.getNumAllocations(), 101U);
+        ensure_equals("wrong bytes in use", pool.getBytesInUse(), (size_t)(100 * 48 + 10000));
+
+        const size_t reserved = pool.getBytesReserved();
+        const U32 chunks = pool.getNumChunks();
+        for (void* block : blocks)
+        {
+            pool.deallocate(block, 40);
+        }
+        pool.deallocate(large, 10000);
+        ensure_equals("bytes still in use", pool.getBytesInUse(), (size_t)0);
+
+        for (S32 i = 0; i < 100; ++i)
+        {
+            blocks[i] = pool.allocate(33);
+        }
+        ensure_equals("freed blocks not reused", pool.getNumChunks(), chunks);
+        ensure_equals("reserved grew", pool.getBytesReserved(), reserved - 10000);
+
+        pool.reset();
+        ensure("reset with blocks in use", pool.getNumChunks() > 0);
+        for (void* block : blocks)
+        {
+            pool.deallocate(block, 33);
+        }
+        pool.reset();
+        ensure_equals("chunks left", pool.getNumChunks(), 0U);
+        ensure_equals("bytes left", pool.getBytesReserved(), (size_t)0);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("pooled octree");
+        LLOctreePool pool;
+        TestRoot* root = new TestRoot(LLVector4a(128.f, 128.f, 128.f), LLVector4a(128.f, 128.f, 128.f), NULL, &pool);
+        ensure("too few nodes", exercise(root, &pool) > 1);
+
+        // run it again on the warm pool
+        const U32 chunks = pool.getNumChunks();
+        exercise(root, &pool);
+        ensure_equals("warm pool grew", pool.getNumChunks(), chunks);
+
+        delete root;
+        ensure_equals("blocks leaked", pool.getNumAllocations(), 0U);
+        ensure_equals("bytes leaked", pool.getBytesInUse(), (size_t)0);
+        pool.reset();
+        ensure_equals("chunks left", pool.getNumChunks(), 0U);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("octree without pool");
+        TestRoot* root = new TestRoot(LLVector4a(128.f, 128.f, 128.f), LLVector4a(128.f, 128.f, 128.f), NULL);
+        ensure("too few nodes", exercise(root, NULL) > 1);
+        delete root;
+    }
+}
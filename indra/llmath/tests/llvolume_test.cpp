@@ -0,0 +1,193 @@
+/**
+ * @file   llvolume_test.cpp
+ * @date   2024-07-02
+ * @brief  Test for the decoded face cache format of llvolume.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "llrand.h"
+#include "../llvolume.h"
+
+namespace tut
+{
+    struct LLVolumeData
+    {
+        LLVolumeParams mParams;
+
+        LLVolumeData()
+        {
+            mParams.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+            LLUUID id;
+            id.generate();
+            mParams.setSculptID(id, LL_SCULPT_TYPE_MESH);
+        }
+
+        // Fills a face with random triangles, as unpacking a mesh LOD would
+        static void fillFace(LLVolumeFace& face, S32 num_verts, S32 num_triangles, bool rigged)
+        {
+            face.resizeVertices(num_verts);
+            face.allocateTangents(num_verts);
+            if (rigged)
+            {
+                face.allocateWeights(num_verts);
+            }
+            for (S32 i = 0; i < num_verts; ++i)
+            {
+                face.mPositions[i].set(ll_frand() - 0.5f, ll_frand() - 0.5f, ll_frand() - 0.5f);
+                face.mNormals[i].set(ll_frand(), ll_frand(), ll_frand());
+                face.mNormals[i].normalize3fast();
+                face.mTangents[i].set(ll_frand(), ll_frand(), ll_frand(), 1.f);
+                face.mTexCoords[i].set(ll_frand(), ll_frand());
+                if (rigged)
+                {
+                    face.mWeights[i].set(1.5f, 2.25f, 0.f, 0.f);
+                }
+            }
+
+            face.resizeIndices(num_triangles * 3);
+            for (S32 i = 0; i < face.mNumIndices; ++i)
+            {
+                face.mIndices[i] = (U16)ll_rand(num_verts);
+            }
+
+            face.mExtents[0].splat(-0.5f);
+            face.mExtents[1].splat(0.5f);
+            face.mTexCoordExtents[0].set(0.f, 0.f);
+            face.mTexCoordExtents[1].set(1.f, 1.f);
+            face.mNormalizedScale.set(2.f, 3.f, 4.f);
+            face.mOptimized = TRUE;
+        }
+
+        LLPointer<LLVolume> makeVolume(const LLVolumeParams& params)
+        {
+            LLPointer<LLVolume> volume = new LLVolume(params, 1.f);
+            volume->getVolumeFaces().resize(2);
+            fillFace(volume->getVolumeFace(0), 301, 200, true);
+            // no tangents or weights on this one
+            LLVolumeFace& plain = volume->getVolumeFace(1);
+            fillFace(plain, 17, 9, false);
+            ll_aligned_free_16(plain.mTangents);
+            plain.mTangents = NULL;
+            return volume;
+        }
+
+        static void ensureVectorsEqual(const char* what, const LLVector4a* a, const LLVector4a* b, S32 count)
+        {
+            ensure(what, !memcmp(a, b, count * sizeof(LLVector4a)));
+        }
+    };
+
+    typedef test_group<LLVolumeData> factory;
+    typedef factory::object object;
+}
+
+namespace
+{
+    tut::factory llvolume_test_factory("LLVolume");
+}
+
+namespace tut
+{
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("decoded faces round trip");
+        LLPointer<LLVolume> source = makeVolume(mParams);
+        std::vector<U8> packed;
+        source->packDecodedFaces(packed);
+        ensure_equals("unaligned size", packed.size() % 16, (size_t)0);
+
+        LLPointer<LLVolume> loaded = new LLVolume(mParams, 1.f);
+        ensure("unpack failed", loaded->unpackDecodedFaces(packed.data(), (S32)packed.size()));
+        ensure_equals("wrong face count", loaded->getNumVolumeFaces(), 2);
+        ensure_equals("not marked unpacked", loaded->getSculptLevel(), 0);
+
+        for (S32 f = 0; f < 2; ++f)
+        {
+            const LLVolumeFace& a = source->getVolumeFace(f);
+            const LLVolumeFace& b = loaded->getVolumeFace(f);
+            ensure_equals("vertex count", b.mNumVertices, a.mNumVertices);
+            ensure_equals("index count", b.mNumIndices, a.mNumIndices);
+            ensureVectorsEqual("positions", a.mPositions, b.mPositions, a.mNumVertices);
+            ensureVectorsEqual("normals", a.mNormals, b.mNormals, a.mNumVertices);
+            ensureVectorsEqual("extents", a.mExtents, b.mExtents, 2);
+            for (S32 i = 0; i < a.mNumVertices; ++i)
+            {
+                ensure("texcoords", a.mTexCoords[i] == b.mTexCoords[i]);
+            }
+            ensure("indices", !memcmp(a.mIndices, b.mIndices, a.mNumIndices * sizeof(U16)));
+            ensure("tangents", (a.mTangents == NULL) == (b.mTangents == NULL));
+            if (a.mTangents)
+            {
+                ensureVectorsEqual("tangents", a.mTangents, b.mTangents, a.mNumVertices);
+            }
+            ensure("weights", (a.mWeights == NULL) == (b.mWeights == NULL));
+            if (a.mWeights)
+            {
+                ensureVectorsEqual("weights", a.mWeights, b.mWeights, a.mNumVertices);
+            }
+            ensure("texcoord extents", a.mTexCoordExtents[1] == b.mTexCoordExtents[1]);
+            ensure("normalized scale", a.mNormalizedScale == b.mNormalizedScale);
+            ensure("not optimized", b.mOptimized);
+        }
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("damaged or mismatched decoded faces are rejected");
+        LLPointer<LLVolume> source = makeVolume(mParams);
+        std::vector<U8> packed;
+        source->packDecodedFaces(packed);
+
+        LLPointer<LLVolume> loaded = new LLVolume(mParams, 1.f);
+        const S32 faces = loaded->getNumVolumeFaces();
+        ensure("null accepted", !loaded->unpackDecodedFaces(NULL, 0));
+        ensure("truncated accepted", !loaded->unpackDecodedFaces(packed.data(), (S32)packed.size() - 16));
+        ensure("header only accepted", !loaded->unpackDecodedFaces(packed.data(), 16));
+
+        std::vector<U8> bad_magic(packed);
+        bad_magic[0] ^= 0xFF;
+        ensure("bad magic accepted", !loaded->unpackDecodedFaces(bad_magic.data(), (S32)bad_magic.size()));
+
+        // last index of the last face, just before its padding
+        std::vector<U8> bad_index(packed);
+        const LLVolumeFace& last = source->getVolumeFace(1);
+        const size_t index_bytes = ((last.mNumIndices * sizeof(U16)) + 0xF) & ~0xF;
+        const size_t last_index = bad_index.size() - index_bytes + (last.mNumIndices - 1) * sizeof(U16);
+        bad_index[last_index] = 0xFF;
+        bad_index[last_index + 1] = 0xFF;
+        ensure("index out of range accepted", !loaded->unpackDecodedFaces(bad_index.data(), (S32)bad_index.size()));
+        ensure_equals("failed unpack changed faces", loaded->getNumVolumeFaces(), faces);
+
+        // mirroring changes the decoded geometry
+        LLVolumeParams mirrored(mParams);
+        mirrored.setSculptID(mParams.getSculptID(), LL_SCULPT_TYPE_MESH | LL_SCULPT_FLAG_MIRROR);
+        LLPointer<LLVolume> mirror = new LLVolume(mirrored, 1.f);
+        ensure("other sculpt flags accepted", !mirror->unpackDecodedFaces(packed.data(), (S32)packed.size()));
+    }
+}
@@ -0,0 +1,154 @@
+/**
+ * @file   llvolumemgr_test.cpp
+ * @date   2024-06-10
+ * @brief  Test for llvolumemgr.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "../llvolumemgr.h"
+#include "threadpool.h"
+
+namespace tut
+{
+    struct LLVolumeMgrData
+    {
+        LLVolumeParams mTorus;
+        LLVolumeParams mBox;
+
+        LLVolumeMgrData()
+        {
+            mTorus.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+            mBox.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+        }
+
+        // References and releases the LOD, returning the volume it had
+        static LLPointer<LLVolume> refAndRelease(LLVolumeMgr& mgr, const LLVolumeParams& params, S32 detail)
+        {
+            LLPointer<LLVolume> volumep = mgr.refVolume(params, detail);
+            mgr.unrefVolume(volumep);
+            return volumep;
+        }
+    };
+
+    typedef test_group<LLVolumeMgrData> factory;
+    typedef factory::object object;
+}
+
+namespace
+{
+    tut::factory llvolumemgr_test_factory("LLVolumeMgr");
+}
+
+namespace tut
+{
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("no cache by default");
+        LLVolumeMgr mgr;
+        LLPointer<LLVolume> first = refAndRelease(mgr, mTorus, 2);
+        LLPointer<LLVolume> second = refAndRelease(mgr, mTorus, 2);
+        ensure("volume was reused", first != second);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("released LODs are reused");
+        LLVolumeMgr mgr;
+        mgr.setCacheSize(16);
+        LLPointer<LLVolume> first = refAndRelease(mgr, mTorus, 2);
+        LLPointer<LLVolume> second = refAndRelease(mgr, mTorus, 2);
+        ensure("volume was not reused", first == second);
+        ensure_equals("wrong detail", second->getDetail(), LLVolumeLODGroup::getVolumeScaleFromDetail(2));
+
+        LLPointer<LLVolume> other_lod = refAndRelease(mgr, mTorus, 1);
+        ensure("other LOD was shared", other_lod != first);
+        ensure("references left", mgr.cleanup());
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("sculpts are not cached");
+        LLVolumeParams sculpt;
+        sculpt.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+        LLUUID id;
+        id.generate();
+        sculpt.setSculptID(id, LL_SCULPT_TYPE_SPHERE);
+        ensure("sculpt cacheable", !LLVolumeMgr::isCacheable(sculpt));
+        ensure("torus not cacheable", LLVolumeMgr::isCacheable(mTorus));
+
+        LLVolumeMgr mgr;
+        mgr.setCacheSize(16);
+        LLPointer<LLVolume> first = refAndRelease(mgr, sculpt, 2);
+        LLPointer<LLVolume> second = refAndRelease(mgr, sculpt, 2);
+        ensure("sculpt was reused", first != second);
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("least recently used LODs are dropped");
+        LLVolumeMgr mgr;
+        mgr.setCacheSize(1);
+        LLPointer<LLVolume> torus = refAndRelease(mgr, mTorus, 3);
+        LLPointer<LLVolume> box = refAndRelease(mgr, mBox, 3);
+        ensure("dropped LOD was reused", refAndRelease(mgr, mTorus, 3) != torus);
+
+        mgr.setCacheSize(0);
+        ensure("disabled cache reused", refAndRelease(mgr, mTorus, 3) != torus);
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("neighbouring LODs are generated on the queue");
+        LL::ThreadPool pool("LLVolumeMgr", 2);
+        pool.start();
+
+        LLVolumeMgr mgr;
+        mgr.setCacheSize(16);
+        mgr.setGenerationQueue("LLVolumeMgr");
+        LLPointer<LLVolume> middle = mgr.refVolume(mTorus, 1);
+        mgr.prefetchVolume(mTorus, 3);
+        // whether or not the workers got there first, the LODs come out right
+        for (S32 detail : { 0, 2, 3 })
+        {
+            LLPointer<LLVolume> volumep = mgr.refVolume(mTorus, detail);
+            LLPointer<LLVolume> expected = new LLVolume(mTorus, LLVolumeLODGroup::getVolumeScaleFromDetail(detail));
+            ensure_equals("wrong detail", volumep->getDetail(), expected->getDetail());
+            ensure_equals("wrong face count", volumep->getNumVolumeFaces(), expected->getNumVolumeFaces());
+            ensure_equals("wrong vertex count", volumep->getVolumeFace(0).mNumVertices,
+                          expected->getVolumeFace(0).mNumVertices);
+            mgr.unrefVolume(volumep);
+        }
+        mgr.unrefVolume(middle);
+        pool.close();
+        ensure("references left", mgr.cleanup());
+    }
+}
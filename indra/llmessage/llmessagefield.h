@@ -0,0 +1,84 @@
+/**
+ * @file llmessagefield.h
+ * @brief Declaration of LLMessageField class.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGEFIELD_H
+#define LL_LLMESSAGEFIELD_H
+
+#include "stdtypes.h"
+
+class LLMessageTemplate;
+
+/**
+ * A variable of a block in a template message, for handlers that read the
+ * same variables from every message they receive.
+ *
+ * The first read through a field looks its block and variable up in the
+ * message template by name, like the get*Fast() calls do, and remembers
+ * their positions in the template. Later reads of the same message go
+ * straight to the decoded data by index:
+ *
+ * @code
+ * static const LLMessageField local_id(_PREHASH_ObjectData, _PREHASH_ID);
+ * for (S32 i = 0; i < num_objects; i++)
+ * {
+ *     mesgsys->getU32Fast(local_id, id, i);
+ * }
+ * @endcode
+ *
+ * Names must be canonical strings, such as the _PREHASH_ constants. Fields
+ * may be read from any message with that block and variable, but reading
+ * the same field from several message types alternately looks it up again
+ * each time the message type changes. Readers other than
+ * LLTemplateMessageReader just use the names.
+ */
+class LLMessageField
+{
+public:
+    LLMessageField(const char* block, const char* variable)
+    :   mBlock(block),
+        mVariable(variable),
+        mTemplate(nullptr),
+        mBlockIndex(-1),
+        mVariableIndex(-1)
+    {
+    }
+
+    const char* getBlock() const { return mBlock; }
+    const char* getVariable() const { return mVariable; }
+
+private:
+    friend class LLTemplateMessageReader;
+
+    const char* mBlock;
+    const char* mVariable;
+
+    // Positions in the template last read from, set by LLTemplateMessageReader
+    mutable const LLMessageTemplate* mTemplate;
+    mutable S32 mBlockIndex;
+    mutable S32 mVariableIndex;
+};
+
+#endif // LL_LLMESSAGEFIELD_H
@@ -0,0 +1,200 @@
+/**
+ * @file llmessagereceivethread.cpp
+ * @brief LLMessageReceiveThread implementation.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llmessagereceivethread.h"
+
+#include "llpacketring.h"
+#include "message.h"
+
+// Packets read ahead of the main thread at most. Past this the socket's
+// own receive buffer holds the rest.
+static const S32 MAX_PACKETS = 256;
+
+// How long to wait on the socket before checking for shutdown
+static const S32 WAIT_MS = 10;
+
+LLMessageReceiveThread::LLMessageReceiveThread(S32 socket, LLPacketRing& packet_ring,
+                                               LLTemplateMessageReader::message_template_number_map_t& templates) :
+    LLThread("Message receive"),
+    mSocket(socket),
+    mPacketRing(packet_ring),
+    mReader(templates),
+    mReadyPackets(MAX_PACKETS),
+    mFreePackets(MAX_PACKETS),
+    mPacketCount(0)
+{
+}
+
+LLMessageReceiveThread::~LLMessageReceiveThread()
+{
+    shutdown();
+
+    Packet* packetp = NULL;
+    while (mReadyPackets.tryPop(packetp))
+    {
+        delete packetp;
+    }
+    while (mFreePackets.tryPop(packetp))
+    {
+        delete packetp;
+    }
+}
+
+void LLMessageReceiveThread::shutdown()
+{
+    // Wake run() if it is waiting on either queue
+    mReadyPackets.close();
+    mFreePackets.close();
+    LLThread::shutdown();
+}
+
+LLMessageReceiveThread::Packet* LLMessageReceiveThread::popPacket()
+{
+    Packet* packetp = NULL;
+    return mReadyPackets.tryPop(packetp) ? packetp : NULL;
+}
+
+void LLMessageReceiveThread::releasePacket(Packet* packetp)
+{
+    if (!mFreePackets.tryPush(packetp))
+    {
+        // closed
+        delete packetp;
+    }
+}
+
+LLMessageReceiveThread::Packet* LLMessageReceiveThread::getFreePacket()
+{
+    Packet* packetp = NULL;
+    if (mFreePackets.tryPop(packetp))
+    {
+        return packetp;
+    }
+    if (mPacketCount < MAX_PACKETS)
+    {
+        ++mPacketCount;
+        return new Packet;
+    }
+
+    // Every packet is waiting on the main thread
+    while (!isQuitting())
+    {
+        if (mFreePackets.tryPopFor(std::chrono::milliseconds(WAIT_MS), packetp))
+        {
+            return packetp;
+        }
+        if (mFreePackets.isClosed())
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+void LLMessageReceiveThread::run()
+{
+    while (!isQuitting())
+    {
+        // Drain what the ring has, batched or throttled, then wait for more
+        Packet* packetp = getFreePacket();
+        if (!packetp)
+        {
+            break;
+        }
+
+        packetp->mSize = mPacketRing.receivePacket(mSocket, reinterpret_cast<char*>(packetp->mBuffer));
+        if (packetp->mSize <= 0)
+        {
+            releasePacket(packetp);
+            wait_for_packet(mSocket, WAIT_MS);
+            continue;
+        }
+
+        packetp->mSender = mPacketRing.getLastSender();
+        packetp->mReceivingIF = mPacketRing.getLastReceivingInterface();
+        preparePacket(*packetp);
+
+        if (!mReadyPackets.pushIfOpen(packetp))
+        {
+            delete packetp;
+            break;
+        }
+    }
+}
+
+// Mirrors the first steps of LLMessageSystem::checkMessages(). Anything
+// that does not check out is left for it to reject and report.
+void LLMessageReceiveThread::preparePacket(Packet& packet)
+{
+    packet.mExpandedSize = 0;
+    packet.mExpandedFrom = 0;
+    packet.mExpandOverflows = 0;
+    packet.mDecoded.mTemplate = NULL;
+
+    S32 size = packet.mSize;
+    if (size < (S32)LL_MINIMUM_VALID_PACKET_SIZE)
+    {
+        return;
+    }
+
+    // leave out appended acks
+    if (packet.mBuffer[0] & LL_ACK_FLAG)
+    {
+        S32 acks = packet.mBuffer[--size];
+        if (size < (S32)(acks * sizeof(TPACKETID) + LL_MINIMUM_VALID_PACKET_SIZE))
+        {
+            return;
+        }
+        size -= acks * sizeof(TPACKETID);
+    }
+
+    const U8* message = packet.mBuffer;
+    if (packet.mBuffer[0] & LL_ZERO_CODE_FLAG)
+    {
+        packet.mExpandedFrom = size;
+        packet.mExpandedSize = LLMessageSystem::zeroCodeExpandBuffer(packet.mBuffer, size,
+                                                                     packet.mExpanded,
+                                                                     packet.mExpandOverflows);
+        if (!packet.mExpandedSize)
+        {
+            return;
+        }
+        message = packet.mExpanded;
+        size = packet.mExpandedSize;
+    }
+
+    if (size < (S32)LL_MINIMUM_VALID_PACKET_SIZE)
+    {
+        return;
+    }
+
+    LLMessageTemplate* templatep = mReader.findTemplate(message, size);
+    if (templatep && !LLTemplateMessageReader::decodeMessage(message, size, templatep, packet.mDecoded))
+    {
+        packet.mDecoded.mTemplate = NULL;
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file llmessagereceivethread.h
+ * @brief Reads and prepares UDP packets off the main thread.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGERECEIVETHREAD_H
+#define LL_LLMESSAGERECEIVETHREAD_H
+
+#include "llhost.h"
+#include "llthread.h"
+#include "llthreadsafequeue.h"
+#include "lltemplatemessagereader.h"
+#include "net.h"
+
+class LLPacketRing;
+
+/**
+ * Reads packets off the message system socket and does the work
+ * LLMessageSystem::checkMessages() would otherwise do for each of them on
+ * the main thread: zero code expansion and laying the message out against
+ * its template. The main thread is left with the circuit bookkeeping and
+ * the handlers.
+ *
+ * Everything done here only reads the packet and the message templates.
+ * Acks, circuits and anything reported through callExceptionFunc() stay
+ * on the main thread.
+ */
+class LLMessageReceiveThread : public LLThread
+{
+public:
+    struct Packet
+    {
+        U8      mBuffer[NET_BUFFER_SIZE];   // as received, appended acks included
+        S32     mSize = 0;
+        LLHost  mSender;
+        LLHost  mReceivingIF;
+
+        // Zero code expansion of the message without its appended acks
+        U8      mExpanded[NET_BUFFER_SIZE];
+        S32     mExpandedSize = 0;          // 0 when not zero coded
+        S32     mExpandedFrom = 0;          // size of what was expanded
+        S32     mExpandOverflows = 0;       // times expansion ran out of room
+
+        // mDecoded.mTemplate is NULL when the message could not be decoded
+        LLTemplateMessageReader::DecodedMessage mDecoded;
+    };
+
+    LLMessageReceiveThread(S32 socket, LLPacketRing& packet_ring,
+                           LLTemplateMessageReader::message_template_number_map_t& templates);
+    ~LLMessageReceiveThread() override;
+
+    void shutdown() override;
+
+    // Main thread: the next packet received, or NULL. Hand it back with
+    // releasePacket() once done with it.
+    Packet* popPacket();
+    void releasePacket(Packet* packetp);
+
+private:
+    void run() override;
+    Packet* getFreePacket();
+    void preparePacket(Packet& packet);
+
+    S32 mSocket;
+    LLPacketRing& mPacketRing;      // only read from here while running
+    LLTemplateMessageReader mReader;
+    LLThreadSafeQueue<Packet*> mReadyPackets;
+    LLThreadSafeQueue<Packet*> mFreePackets;
+    S32 mPacketCount;               // allocated, only touched by run()
+};
+
+#endif // LL_LLMESSAGERECEIVETHREAD_H
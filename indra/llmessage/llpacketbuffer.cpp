@@ -59,6 +59,11 @@ LLPacketBuffer::LLPacketBuffer (S32 hSocket)
     init(hSocket);
 }
 
+LLPacketBuffer::LLPacketBuffer() : mSize(0)
+{
+    mData[0] = '!';
+}
+
 ///////////////////////////////////////////////////////////
 
 void LLPacketBuffer::init (S32 hSocket)
@@ -36,6 +36,7 @@ class LLPacketBuffer
 public:
     LLPacketBuffer(const LLHost &host, const char *datap, const S32 size);
     LLPacketBuffer(S32 hSocket);           // receive a packet
+    LLPacketBuffer();                      // empty slot for LLPacketRing's batches
     ~LLPacketBuffer() = default;
 
     S32         getSize() const                 { return mSize; }
@@ -45,6 +46,8 @@ class LLPacketBuffer
     void init(S32 hSocket);
 
 protected:
+    friend class LLPacketRing;          // fills batch slots in place
+
     char    mData[NET_BUFFER_SIZE];        // packet data       /* Flawfinder : ignore */
     S32     mSize;          // size of buffer in bytes
     LLHost  mHost;         // source/dest IP and port
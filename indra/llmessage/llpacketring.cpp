@@ -48,7 +48,7 @@
 LLPacketRing::LLPacketRing () :
     mUseInThrottle(FALSE),
     mUseOutThrottle(FALSE),
-    mInThrottle(256000.f),
+    mInThrottle(256000.f, true),    // also used by LLMessageReceiveThread
     mOutThrottle(64000.f),
     mActualBitsIn(0),
     mActualBitsOut(0),
@@ -56,7 +56,14 @@ LLPacketRing::LLPacketRing () :
     mInBufferLength(0),
     mOutBufferLength(0),
     mDropPercentage(0.0f),
-    mPacketsToDrop(0x0)
+    mPacketsToDrop(0x0),
+    mUseBatching(FALSE),
+    mReceiveSlotCount(0),
+    mNextReceiveSlot(0),
+    mSendSlotCount(0),
+    mSendBatchSocket(0),
+    mSendBatchFailures(0),
+    mBatchingSends(FALSE)
 {
 }
 
@@ -84,6 +91,10 @@ void LLPacketRing::cleanup ()
         delete packetp;
         mSendQueue.pop();
     }
+
+    mReceiveSlotCount = 0;
+    mNextReceiveSlot = 0;
+    mSendSlotCount = 0;
 }
 
 ///////////////////////////////////////////////////////////
@@ -117,6 +128,91 @@ void LLPacketRing::setOutBandwidth(const F32 bps)
 {
     mOutThrottle.setRate(bps);
 }
+
+void LLPacketRing::setUseBatching(const BOOL use_batching)
+{
+    if (use_batching && mReceiveSlots.empty())
+    {
+        mReceiveSlots.resize(NET_MAX_BATCH_PACKETS);
+        mReceiveDatagrams.resize(NET_MAX_BATCH_PACKETS);
+        for (S32 i = 0; i < NET_MAX_BATCH_PACKETS; ++i)
+        {
+            mReceiveDatagrams[i].mData = mReceiveSlots[i].mData;
+        }
+        mSendSlots.resize(NET_MAX_BATCH_PACKETS);
+    }
+    // Packets already read stay in their slots and are still handed out
+    mUseBatching = use_batching;
+}
+
+// The batch slots are NET_BUFFER_SIZE bytes, which leaves no room for the
+// header a SOCKS proxy wraps around the biggest packets, so those are read
+// one at a time like sends are.
+BOOL LLPacketRing::isBatchingReceives() const
+{
+    return mUseBatching && !LLProxy::isSOCKSProxyEnabled();
+}
+
+///////////////////////////////////////////////////////////
+LLPacketBuffer* LLPacketRing::nextReceivedPacket(S32 socket)
+{
+    if (mNextReceiveSlot >= mReceiveSlotCount)
+    {
+        if (!isBatchingReceives())
+        {
+            return NULL;
+        }
+
+        mNextReceiveSlot = 0;
+        mReceiveSlotCount = receive_packets(socket, &mReceiveDatagrams[0], NET_MAX_BATCH_PACKETS);
+        for (S32 i = 0; i < mReceiveSlotCount; ++i)
+        {
+            const LLNetDatagram& datagram = mReceiveDatagrams[i];
+            LLPacketBuffer& slot = mReceiveSlots[i];
+            slot.mSize = datagram.mSize;
+            slot.mHost = LLHost(datagram.mAddress, datagram.mPort);
+            slot.mReceivingIF = LLHost(datagram.mReceivingIF, INVALID_PORT);
+        }
+        if (!mReceiveSlotCount)
+        {
+            return NULL;
+        }
+    }
+    return &mReceiveSlots[mNextReceiveSlot++];
+}
+
+S32 LLPacketRing::receiveFromBatch(S32 socket, char *datap)
+{
+    LLPacketBuffer *packetp = nextReceivedPacket(socket);
+    if (!packetp)
+    {
+        return 0;
+    }
+
+    const char *data = packetp->getData();
+    S32 packet_size = packetp->getSize();
+    mLastSender = packetp->getHost();
+    mLastReceivingIF = packetp->getReceivingInterface();
+
+    if (LLProxy::isSOCKSProxyEnabled())
+    {
+        if (packet_size <= SOCKS_HEADER_SIZE)
+        {
+            return 0;
+        }
+
+        // *FIX We are assuming ATYP is 0x01 (IPv4), not 0x03 (hostname) or 0x04 (IPv6)
+        const proxywrap_t * header = static_cast<const proxywrap_t*>(static_cast<const void*>(data));
+        mLastSender.setAddress(header->addr);
+        mLastSender.setPort(ntohs(header->port));
+
+        data += SOCKS_HEADER_SIZE;
+        packet_size -= SOCKS_HEADER_SIZE; // The unwrapped packet size
+    }
+
+    memcpy(datap, data, packet_size); /*Flawfinder: ignore*/
+    return packet_size;
+}
 ///////////////////////////////////////////////////////////
 S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 {
@@ -168,7 +264,15 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
         while (!done)
         {
             LLPacketBuffer *packetp;
-            packetp = new LLPacketBuffer(socket);
+            if (isBatchingReceives() || mNextReceiveSlot < mReceiveSlotCount)
+            {
+                LLPacketBuffer *slotp = nextReceivedPacket(socket);
+                packetp = slotp ? new LLPacketBuffer(*slotp) : new LLPacketBuffer(LLHost(), NULL, 0);
+            }
+            else
+            {
+                packetp = new LLPacketBuffer(socket);
+            }
 
             if (packetp->getSize())
             {
@@ -225,7 +329,11 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
     else
     {
         // no delay, pull straight from net
-        if (LLProxy::isSOCKSProxyEnabled())
+        if (isBatchingReceives() || mNextReceiveSlot < mReceiveSlotCount)
+        {
+            packet_size = receiveFromBatch(socket, datap);
+        }
+        else if (LLProxy::isSOCKSProxyEnabled())
         {
             U8 buffer[NET_BUFFER_SIZE + SOCKS_HEADER_SIZE];
             packet_size = receive_packet(socket, static_cast<char*>(static_cast<void*>(buffer)));
@@ -244,15 +352,15 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
             {
                 packet_size = 0;
             }
+            mLastReceivingIF = ::get_receiving_interface();
         }
         else
         {
             packet_size = receive_packet(socket, datap);
             mLastSender = ::get_sender();
+            mLastReceivingIF = ::get_receiving_interface();
         }
 
-        mLastReceivingIF = ::get_receiving_interface();
-
         if (packet_size)  // did we actually get a packet?
         {
             if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
@@ -279,6 +387,23 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, co
     BOOL status = TRUE;
     if (!mUseOutThrottle)
     {
+        if (mBatchingSends && mUseBatching && buf_size <= NET_BUFFER_SIZE
+            && !LLProxy::isSOCKSProxyEnabled())
+        {
+            if (mSendSlotCount && (mSendSlotCount == NET_MAX_BATCH_PACKETS || h_socket != mSendBatchSocket))
+            {
+                flushSendBatch();
+            }
+            LLPacketBuffer& slot = mSendSlots[mSendSlotCount++];
+            memcpy(slot.mData, send_buffer, buf_size); /*Flawfinder: ignore*/
+            slot.mSize = buf_size;
+            slot.mHost = host;
+            mSendBatchSocket = h_socket;
+            // The outcome is only known once the batch is sent, see endSendBatch()
+            return TRUE;
+        }
+        // Keep packets in the order they were sent
+        flushSendBatch();
         return sendPacketImpl(h_socket, send_buffer, buf_size, host );
     }
     else
@@ -348,6 +473,44 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, co
     return status;
 }
 
+void LLPacketRing::beginSendBatch()
+{
+    mBatchingSends = TRUE;
+}
+
+S32 LLPacketRing::endSendBatch()
+{
+    flushSendBatch();
+    mBatchingSends = FALSE;
+
+    S32 failures = mSendBatchFailures;
+    mSendBatchFailures = 0;
+    return failures;
+}
+
+void LLPacketRing::flushSendBatch()
+{
+    if (!mSendSlotCount)
+    {
+        return;
+    }
+
+    LLNetDatagram datagrams[NET_MAX_BATCH_PACKETS];
+    for (S32 i = 0; i < mSendSlotCount; ++i)
+    {
+        LLPacketBuffer& slot = mSendSlots[i];
+        datagrams[i].mData = slot.mData;
+        datagrams[i].mSize = slot.mSize;
+        datagrams[i].mAddress = slot.mHost.getAddress();
+        datagrams[i].mPort = slot.mHost.getPort();
+        datagrams[i].mReceivingIF = INVALID_HOST_IP_ADDRESS;
+    }
+
+    S32 sent = send_packets(mSendBatchSocket, datagrams, mSendSlotCount);
+    mSendBatchFailures += mSendSlotCount - sent;
+    mSendSlotCount = 0;
+}
+
 BOOL LLPacketRing::sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, const LLHost& host)
 {
 
@@ -28,7 +28,9 @@
 #ifndef LL_LLPACKETRING_H
 #define LL_LLPACKETRING_H
 
+#include <atomic>
 #include <queue>
+#include <vector>
 
 #include "llhost.h"
 #include "llpacketbuffer.h"
@@ -55,10 +57,17 @@ class LLPacketRing
 
     BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, const LLHost& host);
 
+    // When batching, packets are read from the socket up to
+    // NET_MAX_BATCH_PACKETS at a time and handed out by receivePacket(), and
+    // sends between beginSendBatch() and endSendBatch() go out together.
+    void setUseBatching(const BOOL use_batching);
+    void beginSendBatch();
+    S32  endSendBatch();    // sends what is queued, returns the number of failed sends
+
     inline LLHost getLastSender();
     inline LLHost getLastReceivingInterface();
 
-    S32 getAndResetActualInBits()               { S32 bits = mActualBitsIn; mActualBitsIn = 0; return bits;}
+    S32 getAndResetActualInBits()               { return mActualBitsIn.exchange(0); }
     S32 getAndResetActualOutBits()              { S32 bits = mActualBitsOut; mActualBitsOut = 0; return bits;}
 protected:
     BOOL mUseInThrottle;
@@ -68,14 +77,16 @@ class LLPacketRing
     LLThrottle mInThrottle;
     LLThrottle mOutThrottle;
 
-    S32 mActualBitsIn;
+    // Receiving may run on LLMessageReceiveThread, so what the main
+    // thread also touches on that side is atomic
+    std::atomic<S32> mActualBitsIn;
     S32 mActualBitsOut;
     S32 mMaxBufferLength;           // How much data can we queue up before dropping data.
     S32 mInBufferLength;            // Current incoming buffer length
     S32 mOutBufferLength;           // Current outgoing buffer length
 
     F32 mDropPercentage;            // % of packets to drop
-    U32 mPacketsToDrop;             // drop next n packets
+    std::atomic<U32> mPacketsToDrop;    // drop next n packets
 
     std::queue<LLPacketBuffer *> mReceiveQueue;
     std::queue<LLPacketBuffer *> mSendQueue;
@@ -83,8 +94,27 @@ class LLPacketRing
     LLHost mLastSender;
     LLHost mLastReceivingIF;
 
+    BOOL mUseBatching;
+
+    // Preallocated slots for the last batch read from the socket
+    std::vector<LLPacketBuffer> mReceiveSlots;
+    std::vector<LLNetDatagram> mReceiveDatagrams;
+    S32 mReceiveSlotCount;          // slots filled by the last read
+    S32 mNextReceiveSlot;           // next slot receivePacket() hands out
+
+    // Sends queued since beginSendBatch()
+    std::vector<LLPacketBuffer> mSendSlots;
+    S32 mSendSlotCount;
+    S32 mSendBatchSocket;
+    S32 mSendBatchFailures;
+    BOOL mBatchingSends;
+
 private:
     BOOL sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, const LLHost& host);
+    BOOL isBatchingReceives() const;
+    LLPacketBuffer* nextReceivedPacket(S32 socket);
+    S32  receiveFromBatch(S32 socket, char *datap);
+    void flushSendBatch();
 };
 
 
@@ -41,7 +41,7 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
                                                  number_template_map) :
     mReceiveSize(0),
     mCurrentRMessageTemplate(nullptr),
-    mCurrentRMessageData(nullptr),
+    mMessageDecoded(false),
     mMessageNumbers(number_template_map)
 {
 }
@@ -49,8 +49,6 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 //virtual
 LLTemplateMessageReader::~LLTemplateMessageReader()
 {
-    delete mCurrentRMessageData;
-    mCurrentRMessageData = nullptr;
 }
 
 //virtual
@@ -58,11 +56,63 @@ void LLTemplateMessageReader::clearMessage()
 {
     mReceiveSize = -1;
     mCurrentRMessageTemplate = nullptr;
-    delete mCurrentRMessageData;
-    mCurrentRMessageData = nullptr;
+    // keep the buffers for the next message
+    mMessageDecoded = false;
+    mDecoded.mData.clear();
+    mDecoded.mVariables.clear();
+    mDecoded.mBlocks.clear();
+    mPredecoded.mTemplate = nullptr;
 }
 
-void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
+S32 LLTemplateMessageReader::findVariable(const LLMessageField& field, S32 blocknum,
+                                          const DecodedVariable*& variable) const
+{
+    const LLMessageTemplate::message_block_map_t& blocks = mCurrentRMessageTemplate->mMemberBlocks;
+
+    // The cached indices are only trusted if they still point at the same
+    // names, since a template can be freed and another allocated in its place.
+    bool cached = false;
+    if (field.mTemplate == mCurrentRMessageTemplate && field.mBlockIndex < (S32)blocks.size())
+    {
+        const LLMessageBlock* block = blocks.begin()[field.mBlockIndex];
+        cached = block->mName == field.mBlock
+            && field.mVariableIndex < (S32)block->mMemberVariables.size()
+            && block->mMemberVariables.begin()[field.mVariableIndex]->getName() == field.mVariable;
+    }
+
+    if (!cached)
+    {
+        LLMessageTemplate::message_block_map_t::const_iterator block_iter = blocks.find((char *)field.mBlock);
+        if (block_iter == blocks.end())
+        {
+            return LL_BLOCK_NOT_IN_MESSAGE;
+        }
+        const S32 block_index = (S32)(block_iter - blocks.begin());
+
+        const LLMessageBlock::message_variable_map_t& variables = (*block_iter)->mMemberVariables;
+        LLMessageBlock::message_variable_map_t::const_iterator variable_iter = variables.find(field.mVariable);
+        if (variable_iter == variables.end())
+        {
+            return blocknum < mDecoded.mBlocks[block_index].mCount ? LL_VARIABLE_NOT_IN_BLOCK : LL_BLOCK_NOT_IN_MESSAGE;
+        }
+
+        field.mTemplate = mCurrentRMessageTemplate;
+        field.mBlockIndex = block_index;
+        field.mVariableIndex = (S32)(variable_iter - variables.begin());
+    }
+
+    const DecodedBlock& block = mDecoded.mBlocks[field.mBlockIndex];
+    if (blocknum < 0 || blocknum >= block.mCount)
+    {
+        return LL_BLOCK_NOT_IN_MESSAGE;
+    }
+
+    variable = &mDecoded.mVariables[block.mFirstVariable + blocknum * block.mVariableCount + field.mVariableIndex];
+    return 0;
+}
+
+void LLTemplateMessageReader::getData(const LLMessageField& field, void *datap,
+                                      S32 size, S32 blocknum, S32 max_size)
 {
     // is there a message ready to go?
     if (mReceiveSize == -1)
@@ -71,48 +121,40 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
         return;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mMessageDecoded)
     {
-        LL_ERRS() << "Invalid mCurrentMessageData in getData!" << LL_ENDL;
+        LL_ERRS() << "Message not decoded in getData!" << LL_ENDL;
         return;
     }
 
-    char *bnamep = (char *)blockname + blocknum; // this works because it's just a hash.  The bnamep is never derefference
-    char *vnamep = (char *)varname;
-
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+    const DecodedVariable* variable = nullptr;
+    S32 result = findVariable(field, blocknum, variable);
+    if (result == LL_BLOCK_NOT_IN_MESSAGE)
     {
-        LL_ERRS() << "Block " << blockname << " #" << blocknum
-            << " not in message " << mCurrentRMessageData->mName << LL_ENDL;
+        LL_ERRS() << "Block " << field.mBlock << " #" << blocknum
+            << " not in message " << mCurrentRMessageTemplate->mName << LL_ENDL;
         return;
     }
-
-    LLMsgBlkData *msg_block_data = iter->second;
-    LLMsgBlkData::msg_var_data_map_t &var_data_map = msg_block_data->mMemberVarData;
-
-    if (var_data_map.find(vnamep) == var_data_map.end())
+    if (result == LL_VARIABLE_NOT_IN_BLOCK)
     {
-        LL_ERRS() << "Variable "<< vnamep << " not in message "
-            << mCurrentRMessageData->mName<< " block " << bnamep << LL_ENDL;
+        LL_ERRS() << "Variable "<< field.mVariable << " not in message "
+            << mCurrentRMessageTemplate->mName << " block " << field.mBlock << LL_ENDL;
         return;
     }
 
-    LLMsgVarData& vardata = msg_block_data->mMemberVarData[vnamep];
+    const S32 vardata_size = variable->mSize;
+    const U8* vardata = mDecoded.mData.data() + variable->mOffset;
 
-    if (size && size != vardata.getSize())
+    if (size && size != vardata_size)
     {
-        LL_ERRS() << "Msg " << mCurrentRMessageData->mName
-            << " variable " << vnamep
-            << " is size " << vardata.getSize()
+        LL_ERRS() << "Msg " << mCurrentRMessageTemplate->mName
+            << " variable " << field.mVariable
+            << " is size " << vardata_size
             << " but copying into buffer of size " << size
             << LL_ENDL;
         return;
     }
 
-
-    const S32 vardata_size = vardata.getSize();
     if( max_size >= vardata_size )
     {
         switch( vardata_size )
@@ -121,32 +163,31 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
             // This is here to prevent a memcpy from a null value which is undefined behavior.
             break;
         case 1:
-            *((U8*)datap) = *((U8*)vardata.getData());
+            *((U8*)datap) = *vardata;
             break;
         case 2:
-            *((U16*)datap) = *((U16*)vardata.getData());
+            memcpy(datap, vardata, 2);
             break;
         case 4:
-            *((U32*)datap) = *((U32*)vardata.getData());
+            memcpy(datap, vardata, 4);
             break;
         case 8:
-            ((U32*)datap)[0] = ((U32*)vardata.getData())[0];
-            ((U32*)datap)[1] = ((U32*)vardata.getData())[1];
+            memcpy(datap, vardata, 8);
             break;
         default:
-            memcpy(datap, vardata.getData(), vardata_size);
+            memcpy(datap, vardata, vardata_size);
             break;
         }
     }
     else
     {
-        LL_WARNS() << "Msg " << mCurrentRMessageData->mName
-            << " variable " << vnamep
-            << " is size " << vardata.getSize()
+        LL_WARNS() << "Msg " << mCurrentRMessageTemplate->mName
+            << " variable " << field.mVariable
+            << " is size " << vardata_size
             << " but truncated to max size of " << max_size
             << LL_ENDL;
 
-        memcpy(datap, vardata.getData(), max_size);
+        memcpy(datap, vardata, max_size);
     }
 }
 
@@ -159,22 +200,20 @@ S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
         return -1;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mMessageDecoded)
     {
-        LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+        LL_ERRS() << "Message not decoded in getNumberOfBlocks!" << LL_ENDL;
         return -1;
     }
 
-    char *bnamep = (char *)blockname;
-
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+    const LLMessageTemplate::message_block_map_t& blocks = mCurrentRMessageTemplate->mMemberBlocks;
+    LLMessageTemplate::message_block_map_t::const_iterator iter = blocks.find((char *)blockname);
+    if (iter == blocks.end())
     {
         return 0;
     }
 
-    return (iter->second)->mBlockNumber;
+    return mDecoded.mBlocks[iter - blocks.begin()].mCount;
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
@@ -186,46 +225,44 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
         return LL_MESSAGE_ERROR;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mMessageDecoded)
     {   // This is a serious error - crash
-        LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+        LL_ERRS() << "Message not decoded in getSize!" << LL_ENDL;
         return LL_MESSAGE_ERROR;
     }
 
-    char *bnamep = (char *)blockname;
-
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+    const LLMessageField field(blockname, varname);
+    const DecodedVariable* variable = nullptr;
+    S32 result = findVariable(field, 0, variable);
+    if (result == LL_BLOCK_NOT_IN_MESSAGE)
     {   // don't crash
-        LL_INFOS() << "Block " << bnamep << " not in message "
-            << mCurrentRMessageData->mName << LL_ENDL;
+        LL_INFOS() << "Block " << blockname << " not in message "
+            << mCurrentRMessageTemplate->mName << LL_ENDL;
         return LL_BLOCK_NOT_IN_MESSAGE;
     }
-
-    char *vnamep = (char *)varname;
-
-    LLMsgBlkData* msg_data = iter->second;
-    LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-
-    if (!vardata.getName())
+    if (result == LL_VARIABLE_NOT_IN_BLOCK)
     {   // don't crash
         LL_INFOS() << "Variable " << varname << " not in message "
-            << mCurrentRMessageData->mName << " block " << bnamep << LL_ENDL;
+            << mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
         return LL_VARIABLE_NOT_IN_BLOCK;
     }
 
-    if (mCurrentRMessageTemplate->mMemberBlocks[bnamep]->mType != MBT_SINGLE)
+    if (mCurrentRMessageTemplate->mMemberBlocks.begin()[field.mBlockIndex]->mType != MBT_SINGLE)
     {   // This is a serious error - crash
-        LL_ERRS() << "Block " << bnamep << " isn't type MBT_SINGLE,"
+        LL_ERRS() << "Block " << blockname << " isn't type MBT_SINGLE,"
             " use getSize with blocknum argument!" << LL_ENDL;
         return LL_MESSAGE_ERROR;
     }
 
-    return vardata.getSize();
+    return variable->mSize;
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const char *varname)
+{
+    return getSize(LLMessageField(blockname, varname), blocknum);
+}
+
+S32 LLTemplateMessageReader::getSize(const LLMessageField& field, S32 blocknum)
 {
     // is there a message ready to go?
     if (mReceiveSize == -1)
@@ -234,35 +271,28 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
         return LL_MESSAGE_ERROR;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mMessageDecoded)
     {   // This is a serious error - crash
-        LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+        LL_ERRS() << "Message not decoded in getSize!" << LL_ENDL;
         return LL_MESSAGE_ERROR;
     }
 
-    char *bnamep = (char *)blockname + blocknum;
-    char *vnamep = (char *)varname;
-
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+    const DecodedVariable* variable = nullptr;
+    S32 result = findVariable(field, blocknum, variable);
+    if (result == LL_BLOCK_NOT_IN_MESSAGE)
     {   // don't crash
-        LL_INFOS() << "Block " << bnamep << " not in message "
-            << mCurrentRMessageData->mName << LL_ENDL;
+        LL_INFOS() << "Block " << field.mBlock << " #" << blocknum << " not in message "
+            << mCurrentRMessageTemplate->mName << LL_ENDL;
         return LL_BLOCK_NOT_IN_MESSAGE;
     }
-
-    LLMsgBlkData* msg_data = iter->second;
-    LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-
-    if (!vardata.getName())
+    if (result == LL_VARIABLE_NOT_IN_BLOCK)
     {   // don't crash
-        LL_INFOS() << "Variable " << vnamep << " not in message "
-            <<  mCurrentRMessageData->mName << " block " << bnamep << LL_ENDL;
+        LL_INFOS() << "Variable " << field.mVariable << " not in message "
+            << mCurrentRMessageTemplate->mName << " block " << field.mBlock << LL_ENDL;
         return LL_VARIABLE_NOT_IN_BLOCK;
     }
 
-    return vardata.getSize();
+    return variable->mSize;
 }
 
 void LLTemplateMessageReader::getBinaryData(const char *blockname,
@@ -270,67 +300,118 @@ void LLTemplateMessageReader::getBinaryData(const char *blockname,
                                             S32 size, S32 blocknum,
                                             S32 max_size)
 {
-    getData(blockname, varname, datap, size, blocknum, max_size);
+    getData(LLMessageField(blockname, varname), datap, size, blocknum, max_size);
+}
+
+void LLTemplateMessageReader::getBinaryData(const LLMessageField& field, void *datap,
+                                            S32 size, S32 blocknum, S32 max_size)
+{
+    getData(field, datap, size, blocknum, max_size);
 }
 
 void LLTemplateMessageReader::getS8(const char *block, const char *var,
                                         S8 &u, S32 blocknum)
 {
-    getData(block, var, &u, sizeof(S8), blocknum);
+    getS8(LLMessageField(block, var), u, blocknum);
+}
+
+void LLTemplateMessageReader::getS8(const LLMessageField& field, S8 &u, S32 blocknum)
+{
+    getData(field, &u, sizeof(S8), blocknum);
 }
 
 void LLTemplateMessageReader::getU8(const char *block, const char *var,
                                         U8 &u, S32 blocknum)
 {
-    getData(block, var, &u, sizeof(U8), blocknum);
+    getU8(LLMessageField(block, var), u, blocknum);
+}
+
+void LLTemplateMessageReader::getU8(const LLMessageField& field, U8 &u, S32 blocknum)
+{
+    getData(field, &u, sizeof(U8), blocknum);
 }
 
 void LLTemplateMessageReader::getBOOL(const char *block, const char *var,
                                           BOOL &b, S32 blocknum )
+{
+    getBOOL(LLMessageField(block, var), b, blocknum);
+}
+
+void LLTemplateMessageReader::getBOOL(const LLMessageField& field, BOOL &b, S32 blocknum)
 {
     U8 value(0);
-    getData(block, var, &value, sizeof(U8), blocknum);
+    getData(field, &value, sizeof(U8), blocknum);
     b = (BOOL) value;
 }
 
 void LLTemplateMessageReader::getS16(const char *block, const char *var,
                                          S16 &d, S32 blocknum)
 {
-    getData(block, var, &d, sizeof(S16), blocknum);
+    getS16(LLMessageField(block, var), d, blocknum);
+}
+
+void LLTemplateMessageReader::getS16(const LLMessageField& field, S16 &d, S32 blocknum)
+{
+    getData(field, &d, sizeof(S16), blocknum);
 }
 
 void LLTemplateMessageReader::getU16(const char *block, const char *var,
                                          U16 &d, S32 blocknum)
 {
-    getData(block, var, &d, sizeof(U16), blocknum);
+    getU16(LLMessageField(block, var), d, blocknum);
+}
+
+void LLTemplateMessageReader::getU16(const LLMessageField& field, U16 &d, S32 blocknum)
+{
+    getData(field, &d, sizeof(U16), blocknum);
 }
 
 void LLTemplateMessageReader::getS32(const char *block, const char *var,
                                          S32 &d, S32 blocknum)
 {
-    getData(block, var, &d, sizeof(S32), blocknum);
+    getS32(LLMessageField(block, var), d, blocknum);
+}
+
+void LLTemplateMessageReader::getS32(const LLMessageField& field, S32 &d, S32 blocknum)
+{
+    getData(field, &d, sizeof(S32), blocknum);
 }
 
 void LLTemplateMessageReader::getU32(const char *block, const char *var,
                                      U32 &d, S32 blocknum)
 {
-    getData(block, var, &d, sizeof(U32), blocknum);
+    getU32(LLMessageField(block, var), d, blocknum);
+}
+
+void LLTemplateMessageReader::getU32(const LLMessageField& field, U32 &d, S32 blocknum)
+{
+    getData(field, &d, sizeof(U32), blocknum);
 }
 
 void LLTemplateMessageReader::getU64(const char *block, const char *var,
                                      U64 &d, S32 blocknum)
 {
-    getData(block, var, &d, sizeof(U64), blocknum);
+    getU64(LLMessageField(block, var), d, blocknum);
+}
+
+void LLTemplateMessageReader::getU64(const LLMessageField& field, U64 &d, S32 blocknum)
+{
+    getData(field, &d, sizeof(U64), blocknum);
 }
 
 void LLTemplateMessageReader::getF32(const char *block, const char *var,
                                      F32 &d, S32 blocknum)
 {
-    getData(block, var, &d, sizeof(F32), blocknum);
+    getF32(LLMessageField(block, var), d, blocknum);
+}
+
+void LLTemplateMessageReader::getF32(const LLMessageField& field, F32 &d, S32 blocknum)
+{
+    getData(field, &d, sizeof(F32), blocknum);
 
     if( !llfinite( d ) )
     {
-        LL_WARNS() << "non-finite in getF32Fast " << block << " " << var
+        LL_WARNS() << "non-finite in getF32Fast " << field.getBlock() << " " << field.getVariable()
                 << LL_ENDL;
         d = 0;
     }
@@ -339,11 +420,16 @@ void LLTemplateMessageReader::getF32(const char *block, const char *var,
 void LLTemplateMessageReader::getF64(const char *block, const char *var,
                                      F64 &d, S32 blocknum)
 {
-    getData(block, var, &d, sizeof(F64), blocknum);
+    getF64(LLMessageField(block, var), d, blocknum);
+}
+
+void LLTemplateMessageReader::getF64(const LLMessageField& field, F64 &d, S32 blocknum)
+{
+    getData(field, &d, sizeof(F64), blocknum);
 
     if( !llfinite( d ) )
     {
-        LL_WARNS() << "non-finite in getF64Fast " << block << " " << var
+        LL_WARNS() << "non-finite in getF64Fast " << field.getBlock() << " " << field.getVariable()
                 << LL_ENDL;
         d = 0;
     }
@@ -352,12 +438,17 @@ void LLTemplateMessageReader::getF64(const char *block, const char *var,
 void LLTemplateMessageReader::getVector3(const char *block, const char *var,
                                          LLVector3 &v, S32 blocknum )
 {
-    getData(block, var, &v.mV[0], sizeof(v.mV), blocknum);
+    getVector3(LLMessageField(block, var), v, blocknum);
+}
+
+void LLTemplateMessageReader::getVector3(const LLMessageField& field, LLVector3 &v, S32 blocknum)
+{
+    getData(field, &v.mV[0], sizeof(v.mV), blocknum);
 
     if( !v.isFinite() )
     {
-        LL_WARNS() << "non-finite in getVector3Fast " << block << " "
-                << var << LL_ENDL;
+        LL_WARNS() << "non-finite in getVector3Fast " << field.getBlock() << " "
+                << field.getVariable() << LL_ENDL;
         v.zeroVec();
     }
 }
@@ -365,12 +456,17 @@ void LLTemplateMessageReader::getVector3(const char *block, const char *var,
 void LLTemplateMessageReader::getVector4(const char *block, const char *var,
                                          LLVector4 &v, S32 blocknum)
 {
-    getData(block, var, &v.mV[0], sizeof(v.mV), blocknum);
+    getVector4(LLMessageField(block, var), v, blocknum);
+}
+
+void LLTemplateMessageReader::getVector4(const LLMessageField& field, LLVector4 &v, S32 blocknum)
+{
+    getData(field, &v.mV[0], sizeof(v.mV), blocknum);
 
     if( !v.isFinite() )
     {
-        LL_WARNS() << "non-finite in getVector4Fast " << block << " "
-                << var << LL_ENDL;
+        LL_WARNS() << "non-finite in getVector4Fast " << field.getBlock() << " "
+                << field.getVariable() << LL_ENDL;
         v.zeroVec();
     }
 }
@@ -378,29 +474,38 @@ void LLTemplateMessageReader::getVector4(const char *block, const char *var,
 void LLTemplateMessageReader::getVector3d(const char *block, const char *var,
                                           LLVector3d &v, S32 blocknum )
 {
-    getData(block, var, &v.mdV[0], sizeof(v.mdV), blocknum);
+    getVector3d(LLMessageField(block, var), v, blocknum);
+}
+
+void LLTemplateMessageReader::getVector3d(const LLMessageField& field, LLVector3d &v, S32 blocknum)
+{
+    getData(field, &v.mdV[0], sizeof(v.mdV), blocknum);
 
     if( !v.isFinite() )
     {
-        LL_WARNS() << "non-finite in getVector3dFast " << block << " "
-                << var << LL_ENDL;
+        LL_WARNS() << "non-finite in getVector3dFast " << field.getBlock() << " "
+                << field.getVariable() << LL_ENDL;
         v.zeroVec();
     }
-
 }
 
 void LLTemplateMessageReader::getQuat(const char *block, const char *var,
                                       LLQuaternion &q, S32 blocknum)
+{
+    getQuat(LLMessageField(block, var), q, blocknum);
+}
+
+void LLTemplateMessageReader::getQuat(const LLMessageField& field, LLQuaternion &q, S32 blocknum)
 {
     LLVector3 vec;
-    getData(block, var, &vec.mV[0], sizeof(vec.mV), blocknum);
+    getData(field, &vec.mV[0], sizeof(vec.mV), blocknum);
     if( vec.isFinite() )
     {
         q.unpackFromVector3( vec );
     }
     else
     {
-        LL_WARNS() << "non-finite in getQuatFast " << block << " " << var
+        LL_WARNS() << "non-finite in getQuatFast " << field.getBlock() << " " << field.getVariable()
                 << LL_ENDL;
         q.loadIdentity();
     }
@@ -409,31 +514,56 @@ void LLTemplateMessageReader::getQuat(const char *block, const char *var,
 void LLTemplateMessageReader::getUUID(const char *block, const char *var,
                                       LLUUID &u, S32 blocknum)
 {
-    getData(block, var, &u.mData[0], sizeof(u.mData), blocknum);
+    getUUID(LLMessageField(block, var), u, blocknum);
+}
+
+void LLTemplateMessageReader::getUUID(const LLMessageField& field, LLUUID &u, S32 blocknum)
+{
+    getData(field, &u.mData[0], sizeof(u.mData), blocknum);
+}
+
+void LLTemplateMessageReader::getIPAddr(const char *block, const char *var, U32 &u, S32 blocknum)
+{
+    getIPAddr(LLMessageField(block, var), u, blocknum);
+}
+
+void LLTemplateMessageReader::getIPAddr(const LLMessageField& field, U32 &u, S32 blocknum)
+{
+    getData(field, &u, sizeof(U32), blocknum);
 }
 
-inline void LLTemplateMessageReader::getIPAddr(const char *block, const char *var, U32 &u, S32 blocknum)
+void LLTemplateMessageReader::getIPPort(const char *block, const char *var, U16 &u, S32 blocknum)
 {
-    getData(block, var, &u, sizeof(U32), blocknum);
+    getIPPort(LLMessageField(block, var), u, blocknum);
 }
 
-inline void LLTemplateMessageReader::getIPPort(const char *block, const char *var, U16 &u, S32 blocknum)
+void LLTemplateMessageReader::getIPPort(const LLMessageField& field, U16 &u, S32 blocknum)
 {
-    getData(block, var, &u, sizeof(U16), blocknum);
+    getData(field, &u, sizeof(U16), blocknum);
     u = ntohs(u);
 }
 
-inline void LLTemplateMessageReader::getString(const char *block, const char *var, S32 buffer_size, char *s, S32 blocknum )
+void LLTemplateMessageReader::getString(const char *block, const char *var, S32 buffer_size, char *s, S32 blocknum )
+{
+    getString(LLMessageField(block, var), buffer_size, s, blocknum);
+}
+
+void LLTemplateMessageReader::getString(const LLMessageField& field, S32 buffer_size, char *s, S32 blocknum)
 {
     s[0] = '\0';
-    getData(block, var, s, 0, blocknum, buffer_size);
+    getData(field, s, 0, blocknum, buffer_size);
     s[buffer_size - 1] = '\0';
 }
 
-inline void LLTemplateMessageReader::getString(const char *block, const char *var, std::string& outstr, S32 blocknum )
+void LLTemplateMessageReader::getString(const char *block, const char *var, std::string& outstr, S32 blocknum )
+{
+    getString(LLMessageField(block, var), outstr, blocknum);
+}
+
+void LLTemplateMessageReader::getString(const LLMessageField& field, std::string& outstr, S32 blocknum)
 {
     char s[MTUBYTES + 1]= {0}; // every element is initialized with 0
-    getData(block, var, s, 0, blocknum, MTUBYTES);
+    getData(field, s, 0, blocknum, MTUBYTES);
     s[MTUBYTES] = '\0';
     outstr = s;
 }
@@ -444,22 +574,17 @@ S32 LLTemplateMessageReader::getMessageSize() const
     return mReceiveSize;
 }
 
-// Returns template for the message contained in buffer
-BOOL LLTemplateMessageReader::decodeTemplate(
-        const U8* buffer, S32 buffer_size,  // inputs
-        LLMessageTemplate** msg_template, bool custom ) // outputs
+// Reads the message number from the header of buffer
+//static
+bool LLTemplateMessageReader::getMessageNumber(const U8* buffer, S32 buffer_size, U32& num)
 {
     const U8* header = buffer + LL_PACKET_ID_SIZE;
 
-    // is there a message ready to go?
     if (buffer_size <= 0)
     {
-        LL_WARNS() << "No message waiting for decode!" << LL_ENDL;
-        return(FALSE);
+        return false;
     }
 
-    U32 num = 0;
-
     if (header[0] != 255)
     {
         // high frequency message
@@ -488,6 +613,36 @@ BOOL LLTemplateMessageReader::decodeTemplate(
         num = 0xFFFF0000 | message_id_U16;
     }
     else // bogus packet received (too short)
+    {
+        return false;
+    }
+    return true;
+}
+
+LLMessageTemplate* LLTemplateMessageReader::findTemplate(const U8* buffer, S32 buffer_size) const
+{
+    U32 num = 0;
+    if (!getMessageNumber(buffer, buffer_size, num))
+    {
+        return nullptr;
+    }
+    return get_ptr_in_map(mMessageNumbers, num);
+}
+
+// Returns template for the message contained in buffer
+BOOL LLTemplateMessageReader::decodeTemplate(
+        const U8* buffer, S32 buffer_size,  // inputs
+        LLMessageTemplate** msg_template, bool custom ) // outputs
+{
+    // is there a message ready to go?
+    if (buffer_size <= 0)
+    {
+        LL_WARNS() << "No message waiting for decode!" << LL_ENDL;
+        return(FALSE);
+    }
+
+    U32 num = 0;
+    if (!getMessageNumber(buffer, buffer_size, num))
     {
         if (!custom)
         LL_WARNS() << "Packet with unusable length received (too short): "
@@ -532,28 +687,36 @@ void LLTemplateMessageReader::logRanOffEndOfPacket( const LLHost& host, const S3
     gMessageSystem->callExceptionFunc(MX_RAN_OFF_END_OF_PACKET);
 }
 
-// decode a given message
-BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender, bool custom )
+// Lays out the variables of a message. This only reads the template, which
+// does not change once loaded, so it is safe to call from any thread.
+//static
+bool LLTemplateMessageReader::decodeMessage(const U8* buffer, S32 buffer_size,
+                                            LLMessageTemplate* templatep,
+                                            DecodedMessage& decoded)
 {
-    LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
-
-    llassert( mReceiveSize >= 0 );
-    llassert( mCurrentRMessageTemplate);
-    llassert( !mCurrentRMessageData );
-    delete mCurrentRMessageData; // just to make sure
+    decoded.mTemplate = templatep;
+    decoded.mReceiveSize = buffer_size;
+    decoded.mBlockCount = 0;
+    decoded.mRanOffEnd.clear();
 
     // The offset tells us how may bytes to skip after the end of the
     // message name.
     U8 offset = buffer[PHL_OFFSET];
-    S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
+    S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(templatep->mFrequency) + offset;
 
-    // create base working data set
-    mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
+    // Variables are read in place from a copy of the message, so decoding
+    // only records where each one is instead of allocating a copy of it.
+    // Message data is little endian, like every host we build for, so the
+    // bytes need no swapping.
+    decoded.mData.assign(buffer, buffer + buffer_size);
+    decoded.mVariables.clear();
+    decoded.mBlocks.clear();
+    decoded.mBlocks.reserve(templatep->mMemberBlocks.size());
 
     // loop through the template building the data structure as we go
     LLMessageTemplate::message_block_map_t::const_iterator iter;
-    for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
-        iter != mCurrentRMessageTemplate->mMemberBlocks.end();
+    for(iter = templatep->mMemberBlocks.begin();
+        iter != templatep->mMemberBlocks.end();
         ++iter)
     {
         LLMessageBlock* mbci = *iter;
@@ -576,7 +739,7 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
         {
             // need to read the number from the message
             // repeat number is a single byte
-            if (decode_pos >= mReceiveSize)
+            if (decode_pos >= buffer_size)
             {
                 // commented out - hetgrid says that missing variable blocks
                 // at end of message are legal
@@ -593,41 +756,27 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
         }
         else
         {
-            if (!custom)
-            LL_ERRS() << "Unknown block type" << LL_ENDL;
-            return FALSE;
+            // Unknown block type, see decodeData()
+            return false;
         }
 
-        LLMsgBlkData* cur_data_block = nullptr;
+        DecodedBlock block;
+        block.mFirstVariable = (S32)decoded.mVariables.size();
+        block.mVariableCount = (S32)mbci->mMemberVariables.size();
+        block.mCount = repeat_number;
+        decoded.mBlocks.push_back(block);
+        decoded.mBlockCount += repeat_number;
 
         // now loop through the block
         for (i = 0; i < repeat_number; i++)
         {
-            if (i)
-            {
-                // build new name to prevent collisions
-                // TODO: This should really change to a vector
-                cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-                cur_data_block->mName = mbci->mName + i;
-            }
-            else
-            {
-                cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-            }
-
-            // add the block to the message
-            mCurrentRMessageData->addBlock(cur_data_block);
-
             // now read the variables
             for (LLMessageBlock::message_variable_map_t::const_iterator iter =
                      mbci->mMemberVariables.begin();
                  iter != mbci->mMemberVariables.end(); iter++)
             {
                 const LLMessageVariable& mvci = **iter;
-
-                // ok, build out the variables
-                // add variable block
-                cur_data_block->addVariable(mvci.getName(), mvci.getType());
+                DecodedVariable variable;
 
                 // what type of variable?
                 if (mvci.getType() == MVT_VARIABLE)
@@ -638,10 +787,9 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
                     U16 tsizeh = 0;
                     U32 tsize = 0;
 
-                    if ((decode_pos + data_size) > mReceiveSize)
+                    if ((decode_pos + data_size) > buffer_size)
                     {
-                        if (!custom)
-                        logRanOffEndOfPacket(sender, decode_pos, data_size);
+                        decoded.mRanOffEnd.emplace_back(decode_pos, data_size);
 
                         // default to 0 length variable blocks
                         tsize = 0;
@@ -668,38 +816,71 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
                     }
                     decode_pos += data_size;
 
-                    cur_data_block->addData(mvci.getName(), &buffer[decode_pos], tsize, mvci.getType());
+                    variable.mOffset = decode_pos;
+                    variable.mSize = tsize;
                     decode_pos += tsize;
                 }
                 else
                 {
                     // fixed!
-                    // so, copy data pointer and set data size to fixed size
-                    if ((decode_pos + mvci.getSize()) > mReceiveSize)
+                    variable.mOffset = decode_pos;
+                    variable.mSize = mvci.getSize();
+                    decode_pos += mvci.getSize();
+                }
+
+                if (variable.mOffset + variable.mSize > buffer_size)
+                {
+                    // fixed size variables past the end default to 0s, and
+                    // a variable length one running off the end is padded
+                    if (mvci.getType() != MVT_VARIABLE)
                     {
-                        if (!custom)
-                        logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
-
-                        // default to 0s.
-                        U32 size = mvci.getSize();
-                        std::vector<U8> data(size, 0);
-                        cur_data_block->addData(mvci.getName(), &(data[0]),
-                                                size, mvci.getType());
+                        decoded.mRanOffEnd.emplace_back(variable.mOffset, variable.mSize);
+                        variable.mOffset = (S32)decoded.mData.size();
                     }
-                    else
+                    else if (variable.mOffset > (S32)decoded.mData.size())
                     {
-                        cur_data_block->addData(mvci.getName(),
-                                                &buffer[decode_pos],
-                                                mvci.getSize(),
-                                                mvci.getType());
+                        variable.mOffset = (S32)decoded.mData.size();
                     }
-                    decode_pos += mvci.getSize();
+                    decoded.mData.resize(llmax((S32)decoded.mData.size(), variable.mOffset + variable.mSize), 0);
                 }
+                decoded.mVariables.push_back(variable);
             }
         }
     }
+    return true;
+}
 
-    if (mCurrentRMessageData->mMemberBlocks.empty()
+// decode a given message
+BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender, bool custom )
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
+
+    llassert( mReceiveSize >= 0 );
+    llassert( mCurrentRMessageTemplate);
+
+    if (!decodeMessage(buffer, mReceiveSize, mCurrentRMessageTemplate, mDecoded))
+    {
+        if (!custom)
+        LL_ERRS() << "Unknown block type" << LL_ENDL;
+        return FALSE;
+    }
+    return dispatchMessage(sender, custom);
+}
+
+// Reports problems found decoding mDecoded and calls the message handler
+BOOL LLTemplateMessageReader::dispatchMessage(const LLHost& sender, bool custom)
+{
+    mMessageDecoded = true;
+
+    if (!custom)
+    {
+        for (const std::pair<S32, S32>& ran_off_end : mDecoded.mRanOffEnd)
+        {
+            logRanOffEndOfPacket(sender, ran_off_end.first, ran_off_end.second);
+        }
+    }
+
+    if (mDecoded.mBlockCount == 0
         && !mCurrentRMessageTemplate->mMemberBlocks.empty())
     {
         LL_DEBUGS() << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << LL_ENDL;
@@ -796,9 +977,21 @@ BOOL LLTemplateMessageReader::validateMessage(const U8* buffer,
 BOOL LLTemplateMessageReader::readMessage(const U8* buffer,
                                           const LLHost& sender)
 {
+    if (mPredecoded.mTemplate && mPredecoded.mTemplate == mCurrentRMessageTemplate
+        && mPredecoded.mReceiveSize == mReceiveSize)
+    {
+        std::swap(mDecoded, mPredecoded);
+        mPredecoded.mTemplate = nullptr;
+        return dispatchMessage(sender, false);
+    }
     return decodeData(buffer, sender);
 }
 
+void LLTemplateMessageReader::setPredecoded(DecodedMessage& decoded)
+{
+    std::swap(mPredecoded, decoded);
+}
+
 //virtual
 const char* LLTemplateMessageReader::getMessageName() const
 {
@@ -829,11 +1022,36 @@ bool LLTemplateMessageReader::isUdpBanned() const
 //virtual
 void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
 {
-    if(nullptr == mCurrentRMessageTemplate)
+    if(nullptr == mCurrentRMessageTemplate || !mMessageDecoded)
     {
         return;
     }
-    builder.copyFromMessageData(*mCurrentRMessageData);
+
+    // Only forwarded messages are copied, so build the LLMsgData the
+    // builders take here rather than for every message decoded.
+    LLMsgData message_data(mCurrentRMessageTemplate->mName);
+    S32 block_index = 0;
+    for (const LLMessageBlock* mbci : mCurrentRMessageTemplate->mMemberBlocks)
+    {
+        const DecodedBlock& block = mDecoded.mBlocks[block_index++];
+        const DecodedVariable* variable = &mDecoded.mVariables[block.mFirstVariable];
+        for (S32 i = 0; i < block.mCount; i++)
+        {
+            // repeated blocks are keyed by offset names, see LLMsgData
+            LLMsgBlkData* block_data = new LLMsgBlkData(mbci->mName, block.mCount);
+            block_data->mName = mbci->mName + i;
+            message_data.addBlock(block_data);
+
+            for (const LLMessageVariable* mvci : mbci->mMemberVariables)
+            {
+                block_data->addVariable(mvci->getName(), mvci->getType());
+                block_data->addData(mvci->getName(), mDecoded.mData.data() + variable->mOffset,
+                                    variable->mSize, mvci->getType());
+                ++variable;
+            }
+        }
+    }
+    builder.copyFromMessageData(message_data);
 }
 
 LLMessageTemplate* LLTemplateMessageReader::getTemplate()
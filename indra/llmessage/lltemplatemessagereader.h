@@ -27,17 +27,58 @@
 #ifndef LL_LLTEMPLATEMESSAGEREADER_H
 #define LL_LLTEMPLATEMESSAGEREADER_H
 
+#include "llmessagefield.h"
 #include "llmessagereader.h"
 
+#include <utility>
+#include <vector>
+
 class LLMessageTemplate;
-class LLMsgData;
 
 class LLTemplateMessageReader : public LLMessageReader
 {
+private:
+
+    // Where a variable of one block instance is in mData
+    struct DecodedVariable
+    {
+        S32 mOffset;
+        S32 mSize;
+    };
+
+    // The instances of a template block. Their variables are consecutive
+    // in mVariables, in template order, starting at mFirstVariable.
+    struct DecodedBlock
+    {
+        S32 mFirstVariable;
+        S32 mVariableCount;
+        S32 mCount;
+    };
+
 public:
 
     typedef boost::unordered_flat_map<U32, LLMessageTemplate*> message_template_number_map_t;
 
+    /**
+     * A message laid out against its template. decodeMessage() fills one
+     * without a reader, so a message can be decoded on another thread and
+     * passed to readMessage() later.
+     */
+    struct DecodedMessage
+    {
+        LLMessageTemplate*              mTemplate = nullptr;
+        S32                             mReceiveSize = 0;
+        S32                             mBlockCount = 0;    // block instances in the message
+        // A copy of the message, followed by zeros for any variables that
+        // were missing from the end of it
+        std::vector<U8>                 mData;
+        std::vector<DecodedVariable>    mVariables;
+        // One per block of mTemplate
+        std::vector<DecodedBlock>       mBlocks;
+        // Position and size of each read past the end, reported when read
+        std::vector<std::pair<S32, S32> > mRanOffEnd;
+    };
+
     LLTemplateMessageReader(message_template_number_map_t&);
     ~LLTemplateMessageReader() override;
 
@@ -84,10 +125,35 @@ class LLTemplateMessageReader : public LLMessageReader
     void getString(const char *block, const char *var,  std::string& outstr,
                            S32 blocknum = 0) override;
 
+    /** Same as above, with the block and variable looked up by index. */
+    void getBinaryData(const LLMessageField& field, void *datap, S32 size,
+                       S32 blocknum = 0, S32 max_size = S32_MAX);
+    void getBOOL(const LLMessageField& field, BOOL &data, S32 blocknum = 0);
+    void getS8(const LLMessageField& field, S8 &data, S32 blocknum = 0);
+    void getU8(const LLMessageField& field, U8 &data, S32 blocknum = 0);
+    void getS16(const LLMessageField& field, S16 &data, S32 blocknum = 0);
+    void getU16(const LLMessageField& field, U16 &data, S32 blocknum = 0);
+    void getS32(const LLMessageField& field, S32 &data, S32 blocknum = 0);
+    void getF32(const LLMessageField& field, F32 &data, S32 blocknum = 0);
+    void getU32(const LLMessageField& field, U32 &data, S32 blocknum = 0);
+    void getU64(const LLMessageField& field, U64 &data, S32 blocknum = 0);
+    void getF64(const LLMessageField& field, F64 &data, S32 blocknum = 0);
+    void getVector3(const LLMessageField& field, LLVector3 &vec, S32 blocknum = 0);
+    void getVector4(const LLMessageField& field, LLVector4 &vec, S32 blocknum = 0);
+    void getVector3d(const LLMessageField& field, LLVector3d &vec, S32 blocknum = 0);
+    void getQuat(const LLMessageField& field, LLQuaternion &q, S32 blocknum = 0);
+    void getUUID(const LLMessageField& field, LLUUID &uuid, S32 blocknum = 0);
+    void getIPAddr(const LLMessageField& field, U32 &ip, S32 blocknum = 0);
+    void getIPPort(const LLMessageField& field, U16 &port, S32 blocknum = 0);
+    void getString(const LLMessageField& field, S32 buffer_size, char *buffer,
+                   S32 blocknum = 0);
+    void getString(const LLMessageField& field, std::string& outstr, S32 blocknum = 0);
+
     S32 getNumberOfBlocks(const char *blockname) override;
     S32 getSize(const char *blockname, const char *varname) override;
     S32 getSize(const char *blockname, S32 blocknum,
                         const char *varname) override;
+    S32 getSize(const LLMessageField& field, S32 blocknum);
 
     void clearMessage() override;
 
@@ -100,6 +166,13 @@ class LLTemplateMessageReader : public LLMessageReader
                          const LLHost& sender, bool trusted = false, bool custom = false);
     BOOL readMessage(const U8* buffer, const LLHost& sender);
 
+    /**
+     * Hands over a message decoded by decodeMessage(), which readMessage()
+     * then uses instead of decoding it again. Swaps, so decoded gets back
+     * buffers to reuse. clearMessage() drops it.
+     */
+    void setPredecoded(DecodedMessage& decoded);
+
     bool isTrusted() const;
     bool isBanned(bool trusted_source) const;
     bool isUdpBanned() const;
@@ -107,19 +180,38 @@ class LLTemplateMessageReader : public LLMessageReader
     BOOL               decodeData(const U8* buffer, const LLHost& sender, bool custom = false);
     LLMessageTemplate* getTemplate();
 
+    /** Template of the message in buffer, or NULL. Does not log, so any thread may call it. */
+    LLMessageTemplate* findTemplate(const U8* buffer, S32 buffer_size) const;
+
+    /** Lays out buffer against templatep, touching nothing else. Safe on any thread. */
+    static bool decodeMessage(const U8* buffer, S32 buffer_size,
+                              LLMessageTemplate* templatep,
+                              DecodedMessage& decoded);
+
 private:
 
-    void getData(const char *blockname, const char *varname, void *datap,
+    void getData(const LLMessageField& field, void *datap,
                  S32 size = 0, S32 blocknum = 0, S32 max_size = S32_MAX);
 
+    // Finds field in block instance blocknum of the current message.
+    // Returns 0 or LL_BLOCK_NOT_IN_MESSAGE or LL_VARIABLE_NOT_IN_BLOCK.
+    S32 findVariable(const LLMessageField& field, S32 blocknum,
+                     const DecodedVariable*& variable) const;
+
+    static bool getMessageNumber(const U8* buffer, S32 buffer_size, U32& num);
+
     BOOL decodeTemplate(const U8* buffer, S32 buffer_size,  // inputs
                         LLMessageTemplate** msg_template, bool custom = false); // outputs
 
+    BOOL dispatchMessage(const LLHost& sender, bool custom);
+
     void logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted );
 
     S32 mReceiveSize;
     LLMessageTemplate* mCurrentRMessageTemplate;
-    LLMsgData* mCurrentRMessageData;
+    bool mMessageDecoded;
+    DecodedMessage mDecoded;
+    DecodedMessage mPredecoded;
     message_template_number_map_t& mMessageNumbers;
 };
 
@@ -32,12 +32,18 @@
 #include "message.h"
 
 
-LLThrottle::LLThrottle(const F32 rate)
+LLThrottle::LLThrottle(const F32 rate, bool own_clock)
 {
     mRate = rate;
     mAvailable = 0.f;
     mLookaheadSecs = 0.25f;
-    mLastSendTime = LLMessageSystem::getMessageTimeSeconds(TRUE);
+    mOwnClock = own_clock;
+    mLastSendTime = mOwnClock ? F64Seconds(LLTimer::getTotalSeconds()) : LLMessageSystem::getMessageTimeSeconds(TRUE);
+}
+
+F64Seconds LLThrottle::getTime() const
+{
+    return mOwnClock ? F64Seconds(LLTimer::getTotalSeconds()) : LLMessageSystem::getMessageTimeSeconds();
 }
 
 
@@ -45,7 +51,7 @@ void LLThrottle::setRate(const F32 rate)
 {
     // Need to accumulate available bits when adjusting the rate.
     mAvailable = getAvailable();
-    mLastSendTime = LLMessageSystem::getMessageTimeSeconds();
+    mLastSendTime = getTime();
     mRate = rate;
 }
 
@@ -53,7 +59,7 @@ F32 LLThrottle::getAvailable()
 {
     // use a temporary bits_available
     // since we don't want to change mBitsAvailable every time
-    F32Seconds elapsed_time = LLMessageSystem::getMessageTimeSeconds() - mLastSendTime;
+    F32Seconds elapsed_time = getTime() - mLastSendTime;
     return mAvailable + (mRate * elapsed_time.value());
 }
 
@@ -65,7 +71,7 @@ BOOL LLThrottle::checkOverflow(const F32 amount)
 
     // use a temporary bits_available
     // since we don't want to change mBitsAvailable every time
-    F32Seconds elapsed_time =  LLMessageSystem::getMessageTimeSeconds() - mLastSendTime;
+    F32Seconds elapsed_time =  getTime() - mLastSendTime;
     F32 amount_available = mAvailable + (mRate * elapsed_time.value());
 
     if ((amount_available >= lookahead_amount) || (amount_available > amount))
@@ -86,7 +92,7 @@ BOOL LLThrottle::throttleOverflow(const F32 amount)
 
     lookahead_amount = mRate * mLookaheadSecs;
 
-    F64Seconds mt_sec = LLMessageSystem::getMessageTimeSeconds();
+    F64Seconds mt_sec = getTime();
     elapsed_time = mt_sec - mLastSendTime;
     mLastSendTime = mt_sec;
 
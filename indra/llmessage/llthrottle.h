@@ -37,7 +37,9 @@ class LLDataPacker;
 class LLThrottle
 {
 public:
-    LLThrottle(const F32 throttle = 1.f);
+    // With own_clock, time is taken from LLTimer rather than the message
+    // system, so the throttle can be used off the main thread
+    LLThrottle(const F32 throttle = 1.f, bool own_clock = false);
     ~LLThrottle() = default;
 
     void setRate(const F32 rate);
@@ -51,6 +53,9 @@ class LLThrottle
     F32 mRate;  // BPS available, dynamically adjusted
     F32 mAvailable; // Bits available to send right now on each channel
     F64Seconds  mLastSendTime;      // Time since last send on this channel
+    bool        mOwnClock;
+
+    F64Seconds  getTime() const;
 };
 
 typedef enum e_throttle_categories
@@ -57,6 +57,8 @@
 #include "llmd5.h"
 #include "llmessagebuilder.h"
 #include "llmessageconfig.h"
+#include "llmessagefield.h"
+#include "llmessagereceivethread.h"
 #include "lltemplatemessagedispatcher.h"
 #include "llpumpio.h"
 #include "lltemplatemessagebuilder.h"
@@ -280,6 +282,9 @@ LLMessageSystem::LLMessageSystem(const std::string& filename, U32 port,
     mMaxMessageTime   = F32Seconds(1.f);
 
     mTrueReceiveSize = 0;
+    mPreExpandedSize = 0;
+    mPreExpandedFrom = 0;
+    mPreExpandedOverflows = 0;
 
     mReceiveTime = F32Seconds(0.f);
 }
@@ -322,6 +327,9 @@ void LLMessageSystem::loadTemplateFile(const std::string& filename, bool failure
 
 LLMessageSystem::~LLMessageSystem()
 {
+    // the thread reads the templates and the socket
+    stopReceiveThread();
+
     mMessageTemplates.clear(); // don't delete templates.
     std::for_each(mMessageNumbers.begin(), mMessageNumbers.end(), DeletePairedPointer());
     mMessageNumbers.clear();
@@ -360,6 +368,55 @@ void LLMessageSystem::clearReceiveState()
     mLastReceivingIF.invalidate();
     mMessageReader->clearMessage();
     mLastMessageFromTrustedMessageService = false;
+    mPreExpandedSize = 0;
+}
+
+void LLMessageSystem::startReceiveThread()
+{
+    if (mReceiveThread || mbError)
+    {
+        return;
+    }
+    LL_INFOS("Messaging") << "Starting message receive thread" << LL_ENDL;
+    mReceiveThread = std::make_unique<LLMessageReceiveThread>(mSocket, mPacketRing, mMessageNumbers);
+    mReceiveThread->start();
+}
+
+void LLMessageSystem::stopReceiveThread()
+{
+    if (mReceiveThread)
+    {
+        mReceiveThread->shutdown();
+        mReceiveThread.reset();
+    }
+}
+
+// Takes the next packet from the receive thread into mTrueReceiveBuffer,
+// along with its expansion and decode. Returns its size, 0 when none.
+S32 LLMessageSystem::receiveFromThread()
+{
+    LLMessageReceiveThread::Packet* packetp = mReceiveThread->popPacket();
+    if (!packetp)
+    {
+        return 0;
+    }
+
+    S32 size = packetp->mSize;
+    memcpy(mTrueReceiveBuffer, packetp->mBuffer, size);     /* Flawfinder: ignore */
+    mLastSender = packetp->mSender;
+    mLastReceivingIF = packetp->mReceivingIF;
+
+    mPreExpandedSize = packetp->mExpandedSize;
+    if (mPreExpandedSize)
+    {
+        memcpy(mEncodedRecvBuffer, packetp->mExpanded, mPreExpandedSize);     /* Flawfinder: ignore */
+        mPreExpandedFrom = packetp->mExpandedFrom;
+        mPreExpandedOverflows = packetp->mExpandOverflows;
+    }
+    mTemplateMessageReader->setPredecoded(packetp->mDecoded);
+
+    mReceiveThread->releasePacket(packetp);
+    return size;
 }
 
 
@@ -517,18 +574,27 @@ BOOL LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count,
 
         if(!faked_message)
         {
-
-            mTrueReceiveSize = mPacketRing.receivePacket(mSocket, reinterpret_cast<char*>(mTrueReceiveBuffer));
+            if (mReceiveThread)
+            {
+                mTrueReceiveSize = receiveFromThread();
+            }
+            else
+            {
+                mTrueReceiveSize = mPacketRing.receivePacket(mSocket, reinterpret_cast<char*>(mTrueReceiveBuffer));
+                mLastSender = mPacketRing.getLastSender();
+                mLastReceivingIF = mPacketRing.getLastReceivingInterface();
+            }
 
             receive_size = mTrueReceiveSize;
-            mLastSender = mPacketRing.getLastSender();
-            mLastReceivingIF = mPacketRing.getLastReceivingInterface();
         } else {
             buffer = fake_buffer; //true my ass.
             mTrueReceiveSize = fake_size;
             receive_size = mTrueReceiveSize;
             mLastSender = fake_host;
-            mLastReceivingIF = mPacketRing.getLastReceivingInterface(); //don't really give two tits about the interface, just leave it
+            if (!mReceiveThread)    // the ring belongs to the receive thread while it runs
+            {
+                mLastReceivingIF = mPacketRing.getLastReceivingInterface(); //don't really give two tits about the interface, just leave it
+            }
         }
 
         // If you want to dump all received packets into SecondLife.log, uncomment this
@@ -776,6 +842,9 @@ S32 LLMessageSystem::getReceiveBytes() const
 void LLMessageSystem::processAcks(LockMessageChecker&, F32 collect_time)
 {
     F64Seconds mt_sec = getMessageTimeSeconds();
+
+    // Resends, acks and transfer packets go out to the socket together
+    mPacketRing.beginSendBatch();
     {
         gTransferManager.updateTransfers();
 
@@ -830,6 +899,8 @@ void LLMessageSystem::processAcks(LockMessageChecker&, F32 collect_time)
         }
     }
 
+    mSendPacketFailureCount += mPacketRing.endSendBatch();
+
     if (dump)
     {
         dumpReceiveCounts();
@@ -2897,10 +2968,41 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
     *data[0] &= (~LL_ZERO_CODE_FLAG);
 
-    S32 count = (*data_size);
+    S32 overflows = 0;
+    if (mPreExpandedSize && mPreExpandedFrom == in_size)
+    {
+        // already expanded into mEncodedRecvBuffer by the receive thread
+        *data_size = mPreExpandedSize;
+        overflows = mPreExpandedOverflows;
+    }
+    else
+    {
+        *data_size = zeroCodeExpandBuffer(*data, in_size, mEncodedRecvBuffer, overflows);
+    }
+    mPreExpandedSize = 0;
+
+    while (overflows--)
+    {
+        callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+    }
+
+    *data = mEncodedRecvBuffer;
+    mUncompressedBytesIn += *data_size;
+
+    return(in_size);
+}
+
+// Expands the zero coded packet in into out, which holds MAX_BUFFER_SIZE
+// bytes, and returns the expanded size. Counts the times the expansion ran
+// past the end of out in overflows. Touches no member state, so the receive
+// thread uses it too.
+//static
+S32 LLMessageSystem::zeroCodeExpandBuffer(const U8* in, S32 in_size, U8* out, S32& overflows)
+{
+    S32 count = in_size;
 
-    U8 *inptr = (U8 *)*data;
-    U8 *outptr = (U8 *)mEncodedRecvBuffer;
+    const U8 *inptr = in;
+    U8 *outptr = out;
 
 // skip the packet id field
 
@@ -2909,6 +3011,7 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
         count--;
         *outptr++ = *inptr++;
     }
+    out[0] &= (~LL_ZERO_CODE_FLAG);
 
 // reconstruct encoded packet, keeping track of net size gain
 
@@ -2917,26 +3020,26 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
     while (count--)
     {
-        if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
+        if (outptr > (&out[MAX_BUFFER_SIZE-1]))
         {
             LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << LL_ENDL;
-            callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-            outptr = mEncodedRecvBuffer;
+            overflows++;
+            outptr = out;
             break;
         }
         if (!((*outptr++ = *inptr++)))
         {
             while (((count--)) && (!(*inptr)))
             {
-                *outptr++ = *inptr++;
-                if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
+                if (outptr > (&out[MAX_BUFFER_SIZE-256]))
                 {
                     LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << LL_ENDL;
-                    callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-                    outptr = mEncodedRecvBuffer;
+                    overflows++;
+                    outptr = out;
                     count = -1;
                     break;
                 }
+                *outptr++ = *inptr++;
                 memset(outptr,0,255);
                 outptr += 255;
             }
@@ -2948,11 +3051,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
             else
             {
-                if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
+                if (outptr > (&out[MAX_BUFFER_SIZE-(*inptr)]))
                 {
                     LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << LL_ENDL;
-                    callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-                    outptr = mEncodedRecvBuffer;
+                    overflows++;
+                    outptr = out;
                 }
                 memset(outptr,0,(*inptr) - 1);
                 outptr += ((*inptr) - 1);
@@ -2961,11 +3064,7 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
         }
     }
 
-    *data = mEncodedRecvBuffer;
-    *data_size = (S32)(outptr - mEncodedRecvBuffer);
-    mUncompressedBytesIn += *data_size;
-
-    return(in_size);
+    return (S32)(outptr - out);
 }
 
 
@@ -3398,7 +3497,7 @@ void LLMessageSystem::establishBidirectionalTrust(const LLHost &host, S64 frame_
 
 void LLMessageSystem::dumpPacketToLog()
 {
-    LL_WARNS("Messaging") << "Packet Dump from:" << mPacketRing.getLastSender() << LL_ENDL;
+    LL_WARNS("Messaging") << "Packet Dump from:" << mLastSender << LL_ENDL;
     LL_WARNS("Messaging") << "Packet Size:" << mTrueReceiveSize << LL_ENDL;
     char line_buffer[256];      /* Flawfinder: ignore */
     S32 i;
@@ -3992,6 +4091,256 @@ void LLMessageSystem::getString(const char *block, const char *var,
                   blocknum);
 }
 
+
+void LLMessageSystem::getBinaryDataFast(const LLMessageField& field, void *datap,
+                                        S32 size, S32 blocknum, S32 max_size)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getBinaryData(field, datap, size, blocknum, max_size);
+    }
+    else
+    {
+        mMessageReader->getBinaryData(field.getBlock(), field.getVariable(), datap,
+                                      size, blocknum, max_size);
+    }
+}
+
+void LLMessageSystem::getBOOLFast(const LLMessageField& field, BOOL &data, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getBOOL(field, data, blocknum);
+    }
+    else
+    {
+        mMessageReader->getBOOL(field.getBlock(), field.getVariable(), data, blocknum);
+    }
+}
+
+void LLMessageSystem::getS8Fast(const LLMessageField& field, S8 &data, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getS8(field, data, blocknum);
+    }
+    else
+    {
+        mMessageReader->getS8(field.getBlock(), field.getVariable(), data, blocknum);
+    }
+}
+
+void LLMessageSystem::getU8Fast(const LLMessageField& field, U8 &data, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getU8(field, data, blocknum);
+    }
+    else
+    {
+        mMessageReader->getU8(field.getBlock(), field.getVariable(), data, blocknum);
+    }
+}
+
+void LLMessageSystem::getS16Fast(const LLMessageField& field, S16 &data, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getS16(field, data, blocknum);
+    }
+    else
+    {
+        mMessageReader->getS16(field.getBlock(), field.getVariable(), data, blocknum);
+    }
+}
+
+void LLMessageSystem::getU16Fast(const LLMessageField& field, U16 &data, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getU16(field, data, blocknum);
+    }
+    else
+    {
+        mMessageReader->getU16(field.getBlock(), field.getVariable(), data, blocknum);
+    }
+}
+
+void LLMessageSystem::getS32Fast(const LLMessageField& field, S32 &data, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getS32(field, data, blocknum);
+    }
+    else
+    {
+        mMessageReader->getS32(field.getBlock(), field.getVariable(), data, blocknum);
+    }
+}
+
+void LLMessageSystem::getF32Fast(const LLMessageField& field, F32 &data, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getF32(field, data, blocknum);
+    }
+    else
+    {
+        mMessageReader->getF32(field.getBlock(), field.getVariable(), data, blocknum);
+    }
+}
+
+void LLMessageSystem::getU32Fast(const LLMessageField& field, U32 &data, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getU32(field, data, blocknum);
+    }
+    else
+    {
+        mMessageReader->getU32(field.getBlock(), field.getVariable(), data, blocknum);
+    }
+}
+
+void LLMessageSystem::getU64Fast(const LLMessageField& field, U64 &data, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getU64(field, data, blocknum);
+    }
+    else
+    {
+        mMessageReader->getU64(field.getBlock(), field.getVariable(), data, blocknum);
+    }
+}
+
+void LLMessageSystem::getF64Fast(const LLMessageField& field, F64 &data, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getF64(field, data, blocknum);
+    }
+    else
+    {
+        mMessageReader->getF64(field.getBlock(), field.getVariable(), data, blocknum);
+    }
+}
+
+void LLMessageSystem::getVector3Fast(const LLMessageField& field, LLVector3 &vec, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getVector3(field, vec, blocknum);
+    }
+    else
+    {
+        mMessageReader->getVector3(field.getBlock(), field.getVariable(), vec, blocknum);
+    }
+}
+
+void LLMessageSystem::getVector4Fast(const LLMessageField& field, LLVector4 &vec, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getVector4(field, vec, blocknum);
+    }
+    else
+    {
+        mMessageReader->getVector4(field.getBlock(), field.getVariable(), vec, blocknum);
+    }
+}
+
+void LLMessageSystem::getVector3dFast(const LLMessageField& field, LLVector3d &vec, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getVector3d(field, vec, blocknum);
+    }
+    else
+    {
+        mMessageReader->getVector3d(field.getBlock(), field.getVariable(), vec, blocknum);
+    }
+}
+
+void LLMessageSystem::getQuatFast(const LLMessageField& field, LLQuaternion &q, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getQuat(field, q, blocknum);
+    }
+    else
+    {
+        mMessageReader->getQuat(field.getBlock(), field.getVariable(), q, blocknum);
+    }
+}
+
+void LLMessageSystem::getUUIDFast(const LLMessageField& field, LLUUID &uuid, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getUUID(field, uuid, blocknum);
+    }
+    else
+    {
+        mMessageReader->getUUID(field.getBlock(), field.getVariable(), uuid, blocknum);
+    }
+}
+
+void LLMessageSystem::getIPAddrFast(const LLMessageField& field, U32 &ip, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getIPAddr(field, ip, blocknum);
+    }
+    else
+    {
+        mMessageReader->getIPAddr(field.getBlock(), field.getVariable(), ip, blocknum);
+    }
+}
+
+void LLMessageSystem::getIPPortFast(const LLMessageField& field, U16 &port, S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getIPPort(field, port, blocknum);
+    }
+    else
+    {
+        mMessageReader->getIPPort(field.getBlock(), field.getVariable(), port, blocknum);
+    }
+}
+
+void LLMessageSystem::getStringFast(const LLMessageField& field, S32 buffer_size,
+                                    char *buffer, S32 blocknum)
+{
+    if(buffer_size <= 0)
+    {
+        LL_WARNS("Messaging") << "buffer_size <= 0" << LL_ENDL;
+    }
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getString(field, buffer_size, buffer, blocknum);
+    }
+    else
+    {
+        mMessageReader->getString(field.getBlock(), field.getVariable(), buffer_size,
+                                  buffer, blocknum);
+    }
+}
+
+void LLMessageSystem::getStringFast(const LLMessageField& field, std::string& outstr,
+                                    S32 blocknum)
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        mTemplateMessageReader->getString(field, outstr, blocknum);
+    }
+    else
+    {
+        mMessageReader->getString(field.getBlock(), field.getVariable(), outstr, blocknum);
+    }
+}
+
 BOOL    LLMessageSystem::has(const char *blockname) const
 {
     return getNumberOfBlocks(blockname) > 0;
@@ -4037,6 +4386,15 @@ S32 LLMessageSystem::getSize(const char *blockname, S32 blocknum,
                        LLMessageStringTable::getInstance()->getString(varname));
 }
 
+S32 LLMessageSystem::getSizeFast(const LLMessageField& field, S32 blocknum) const
+{
+    if (mMessageReader == mTemplateMessageReader)
+    {
+        return mTemplateMessageReader->getSize(field, blocknum);
+    }
+    return mMessageReader->getSize(field.getBlock(), blocknum, field.getVariable());
+}
+
 S32 LLMessageSystem::getReceiveSize() const
 {
     return mMessageReader->getMessageSize();
@@ -29,6 +29,7 @@
 
 #include <array>
 #include <cstring>
+#include <memory>
 #include <set>
 
 #if LL_LINUX
@@ -183,7 +184,9 @@ class LLMsgBlkData;
 class LLMessageTemplate;
 
 class LLMessagePollInfo;
+class LLMessageReceiveThread;
 class LLMessageBuilder;
+class LLMessageField;
 class LLTemplateMessageBuilder;
 class LLSDMessageBuilder;
 class LLMessageReader;
@@ -426,6 +429,11 @@ class LLMessageSystem : public LLMessageSenderInterface
                           bool faked_message = false, U8 fake_buffer[MAX_BUFFER_SIZE] = nullptr, LLHost fake_host = LLHost(), S32 fake_size = 0);
     void    processAcks(LockMessageChecker&, F32 collect_time = 0.f);
 
+    // Reads packets on a thread of their own, which also zero code expands
+    // and decodes them, leaving checkMessages() the circuits and handlers.
+    void    startReceiveThread();
+    void    stopReceiveThread();
+
     BOOL    isMessageFast(const char *msg);
     BOOL    isMessage(const char *msg)
     {
@@ -546,6 +554,7 @@ class LLMessageSystem : public LLMessageSenderInterface
 
     S32     zeroCode(U8 **data, S32 *data_size);
     S32     zeroCodeExpand(U8 **data, S32 *data_size);
+    static S32 zeroCodeExpandBuffer(const U8* in, S32 in_size, U8* out, S32& overflows);
     S32     zeroCodeAdjustCurrentSendTotal();
 
     // Uses ping-based retry
@@ -647,6 +656,33 @@ class LLMessageSystem : public LLMessageSenderInterface
     void getStringFast( const char *block, const char *var, std::string& outstr, S32 blocknum = 0);
     void    getString(  const char *block, const char *var, std::string& outstr, S32 blocknum = 0);
 
+    /**
+    Same as the get*Fast() calls above, for handlers that keep the block and
+    variable they read in an LLMessageField. Reading the template messages
+    the viewer receives over UDP then skips looking the names up each time.
+    */
+    void    getBinaryDataFast(const LLMessageField& field, void *datap, S32 size, S32 blocknum = 0, S32 max_size = S32_MAX);
+    void    getBOOLFast(const LLMessageField& field, BOOL &data, S32 blocknum = 0);
+    void    getS8Fast(const LLMessageField& field, S8 &data, S32 blocknum = 0);
+    void    getU8Fast(const LLMessageField& field, U8 &data, S32 blocknum = 0);
+    void    getS16Fast(const LLMessageField& field, S16 &data, S32 blocknum = 0);
+    void    getU16Fast(const LLMessageField& field, U16 &data, S32 blocknum = 0);
+    void    getS32Fast(const LLMessageField& field, S32 &data, S32 blocknum = 0);
+    void    getF32Fast(const LLMessageField& field, F32 &data, S32 blocknum = 0);
+    void    getU32Fast(const LLMessageField& field, U32 &data, S32 blocknum = 0);
+    void    getU64Fast(const LLMessageField& field, U64 &data, S32 blocknum = 0);
+    void    getF64Fast(const LLMessageField& field, F64 &data, S32 blocknum = 0);
+    void    getVector3Fast(const LLMessageField& field, LLVector3 &vec, S32 blocknum = 0);
+    void    getVector4Fast(const LLMessageField& field, LLVector4 &vec, S32 blocknum = 0);
+    void    getVector3dFast(const LLMessageField& field, LLVector3d &vec, S32 blocknum = 0);
+    void    getQuatFast(const LLMessageField& field, LLQuaternion &q, S32 blocknum = 0);
+    void    getUUIDFast(const LLMessageField& field, LLUUID &uuid, S32 blocknum = 0);
+    void    getIPAddrFast(const LLMessageField& field, U32 &ip, S32 blocknum = 0);
+    void    getIPPortFast(const LLMessageField& field, U16 &port, S32 blocknum = 0);
+    void    getStringFast(const LLMessageField& field, S32 buffer_size, char *buffer, S32 blocknum = 0);
+    void    getStringFast(const LLMessageField& field, std::string& outstr, S32 blocknum = 0);
+    S32     getSizeFast(const LLMessageField& field, S32 blocknum) const;
+
 
     // Utility functions to generate a replay-resistant digest check
     // against the shared secret. The window specifies how much of a
@@ -870,6 +906,15 @@ class LLMessageSystem : public LLMessageSenderInterface
     U8  mTrueReceiveBuffer[MAX_BUFFER_SIZE];
     S32 mTrueReceiveSize;
 
+    std::unique_ptr<LLMessageReceiveThread> mReceiveThread;
+    S32 receiveFromThread();
+
+    // Set when the receive thread has already expanded the current packet
+    // into mEncodedRecvBuffer
+    S32 mPreExpandedSize;
+    S32 mPreExpandedFrom;
+    S32 mPreExpandedOverflows;
+
     // Must be valid during decode
 
     BOOL    mbError;
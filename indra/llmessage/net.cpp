@@ -523,12 +523,30 @@ void end_net(S32& socket_out)
 }
 
 #if LL_LINUX
+// Picks the IP_PKTINFO destination address out of a received message
+static void get_destip(struct msghdr *msg, U32 *dstip)
+{
+    for (struct cmsghdr *cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(msg, cmsgptr))
+    {
+        if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
+        {
+            in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
+            if( pktinfo )
+            {
+                // Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
+                // routed. We should stay with specified until we go to multiple
+                // interfaces
+                *dstip = pktinfo->ipi_spec_dst.s_addr;
+            }
+        }
+    }
+}
+
 static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *from, socklen_t *fromlen, U32 *dstip )
 {
     int size;
     struct iovec iov[1];
     char cmsg[CMSG_SPACE(sizeof(struct in_pktinfo))];
-    struct cmsghdr *cmsgptr;
     struct msghdr msg = {};
 
     iov[0].iov_base = buf;
@@ -549,20 +567,7 @@ static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *fro
         return -1;
     }
 
-    for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR( &msg, cmsgptr))
-    {
-        if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
-        {
-            in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
-            if( pktinfo )
-            {
-                // Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
-                // routed. We should stay with specified until we go to multiple
-                // interfaces
-                *dstip = pktinfo->ipi_spec_dst.s_addr;
-            }
-        }
-    }
+    get_destip(&msg, dstip);
 
     return size;
 }
@@ -660,4 +665,160 @@ BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
 
 #endif
 
+BOOL wait_for_packet(int hSocket, S32 timeout_ms)
+{
+    fd_set read_set;
+    FD_ZERO(&read_set);
+    FD_SET(hSocket, &read_set);
+
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+    return select(hSocket + 1, &read_set, NULL, NULL, &timeout) > 0;
+}
+
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+    count = llmin(count, NET_MAX_BATCH_PACKETS);
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+#if LL_LINUX
+    struct mmsghdr msgs[NET_MAX_BATCH_PACKETS];
+    struct iovec iovs[NET_MAX_BATCH_PACKETS];
+    struct sockaddr_in from[NET_MAX_BATCH_PACKETS];
+    char cmsgs[NET_MAX_BATCH_PACKETS][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+    memset(msgs, 0, sizeof(msgs[0]) * count);
+    for (S32 i = 0; i < count; ++i)
+    {
+        iovs[i].iov_base = datagrams[i].mData;
+        iovs[i].iov_len = NET_BUFFER_SIZE;
+
+        struct msghdr& msg = msgs[i].msg_hdr;
+        msg.msg_name = &from[i];
+        msg.msg_namelen = sizeof(from[i]);
+        msg.msg_iov = &iovs[i];
+        msg.msg_iovlen = 1;
+        msg.msg_control = cmsgs[i];
+        msg.msg_controllen = sizeof(cmsgs[i]);
+    }
+
+    // The socket is non-blocking, so this returns whatever is already queued
+    int received = recvmmsg(hSocket, msgs, count, 0, NULL);
+    if (received <= 0)
+    {
+        return 0;
+    }
+
+    for (S32 i = 0; i < received; ++i)
+    {
+        LLNetDatagram& datagram = datagrams[i];
+        datagram.mSize = msgs[i].msg_len;
+        datagram.mAddress = from[i].sin_addr.s_addr;
+        datagram.mPort = ntohs(from[i].sin_port);
+        datagram.mReceivingIF = INVALID_HOST_IP_ADDRESS;
+        get_destip(&msgs[i].msg_hdr, &datagram.mReceivingIF);
+    }
+
+    // Keep get_sender() and get_receiving_interface() describing the last
+    // datagram read, as they would after receive_packet()
+    stSrcAddr = from[received - 1];
+    gsnReceivingIFAddr = datagrams[received - 1].mReceivingIF;
+    return received;
+#else
+    S32 received = 0;
+    while (received < count)
+    {
+        LLNetDatagram& datagram = datagrams[received];
+        datagram.mSize = receive_packet(hSocket, datagram.mData);
+        if (datagram.mSize <= 0)
+        {
+            break;
+        }
+        datagram.mAddress = get_sender_ip();
+        datagram.mPort = get_sender_port();
+        datagram.mReceivingIF = get_receiving_interface_ip();
+        ++received;
+    }
+    return received;
+#endif
+}
+
+S32 send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count)
+{
+#if LL_LINUX
+    S32 sent = 0;
+    while (count > 0)
+    {
+        S32 batch = llmin(count, NET_MAX_BATCH_PACKETS);
+        struct mmsghdr msgs[NET_MAX_BATCH_PACKETS];
+        struct iovec iovs[NET_MAX_BATCH_PACKETS];
+        struct sockaddr_in to[NET_MAX_BATCH_PACKETS];
+
+        memset(msgs, 0, sizeof(msgs[0]) * batch);
+        memset(to, 0, sizeof(to[0]) * batch);
+        for (S32 i = 0; i < batch; ++i)
+        {
+            iovs[i].iov_base = datagrams[i].mData;
+            iovs[i].iov_len = datagrams[i].mSize;
+
+            to[i].sin_family = AF_INET;
+            to[i].sin_addr.s_addr = datagrams[i].mAddress;
+            to[i].sin_port = htons(datagrams[i].mPort);
+
+            struct msghdr& msg = msgs[i].msg_hdr;
+            msg.msg_name = &to[i];
+            msg.msg_namelen = sizeof(to[i]);
+            msg.msg_iov = &iovs[i];
+            msg.msg_iovlen = 1;
+        }
+
+        // sendmmsg() stops at the first datagram the socket refuses. Retry
+        // that one the way send_packet() would, then carry on past it.
+        S32 next = 0;
+        S32 send_attempts = 0;
+        while (next < batch)
+        {
+            int ret = sendmmsg(hSocket, &msgs[next], batch - next, 0);
+            if (ret > 0)
+            {
+                next += ret;
+                sent += ret;
+                send_attempts = 0;
+                continue;
+            }
+
+            if ((errno == EAGAIN || errno == ECONNREFUSED) && ++send_attempts < 3)
+            {
+                LL_INFOS() << "sendmmsg() reported " << strerror(errno) << ", resending (attempt " << send_attempts << ")" << LL_ENDL;
+                continue;
+            }
+
+            LL_INFOS() << "sendmmsg() failed: " << errno << ", " << strerror(errno) << LL_ENDL;
+            LL_INFOS() << u32_to_ip_string(datagrams[next].mAddress) << ":" << datagrams[next].mPort << LL_ENDL;
+            ++next;
+            send_attempts = 0;
+        }
+
+        datagrams += batch;
+        count -= batch;
+    }
+    return sent;
+#else
+    S32 sent = 0;
+    for (S32 i = 0; i < count; ++i)
+    {
+        if (send_packet(hSocket, datagrams[i].mData, datagrams[i].mSize, datagrams[i].mAddress, datagrams[i].mPort))
+        {
+            ++sent;
+        }
+    }
+    return sent;
+#endif
+}
+
 //EOF
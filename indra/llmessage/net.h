@@ -43,8 +43,31 @@ void    end_net(S32& socket_out);
 // returns size of packet or -1 in case of error
 S32     receive_packet(int hSocket, char * receiveBuffer);
 
+// Waits up to timeout_ms for a packet to arrive. Returns TRUE if one is waiting.
+BOOL    wait_for_packet(int hSocket, S32 timeout_ms);
+
 BOOL    send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);   // Returns TRUE on success.
 
+// Most datagrams handed to receive_packets() or send_packets() in one call
+const S32   NET_MAX_BATCH_PACKETS = 32;
+
+// One datagram of a batched receive or send
+struct LLNetDatagram
+{
+    char*   mData;          // NET_BUFFER_SIZE bytes when receiving
+    S32     mSize;          // bytes received, or bytes to send
+    U32     mAddress;       // sender when receiving, recipient when sending
+    U16     mPort;
+    U32     mReceivingIF;   // address the datagram was sent to, receive only
+};
+
+// Reads up to count waiting datagrams, with a single recvmmsg() on Linux.
+// Returns the number read, 0 when nothing is waiting.
+S32     receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count);
+
+// Sends count datagrams, with sendmmsg() on Linux. Returns the number sent.
+S32     send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count);
+
 //void  get_sender(char * tmp);
 LLHost  get_sender();
 U32     get_sender_port();
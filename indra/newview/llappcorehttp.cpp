@@ -52,6 +52,7 @@
 
 const F64 LLAppCoreHttp::MAX_THREAD_WAIT_TIME(10.0);
 const long LLAppCoreHttp::PIPELINING_DEPTH(5L);
+const long LLAppCoreHttp::MULTIPLEX_STREAMS(16L);
 
 //  Default and dynamic values for classes
 static const struct
@@ -129,7 +130,8 @@ static void ssl_verification_changed();
 LLAppCoreHttp::HttpClass::HttpClass()
     : mPolicy(LLCore::HttpRequest::DEFAULT_POLICY_ID),
       mConnLimit(0U),
-      mPipelined(false)
+      mPipelined(false),
+      mMultiplexed(false)
 {}
 
 
@@ -138,7 +140,8 @@ LLAppCoreHttp::LLAppCoreHttp()
       mStopHandle(LLCORE_HTTP_HANDLE_INVALID),
       mStopRequested(0.0),
       mStopped(false),
-      mPipelined(true)
+      mPipelined(true),
+      mMultiplexed(false)
 {}
 
 
@@ -275,6 +278,15 @@ void LLAppCoreHttp::init()
         }
     }
 
+    // HTTP/2 multiplexing takes over from pipelining on the
+    // classes that would pipeline.  Init-time only.
+    static const std::string http_multiplexing("HttpMultiplexing");
+    if (gSavedSettings.controlExists(http_multiplexing))
+    {
+        mMultiplexed = gSavedSettings.getBOOL(http_multiplexing);
+        LL_INFOS("Init") << "HTTP/2 multiplexing " << (mMultiplexed ? "enabled" : "disabled") << "!" << LL_ENDL;
+    }
+
     // Need a request object to handle dynamic options before setting them
     mRequest = new LLCore::HttpRequest;
 
@@ -439,7 +451,8 @@ void LLAppCoreHttp::refreshSettings(bool initial)
         // Pipelining changes
         if (initial)
         {
-            const bool to_pipeline(mPipelined && init_data[i].mPipelined);
+            const bool to_multiplex(mMultiplexed && init_data[i].mPipelined);
+            const bool to_pipeline(mPipelined && init_data[i].mPipelined && ! to_multiplex);
             if (to_pipeline != mHttpClasses[app_policy].mPipelined)
             {
                 // Pipeline election changing, set dynamic option via request
@@ -466,6 +479,31 @@ void LLAppCoreHttp::refreshSettings(bool initial)
                     mHttpClasses[app_policy].mPipelined = to_pipeline;
                 }
             }
+
+            if (to_multiplex != mHttpClasses[app_policy].mMultiplexed)
+            {
+                LLCore::HttpHandle handle;
+                const long new_streams(to_multiplex ? MULTIPLEX_STREAMS : 0);
+
+                handle = mRequest->setPolicyOption(LLCore::HttpRequest::PO_MULTIPLEX_STREAMS,
+                                                   mHttpClasses[app_policy].mPolicy,
+                                                   new_streams,
+                                                   LLCore::HttpHandler::ptr_t());
+                if (LLCORE_HTTP_HANDLE_INVALID == handle)
+                {
+                    status = mRequest->getStatus();
+                    LL_WARNS("Init") << "Unable to set " << init_data[i].mUsage
+                                     << " multiplexing.  Reason:  " << status.toString()
+                                     << LL_ENDL;
+                }
+                else
+                {
+                    LL_DEBUGS("Init") << "Changed " << init_data[i].mUsage
+                                      << " multiplexing.  New value:  " << new_streams
+                                      << LL_ENDL;
+                    mHttpClasses[app_policy].mMultiplexed = to_multiplex;
+                }
+            }
         }
 
         // Get target connection concurrency value
@@ -496,10 +534,15 @@ void LLAppCoreHttp::refreshSettings(bool initial)
             // avatars, etc.) can request additional outbound connections
             // to other servers via 2X total connection limit.
             //
+            // Multiplexing.  As with pipelining but libcurl fills the
+            // HTTP/2 streams of a connection before opening another, so
+            // a host normally sees one or two connections.
+            //
             LLCore::HttpHandle handle;
             handle = mRequest->setPolicyOption(LLCore::HttpRequest::PO_CONNECTION_LIMIT,
                                                mHttpClasses[app_policy].mPolicy,
-                                               (mHttpClasses[app_policy].mPipelined ? 2 * setting : setting),
+                                               ((mHttpClasses[app_policy].mPipelined || mHttpClasses[app_policy].mMultiplexed)
+                                                ? 2 * setting : setting),
                                                LLCore::HttpHandler::ptr_t());
             if (LLCORE_HTTP_HANDLE_INVALID == handle)
             {
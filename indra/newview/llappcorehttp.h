@@ -42,6 +42,7 @@ class LLAppCoreHttp : public LLCore::HttpHandler
 {
 public:
     static const long           PIPELINING_DEPTH;
+    static const long           MULTIPLEX_STREAMS;
 
     typedef LLCore::HttpRequest::policy_t policy_t;
 
@@ -242,6 +243,12 @@ class LLAppCoreHttp : public LLCore::HttpHandler
             return mHttpClasses[policy].mPipelined;
         }
 
+    // Return whether a policy is multiplexing requests over HTTP/2.
+    bool isMultiplexed(EAppPolicy policy) const
+        {
+            return mHttpClasses[policy].mMultiplexed;
+        }
+
     // Apply initial or new settings from the environment.
     void refreshSettings(bool initial);
 
@@ -260,6 +267,7 @@ class LLAppCoreHttp : public LLCore::HttpHandler
         policy_t                    mPolicy;            // Policy class id for the class
         U32                         mConnLimit;
         bool                        mPipelined;
+        bool                        mMultiplexed;
         boost::signals2::connection mSettingsSignal;    // Signal to global setting that affect this class (if any)
     };
 
@@ -269,6 +277,7 @@ class LLAppCoreHttp : public LLCore::HttpHandler
     bool                        mStopped;
     HttpClass                   mHttpClasses[AP_COUNT];
     bool                        mPipelined;             // Global setting
+    bool                        mMultiplexed;           // Global 'HttpMultiplexing' setting
     boost::signals2::connection mPipelinedSignal;       // Signal for 'HttpPipelining' setting
     boost::signals2::connection mSSLNoVerifySignal;     // Signal for 'NoVerifySSLCert' setting
 
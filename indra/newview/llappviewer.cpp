@@ -557,6 +557,7 @@ static void settings_to_globals()
     LLVOVolume::sLODFactor              = llclamp(gSavedSettings.getF32("RenderVolumeLODFactor"), 0.01f, MAX_LOD_FACTOR);
     LLVOVolume::sDistanceFactor         = 1.f-LLVOVolume::sLODFactor * 0.1f;
     LLVolumeImplFlexible::sUpdateFactor = gSavedSettings.getF32("RenderFlexTimeFactor");
+    LLVolume::sUseBVH                   = gSavedSettings.getBOOL("RaycastUseBVH");
     LLVOTree::sTreeFactor               = gSavedSettings.getF32("RenderTreeLODFactor");
     LLVOAvatar::sLODFactor              = llclamp(gSavedSettings.getF32("RenderAvatarLODFactor"), 0.f, MAX_AVATAR_LOD_FACTOR);
     LLVOAvatar::sPhysicsLODFactor       = llclamp(gSavedSettings.getF32("RenderAvatarPhysicsLODFactor"), 0.f, MAX_AVATAR_LOD_FACTOR);
@@ -655,6 +656,7 @@ LLAppViewer::LLAppViewer()
     mReportedCrash(false),
     mNumSessions(0),
     mGeneralThreadPool(nullptr),
+    mParallelThreadPool(nullptr),
     mPurgeCache(false),
     mPurgeCacheOnExit(false),
     mPurgeUserDataOnExit(false),
@@ -2003,11 +2005,16 @@ bool LLAppViewer::cleanup()
     {
         mGeneralThreadPool->close();
     }
+    if (mParallelThreadPool)
+    {
+        mParallelThreadPool->close();
+    }
 
     sTextureFetch->shutDownTextureCacheThread() ;
     LLLFSThread::sLocal->shutdown();
 
     LL_INFOS() << "Shutting down disk cache" << LL_ENDL;
+    LLDiskCache::getInstance()->saveIndex();
     LLDiskCache::deleteSingleton();
 
     LL_INFOS() << "Shutting down message system" << LL_ENDL;
@@ -2037,6 +2044,8 @@ bool LLAppViewer::cleanup()
     sPurgeDiskCacheThread = NULL;
     delete mGeneralThreadPool;
     mGeneralThreadPool = NULL;
+    delete mParallelThreadPool;
+    mParallelThreadPool = NULL;
 
     if (LLFastTimerView::sAnalyzePerformance)
     {
@@ -2177,6 +2186,11 @@ bool LLAppViewer::initThreads()
     // general task background thread (LLPerfStats, etc)
     LLAppViewer::instance()->initGeneralThread();
 
+    // helpers for loops the main thread splits with LL::parallelFor(), which
+    // works through them as well, so leave a core for it
+    mParallelThreadPool = new LL::ThreadPool("Parallel", llclamp(cores - 2, 1, 4));
+    mParallelThreadPool->start();
+
     LLAppViewer::sPurgeDiskCacheThread = new LLPurgeDiskCacheThread();
 
     if (LLTrace::BlockTimer::sLog || LLTrace::BlockTimer::sMetricLog)
@@ -2882,6 +2896,11 @@ bool LLAppViewer::initConfiguration()
     //LLVolumeMgr::initClass();
     LLVolumeMgr* volume_manager = new LLVolumeMgr();
     volume_manager->useMutex(); // LLApp and LLMutex magic must be manually enabled
+    volume_manager->setCacheSize(gSavedSettings.getU32("PrimVolumeCacheSize"));
+    if (gSavedSettings.getBOOL("PrimVolumeBackgroundGeneration"))
+    {
+        volume_manager->setGenerationQueue("General");
+    }
     LLPrimitive::setVolumeManager(volume_manager);
 
     // Note: this is where we used to initialize gFeatureManagerp.
@@ -4067,7 +4086,7 @@ U32 LLAppViewer::getObjectCacheVersion()
 {
     // Viewer object cache version, change if object update
     // format changes. JC
-    const U32 INDRA_OBJECT_CACHE_VERSION = 17;
+    const U32 INDRA_OBJECT_CACHE_VERSION = 18;
 
     return INDRA_OBJECT_CACHE_VERSION;
 }
@@ -4160,7 +4179,8 @@ bool LLAppViewer::initCache()
         const uintmax_t disk_cache_bytes = disk_cache_mb * 1024ull * 1024ull;
 
         const bool enable_cache_debug_info = gSavedSettings.getBOOL("EnableDiskCacheDebugInfo");
-        LLDiskCache::getInstance()->init(LL_PATH_CACHE, disk_cache_bytes, enable_cache_debug_info, disk_cache_mismatch);
+        const bool use_packed_store = gSavedSettings.getBOOL("DiskCachePackedStore");
+        LLDiskCache::getInstance()->init(LL_PATH_CACHE, disk_cache_bytes, enable_cache_debug_info, disk_cache_mismatch, use_packed_store);
 
         if (!read_only)
         {
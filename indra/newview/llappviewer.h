@@ -294,6 +294,7 @@ class LLAppViewer : public LLApp
     static LLTextureFetch* sTextureFetch;
     static LLPurgeDiskCacheThread* sPurgeDiskCacheThread;
     LL::ThreadPool* mGeneralThreadPool;
+    LL::ThreadPool* mParallelThreadPool;
 
     S32 mNumSessions;
 
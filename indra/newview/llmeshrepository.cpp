@@ -46,6 +46,7 @@
 #include "llsdserialize.h"
 #include "llthread.h"
 #include "llfilesystem.h"
+#include "threadpool.h"
 #include "llviewercontrol.h"
 #include "llviewerinventory.h"
 #include "llviewermenufile.h"
@@ -77,8 +78,6 @@
 #include "llviewernetwork.h"
 
 #include <boost/smart_ptr/make_shared.hpp>
-#include <boost/iostreams/device/array.hpp>
-#include <boost/iostreams/stream.hpp>
 
 #ifndef LL_WINDOWS
 #include "netdb.h"
@@ -221,10 +220,14 @@
 //     sHTTPErrorCount                 "
 //     sLODPending                     mMeshMutex [4]  rw.main.mMeshMutex
 //     sLODProcessing                  Repo::mMutex    rw.any.Repo::mMutex
-//     sCacheBytesRead                 none            rw.repo.none, ro.main.none [1]
+//     sCacheBytesRead                 atomic          rw.any.none, ro.main.none
 //     sCacheBytesWritten              "
 //     sCacheReads                     "
 //     sCacheWrites                    "
+//     sDecodePending                  Repo::mMutex    rw.any.Repo::mMutex, ro.main.none [1]
+//     sDecodeCount                    "
+//     sDecodeWaitTotal                "
+//     sDecodeWaitMax                  "
 //     mLoadingMeshes                  mMeshMutex [4]  rw.main.none, rw.any.mMeshMutex
 //     mSkinMap                        none            rw.main.none
 //     mDecompositionMap               none            rw.main.none
@@ -359,6 +362,8 @@ const long LARGE_MESH_XFER_TIMEOUT = 600L;              // Seconds to complete x
 const U32 DOWNLOAD_RETRY_LIMIT = 8;
 const F32 DOWNLOAD_RETRY_DELAY = 0.5f; // seconds
 
+const size_t MESH_DECODE_THREADS = 2;                   // Default "MeshDecode" pool width
+
 // Would normally like to retry on uploads as some
 // retryable failures would be recoverable.  Unfortunately,
 // the mesh service is using 500 (retryable) rather than
@@ -386,14 +391,18 @@ U32 LLMeshRepository::sHTTPErrorCount = 0;
 U32 LLMeshRepository::sLODProcessing = 0;
 U32 LLMeshRepository::sLODPending = 0;
 
-U32 LLMeshRepository::sCacheBytesRead = 0;
-U32 LLMeshRepository::sCacheBytesWritten = 0;
+std::atomic<U32> LLMeshRepository::sCacheBytesRead(0);
+std::atomic<U32> LLMeshRepository::sCacheBytesWritten(0);
 U32 LLMeshRepository::sCacheBytesHeaders = 0;
 U32 LLMeshRepository::sCacheBytesSkins = 0;
 U32 LLMeshRepository::sCacheBytesDecomps = 0;
-U32 LLMeshRepository::sCacheReads = 0;
-U32 LLMeshRepository::sCacheWrites = 0;
+std::atomic<U32> LLMeshRepository::sCacheReads(0);
+std::atomic<U32> LLMeshRepository::sCacheWrites(0);
 U32 LLMeshRepository::sMaxLockHoldoffs = 0;
+U32 LLMeshRepository::sDecodePending = 0;
+U32 LLMeshRepository::sDecodeCount = 0;
+F64 LLMeshRepository::sDecodeWaitTotal = 0.0;
+F64 LLMeshRepository::sDecodeWaitMax = 0.0;
 
 LLDeadmanTimer LLMeshRepository::sQuiescentTimer(15.0, false);  // true -> gather cpu metrics
 
@@ -446,6 +455,14 @@ void on_new_single_inventory_upload_complete(
     S32 upload_price);
 
 
+// Unpacked LODs are cached under an id derived from the mesh id, the LOD
+// and the sculpt flags that change the unpacked geometry
+LLUUID get_decoded_cache_id(const LLVolumeParams& mesh_params, S32 lod)
+{
+    U8 flags = mesh_params.getSculptType() & (LL_SCULPT_FLAG_MIRROR | LL_SCULPT_FLAG_INVERT);
+    return mesh_params.getSculptID().combine(LLUUID::generateNewID(llformat("decoded mesh lod %d flags %d", lod, flags)));
+}
+
 //get the number of bytes resident in memory for given volume
 U32 get_volume_memory_size(const LLVolume* volume)
 {
@@ -598,7 +615,8 @@ class LLMeshHandlerBase : public LLCore::HttpHandler,
 
 public:
     virtual void onCompleted(LLCore::HttpHandle handle, LLCore::HttpResponse * response);
-    virtual void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) = 0;
+    // owner keeps data valid for as long as it is held
+    virtual void processData(const std::shared_ptr<const void> & owner, U8 * data, S32 data_size) = 0;
     virtual void processFailure(LLCore::HttpStatus status) = 0;
 
 public:
@@ -628,7 +646,7 @@ class LLMeshHeaderHandler : public LLMeshHandlerBase
     LLMeshHeaderHandler(const LLMeshHeaderHandler &) = delete;              // Not defined
     LLMeshHeaderHandler& operator=(const LLMeshHeaderHandler &) = delete;   // Not defined
 
-    void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) override;
+    void processData(const std::shared_ptr<const void> & owner, U8 * data, S32 data_size) override;
     void processFailure(LLCore::HttpStatus status) override;
 };
 
@@ -652,7 +670,7 @@ class LLMeshLODHandler : public LLMeshHandlerBase
     LLMeshLODHandler(const LLMeshLODHandler &) = delete;                    // Not defined
     LLMeshLODHandler& operator=(const LLMeshLODHandler &) = delete;         // Not defined
 
-    void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) override;
+    void processData(const std::shared_ptr<const void> & owner, U8 * data, S32 data_size) override;
     void processFailure(LLCore::HttpStatus status) override;
 
 public:
@@ -676,7 +694,7 @@ class LLMeshSkinInfoHandler : public LLMeshHandlerBase
     LLMeshSkinInfoHandler(const LLMeshSkinInfoHandler &) = delete;              // Not defined
     LLMeshSkinInfoHandler& operator=(const LLMeshSkinInfoHandler &) = delete;   // Not defined
 
-    void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) override;
+    void processData(const std::shared_ptr<const void> & owner, U8 * data, S32 data_size) override;
     void processFailure(LLCore::HttpStatus status) override;
 
 public:
@@ -700,7 +718,7 @@ class LLMeshDecompositionHandler : public LLMeshHandlerBase
     LLMeshDecompositionHandler(const LLMeshDecompositionHandler &) = delete;            // Not defined
     LLMeshDecompositionHandler& operator=(const LLMeshDecompositionHandler &) = delete; // Not defined
 
-    void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) override;
+    void processData(const std::shared_ptr<const void> & owner, U8 * data, S32 data_size) override;
     void processFailure(LLCore::HttpStatus status) override;
 
 public:
@@ -724,7 +742,7 @@ class LLMeshPhysicsShapeHandler : public LLMeshHandlerBase
     LLMeshPhysicsShapeHandler(const LLMeshPhysicsShapeHandler &) = delete;              // Not defined
     LLMeshPhysicsShapeHandler operator=(const LLMeshPhysicsShapeHandler &) = delete;    // Not defined
 
-    void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) override;
+    void processData(const std::shared_ptr<const void> & owner, U8 * data, S32 data_size) override;
     void processFailure(LLCore::HttpStatus status) override;
 
 public:
@@ -822,7 +840,8 @@ LLMeshRepoThread::LLMeshRepoThread()
   mHttpPolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
   mHttpLegacyPolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
   mHttpLargePolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
-  mLegacyGetMeshVersion(0)
+  mLegacyGetMeshVersion(0),
+  mUseDecodedCache(false)
 {
     LLAppCoreHttp & app_core_http(LLAppViewer::instance()->getAppCoreHttp());
 
@@ -841,6 +860,15 @@ LLMeshRepoThread::LLMeshRepoThread()
     mHttpPolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_MESH2);
     mHttpLegacyPolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_MESH1);
     mHttpLargePolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_LARGE_MESH);
+    mUseDecodedCache = gSavedSettings.getBOOL("MeshDecodedCache");
+
+    // A couple of threads keep up with fetching; ThreadPoolSizes can
+    // widen the pool or set it to 0 to decode on this thread.
+    if (LL::ThreadPool::getConfiguredWidth("MeshDecode", MESH_DECODE_THREADS) > 0)
+    {
+        mDecodePool.reset(new LL::ThreadPool("MeshDecode", MESH_DECODE_THREADS));
+        mDecodePool->start();
+    }
 }
 
 
@@ -854,6 +882,13 @@ LLMeshRepoThread::~LLMeshRepoThread()
     mHttpRequestSet.clear();
     mHttpHeaders.reset();
 
+    // Decodes still running push into the queues below
+    if (mDecodePool)
+    {
+        mDecodePool->close();
+        mDecodePool.reset();
+    }
+
     delete_and_clear(mSkinInfoQ);
 
     mDecompositionQ.clear();
@@ -1317,22 +1352,59 @@ LLCore::HttpHandle LLMeshRepoThread::getByteRange(const std::string & url, int l
     return handle;
 }
 
-bool LLMeshRepoThread::loadInfoFromFilesystem(const LLUUID& mesh_id, MeshHeaderInfo& info, boost::function<bool(const LLUUID&, U8*, S32)> fn)
+void LLMeshRepoThread::decodeMeshData(std::shared_ptr<const void> owner, const U8* data, S32 data_size,
+                                      decode_fn_t decode, decoded_fn_t decoded)
+{
+    {
+        LLMutexLock lock(mMutex);
+        ++LLMeshRepository::sDecodePending;
+    }
+
+    F64 queued = LLTimer::getTotalSeconds();
+    auto task = [this, owner, data, data_size, decode, decoded, queued]()
+        {
+            LL_PROFILE_ZONE_NAMED_CATEGORY_NETWORK("mesh decode");
+            F64 wait = LLTimer::getTotalSeconds() - queued;
+            {
+                LLMutexLock lock(mMutex);
+                --LLMeshRepository::sDecodePending;
+                ++LLMeshRepository::sDecodeCount;
+                LLMeshRepository::sDecodeWaitTotal += wait;
+                LLMeshRepository::sDecodeWaitMax = llmax(LLMeshRepository::sDecodeWaitMax, wait);
+            }
+
+            EMeshProcessingResult result = decode(data, data_size);
+            if (decoded)
+            {
+                decoded(result);
+            }
+        };
+
+    // The pool closes itself when the viewer starts quitting, after which
+    // whatever is still arriving decodes here.
+    if (!mDecodePool || !mDecodePool->getQueue().post(task))
+    {
+        task();
+    }
+}
+
+bool LLMeshRepoThread::loadInfoFromFilesystem(const LLUUID& mesh_id, MeshHeaderInfo& info, decode_fn_t fn, std::function<void()> refetch)
 {
     //check cache for mesh skin info
     LLFileSystem file(mesh_id, LLAssetType::AT_MESH);
     if (file.getSize() >= info.mOffset + info.mSize)
     {
-        auto buffer = std::make_unique<U8[]>(info.mSize);
-        if (!buffer)
-        {
-            LL_WARNS_ONCE(LOG_MESH) << "Failed to allocate memory for mesh data load, size: " << info.mSize << LL_ENDL;
-            return false;
-        }
         LLMeshRepository::sCacheBytesRead += info.mSize;
         ++LLMeshRepository::sCacheReads;
         file.seek(info.mOffset);
-        file.read(buffer.get(), info.mSize);
+
+        // parse straight out of the cache, no copy when it is mapped
+        auto view = std::make_shared<LLMappedFileView>(file.mapView(info.mSize));
+        if (view->getSize() != info.mSize)
+        {
+            return false;
+        }
+        const U8* buffer = view->getData();
 
         //make sure buffer isn't all 0's by checking the first 1KB (reserved block but not written)
         bool zero = true;
@@ -1343,15 +1415,81 @@ bool LLMeshRepoThread::loadInfoFromFilesystem(const LLUUID& mesh_id, MeshHeaderI
 
         if (!zero)
         { //attempt to parse
-            if (fn(mesh_id, buffer.get(), info.mSize) == MESH_OK)
-            {
-                return true;
-            }
+            S32 offset = info.mOffset;
+            S32 size = info.mSize;
+            decodeMeshData(view, buffer, size, fn,
+                [mesh_id, offset, size, refetch](EMeshProcessingResult result)
+                {
+                    if (result != MESH_OK)
+                    {
+                        // Zero the start of the block, as if never written, so
+                        // that the next fetch skips the cache and rewrites it.
+                        LL_WARNS(LOG_MESH) << "Cached mesh data failed to parse.  ID:  " << mesh_id
+                                           << ", Reason: " << result << ".  Fetching from sim." << LL_ENDL;
+                        std::vector<U8> zeros(llmin(size, S32(1024)), 0);
+                        LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
+                        if (file.getSize() >= offset + size)
+                        {
+                            file.seek(offset);
+                            file.write(zeros.data(), (S32)zeros.size());
+                        }
+                        refetch();
+                    }
+                });
+            return true;
         }
     }
     return false;
 }
 
+bool LLMeshRepoThread::loadDecodedFromFilesystem(const LLVolumeParams& mesh_params, S32 lod)
+{
+    const LLUUID cache_id = get_decoded_cache_id(mesh_params, lod);
+    LLFileSystem file(cache_id, LLAssetType::AT_MESH);
+    S32 size = file.getSize();
+    if (size < 4)
+    {
+        return false;
+    }
+
+    auto view = std::make_shared<LLMappedFileView>(file.mapView(size));
+    if (view->getSize() != size)
+    {
+        return false;
+    }
+
+    //a cleared entry starts with 0's, as with the mesh asset
+    const U8* buffer = view->getData();
+    if (!buffer[0] && !buffer[1] && !buffer[2] && !buffer[3])
+    {
+        return false;
+    }
+
+    LLMeshRepository::sCacheBytesRead += size;
+    ++LLMeshRepository::sCacheReads;
+
+    decodeMeshData(view, buffer, size,
+        [this, mesh_params, lod](const U8* data, S32 data_size) { return decodedLodReceived(mesh_params, lod, data, data_size); },
+        [this, mesh_params, lod, cache_id](EMeshProcessingResult result)
+        {
+            if (result != MESH_OK)
+            {
+                // Likely written by another version.  Clear it so that the
+                // mesh asset is used, which saves it again in this format.
+                LL_DEBUGS(LOG_MESH) << "Cached unpacked LOD " << lod << " of mesh " << mesh_params.getSculptID()
+                                    << " did not load, reason: " << result << LL_ENDL;
+                LLFileSystem file(cache_id, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
+                const U8 zeros[4] = { 0, 0, 0, 0 };
+                file.write(zeros, sizeof(zeros));
+
+                LLMutexLock lock(mMutex);
+                mLODReqQ.emplace(mesh_params, lod);
+                ++LLMeshRepository::sLODProcessing;
+            }
+        });
+    return true;
+}
+
 bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
 {
     MeshHeaderInfo info;
@@ -1383,7 +1521,9 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
     if (info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
     {
         //check cache for mesh skin info
-        if (loadInfoFromFilesystem(mesh_id, info, boost::bind(&LLMeshRepoThread::skinInfoReceived, this, _1, _2, _3)))
+        if (loadInfoFromFilesystem(mesh_id, info,
+                                   [this, mesh_id](const U8* data, S32 size) { return skinInfoReceived(mesh_id, data, size); },
+                                   [this, mesh_id]() { LLMutexLock lock(mMutex); mSkinReqQ.emplace(mesh_id); }))
             return true;
 
         //reading from cache failed for whatever reason, fetch from sim
@@ -1461,7 +1601,9 @@ bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id)
     if (info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
     {
         //check cache for mesh physics info
-        if (loadInfoFromFilesystem(mesh_id, info, boost::bind(&LLMeshRepoThread::decompositionReceived, this, _1, _2, _3)))
+        if (loadInfoFromFilesystem(mesh_id, info,
+                                   [this, mesh_id](const U8* data, S32 size) { return decompositionReceived(mesh_id, data, size); },
+                                   [this, mesh_id]() { LLMutexLock lock(mMutex); mDecompositionRequests.emplace(mesh_id); }))
             return true;
 
         //reading from cache failed for whatever reason, fetch from sim
@@ -1523,7 +1665,9 @@ bool LLMeshRepoThread::fetchMeshPhysicsShape(const LLUUID& mesh_id)
 
     if (info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
     {
-        if (loadInfoFromFilesystem(mesh_id, info, boost::bind(&LLMeshRepoThread::physicsShapeReceived, this, _1, _2, _3)))
+        if (loadInfoFromFilesystem(mesh_id, info,
+                                   [this, mesh_id](const U8* data, S32 size) { return physicsShapeReceived(mesh_id, data, size); },
+                                   [this, mesh_id]() { LLMutexLock lock(mMutex); mPhysicsShapeRequests.emplace(mesh_id); }))
             return true;
 
         //reading from cache failed for whatever reason, fetch from sim
@@ -1599,12 +1743,11 @@ bool LLMeshRepoThread::fetchMeshHeader(const LLVolumeParams& mesh_params, bool c
         if (size > 0)
         {
             // *NOTE:  if the header size is ever more than 4KB, this will break
-            U8 buffer[MESH_HEADER_SIZE];
             S32 bytes = llmin(size, MESH_HEADER_SIZE);
             LLMeshRepository::sCacheBytesRead += bytes;
             ++LLMeshRepository::sCacheReads;
-            file.read(buffer, bytes);
-            if (headerReceived(mesh_params, buffer, bytes) == MESH_OK)
+            LLMappedFileView view = file.mapView(bytes);
+            if (view.isValid() && headerReceived(mesh_params, view.getData(), view.getSize()) == MESH_OK)
             {
 #ifdef SHOW_DEBUG
                 std::string mid;
@@ -1687,7 +1830,17 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 
     if(info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
     {
-        if (loadInfoFromFilesystem(mesh_id, info, boost::bind(&LLMeshRepoThread::lodReceived, this, mesh_params, lod, _2, _3 )))
+        if (mUseDecodedCache && loadDecodedFromFilesystem(mesh_params, lod))
+            return true;
+
+        if (loadInfoFromFilesystem(mesh_id, info,
+                                   [this, mesh_params, lod](const U8* data, S32 size) { return lodReceived(mesh_params, lod, data, size); },
+                                   [this, mesh_params, lod]()
+                                   {
+                                       LLMutexLock lock(mMutex);
+                                       mLODReqQ.emplace(mesh_params, lod);
+                                       ++LLMeshRepository::sLODProcessing;
+                                   }))
             return true;
 
         //reading from cache failed for whatever reason, fetch from sim
@@ -1736,7 +1889,7 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
     return true;
 }
 
-EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size)
+EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, const U8* data, S32 data_size)
 {
     const LLUUID& mesh_id = mesh_params.getSculptID();
     LLSD header_data;
@@ -1751,9 +1904,9 @@ EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mes
 
         data_size = dsize;
 
-        boost::iostreams::stream<boost::iostreams::array_source> stream(result_ptr, data_size);
+        LLSDBinaryBufferParser parser((const U8*)result_ptr, data_size);
 
-        if (!LLSDSerialize::fromBinary(header_data, stream, data_size))
+        if (parser.parse(header_data) <= 0)
         {
             LL_WARNS(LOG_MESH) << "Mesh header parse error.  Not a valid mesh asset!  ID:  " << mesh_id
                                << LL_ENDL;
@@ -1776,7 +1929,7 @@ EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mes
         // make sure there is at least one lod, function returns -1 and marks as 404 otherwise
         else if (LLMeshRepository::getActualMeshLOD(header, 0) >= 0)
         {
-            header_size += stream.tellg();
+            header_size += parser.getBytesRead();
         }
     }
     else
@@ -1813,7 +1966,7 @@ EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mes
     return MESH_OK;
 }
 
-EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size)
+EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, const U8* data, S32 data_size)
 {
     if (data == NULL || data_size == 0)
     {
@@ -1825,6 +1978,19 @@ EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_p
     {
         if (volume->getNumFaces() > 0)
         {
+            if (mUseDecodedCache)
+            {
+                // save the unpacked faces, so the next load is a copy
+                std::vector<U8> decoded;
+                volume->packDecodedFaces(decoded);
+                LLFileSystem file(get_decoded_cache_id(mesh_params, lod), LLAssetType::AT_MESH, LLFileSystem::WRITE);
+                if (file.write(decoded.data(), (S32)decoded.size()))
+                {
+                    LLMeshRepository::sCacheBytesWritten += (U32)decoded.size();
+                    ++LLMeshRepository::sCacheWrites;
+                }
+            }
+
             LoadedMesh mesh(volume, mesh_params, lod);
             {
                 LLMutexLock lock(mMutex);
@@ -1843,7 +2009,26 @@ EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_p
     return MESH_UNKNOWN;
 }
 
-EMeshProcessingResult LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
+EMeshProcessingResult LLMeshRepoThread::decodedLodReceived(const LLVolumeParams& mesh_params, S32 lod, const U8* data, S32 data_size)
+{
+    LLPointer<LLVolume> volume = new LLVolume(mesh_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
+    if (!volume->unpackDecodedFaces(data, data_size))
+    {
+        return MESH_PARSE_FAILURE;
+    }
+
+    LoadedMesh mesh(volume, mesh_params, lod);
+    {
+        LLMutexLock lock(mMutex);
+        mLoadedQ.push_back(mesh);
+        // see lodReceived
+        volume = NULL;
+        mesh.mVolume = NULL;
+    }
+    return MESH_OK;
+}
+
+EMeshProcessingResult LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, const U8* data, S32 data_size)
 {
     if (data == NULL || data_size == 0)
     {
@@ -1890,7 +2075,7 @@ EMeshProcessingResult LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id,
     return MESH_OK;
 }
 
-EMeshProcessingResult LLMeshRepoThread::decompositionReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
+EMeshProcessingResult LLMeshRepoThread::decompositionReceived(const LLUUID& mesh_id, const U8* data, S32 data_size)
 {
     if (data == NULL || data_size == 0)
     {
@@ -1927,7 +2112,7 @@ EMeshProcessingResult LLMeshRepoThread::decompositionReceived(const LLUUID& mesh
     return MESH_OK;
 }
 
-EMeshProcessingResult LLMeshRepoThread::physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
+EMeshProcessingResult LLMeshRepoThread::physicsShapeReceived(const LLUUID& mesh_id, const U8* data, S32 data_size)
 {
     if (data == NULL || data_size == 0)
     {
@@ -2981,6 +3166,8 @@ void LLMeshHandlerBase::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespo
         LLCore::BufferArray * body(response->getBody());
         S32 body_offset(0);
         U8 * data(NULL);
+        U8 * data_copy(NULL);
+        std::shared_ptr<const void> owner;
         S32 data_size(body ? body->size() : 0);
 
         if (data_size > 0)
@@ -3033,14 +3220,22 @@ void LLMeshHandlerBase::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespo
                 goto common_exit;
             }
 
-            // *TODO: Try to get rid of data copying and add interfaces
-            // that support BufferArray directly.  Introduce a two-phase
-            // handler, optional first that takes a body, fallback second
-            // that requires a temporary allocation and data copy.
+            // Bodies of known length arrive in a single block, which
+            // the handlers can read in place for as long as they hold
+            // the body.  Others need an allocation and data copy.
             body_offset = mOffset - offset;
-            data = new(std::nothrow) U8[data_size - body_offset];
+            data = static_cast<U8 *>(body->contiguousData());
             if (data)
             {
+                data += body_offset;
+                body->addRef();
+                owner.reset(body, [](LLCore::BufferArray * held) { held->release(); });
+                LLMeshRepository::sBytesReceived += data_size;
+            }
+            else if ((data_copy = new(std::nothrow) U8[data_size - body_offset]))
+            {
+                data = data_copy;
+                owner.reset(data_copy, std::default_delete<U8[]>());
                 body->read(body_offset, (char *) data, data_size - body_offset);
                 LLMeshRepository::sBytesReceived += data_size;
             }
@@ -3051,9 +3246,7 @@ void LLMeshHandlerBase::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespo
             }
         }
 
-        processData(body, body_offset, data, data_size - body_offset);
-
-        delete [] data;
+        processData(owner, data, data_size - body_offset);
     }
 
     // Release handler
@@ -3093,7 +3286,7 @@ void LLMeshHeaderHandler::processFailure(LLCore::HttpStatus status)
     }
 }
 
-void LLMeshHeaderHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
+void LLMeshHeaderHandler::processData(const std::shared_ptr<const void> & /* owner */,
                                       U8 * data, S32 data_size)
 {
     const LLUUID& mesh_id = mMeshParams.getSculptID();
@@ -3229,42 +3422,50 @@ void LLMeshLODHandler::processFailure(LLCore::HttpStatus status)
     gMeshRepo.mThread->mUnavailableQ.emplace_back(mMeshParams, mLOD);
 }
 
-void LLMeshLODHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
+void LLMeshLODHandler::processData(const std::shared_ptr<const void> & owner,
                                    U8 * data, S32 data_size)
 {
     if ((!MESH_LOD_PROCESS_FAILED)
         && ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
     {
-        EMeshProcessingResult result = gMeshRepo.mThread->lodReceived(mMeshParams, mLOD, data, data_size);
-        if (result == MESH_OK)
-        {
-            // good fetch from sim, write to cache
-            // <FS:Ansariel> Fix asset caching
-            //LLFileSystem file(mMeshParams.getSculptID(), LLAssetType::AT_MESH, LLFileSystem::WRITE);
-            LLFileSystem file(mMeshParams.getSculptID(), LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
-            S32 offset = mOffset;
-            S32 size = mRequestedBytes;
-
-            if (file.getSize() >= offset+size)
+        LLVolumeParams mesh_params = mMeshParams;
+        S32 lod = mLOD;
+        S32 offset = mOffset;
+        S32 size = mRequestedBytes;
+        gMeshRepo.mThread->decodeMeshData(owner, data, data_size,
+            [mesh_params, lod](const U8* data, S32 data_size)
             {
-                file.seek(offset);
-                file.write(data, size);
-                LLMeshRepository::sCacheBytesWritten += size;
-                ++LLMeshRepository::sCacheWrites;
-            }
-        }
-        else
-        {
-            LL_WARNS(LOG_MESH) << "Error during mesh LOD processing.  ID:  " << mMeshParams.getSculptID()
-                               << ", Reason: " << result
-                               << " LOD: " << mLOD
-                               << " Data size: " << data_size
-                               << " Not retrying."
-                               << LL_ENDL;
-            LLMutexLock lock(gMeshRepo.mThread->mMutex);
-            gMeshRepo.mThread->mUnavailableQ.emplace_back(mMeshParams, mLOD);
-        }
+                return gMeshRepo.mThread->lodReceived(mesh_params, lod, data, data_size);
+            },
+            [mesh_params, lod, offset, size, data, data_size](EMeshProcessingResult result)
+            {
+                if (result == MESH_OK)
+                {
+                    // good fetch from sim, write to cache
+                    // <FS:Ansariel> Fix asset caching
+                    //LLFileSystem file(mesh_params.getSculptID(), LLAssetType::AT_MESH, LLFileSystem::WRITE);
+                    LLFileSystem file(mesh_params.getSculptID(), LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
+
+                    if (file.getSize() >= offset+size)
+                    {
+                        file.seek(offset);
+                        file.write(data, size);
+                        LLMeshRepository::sCacheBytesWritten += size;
+                        ++LLMeshRepository::sCacheWrites;
+                    }
+                }
+                else
+                {
+                    LL_WARNS(LOG_MESH) << "Error during mesh LOD processing.  ID:  " << mesh_params.getSculptID()
+                                       << ", Reason: " << result
+                                       << " LOD: " << lod
+                                       << " Data size: " << data_size
+                                       << " Not retrying."
+                                       << LL_ENDL;
+                    LLMutexLock lock(gMeshRepo.mThread->mMutex);
+                    gMeshRepo.mThread->mUnavailableQ.emplace_back(mesh_params, lod);
+                }
+            });
     }
     else
     {
@@ -3296,28 +3497,46 @@ void LLMeshSkinInfoHandler::processFailure(LLCore::HttpStatus status)
         gMeshRepo.mThread->mSkinUnavailableQ.emplace_back(mMeshID);
 }
 
-void LLMeshSkinInfoHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
+void LLMeshSkinInfoHandler::processData(const std::shared_ptr<const void> & owner,
                                         U8 * data, S32 data_size)
 {
     if ((!MESH_SKIN_INFO_PROCESS_FAILED)
-        && ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-        && gMeshRepo.mThread->skinInfoReceived(mMeshID, data, data_size) == MESH_OK)
+        && ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
     {
-        // good fetch from sim, write to cache
-        // <FS:Ansariel> Fix asset caching
-        //LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::WRITE);
-        LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
+        LLUUID mesh_id = mMeshID;
         S32 offset = mOffset;
         S32 size = mRequestedBytes;
+        gMeshRepo.mThread->decodeMeshData(owner, data, data_size,
+            [mesh_id](const U8* data, S32 data_size)
+            {
+                return gMeshRepo.mThread->skinInfoReceived(mesh_id, data, data_size);
+            },
+            [mesh_id, offset, size, data](EMeshProcessingResult result)
+            {
+                if (result == MESH_OK)
+                {
+                    // good fetch from sim, write to cache
+                    // <FS:Ansariel> Fix asset caching
+                    //LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::WRITE);
+                    LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
 
-        if (file.getSize() >= offset+size)
-        {
-            LLMeshRepository::sCacheBytesWritten += size;
-            ++LLMeshRepository::sCacheWrites;
-            file.seek(offset);
-            file.write(data, size);
-        }
+                    if (file.getSize() >= offset+size)
+                    {
+                        LLMeshRepository::sCacheBytesWritten += size;
+                        ++LLMeshRepository::sCacheWrites;
+                        file.seek(offset);
+                        file.write(data, size);
+                    }
+                }
+                else
+                {
+                    LL_WARNS(LOG_MESH) << "Error during mesh skin info processing.  ID:  " << mesh_id
+                                       << ", Reason: " << result << ".  Not retrying."
+                                       << LL_ENDL;
+                    LLMutexLock lock(gMeshRepo.mThread->mMutex);
+                    gMeshRepo.mThread->mSkinUnavailableQ.emplace_back(mesh_id);
+                }
+            });
     }
     else
     {
@@ -3347,28 +3566,44 @@ void LLMeshDecompositionHandler::processFailure(LLCore::HttpStatus status)
     // request unfulfilled rather than retry forever.
 }
 
-void LLMeshDecompositionHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
+void LLMeshDecompositionHandler::processData(const std::shared_ptr<const void> & owner,
                                              U8 * data, S32 data_size)
 {
     if ((!MESH_DECOMP_PROCESS_FAILED)
-        && ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-        && gMeshRepo.mThread->decompositionReceived(mMeshID, data, data_size) == MESH_OK)
+        && ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
     {
-        // good fetch from sim, write to cache
-        // <FS:Ansariel> Fix asset caching
-        //LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::WRITE);
-        LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
+        LLUUID mesh_id = mMeshID;
         S32 offset = mOffset;
         S32 size = mRequestedBytes;
+        gMeshRepo.mThread->decodeMeshData(owner, data, data_size,
+            [mesh_id](const U8* data, S32 data_size)
+            {
+                return gMeshRepo.mThread->decompositionReceived(mesh_id, data, data_size);
+            },
+            [mesh_id, offset, size, data](EMeshProcessingResult result)
+            {
+                if (result == MESH_OK)
+                {
+                    // good fetch from sim, write to cache
+                    // <FS:Ansariel> Fix asset caching
+                    //LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::WRITE);
+                    LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
 
-        if (file.getSize() >= offset+size)
-        {
-            LLMeshRepository::sCacheBytesWritten += size;
-            ++LLMeshRepository::sCacheWrites;
-            file.seek(offset);
-            file.write(data, size);
-        }
+                    if (file.getSize() >= offset+size)
+                    {
+                        LLMeshRepository::sCacheBytesWritten += size;
+                        ++LLMeshRepository::sCacheWrites;
+                        file.seek(offset);
+                        file.write(data, size);
+                    }
+                }
+                else
+                {
+                    LL_WARNS(LOG_MESH) << "Error during mesh decomposition processing.  ID:  " << mesh_id
+                                       << ", Reason: " << result << ".  Not retrying."
+                                       << LL_ENDL;
+                }
+            });
     }
     else
     {
@@ -3396,28 +3631,44 @@ void LLMeshPhysicsShapeHandler::processFailure(LLCore::HttpStatus status)
     // *TODO:  Mark mesh unavailable on error
 }
 
-void LLMeshPhysicsShapeHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
+void LLMeshPhysicsShapeHandler::processData(const std::shared_ptr<const void> & owner,
                                             U8 * data, S32 data_size)
 {
     if ((!MESH_PHYS_SHAPE_PROCESS_FAILED)
-        && ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-        && gMeshRepo.mThread->physicsShapeReceived(mMeshID, data, data_size) == MESH_OK)
+        && ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
     {
-        // good fetch from sim, write to cache for caching
-        // <FS:Ansariel> Fix asset caching
-        //LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::WRITE);
-        LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
+        LLUUID mesh_id = mMeshID;
         S32 offset = mOffset;
         S32 size = mRequestedBytes;
+        gMeshRepo.mThread->decodeMeshData(owner, data, data_size,
+            [mesh_id](const U8* data, S32 data_size)
+            {
+                return gMeshRepo.mThread->physicsShapeReceived(mesh_id, data, data_size);
+            },
+            [mesh_id, offset, size, data](EMeshProcessingResult result)
+            {
+                if (result == MESH_OK)
+                {
+                    // good fetch from sim, write to cache for caching
+                    // <FS:Ansariel> Fix asset caching
+                    //LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::WRITE);
+                    LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
 
-        if (file.getSize() >= offset+size)
-        {
-            LLMeshRepository::sCacheBytesWritten += size;
-            ++LLMeshRepository::sCacheWrites;
-            file.seek(offset);
-            file.write(data, size);
-        }
+                    if (file.getSize() >= offset+size)
+                    {
+                        LLMeshRepository::sCacheBytesWritten += size;
+                        ++LLMeshRepository::sCacheWrites;
+                        file.seek(offset);
+                        file.write(data, size);
+                    }
+                }
+                else
+                {
+                    LL_WARNS(LOG_MESH) << "Error during mesh physics shape processing.  ID:  " << mesh_id
+                                       << ", Reason: " << result << ".  Not retrying."
+                                       << LL_ENDL;
+                }
+            });
     }
     else
     {
@@ -3679,6 +3930,7 @@ void LLMeshRepository::notifyLoadedMeshes()
     {
         LLAppCoreHttp & app_core_http(LLAppViewer::instance()->getAppCoreHttp());
         S32 scale(app_core_http.isPipelined(LLAppCoreHttp::AP_MESH2)
+                  || app_core_http.isMultiplexed(LLAppCoreHttp::AP_MESH2)
                   ? (2 * LLAppCoreHttp::PIPELINING_DEPTH)
                   : 5);
 
@@ -5394,6 +5646,9 @@ void LLMeshRepository::metricsUpdate()
         metrics["teleports"] = LLSD::Integer(metrics_teleport_start_count);
         metrics["user_cpu"] = double(user_cpu) / 1.0e6;
         metrics["sys_cpu"] = double(sys_cpu) / 1.0e6;
+        metrics["decodes"] = LLSD::Integer(sDecodeCount);
+        metrics["decode_wait_avg"] = sDecodeCount ? sDecodeWaitTotal / sDecodeCount : 0.0;
+        metrics["decode_wait_max"] = sDecodeWaitMax;
         LL_INFOS(LOG_MESH) << "EventMarker " << metrics << LL_ENDL;
     }
 }
@@ -27,6 +27,7 @@
 #ifndef LL_MESH_REPOSITORY_H
 #define LL_MESH_REPOSITORY_H
 
+#include <atomic>
 #include <unordered_map>
 #include "llassettype.h"
 #include "llmodel.h"
@@ -40,6 +41,7 @@
 #include "httpheaders.h"
 #include "httphandler.h"
 #include "llthread.h"
+#include "threadpool_fwd.h"
 
 #include "boost/unordered/unordered_map.hpp"
 #include "boost/unordered/unordered_flat_map.hpp"
@@ -416,6 +418,14 @@ class LLMeshRepoThread final : public LLThread
     int mLegacyGetMeshVersion;
     std::string mGetMeshCapability;
 
+    // Inflates and parses received LOD, skin, decomposition and physics
+    // payloads off this thread.  NULL when "MeshDecode" is sized to no
+    // threads in ThreadPoolSizes, in which case payloads decode inline.
+    std::unique_ptr<LL::ThreadPool> mDecodePool;
+
+    // Keep unpacked LODs in the disk cache too (MeshDecodedCache)
+    bool mUseDecodedCache;
+
     LLMeshRepoThread();
     ~LLMeshRepoThread();
 
@@ -426,16 +436,35 @@ class LLMeshRepoThread final : public LLThread
 
     bool fetchMeshHeader(const LLVolumeParams& mesh_params, bool can_retry = true);
     bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, bool can_retry = true);
-    EMeshProcessingResult headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size);
-    EMeshProcessingResult lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size);
-    EMeshProcessingResult skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
-    EMeshProcessingResult decompositionReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
-    EMeshProcessingResult physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
+    EMeshProcessingResult headerReceived(const LLVolumeParams& mesh_params, const U8* data, S32 data_size);
+    EMeshProcessingResult lodReceived(const LLVolumeParams& mesh_params, S32 lod, const U8* data, S32 data_size);
+    EMeshProcessingResult decodedLodReceived(const LLVolumeParams& mesh_params, S32 lod, const U8* data, S32 data_size);
+    EMeshProcessingResult skinInfoReceived(const LLUUID& mesh_id, const U8* data, S32 data_size);
+    EMeshProcessingResult decompositionReceived(const LLUUID& mesh_id, const U8* data, S32 data_size);
+    EMeshProcessingResult physicsShapeReceived(const LLUUID& mesh_id, const U8* data, S32 data_size);
     bool hasPhysicsShapeInHeader(const LLUUID& mesh_id);
     bool hasSkinInfoInHeader(const LLUUID& mesh_id);
     bool hasHeader(const LLUUID& mesh_id);
 
-    bool loadInfoFromFilesystem(const LLUUID& mesh_id, MeshHeaderInfo& info, boost::function<bool(const LLUUID&, U8*, S32)> fn);
+    typedef std::function<EMeshProcessingResult(const U8*, S32)> decode_fn_t;
+    typedef std::function<void(EMeshProcessingResult)> decoded_fn_t;
+
+    // Runs decode over the payload on the decode pool, then decoded, if
+    // any, with the result on the same thread.  owner keeps data alive
+    // until then.  Both must be safe to run off the repo thread.
+    //
+    // Mutex:  acquires mMutex
+    void decodeMeshData(std::shared_ptr<const void> owner, const U8* data, S32 data_size,
+                        decode_fn_t decode, decoded_fn_t decoded = decoded_fn_t());
+
+    // Queues the decode of a cached payload and returns true if the cache
+    // holds it.  Should the decode fail, the cached copy is cleared and
+    // refetch is called to request it again, this time from the sim.
+    bool loadInfoFromFilesystem(const LLUUID& mesh_id, MeshHeaderInfo& info, decode_fn_t fn, std::function<void()> refetch);
+
+    // Like loadInfoFromFilesystem for the unpacked LOD saved by
+    // lodReceived.  A failed load clears it and requests the LOD again.
+    bool loadDecodedFromFilesystem(const LLVolumeParams& mesh_params, S32 lod);
 
     void notifyLoadedMeshes(); // Only call from main thread.
     S32 getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
@@ -643,14 +672,18 @@ class LLMeshRepository
     static U32 sHTTPErrorCount;                 // Requests ending in error
     static U32 sLODPending;
     static U32 sLODProcessing;
-    static U32 sCacheBytesRead;
-    static U32 sCacheBytesWritten;
+    static std::atomic<U32> sCacheBytesRead;    // Also counted on mesh decode threads
+    static std::atomic<U32> sCacheBytesWritten;
     static U32 sCacheBytesHeaders;
     static U32 sCacheBytesSkins;
     static U32 sCacheBytesDecomps;
-    static U32 sCacheReads;
-    static U32 sCacheWrites;
+    static std::atomic<U32> sCacheReads;
+    static std::atomic<U32> sCacheWrites;
     static U32 sMaxLockHoldoffs;                // Maximum sequential locking failures
+    static U32 sDecodePending;                  // Payloads queued for or in mesh decode
+    static U32 sDecodeCount;                    // Payloads taken up by mesh decode
+    static F64 sDecodeWaitTotal;                // Seconds payloads waited for a decode thread
+    static F64 sDecodeWaitMax;
 
     static LLDeadmanTimer sQuiescentTimer;      // Time-to-complete-mesh-downloads after significant events
 
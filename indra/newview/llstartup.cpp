@@ -674,6 +674,7 @@ bool idle_startup()
 
             F32 dropPercent = gSavedSettings.getF32("PacketDropPercentage");
             msg->mPacketRing.setDropPercentage(dropPercent);
+            msg->mPacketRing.setUseBatching(gSavedSettings.getBOOL("PacketBatching"));
 
             F32 inBandwidth = gSavedSettings.getF32("InBandwidth");
             F32 outBandwidth = gSavedSettings.getF32("OutBandwidth");
@@ -689,6 +690,11 @@ bool idle_startup()
                 msg->mPacketRing.setUseOutThrottle(TRUE);
                 msg->mPacketRing.setOutBandwidth(outBandwidth);
             }
+
+            if (gSavedSettings.getBOOL("MessageReceiveThread"))
+            {
+                msg->startReceiveThread();
+            }
         }
 
         LL_INFOS("AppInit") << "Message System Initialized." << LL_ENDL;
@@ -41,9 +41,16 @@
 
 // Cache organization:
 // cache/texture.entries
-//  Unordered array of Entry structs
+//  EntriesInfo followed by an unordered array of Entry structs. Memory mapped
+//  while the cache is open and grown in chunks, so it can hold more slots
+//  than EntriesInfo::mEntries says are in use.
 // cache/texture.cache
 //  First TEXTURE_CACHE_ENTRY_SIZE bytes of each texture in texture.entries in same order
+// cache/FastCache.cache
+//  16px raw thumbnail of each texture in texture.entries in same order
+// cache/FastCache64.cache, cache/FastCache256.cache
+//  64px and 256px raws of the textures written last, each entry tagged with
+//  the texture id. Memory mapped like FastCache.cache.
 // cache/textures/[0-F]/UUID.texture
 //  Actual texture body files
 
@@ -54,6 +61,16 @@ const F32 TEXTURE_CACHE_LRU_SIZE = .10f; // % amount for LRU list (low overhead
 const S32 TEXTURE_FAST_CACHE_ENTRY_OVERHEAD = sizeof(S32) * 4; //w, h, c, level
 const S32 TEXTURE_FAST_CACHE_DATA_SIZE = 16 * 16 * 4;
 const S32 TEXTURE_FAST_CACHE_ENTRY_SIZE = TEXTURE_FAST_CACHE_DATA_SIZE + TEXTURE_FAST_CACHE_ENTRY_OVERHEAD;
+const S32 TEXTURE_FAST_CACHE_TIER_ID_OFFSET = TEXTURE_FAST_CACHE_ENTRY_OVERHEAD;
+const S32 TEXTURE_FAST_CACHE_TIER_SERIAL_OFFSET = TEXTURE_FAST_CACHE_TIER_ID_OFFSET + UUID_BYTES;
+const S32 TEXTURE_FAST_CACHE_TIER_OVERHEAD = 48; //w, h, c, level, id, serial, padded
+const S32 TEXTURE_FAST_CACHE_TIERS_PERCENT = 10; // of the cache size, for the 64px and 256px tiers
+// Smallest first, the bigger tiers split TEXTURE_FAST_CACHE_TIERS_PERCENT between them
+const S32 TEXTURE_FAST_CACHE_TIER_DATA_SIZE[] = { TEXTURE_FAST_CACHE_DATA_SIZE, 64 * 64 * 4, 256 * 256 * 4 };
+const S32 TEXTURE_FAST_CACHE_TIER_ENTRY_SIZE[] = { TEXTURE_FAST_CACHE_ENTRY_SIZE,
+                                                   64 * 64 * 4 + TEXTURE_FAST_CACHE_TIER_OVERHEAD,
+                                                   256 * 256 * 4 + TEXTURE_FAST_CACHE_TIER_OVERHEAD };
+const S32 TEXTURE_FAST_CACHE_TIER_PERCENT[] = { 0, 25, 75 };
 const F32 TEXTURE_LAZY_PURGE_TIME_LIMIT = .004f; // 4ms. Would be better to autoadjust, but there is a major cache rework in progress.
 const F32 TEXTURE_PRUNING_MAX_TIME = 15.f;
 
@@ -382,6 +399,14 @@ bool LLTextureCacheRemoteWorker::doRead()
 
     // Second state / stage : identify the cache or not...
     if (!done && (mState == CACHE))
+    {
+        // Written to the cache but not to disk yet
+        if (mCache->readFromPendingWrites(mID, mOffset, mDataSize, mImageSize, mReadData))
+        {
+            done = true;
+        }
+    }
+    if (!done && (mState == CACHE))
     {
         LLTextureCache::Entry entry ;
         idx = mCache->getHeaderCacheEntry(mID, entry);
@@ -798,15 +823,16 @@ LLTextureCache::LLTextureCache(bool threaded)
       mHeaderMutex(),
       mListMutex(),
       mFastCacheMutex(),
-      mHeaderAPRFile(NULL),
+      mPendingWritesMutex(),
+      mPendingWritesSavedBytes(0),
+      mWriteBehind(TRUE),
       mPrioritizeWriteListEmpty(true),
       mCompletedListEmpty(true),
       mReadOnly(TRUE), //do not allow to change the texture cache until setReadOnly() is called.
+      mLRUTime(0),
+      mHeaderEntriesCapacity(0),
       mTexturesSizeTotal(0),
-      mDoPurge(FALSE),
-      mFastCachep(NULL),
-      mFastCachePoolp(NULL),
-      mFastCachePadBuffer(NULL)
+      mDoPurge(FALSE)
 {
     mHeaderAPRFilePoolp = new LLVolatileAPRPool("Texture Cache Pool"); // is_local = true, because this pool is for headers, headers are under own mutex
 }
@@ -814,11 +840,13 @@ LLTextureCache::LLTextureCache(bool threaded)
 LLTextureCache::~LLTextureCache()
 {
     clearDeleteList() ;
-    writeUpdatedEntries() ;
-    delete mFastCachep;
-    delete mFastCachePoolp;
+    flushPendingWrites() ;
+    flushHeaderEntries() ;
+    {
+        LLMutexLock lock(&mFastCacheMutex);
+        closeFastCache();
+    }
     delete mHeaderAPRFilePoolp;
-    ll_aligned_free_16(mFastCachePadBuffer);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -857,12 +885,38 @@ size_t LLTextureCache::update(F32 max_time_ms)
     if(!res && timer.getElapsedTimeF32() > MAX_TIME_INTERVAL)
     {
         timer.reset() ;
-        writeUpdatedEntries() ;
+        flushHeaderEntries() ;
     }
 
     return res;
 }
 
+//virtual (WORKER THREAD)
+void LLTextureCache::threadedUpdate()
+{
+    static const F32 MAX_WRITE_DELAY = 1.f; // seconds
+    static const S32 MAX_PENDING_WRITES = 256;
+
+    {
+        // Reads go first, unless the queue has been waiting for too long
+        LLMutexLock lock(&mPendingWritesMutex);
+        if (mPendingWrites.empty()
+            || (getPending() > 0
+                && mPendingWrites.size() < MAX_PENDING_WRITES
+                && mPendingWritesTimer.getElapsedTimeF32() < MAX_WRITE_DELAY))
+        {
+            return;
+        }
+    }
+    flushPendingWrites();
+}
+
+S32 LLTextureCache::getNumPendingWrites()
+{
+    LLMutexLock lock(&mPendingWritesMutex);
+    return (S32)mPendingWrites.size();
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // search for local copy of UUID-based image file
 std::string LLTextureCache::getLocalFileName(const LLUUID& id)
@@ -884,10 +938,14 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 //debug
 BOOL LLTextureCache::isInCache(const LLUUID& id)
 {
-    LLMutexLock lock(&mHeaderMutex);
-    id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-
-    return (iter != mHeaderIDMap.end()) ;
+    {
+        LLMutexLock lock(&mPendingWritesMutex);
+        if (mPendingWrites.find(id) != mPendingWrites.end())
+        {
+            return TRUE;
+        }
+    }
+    return findHeaderEntry(id) >= 0;
 }
 
 //debug
@@ -949,13 +1007,17 @@ const char* old_textures_dirname = "textures";
 //change the location of the texture cache to prevent from being deleted by old version viewers.
 const char* textures_dirname = "texturecache";
 const char* fast_cache_filename = "FastCache.cache";
+const char* fast_cache_64_filename = "FastCache64.cache";
+const char* fast_cache_256_filename = "FastCache256.cache";
 
 void LLTextureCache::setDirNames(ELLPath location)
 {
     mHeaderEntriesFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, entries_filename);
     mHeaderDataFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, cache_filename);
     mTexturesDirName = gDirUtilp->getExpandedFilename(location, textures_dirname);
-    mFastCacheFileName =  gDirUtilp->getExpandedFilename(location, textures_dirname, fast_cache_filename);
+    mFastCacheTiers[0].mFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, fast_cache_filename);
+    mFastCacheTiers[1].mFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, fast_cache_64_filename);
+    mFastCacheTiers[2].mFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, fast_cache_256_filename);
 }
 
 void LLTextureCache::purgeCache(ELLPath location, bool remove_dir)
@@ -965,7 +1027,6 @@ void LLTextureCache::purgeCache(ELLPath location, bool remove_dir)
     if (!mReadOnly)
     {
         setDirNames(location);
-        llassert_always(mHeaderAPRFile == NULL);
 
         //remove the legacy cache if exists
         std::string texture_dir = mTexturesDirName ;
@@ -1005,6 +1066,8 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
     sCacheMaxEntries = (U32)(llmin((S64)sCacheMaxEntries, max_entries));
     entries_size = (S64)sCacheMaxEntries * (S64)(TEXTURE_CACHE_ENTRY_SIZE + TEXTURE_FAST_CACHE_ENTRY_SIZE);
     max_size -= entries_size;
+    S64 fast_cache_tiers_size = (max_size * TEXTURE_FAST_CACHE_TIERS_PERCENT) / 100;
+    max_size -= fast_cache_tiers_size;
     if (sCacheMaxTexturesSize > 0)
         sCacheMaxTexturesSize = llmin(sCacheMaxTexturesSize, max_size);
     else
@@ -1015,6 +1078,9 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
             << " Textures size: " << sCacheMaxTexturesSize / (1024 * 1024) << " MB" << LL_ENDL;
 
     setDirNames(location);
+    setFastCacheTiers(fast_cache_tiers_size);
+
+    mWriteBehind = gSavedSettings.getBOOL("TextureCacheWriteBehind");
 
     if(texture_cache_mismatch)
     {
@@ -1043,7 +1109,10 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
     purgeTextures(true); // calc mTexturesSize and make some room in the texture cache if we need it
 
     llassert_always(getPending() == 0) ; //should not start accessing the texture cache before initialized.
-    openFastCache(true);
+    {
+        LLMutexLock lock(&mFastCacheMutex);
+        openFastCache();
+    }
 
     return max_size; // unused cache space
 }
@@ -1051,37 +1120,63 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 //----------------------------------------------------------------------------
 // mHeaderMutex must be locked for the following functions!
 
-LLAPRFile* LLTextureCache::openHeaderEntriesFile(bool readonly, S32 offset)
+// Map texture.entries with room for at least min_entries entries. The file
+// grows in chunks so adding entries only rarely needs a remap.
+bool LLTextureCache::mapHeaderEntries(U32 min_entries)
 {
-    llassert_always(mHeaderAPRFile == NULL);
-    apr_int32_t flags = readonly ? APR_READ|APR_BINARY : APR_READ|APR_WRITE|APR_BINARY;
-    mHeaderAPRFile = new LLAPRFile(mHeaderEntriesFileName, flags, mHeaderAPRFilePoolp);
-    if(offset > 0)
+    static const U32 ENTRIES_GROWTH_CHUNK = 4096;
+
+    if (mHeaderEntriesFile.isMapped() && min_entries <= mHeaderEntriesCapacity)
     {
-        mHeaderAPRFile->seek(APR_SET, offset);
+        return true;
     }
-    return mHeaderAPRFile;
-}
 
-void LLTextureCache::closeHeaderEntriesFile()
-{
-    if(!mHeaderAPRFile)
+    // Nobody may be looking at the old mapping while it is replaced
+    lockHeaderIndex();
+    bool success = false;
+    if (mReadOnly)
+    {
+        // a read only cache takes the file as it is
+        success = mHeaderEntriesFile.isMapped() || mHeaderEntriesFile.map(mHeaderEntriesFileName);
+    }
+    else
+    {
+        U32 capacity = llmax(min_entries, llmax(mHeaderEntriesCapacity * 2, ENTRIES_GROWTH_CHUNK));
+        capacity = llmin(capacity, llmax(min_entries, sCacheMaxEntries));
+        success = mHeaderEntriesFile.mapWritable(mHeaderEntriesFileName, sizeof(EntriesInfo) + (size_t)capacity * sizeof(Entry));
+    }
+
+    mHeaderEntriesCapacity = 0;
+    if (success && mHeaderEntriesFile.getSize() >= sizeof(EntriesInfo))
     {
-        return ;
+        mHeaderEntriesCapacity = (U32)((mHeaderEntriesFile.getSize() - sizeof(EntriesInfo)) / sizeof(Entry));
     }
+    unlockHeaderIndex();
 
-    delete mHeaderAPRFile;
-    mHeaderAPRFile = NULL;
+    if (!success)
+    {
+        LL_WARNS("TextureCache") << "Unable to map " << mHeaderEntriesFileName << LL_ENDL;
+        return false;
+    }
+    return min_entries <= mHeaderEntriesCapacity;
+}
+
+void LLTextureCache::unmapHeaderEntries()
+{
+    lockHeaderIndex();
+    mHeaderEntriesFile.unmap();
+    mHeaderEntriesCapacity = 0;
+    unlockHeaderIndex();
 }
 
 void LLTextureCache::readEntriesHeader()
 {
     // mHeaderEntriesInfo initializes to default values so safe not to read it
-    llassert_always(mHeaderAPRFile == NULL);
-    if (LLAPRFile::isExist(mHeaderEntriesFileName, mHeaderAPRFilePoolp))
+    if (LLAPRFile::isExist(mHeaderEntriesFileName, mHeaderAPRFilePoolp)
+        && mapHeaderEntries(0)
+        && mHeaderEntriesFile.getSize() >= sizeof(EntriesInfo))
     {
-        LLAPRFile::readEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-                          mHeaderAPRFilePoolp);
+        memcpy(&mHeaderEntriesInfo, mHeaderEntriesFile.getData(), sizeof(EntriesInfo));
     }
     else //create an empty entries header.
     {
@@ -1109,24 +1204,78 @@ void LLTextureCache::setEntriesHeader()
 
 void LLTextureCache::writeEntriesHeader()
 {
-    llassert_always(mHeaderAPRFile == NULL);
-    if (!mReadOnly)
+    // Lookups never read the header, no need to lock the index for it
+    if (!mReadOnly && LLFile::isdir(mTexturesDirName) && mapHeaderEntries(0))
     {
-        LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-                           mHeaderAPRFilePoolp);
+        memcpy(mHeaderEntriesFile.getWritableData(), &mHeaderEntriesInfo, sizeof(EntriesInfo));
     }
 }
 
-//mHeaderMutex is locked before calling this.
-S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
+//----------------------------------------------------------------------------
+// Header index shards, these lock on their own
+
+LLTextureCache::HeaderIndexShard& LLTextureCache::getHeaderIndexShard(const LLUUID& id)
 {
-    S32 idx = -1;
+    // ids are random, any byte spreads them evenly
+    return mHeaderIndex[id.mData[1] % sHeaderIndexShards];
+}
+
+S32 LLTextureCache::findHeaderEntry(const LLUUID& id)
+{
+    HeaderIndexShard& shard = getHeaderIndexShard(id);
+    LLMutexLock lock(&shard.mMutex);
+    id_map_t::const_iterator iter = shard.mIDMap.find(id);
+    return iter != shard.mIDMap.end() ? iter->second : -1;
+}
+
+void LLTextureCache::setHeaderEntryIndex(const LLUUID& id, S32 idx)
+{
+    HeaderIndexShard& shard = getHeaderIndexShard(id);
+    LLMutexLock lock(&shard.mMutex);
+    shard.mIDMap[id] = idx;
+}
+
+void LLTextureCache::eraseHeaderEntryIndex(const LLUUID& id)
+{
+    HeaderIndexShard& shard = getHeaderIndexShard(id);
+    LLMutexLock lock(&shard.mMutex);
+    shard.mIDMap.erase(id);
+}
 
-    id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-    if (iter1 != mHeaderIDMap.end())
+// Always in the same order, and only with mHeaderMutex held
+void LLTextureCache::lockHeaderIndex()
+{
+    for (HeaderIndexShard& shard : mHeaderIndex)
     {
-        idx = iter1->second;
+        shard.mMutex.lock();
     }
+}
+
+void LLTextureCache::unlockHeaderIndex()
+{
+    for (S32 i = sHeaderIndexShards - 1; i >= 0; --i)
+    {
+        mHeaderIndex[i].mMutex.unlock();
+    }
+}
+
+// Entry idx in the mapped entries file, NULL if the file does not go that
+// far. Hold the shard of the entry's id, or the whole index, while using it.
+LLTextureCache::Entry* LLTextureCache::getMappedEntry(S32 idx)
+{
+    if (idx < 0 || (U32)idx >= mHeaderEntriesCapacity)
+    {
+        return NULL;
+    }
+    return (Entry*)(mHeaderEntriesFile.getData() + sizeof(EntriesInfo)) + idx;
+}
+
+//----------------------------------------------------------------------------
+
+//mHeaderMutex is locked before calling this.
+S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
+{
+    S32 idx = findHeaderEntry(id);
 
     if (idx < 0)
     {
@@ -1134,9 +1283,11 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
         {
             if (mHeaderEntriesInfo.mEntries < sCacheMaxEntries)
             {
-                // Add an entry to the end of the list
-                idx = mHeaderEntriesInfo.mEntries++;
-
+                // Add an entry to the end of the list, growing the file if needed
+                if (mapHeaderEntries(mHeaderEntriesInfo.mEntries + 1))
+                {
+                    idx = mHeaderEntriesInfo.mEntries++;
+                }
             }
             else if (!mFreeList.empty())
             {
@@ -1152,10 +1303,18 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
                     LLUUID oldid = *curiter2;
                     // Erase entry from LRU regardless
                     mLRU.erase(curiter2);
-                    // Look up entry and use it if it is valid
-                    id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-                    if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
+                    // Look up entry and use it if it is valid and was not
+                    // read since the LRU was built
+                    HeaderIndexShard& shard = getHeaderIndexShard(oldid);
+                    LLMutexLock shard_lock(&shard.mMutex);
+                    id_map_t::iterator iter3 = shard.mIDMap.find(oldid);
+                    if (iter3 != shard.mIDMap.end() && iter3->second >= 0)
                     {
+                        const Entry* old_entry = getMappedEntry(iter3->second);
+                        if (old_entry && !isEvictableFromLRU(old_entry->mTime, mLRUTime))
+                        {
+                            continue;
+                        }
                         idx = iter3->second;
                         removeCachedTexture(oldid) ;//remove the existing cached texture to release the entry index.
                         break;
@@ -1178,14 +1337,20 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
         // Remove this entry from the LRU if it exists
         mLRU.erase(id);
         // Read the entry
-        idx_entry_map_t::iterator iter = mUpdatedEntryMap.find(idx) ;
-        if(iter != mUpdatedEntryMap.end())
+        bool read = false;
         {
-            entry = iter->second ;
+            HeaderIndexShard& shard = getHeaderIndexShard(id);
+            LLMutexLock shard_lock(&shard.mMutex);
+            if (const Entry* mapped_entry = getMappedEntry(idx))
+            {
+                entry = *mapped_entry;
+                read = true;
+            }
         }
-        else
+        if (!read)
         {
-            readEntryFromHeaderImmediately(idx, entry) ;
+            clearCorruptedCache() ; //clear the cache.
+            return -1;
         }
         if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
         {
@@ -1194,7 +1359,6 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
             //erase this entry and the cached texture from the cache.
             std::string tex_filename = getTextureFileName(id);
             removeEntry(idx, entry, tex_filename) ;
-            mUpdatedEntryMap.erase(idx) ;
             idx = -1 ;
         }
     }
@@ -1204,71 +1368,51 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 //mHeaderMutex is locked before calling this.
 void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header)
 {
-    LLAPRFile* aprfile ;
-    S32 bytes_written ;
-    S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-    if(write_header)
+    if (mReadOnly)
     {
-        aprfile = openHeaderEntriesFile(false, 0);
-        bytes_written = aprfile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-        if(bytes_written != sizeof(EntriesInfo))
-        {
-            clearCorruptedCache() ; //clear the cache.
-            idx = -1 ;//mark the idx invalid.
-            return ;
-        }
-
-        mHeaderAPRFile->seek(APR_SET, offset);
+        return;
     }
-    else
+
+    if(write_header)
     {
-        aprfile = openHeaderEntriesFile(false, offset);
+        writeEntriesHeader();
     }
-    bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-    if(bytes_written != sizeof(Entry))
-    {
-        clearCorruptedCache() ; //clear the cache.
-        idx = -1 ;//mark the idx invalid.
 
-        return ;
+    bool written = false;
+    {
+        HeaderIndexShard& shard = getHeaderIndexShard(entry.mID);
+        LLMutexLock shard_lock(&shard.mMutex);
+        Entry* mapped_entry = getMappedEntry(idx);
+        if (mapped_entry && mHeaderEntriesFile.isWritable())
+        {
+            *mapped_entry = entry;
+            written = true;
+        }
     }
 
-    closeHeaderEntriesFile();
-    mUpdatedEntryMap.erase(idx) ;
-}
-
-//mHeaderMutex is locked before calling this.
-void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
-{
-    S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-    LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-    S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-    closeHeaderEntriesFile();
-
-    if(bytes_read != sizeof(Entry))
+    if (!written)
     {
         clearCorruptedCache() ; //clear the cache.
         idx = -1 ;//mark the idx invalid.
     }
 }
 
-//mHeaderMutex is locked before calling this.
-//update an existing entry time stamp, delay writing.
+//update an existing entry time stamp, straight into the mapped file.
+//Either mHeaderMutex or the shard of the entry's id is locked.
+//Read hits only dirty the index page when needsTimeStamp() says so.
 void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 {
-    static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f) ;
-
-    if(mHeaderEntriesInfo.mEntries < MAX_ENTRIES_WITHOUT_TIME_STAMP)
+    const U32 now = (U32)time(NULL);
+    if (idx >= 0 && !mReadOnly && needsTimeStamp(entry.mTime, now, mLRUTime))
     {
-        return ; //there are enough empty entry index space, no need to stamp time.
-    }
+        entry.mTime = now;
 
-    if (idx >= 0)
-    {
-        if (!mReadOnly)
+        HeaderIndexShard& shard = getHeaderIndexShard(entry.mID);
+        LLMutexLock shard_lock(&shard.mMutex);
+        Entry* mapped_entry = getMappedEntry(idx);
+        if (mapped_entry && mHeaderEntriesFile.isWritable())
         {
-            entry.mTime = time(NULL);
-            mUpdatedEntryMap[idx] = entry ;
+            mapped_entry->mTime = now;
         }
     }
 }
@@ -1292,7 +1436,6 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
         bool update_header = false ;
         if(entry.mImageSize < 0) //is a brand-new entry
         {
-            mHeaderIDMap[entry.mID] = idx;
             mTexturesSizeMap[entry.mID] = new_body_size ;
             mTexturesSizeTotal += new_body_size ;
 
@@ -1301,7 +1444,7 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
         }
         else if (entry.mBodySize != new_body_size)
         {
-            //already in mHeaderIDMap.
+            //already in the index.
             mTexturesSizeMap[entry.mID] = new_body_size ;
             mTexturesSizeTotal -= entry.mBodySize ;
             mTexturesSizeTotal += new_body_size ;
@@ -1312,6 +1455,12 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 
         writeEntryToHeaderImmediately(idx, entry, update_header) ;
 
+        if (update_header && idx >= 0)
+        {
+            // Only visible to lookups once the entry is written
+            setHeaderEntryIndex(entry.mID, idx);
+        }
+
         if (mTexturesSizeTotal > sCacheMaxTexturesSize)
         {
             purge = true;
@@ -1332,36 +1481,30 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 {
     U32 num_entries = mHeaderEntriesInfo.mEntries;
 
-    mHeaderIDMap.clear();
     mTexturesSizeMap.clear();
     mFreeList.clear();
     mTexturesSizeTotal = 0;
 
-    LLAPRFile* aprfile = NULL;
-    if(mUpdatedEntryMap.empty())
+    // The index is rebuilt from scratch, hold all of it so that lookups
+    // never see it half done
+    lockHeaderIndex();
+    for (HeaderIndexShard& shard : mHeaderIndex)
     {
-        aprfile = openHeaderEntriesFile(true, (S32)sizeof(EntriesInfo));
+        shard.mIDMap.clear();
     }
-    else //update the header file first.
+
+    if (num_entries > mHeaderEntriesCapacity)
     {
-        aprfile = openHeaderEntriesFile(false, 0);
-        updatedHeaderEntriesFile() ;
-        if(!aprfile)
-        {
-            return 0;
-        }
-        aprfile->seek(APR_SET, (S32)sizeof(EntriesInfo));
+        LL_WARNS() << "Corrupted header entries, expected " << num_entries << " entries but the file holds " << mHeaderEntriesCapacity << LL_ENDL;
+        unlockHeaderIndex();
+        purgeAllTextures(false);
+        return 0;
     }
 
     entries.resize(num_entries);
-    S32 total_entries_size = sizeof(Entry) * num_entries;
-    S32 bytes_read = aprfile->read((void*)entries.data(), total_entries_size);
-    if (bytes_read != total_entries_size)
+    if (num_entries)
     {
-        LL_WARNS() << "Corrupted header entries, expected " << total_entries_size << " bytes but got " << bytes_read << " bytes" << LL_ENDL;
-        closeHeaderEntriesFile();
-        purgeAllTextures(false);
-        return 0;
+        memcpy((void*)entries.data(), getMappedEntry(0), sizeof(Entry) * num_entries);
     }
 
     for (U32 idx=0; idx<num_entries; idx++)
@@ -1370,7 +1513,7 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 //      LL_INFOS() << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << LL_ENDL;
         if(entry.mImageSize > entry.mBodySize)
         {
-            mHeaderIDMap[entry.mID] = idx;
+            getHeaderIndexShard(entry.mID).mIDMap[entry.mID] = idx;
             mTexturesSizeMap[entry.mID] = entry.mBodySize;
             mTexturesSizeTotal += entry.mBodySize;
         }
@@ -1379,7 +1522,7 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
             mFreeList.insert(idx);
         }
     }
-    closeHeaderEntriesFile();
+    unlockHeaderIndex();
     return num_entries;
 }
 
@@ -1388,69 +1531,32 @@ void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
     S32 num_entries = entries.size();
     llassert_always(num_entries == mHeaderEntriesInfo.mEntries);
 
-    if (!mReadOnly)
+    if (!mReadOnly && num_entries)
     {
-        LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
-        for (S32 idx=0; idx<num_entries; idx++)
+        bool written = false;
+        lockHeaderIndex();
+        if (getMappedEntry(num_entries - 1) && mHeaderEntriesFile.isWritable())
         {
-            S32 bytes_written = aprfile->write((void*)(&entries[idx]), (S32)sizeof(Entry));
-            if(bytes_written != sizeof(Entry))
-            {
-                clearCorruptedCache() ; //clear the cache.
-                return ;
-            }
+            memcpy((void*)getMappedEntry(0), entries.data(), sizeof(Entry) * num_entries);
+            written = true;
         }
-        closeHeaderEntriesFile();
-    }
-}
+        unlockHeaderIndex();
 
-void LLTextureCache::writeUpdatedEntries()
-{
-    lockHeaders() ;
-    if (!mReadOnly && !mUpdatedEntryMap.empty())
-    {
-        openHeaderEntriesFile(false, 0);
-        updatedHeaderEntriesFile() ;
-        closeHeaderEntriesFile();
+        if (!written)
+        {
+            clearCorruptedCache() ; //clear the cache.
+        }
     }
-    unlockHeaders() ;
 }
 
-//mHeaderMutex is locked and mHeaderAPRFile is created before calling this.
-void LLTextureCache::updatedHeaderEntriesFile()
+// Everything is written through the mapping as it changes, this only
+// makes sure it reaches the disk every now and then.
+void LLTextureCache::flushHeaderEntries()
 {
-    if (!mReadOnly && !mUpdatedEntryMap.empty() && mHeaderAPRFile)
+    LLMutexLock lock(&mHeaderMutex);
+    if (!mReadOnly)
     {
-        //entriesInfo
-        mHeaderAPRFile->seek(APR_SET, 0);
-        S32 bytes_written = mHeaderAPRFile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-        if(bytes_written != sizeof(EntriesInfo))
-        {
-            clearCorruptedCache() ; //clear the cache.
-            return ;
-        }
-
-        //write each updated entry
-        S32 entry_size = (S32)sizeof(Entry) ;
-        S32 prev_idx = -1 ;
-        S32 delta_idx ;
-        for (idx_entry_map_t::iterator iter = mUpdatedEntryMap.begin(); iter != mUpdatedEntryMap.end(); ++iter)
-        {
-            delta_idx = iter->first - prev_idx - 1;
-            prev_idx = iter->first ;
-            if(delta_idx)
-            {
-                mHeaderAPRFile->seek(APR_CUR, delta_idx * entry_size);
-            }
-
-            bytes_written = mHeaderAPRFile->write((void*)(&iter->second), entry_size);
-            if(bytes_written != entry_size)
-            {
-                clearCorruptedCache() ; //clear the cache.
-                return ;
-            }
-        }
-        mUpdatedEntryMap.clear() ;
+        mHeaderEntriesFile.flush();
     }
 }
 //----------------------------------------------------------------------------
@@ -1461,6 +1567,7 @@ void LLTextureCache::readHeaderCache()
     mHeaderMutex.lock();
 
     mLRU.clear(); // always clear the LRU
+    mLRUTime = (U32)time(NULL);
 
     readEntriesHeader();
 
@@ -1565,7 +1672,6 @@ void LLTextureCache::clearCorruptedCache()
 {
     LL_WARNS() << "the texture cache is corrupted, need to be cleared." << LL_ENDL ;
 
-    closeHeaderEntriesFile();//close possible file handler
     purgeAllTextures(false) ; //clear the cache.
 
     if (!mReadOnly) //regenerate the directory tree if not exists.
@@ -1585,6 +1691,25 @@ void LLTextureCache::clearCorruptedCache()
 
 void LLTextureCache::purgeAllTextures(bool purge_directories)
 {
+    {
+        LLMutexLock lock(&mPendingWritesMutex);
+        mPendingWrites.clear();
+    }
+    {
+        // Mapped again on next use
+        LLMutexLock lock(&mFastCacheMutex);
+        closeFastCache();
+    }
+
+    // Empty the index and let go of the entries file before it is deleted
+    lockHeaderIndex();
+    for (HeaderIndexShard& shard : mHeaderIndex)
+    {
+        shard.mIDMap.clear();
+    }
+    unmapHeaderEntries();
+    unlockHeaderIndex();
+
     if (!mReadOnly)
     {
         const char* subdirs = "0123456789abcdef";
@@ -1615,11 +1740,9 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
             LLFile::rmdir(mTexturesDirName);
         }
     }
-    mHeaderIDMap.clear();
     mTexturesSizeMap.clear();
     mTexturesSizeTotal = 0;
     mFreeList.clear();
-    mUpdatedEntryMap.clear();
 
     // Info with 0 entries
     setEntriesHeader();
@@ -1661,15 +1784,14 @@ void LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
         {
             if (iter1->second > 0)
             {
-                id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-                if (iter2 != mHeaderIDMap.end())
+                S32 idx = findHeaderEntry(iter1->first);
+                if (idx >= 0)
                 {
-                    S32 idx = iter2->second;
                     time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
                 }
                 else
                 {
-                    LL_ERRS("TextureCache") << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL;
+                    LL_ERRS("TextureCache") << "mTexturesSizeMap / header index corrupted." << LL_ENDL;
                 }
             }
         }
@@ -1702,8 +1824,7 @@ void LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
             Entry entry = mPurgeEntryList.back().second;
             mPurgeEntryList.pop_back();
             // make sure record is still valid
-            id_map_t::iterator iter_header = mHeaderIDMap.find(entry.mID);
-            if (iter_header != mHeaderIDMap.end() && iter_header->second == idx)
+            if (findHeaderEntry(entry.mID) == idx)
             {
                 std::string tex_filename = getTextureFileName(entry.mID);
                 removeEntry(idx, entry, tex_filename);
@@ -1746,16 +1867,15 @@ void LLTextureCache::purgeTextures(bool validate)
     {
         if (iter1->second > 0)
         {
-            id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-            if (iter2 != mHeaderIDMap.end())
+            S32 idx = findHeaderEntry(iter1->first);
+            if (idx >= 0)
             {
-                S32 idx = iter2->second;
                 time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
 //              LL_INFOS() << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << LL_ENDL;
             }
             else
             {
-                LL_ERRS() << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL ;
+                LL_ERRS() << "mTexturesSizeMap / header index corrupted." << LL_ENDL ;
             }
         }
     }
@@ -1863,6 +1983,29 @@ LLTextureCacheWorker* LLTextureCache::getWriter(handle_t handle)
 S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+    {
+        // Hits and misses only lock the shard of the index the id is in.
+        // The new time stamp also keeps the entry from being evicted out
+        // of the LRU.
+        HeaderIndexShard& shard = getHeaderIndexShard(id);
+        LLMutexLock shard_lock(&shard.mMutex);
+        id_map_t::const_iterator iter = shard.mIDMap.find(id);
+        if (iter == shard.mIDMap.end())
+        {
+            return -1;
+        }
+
+        S32 idx = iter->second;
+        const Entry* mapped_entry = getMappedEntry(idx);
+        if (mapped_entry && mapped_entry->mImageSize > mapped_entry->mBodySize)
+        {
+            entry = *mapped_entry;
+            updateEntryTimeStamp(idx, entry); // updates time
+            return idx;
+        }
+    }
+
+    // Anything wrong with the entry is cleaned up with the whole cache locked
     LLMutexLock lock(&mHeaderMutex);
     S32 idx = openAndReadEntry(id, entry, false);
     if (idx >= 0)
@@ -1993,6 +2136,15 @@ LLTextureCache::handle_t LLTextureCache::writeToCache(const LLUUID& id,
         return LLWorkerThread::nullHandle();
     }
 
+    if (mWriteBehind)
+    {
+        // Everything is copied into the queue, so the caller is free to
+        // carry on as soon as this returns
+        bool success = queueWrite(id, data, datasize, imagesize, rawimage, discardlevel);
+        addCompleted(responder, success);
+        return LLWorkerThread::nullHandle();
+    }
+
     LLMutexLock lock(&mWorkersMutex);
     LLTextureCacheWorker* worker = new LLTextureCacheRemoteWorker(this, id,
                                                                   data, datasize, 0,
@@ -2002,187 +2154,633 @@ LLTextureCache::handle_t LLTextureCache::writeToCache(const LLUUID& id,
     return handle;
 }
 
-//called in the main thread
-LLPointer<LLImageRaw> LLTextureCache::readFromFastCache(const LLUUID& id, S32& discardlevel)
+// Called from texture pipeline thread (i.e. LLTextureFetch)
+bool LLTextureCache::queueWrite(const LLUUID& id, U8* data, S32 datasize, S32 imagesize,
+                                LLPointer<LLImageRaw> rawimage, S32 discardlevel)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+    if ((datasize <= 0)
+        || (imagesize < datasize)
+        || (discardlevel < 0)
+        || (rawimage->isBufferInvalid())) // decode failed or malfunctioned, don't write
+    {
+        LL_WARNS() << "Invalid write for image: " << id << " Size: " << imagesize << " DataSize: " << datasize << " Discard:" << discardlevel << LL_ENDL;
+        removeFromCache(id);
+        return false;
+    }
+
+    std::shared_ptr<PendingWrite> write = std::make_shared<PendingWrite>();
+    write->mID = id;
+    write->mImageSize = imagesize;
+    write->mData.assign(data, data + datasize);
+    // The raw image belongs to the fetch worker and can change once we return,
+    // so the fast cache entries are made now
+    if (!packFastCacheEntries(rawimage, discardlevel, write->mFastCacheEntries))
+    {
+        removeFromCache(id);
+        return false;
+    }
+
+    LLMutexLock lock(&mPendingWritesMutex);
+    if (mPendingWrites.empty())
+    {
+        mPendingWritesTimer.reset();
+    }
+    std::shared_ptr<PendingWrite>& pending = mPendingWrites[id];
+    if (pending)
+    {
+        // Textures are written again every time a lower discard level
+        // arrives, only the one with the most data needs to reach the disk
+        if (pending->mData.size() > write->mData.size())
+        {
+            mPendingWritesSavedBytes += datasize;
+            return true;
+        }
+        if (!pending->mInFlight)
+        {
+            mPendingWritesSavedBytes += (S64)pending->mData.size();
+        }
+    }
+    pending = write;
+    return true;
+}
+
+// Called from the cache thread, or once it is stopped
+void LLTextureCache::flushPendingWrites()
 {
-    U32 offset;
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+    std::vector<std::shared_ptr<PendingWrite> > batch;
+    {
+        LLMutexLock lock(&mPendingWritesMutex);
+        batch.reserve(mPendingWrites.size());
+        for (auto& pending : mPendingWrites)
+        {
+            pending.second->mInFlight = true;
+            batch.push_back(pending.second);
+        }
+    }
+    if (batch.empty())
+    {
+        return;
+    }
+
+    typedef std::vector<std::pair<S32, PendingWrite*> > idx_write_vector_t;
+    idx_write_vector_t headers;     // records for texture.cache
+    idx_write_vector_t fast_cache;
+    idx_write_vector_t bodies;
+    std::vector<LLUUID> failed;
+
     {
+        // One lock of the headers for all the entries of the batch
         LLMutexLock lock(&mHeaderMutex);
-        id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-        if(iter == mHeaderIDMap.end())
+        for (auto& write : batch)
         {
-            return NULL; //not in the cache
+            if (mReadOnly)
+            {
+                break; // setHeaderCacheEntry() gave up on the cache
+            }
+            if (write->mCancelled)
+            {
+                continue; // removed from the cache since the batch was taken
+            }
+
+            S32 datasize = (S32)write->mData.size();
+            bool already_cached = false;
+            Entry entry;
+            S32 idx = getHeaderCacheEntry(write->mID, entry);
+            if (idx < 0)
+            {
+                idx = setHeaderCacheEntry(write->mID, entry, write->mImageSize, datasize); // create the new entry.
+            }
+            else
+            {
+                already_cached = updateEntry(idx, entry, write->mImageSize, datasize); // update the existing entry.
+            }
+
+            if (idx < 0)
+            {
+                LL_WARNS() << "LLTextureCache: " << write->mID
+                    << " Unable to create header entry for writing!" << LL_ENDL;
+                failed.push_back(write->mID);
+                continue;
+            }
+
+            // Later writes have more data, which the bigger fast cache tiers can use
+            fast_cache.push_back(std::make_pair(idx, write.get()));
+
+            // If the texture has already been cached, only the body can have changed
+            if (!already_cached)
+            {
+                headers.push_back(std::make_pair(idx, write.get()));
+            }
+            if (datasize > TEXTURE_CACHE_ENTRY_SIZE)
+            {
+                bodies.push_back(std::make_pair(idx, write.get()));
+            }
         }
+    }
 
-        offset = iter->second;
+    if (!headers.empty())
+    {
+        // In file order, through a single open of texture.cache
+        std::sort(headers.begin(), headers.end(),
+                  [](const idx_write_vector_t::value_type& a, const idx_write_vector_t::value_type& b)
+                  {
+                      return a.first < b.first;
+                  });
+
+        LLAPRFile header_file(mHeaderDataFileName, APR_CREATE|APR_WRITE|APR_BINARY, getLocalAPRFilePool());
+        U8 record[TEXTURE_CACHE_ENTRY_SIZE];
+        for (auto& header : headers)
+        {
+            PendingWrite* write = header.second;
+
+            // Commit only while the entry is still this texture's, so a
+            // removal never leaves a record behind, nor writes over a reused entry
+            LLMutexLock lock(&mHeaderMutex);
+            if (!isPendingWriteEntry(write, header.first))
+            {
+                continue;
+            }
+
+            // Records are padded with 0 when the texture is smaller than one
+            S32 size = llmin((S32)write->mData.size(), TEXTURE_CACHE_ENTRY_SIZE);
+            memcpy(record, write->mData.data(), size);
+            memset(record + size, 0, TEXTURE_CACHE_ENTRY_SIZE - size);
+
+            if (!header_file.getFileHandle()
+                || header_file.seek(APR_SET, header.first * TEXTURE_CACHE_ENTRY_SIZE) < 0
+                || header_file.write(record, TEXTURE_CACHE_ENTRY_SIZE) != TEXTURE_CACHE_ENTRY_SIZE)
+            {
+                LL_WARNS() << "LLTextureCache: " << write->mID
+                    << " Unable to write header entry!" << LL_ENDL;
+                failed.push_back(write->mID);
+            }
+        }
     }
-    offset *= TEXTURE_FAST_CACHE_ENTRY_SIZE;
 
-    U8* data;
-    S32 head[4];
+    if (!fast_cache.empty())
     {
         LLMutexLock lock(&mFastCacheMutex);
 
         openFastCache();
+        for (auto& fast_entry : fast_cache)
+        {
+            if (fast_entry.second->mCancelled)
+            {
+                continue; // removeFromFastCache() is done with it, or waits for us
+            }
+            writeFastCacheEntries(fast_entry.second->mID, fast_entry.first, fast_entry.second->mFastCacheEntries);
+        }
+    }
 
-        mFastCachep->seek(APR_SET, offset);
+    for (auto& body : bodies)
+    {
+        PendingWrite* write = body.second;
 
-        if(mFastCachep->read(head, TEXTURE_FAST_CACHE_ENTRY_OVERHEAD) != TEXTURE_FAST_CACHE_ENTRY_OVERHEAD)
+        LLMutexLock lock(&mHeaderMutex);
+        if (!isPendingWriteEntry(write, body.first))
         {
-            //cache corrupted or under thread race condition
-            closeFastCache();
-            return NULL;
+            continue;
         }
 
-        S32 image_size = head[0] * head[1] * head[2];
-        if(image_size <= 0
-           || image_size > TEXTURE_FAST_CACHE_DATA_SIZE
-           || head[3] < 0) //invalid
+        S32 file_size = (S32)write->mData.size() - TEXTURE_CACHE_ENTRY_SIZE;
+        S32 bytes_written = LLAPRFile::writeEx(getTextureFileName(write->mID),
+                                               write->mData.data() + TEXTURE_CACHE_ENTRY_SIZE,
+                                               0, file_size,
+                                               getLocalAPRFilePool());
+        if (bytes_written <= 0)
         {
-            closeFastCache();
-            return NULL;
+            LL_WARNS() << "LLTextureCache: " << write->mID
+                << " incorrect number of bytes written to body: " << bytes_written
+                << " / " << file_size << LL_ENDL;
+            failed.push_back(write->mID);
         }
-        discardlevel = head[3];
+    }
 
-        data = (U8*)ll_aligned_malloc_16(image_size);
-        if(mFastCachep->read(data, image_size) != image_size)
+    {
+        LLMutexLock lock(&mPendingWritesMutex);
+        for (auto& write : batch)
         {
-            ll_aligned_free_16(data);
-            closeFastCache();
-            return NULL;
+            // Anything queued for the same texture meanwhile stays in
+            pending_write_map_t::iterator iter = mPendingWrites.find(write->mID);
+            if (iter != mPendingWrites.end() && iter->second == write)
+            {
+                mPendingWrites.erase(iter);
+            }
         }
+        mPendingWritesTimer.reset();
+    }
 
-        closeFastCache();
+    for (const LLUUID& id : failed)
+    {
+        removeFromCache(id);
     }
-    LLPointer<LLImageRaw> raw = new LLImageRaw(data, head[0], head[1], head[2], true);
+}
 
-    return raw;
+// mHeaderMutex must be locked
+bool LLTextureCache::isPendingWriteEntry(const PendingWrite* write, S32 idx)
+{
+    return !mReadOnly && !write->mCancelled && findHeaderEntry(write->mID) == idx;
 }
 
-//return the fast cache location
-bool LLTextureCache::writeToFastCache(LLUUID image_id, S32 id, LLPointer<LLImageRaw> raw, S32 discardlevel)
+bool LLTextureCache::readFromPendingWrites(const LLUUID& id, S32 offset, S32& size, S32& imagesize, U8*& data)
 {
-    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
-    //rescale image if needed
-    if (raw.isNull() || raw->isBufferInvalid() || !raw->getData())
+    LLMutexLock lock(&mPendingWritesMutex);
+    pending_write_map_t::const_iterator iter = mPendingWrites.find(id);
+    if (iter == mPendingWrites.end())
     {
-        LL_ERRS() << "Attempted to write NULL raw image to fastcache" << LL_ENDL;
         return false;
     }
 
-    S32 w, h, c;
-    w = raw->getWidth();
-    h = raw->getHeight();
-    c = raw->getComponents();
-
-    S32 i = 0 ;
-
-    // Search for a discard level that will fit into fast cache
-    while(((w >> i) * (h >> i) * c) > TEXTURE_FAST_CACHE_DATA_SIZE)
+    const PendingWrite* write = iter->second.get();
+    size = llmin(size, (S32)write->mData.size() - offset);
+    if (size <= 0)
+    {
+        size = 0;
+        return true;
+    }
+    data = (U8*)ll_aligned_malloc_16(size);
+    if (!data)
     {
-        ++i ;
+        LL_WARNS() << "LLTextureCache: " << id
+            << " failed to allocate memory for reading: " << size << LL_ENDL;
+        size = -1; // failed
+        return true;
     }
+    memcpy(data, write->mData.data() + offset, size);
+    imagesize = write->mImageSize;
+    return true;
+}
 
-    if(i)
+//called in the main thread
+LLPointer<LLImageRaw> LLTextureCache::readFromFastCache(const LLUUID& id, S32& discardlevel)
+{
     {
-        w >>= i;
-        h >>= i;
-        if(w * h *c > 0) //valid
+        // The fast cache entries are made when the write is queued
+        LLMutexLock lock(&mPendingWritesMutex);
+        pending_write_map_t::const_iterator iter = mPendingWrites.find(id);
+        if (iter != mPendingWrites.end())
         {
-            // Make a duplicate to keep the original raw image untouched.
-            raw = raw->duplicate();
-
-            if (raw->isBufferInvalid())
+            for (S32 tier = sFastCacheTiers - 1; tier >= 0; --tier)
             {
-                LL_WARNS() << "Invalid image duplicate buffer" << LL_ENDL;
-                return false;
+                const std::vector<U8>& fast_entry = iter->second->mFastCacheEntries[tier];
+                if (!fast_entry.empty())
+                {
+                    LLPointer<LLImageRaw> raw = unpackFastCacheEntry(fast_entry.data(), (S32)fast_entry.size(), tier, discardlevel);
+                    if (raw.notNull())
+                    {
+                        return raw;
+                    }
+                }
             }
+            // Nothing usable queued, what is on disk may still do
+        }
+    }
+
+    S32 idx = findHeaderEntry(id);
 
-            raw->scale(w, h);
+    LLMutexLock lock(&mFastCacheMutex);
+    openFastCache();
 
-            discardlevel += i ;
+    // Biggest first, those do not need the texture to still be in the cache
+    for (S32 tier = sFastCacheTiers - 1; tier > 0; --tier)
+    {
+        FastCacheTier& fast_cache_tier = mFastCacheTiers[tier];
+        id_map_t::const_iterator iter = fast_cache_tier.mIDMap.find(id);
+        if (iter != fast_cache_tier.mIDMap.end())
+        {
+            const U8* fast_entry = getFastCacheEntry(fast_cache_tier, iter->second);
+            if (fast_entry)
+            {
+                LLPointer<LLImageRaw> raw = unpackFastCacheEntry(fast_entry, TEXTURE_FAST_CACHE_TIER_ENTRY_SIZE[tier], tier, discardlevel);
+                if (raw.notNull())
+                {
+                    return raw;
+                }
+            }
         }
     }
 
-    //copy data
-    memcpy(mFastCachePadBuffer, &w, sizeof(S32));
-    memcpy(mFastCachePadBuffer + sizeof(S32), &h, sizeof(S32));
-    memcpy(mFastCachePadBuffer + sizeof(S32) * 2, &c, sizeof(S32));
-    memcpy(mFastCachePadBuffer + sizeof(S32) * 3, &discardlevel, sizeof(S32));
+    if (idx < 0)
+    {
+        return NULL; //not in the cache
+    }
+
+    const U8* fast_entry = getFastCacheEntry(mFastCacheTiers[0], idx);
+    if (!fast_entry)
+    {
+        //cache corrupted or not written yet
+        return NULL;
+    }
+    return unpackFastCacheEntry(fast_entry, TEXTURE_FAST_CACHE_ENTRY_SIZE, 0, discardlevel);
+}
 
-    S32 copy_size = w * h * c;
-    if(copy_size > 0) //valid
+//return the fast cache location
+bool LLTextureCache::writeToFastCache(LLUUID image_id, S32 id, LLPointer<LLImageRaw> raw, S32 discardlevel)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+    std::vector<U8> entries[sFastCacheTiers];
+    if (!packFastCacheEntries(raw, discardlevel, entries))
     {
-        copy_size = llmin(copy_size, TEXTURE_FAST_CACHE_ENTRY_SIZE - TEXTURE_FAST_CACHE_ENTRY_OVERHEAD);
-        memcpy(mFastCachePadBuffer + TEXTURE_FAST_CACHE_ENTRY_OVERHEAD, raw->getData(), copy_size);
+        return false;
     }
-    S32 offset = id * TEXTURE_FAST_CACHE_ENTRY_SIZE;
 
+    LLMutexLock lock(&mFastCacheMutex);
+    openFastCache();
+    writeFastCacheEntries(image_id, id, entries);
+    return true;
+}
+
+// mFastCacheMutex must be locked and the fast cache open
+void LLTextureCache::writeFastCacheEntries(const LLUUID& id, S32 cache_id, const std::vector<U8>* entries)
+{
+    //no need to report failures. When one happens, let it fail quietly.
+    //this failure could happen because other viewer removes the fast cache file when clearing cache.
+    if (!entries[0].empty() && cache_id >= 0)
     {
-        LLMutexLock lock(&mFastCacheMutex);
+        U8* fast_entry = getFastCacheEntry(mFastCacheTiers[0], cache_id);
+        if (fast_entry && mFastCacheTiers[0].mFile.isWritable())
+        {
+            memcpy(fast_entry, entries[0].data(), entries[0].size());
+        }
+    }
 
-        openFastCache();
+    for (S32 tier = 1; tier < sFastCacheTiers; ++tier)
+    {
+        FastCacheTier& fast_cache_tier = mFastCacheTiers[tier];
+        if (entries[tier].empty() || !fast_cache_tier.mFile.isWritable())
+        {
+            continue;
+        }
 
-        mFastCachep->seek(APR_SET, offset);
+        // Rewritten in place, otherwise replaces the oldest entry
+        U32 entry_idx;
+        id_map_t::iterator iter = fast_cache_tier.mIDMap.find(id);
+        if (iter != fast_cache_tier.mIDMap.end())
+        {
+            entry_idx = iter->second;
+        }
+        else
+        {
+            entry_idx = fast_cache_tier.mNextEntry;
+            fast_cache_tier.mNextEntry = (entry_idx + 1) % fast_cache_tier.mNumEntries;
+        }
 
-        //no need to do this assertion check. When it fails, let it fail quietly.
-        //this failure could happen because other viewer removes the fast cache file when clearing cache.
-        //--> llassert_always(mFastCachep->write(mFastCachePadBuffer, TEXTURE_FAST_CACHE_ENTRY_SIZE) == TEXTURE_FAST_CACHE_ENTRY_SIZE);
-        mFastCachep->write(mFastCachePadBuffer, TEXTURE_FAST_CACHE_ENTRY_SIZE);
+        U8* fast_entry = getFastCacheEntry(fast_cache_tier, entry_idx);
+        if (!fast_entry)
+        {
+            continue;
+        }
 
-        closeFastCache(true);
-    }
+        LLUUID old_id;
+        memcpy(old_id.mData, fast_entry + TEXTURE_FAST_CACHE_TIER_ID_OFFSET, UUID_BYTES);
+        id_map_t::iterator old_iter = fast_cache_tier.mIDMap.find(old_id);
+        if (old_iter != fast_cache_tier.mIDMap.end() && old_iter->second == (S32)entry_idx)
+        {
+            fast_cache_tier.mIDMap.erase(old_iter);
+        }
 
-    return true;
+        memcpy(fast_entry, entries[tier].data(), entries[tier].size());
+        memcpy(fast_entry + TEXTURE_FAST_CACHE_TIER_ID_OFFSET, id.mData, UUID_BYTES);
+        memcpy(fast_entry + TEXTURE_FAST_CACHE_TIER_SERIAL_OFFSET, &fast_cache_tier.mSerial, sizeof(U32));
+        ++fast_cache_tier.mSerial;
+        fast_cache_tier.mIDMap[id] = entry_idx;
+    }
 }
 
-void LLTextureCache::openFastCache(bool first_time)
+void LLTextureCache::removeFromFastCache(const LLUUID& id)
 {
-    if(!mFastCachep)
+    LLMutexLock lock(&mFastCacheMutex);
+    for (S32 tier = 1; tier < sFastCacheTiers; ++tier)
     {
-        if(first_time)
+        FastCacheTier& fast_cache_tier = mFastCacheTiers[tier];
+        id_map_t::iterator iter = fast_cache_tier.mIDMap.find(id);
+        if (iter != fast_cache_tier.mIDMap.end())
         {
-            if(!mFastCachePadBuffer)
-            {
-                mFastCachePadBuffer = (U8*)ll_aligned_malloc_16(TEXTURE_FAST_CACHE_ENTRY_SIZE);
-            }
-            mFastCachePoolp = new LLVolatileAPRPool("Fast Cache Pool", FALSE); // is_local=false, thread safe mode due to crashes
-            if (LLAPRFile::isExist(mFastCacheFileName, mFastCachePoolp))
+            // Untagged, so it is not found again once mapped next time
+            U8* fast_entry = getFastCacheEntry(fast_cache_tier, iter->second);
+            if (fast_entry && fast_cache_tier.mFile.isWritable())
             {
-                mFastCachep = new LLAPRFile(mFastCacheFileName, APR_READ|APR_WRITE|APR_BINARY, mFastCachePoolp) ;
+                memset(fast_entry + TEXTURE_FAST_CACHE_TIER_ID_OFFSET, 0, UUID_BYTES);
             }
-            else
+            fast_cache_tier.mIDMap.erase(iter);
+        }
+    }
+}
+
+// Fills entries with the fast cache entry of each tier, raw scaled down to
+// fit if needed. Entries only hold the used part of the image data, and are
+// left empty for the bigger tiers when raw fits whole in a smaller one.
+//static
+bool LLTextureCache::packFastCacheEntries(LLPointer<LLImageRaw> raw, S32 discardlevel, std::vector<U8>* entries)
+{
+    //rescale image if needed
+    if (raw.isNull() || raw->isBufferInvalid() || !raw->getData())
+    {
+        LL_ERRS() << "Attempted to write NULL raw image to fastcache" << LL_ENDL;
+        return false;
+    }
+
+    const S32 full_size = raw->getWidth() * raw->getHeight() * raw->getComponents();
+
+    // Biggest first, so each tier is scaled down from the previous one
+    for (S32 tier = sFastCacheTiers - 1; tier >= 0; --tier)
+    {
+        entries[tier].clear();
+        if (tier > 0 && full_size <= TEXTURE_FAST_CACHE_TIER_DATA_SIZE[tier - 1])
+        {
+            continue;
+        }
+
+        S32 w, h, c;
+        w = raw->getWidth();
+        h = raw->getHeight();
+        c = raw->getComponents();
+
+        S32 i = 0 ;
+
+        // Search for a discard level that will fit into the tier
+        while(((w >> i) * (h >> i) * c) > TEXTURE_FAST_CACHE_TIER_DATA_SIZE[tier])
+        {
+            ++i ;
+        }
+
+        if(i)
+        {
+            w >>= i;
+            h >>= i;
+            if(w * h *c > 0) //valid
             {
-                mFastCachep = new LLAPRFile(mFastCacheFileName, APR_CREATE|APR_READ|APR_WRITE|APR_BINARY, mFastCachePoolp) ;
+                // Make a duplicate to keep the original raw image untouched.
+                raw = raw->duplicate();
+
+                if (raw->isBufferInvalid())
+                {
+                    LL_WARNS() << "Invalid image duplicate buffer" << LL_ENDL;
+                    return false;
+                }
+
+                raw->scale(w, h);
+
+                discardlevel += i ;
             }
         }
-        else
+
+        S32 copy_size = w * h * c;
+        if (copy_size <= 0 && tier > 0)
         {
-            mFastCachep = new LLAPRFile(mFastCacheFileName, APR_READ|APR_WRITE|APR_BINARY, mFastCachePoolp) ;
+            continue; // too thin to scale, the 16px tier says so
         }
+        copy_size = llmax(copy_size, 0);
+
+        const S32 overhead = tier ? TEXTURE_FAST_CACHE_TIER_OVERHEAD : TEXTURE_FAST_CACHE_ENTRY_OVERHEAD;
+        std::vector<U8>& entry = entries[tier];
+        entry.resize(overhead + copy_size, 0);
 
-        mFastCacheTimer.reset();
+        //copy data
+        memcpy(entry.data(), &w, sizeof(S32));
+        memcpy(entry.data() + sizeof(S32), &h, sizeof(S32));
+        memcpy(entry.data() + sizeof(S32) * 2, &c, sizeof(S32));
+        memcpy(entry.data() + sizeof(S32) * 3, &discardlevel, sizeof(S32));
+        if (copy_size > 0)
+        {
+            memcpy(entry.data() + overhead, raw->getData(), copy_size);
+        }
     }
-    return;
+
+    return true;
+}
+
+//static
+LLPointer<LLImageRaw> LLTextureCache::unpackFastCacheEntry(const U8* entry, S32 entry_size, S32 tier, S32& discardlevel)
+{
+    S32 head[4];
+    memcpy(head, entry, TEXTURE_FAST_CACHE_ENTRY_OVERHEAD);
+
+    const S32 overhead = tier ? TEXTURE_FAST_CACHE_TIER_OVERHEAD : TEXTURE_FAST_CACHE_ENTRY_OVERHEAD;
+    S32 image_size = head[0] * head[1] * head[2];
+    if(head[0] <= 0 || head[1] <= 0 || head[2] <= 0
+       || image_size > TEXTURE_FAST_CACHE_TIER_DATA_SIZE[tier]
+       || image_size > entry_size - overhead
+       || head[3] < 0) //invalid
+    {
+        return NULL;
+    }
+    discardlevel = head[3];
+
+    U8* data = (U8*)ll_aligned_malloc_16(image_size);
+    if (!data)
+    {
+        return NULL;
+    }
+    memcpy(data, entry + overhead, image_size);
+
+    return new LLImageRaw(data, head[0], head[1], head[2], true);
 }
 
-void LLTextureCache::closeFastCache(bool forced)
+// Called in the main thread, from initCache()
+void LLTextureCache::setFastCacheTiers(S64 tiers_size)
 {
-    static const F32 timeout = 10.f ; //seconds
+    LLMutexLock lock(&mFastCacheMutex);
+    closeFastCache();
 
-    if(!mFastCachep)
+    mFastCacheTiers[0].mNumEntries = sCacheMaxEntries;
+    for (S32 tier = 1; tier < sFastCacheTiers; ++tier)
     {
-        return ;
+        S64 tier_size = (tiers_size * TEXTURE_FAST_CACHE_TIER_PERCENT[tier]) / 100;
+        mFastCacheTiers[tier].mNumEntries = (U32)(tier_size / TEXTURE_FAST_CACHE_TIER_ENTRY_SIZE[tier]);
     }
 
-    if(!forced && mFastCacheTimer.getElapsedTimeF32() < timeout)
+    LL_INFOS("TextureCache") << "Fast cache entries: " << mFastCacheTiers[0].mNumEntries
+            << " / " << mFastCacheTiers[1].mNumEntries
+            << " / " << mFastCacheTiers[2].mNumEntries << LL_ENDL;
+}
+
+// mFastCacheMutex must be locked. Returns NULL if the entry is not mapped.
+U8* LLTextureCache::getFastCacheEntry(FastCacheTier& tier, U32 entry)
+{
+    S32 tier_idx = (S32)(&tier - mFastCacheTiers);
+    size_t entry_size = TEXTURE_FAST_CACHE_TIER_ENTRY_SIZE[tier_idx];
+    size_t offset = (size_t)entry * entry_size;
+    if (entry >= tier.mNumEntries || offset + entry_size > tier.mFile.getSize())
     {
-        return ;
+        return NULL;
+    }
+    // Writes only ever go through writable mappings
+    return const_cast<U8*>(tier.mFile.getData()) + offset;
+}
+
+// mFastCacheMutex must be locked
+void LLTextureCache::openFastCache()
+{
+    for (S32 tier = 0; tier < sFastCacheTiers; ++tier)
+    {
+        FastCacheTier& fast_cache_tier = mFastCacheTiers[tier];
+        if (fast_cache_tier.mFile.isMapped() || !fast_cache_tier.mNumEntries)
+        {
+            continue;
+        }
+
+        bool mapped;
+        if (mReadOnly)
+        {
+            mapped = fast_cache_tier.mFile.map(fast_cache_tier.mFileName);
+        }
+        else
+        {
+            size_t size = (size_t)fast_cache_tier.mNumEntries * TEXTURE_FAST_CACHE_TIER_ENTRY_SIZE[tier];
+            mapped = fast_cache_tier.mFile.mapWritable(fast_cache_tier.mFileName, size);
+        }
+        if (!mapped || tier == 0)
+        {
+            continue;
+        }
+
+        // Rebuild the index from the tags, the oldest entry is the one
+        // after the last written
+        fast_cache_tier.mIDMap.clear();
+        fast_cache_tier.mNextEntry = 0;
+        fast_cache_tier.mSerial = 0;
+        bool found = false;
+        U32 last_serial = 0;
+        for (U32 entry = 0; entry < fast_cache_tier.mNumEntries; ++entry)
+        {
+            const U8* fast_entry = getFastCacheEntry(fast_cache_tier, entry);
+            if (!fast_entry)
+            {
+                break;
+            }
+
+            LLUUID id;
+            memcpy(id.mData, fast_entry + TEXTURE_FAST_CACHE_TIER_ID_OFFSET, UUID_BYTES);
+            if (id.isNull())
+            {
+                continue;
+            }
+
+            U32 serial;
+            memcpy(&serial, fast_entry + TEXTURE_FAST_CACHE_TIER_SERIAL_OFFSET, sizeof(U32));
+            fast_cache_tier.mIDMap[id] = entry;
+            if (!found || serial >= last_serial)
+            {
+                found = true;
+                last_serial = serial;
+                fast_cache_tier.mNextEntry = (entry + 1) % fast_cache_tier.mNumEntries;
+                fast_cache_tier.mSerial = serial + 1;
+            }
+        }
     }
+}
 
-    delete mFastCachep;
-    mFastCachep = NULL;
-    return;
+// mFastCacheMutex must be locked
+void LLTextureCache::closeFastCache()
+{
+    for (FastCacheTier& fast_cache_tier : mFastCacheTiers)
+    {
+        fast_cache_tier.mFile.unmap();
+        fast_cache_tier.mIDMap.clear();
+    }
 }
 
 bool LLTextureCache::writeComplete(handle_t handle, bool abort)
@@ -2231,7 +2829,7 @@ void LLTextureCache::removeCachedTexture(const LLUUID& id)
         mTexturesSizeTotal -= mTexturesSizeMap[id] ;
         mTexturesSizeMap.erase(id);
     }
-    mHeaderIDMap.erase(id);
+    eraseHeaderEntryIndex(id);
     // We are inside header's mutex so mHeaderAPRFilePoolp is safe to use,
     // but getLocalAPRFilePool() is not safe, it might be in use by worker
     LLAPRFile::remove(getTextureFileName(id), mHeaderAPRFilePoolp);
@@ -2262,7 +2860,7 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 
         entry.mImageSize = -1;
         entry.mBodySize = 0;
-        mHeaderIDMap.erase(entry.mID);
+        eraseHeaderEntryIndex(entry.mID);
         mTexturesSizeMap.erase(entry.mID);
         mFreeList.insert(idx);
     }
@@ -2276,6 +2874,18 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 bool LLTextureCache::removeFromCache(const LLUUID& id)
 {
     //LL_WARNS() << "Removing texture from cache: " << id << LL_ENDL;
+    {
+        LLMutexLock lock(&mPendingWritesMutex);
+        pending_write_map_t::iterator iter = mPendingWrites.find(id);
+        if (iter != mPendingWrites.end())
+        {
+            // A flush already writing it checks this before each part it commits
+            iter->second->mCancelled = true;
+            mPendingWrites.erase(iter);
+        }
+    }
+    removeFromFastCache(id);
+
     bool ret = false ;
     if (!mReadOnly)
     {
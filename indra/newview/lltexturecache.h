@@ -33,6 +33,7 @@
 #include "lluuid.h"
 
 #include "llworkerthread.h"
+#include "llmappedfile.h"
 
 #include <boost/unordered/unordered_flat_map.hpp>
 
@@ -115,7 +116,17 @@ class LLTextureCache final : public LLWorkerThread
     LLTextureCache(bool threaded);
     ~LLTextureCache();
 
+    // A read hit only writes a new entry time stamp when the old one is too
+    // stale to order the purge, or older than the LRU, which would evict it
+    static const U32 sTimeStampGranularity = 60 * 60; // seconds
+    static bool needsTimeStamp(U32 entry_time, U32 now, U32 lru_time)
+    {
+        return isEvictableFromLRU(entry_time, lru_time) || now - entry_time >= sTimeStampGranularity;
+    }
+    static bool isEvictableFromLRU(U32 entry_time, U32 lru_time) { return entry_time < lru_time; }
+
     /*virtual*/ size_t update(F32 max_time_ms);
+    /*virtual*/ void threadedUpdate() override;
 
     void purgeCache(ELLPath location, bool remove_dir = true);
     void setReadOnly(BOOL read_only) ;
@@ -144,6 +155,8 @@ class LLTextureCache final : public LLWorkerThread
     // debug
     S32 getNumReads() { return mReaders.size(); }
     S32 getNumWrites() { return mWriters.size(); }
+    S32 getNumPendingWrites();
+    S64Bytes getPendingWritesSavedBytes() { return S64Bytes(mPendingWritesSavedBytes); }
     S64Bytes getUsage() { return S64Bytes(mTexturesSizeTotal); }
     S64Bytes getMaxUsage() { return S64Bytes(sCacheMaxTexturesSize); }
     U32 getEntries() { return mHeaderEntriesInfo.mEntries; }
@@ -156,6 +169,7 @@ class LLTextureCache final : public LLWorkerThread
     std::string getLocalFileName(const LLUUID& id);
     std::string getTextureFileName(const LLUUID& id);
     void addCompleted(Responder* responder, bool success);
+    bool readFromPendingWrites(const LLUUID& id, S32 offset, S32& size, S32& imagesize, U8*& data);
 
 protected:
     //void setFileAPRPool(apr_pool_t* pool) { mFileAPRPool = pool ; }
@@ -167,8 +181,8 @@ class LLTextureCache final : public LLWorkerThread
     void purgeAllTextures(bool purge_directories);
     void purgeTexturesLazy(F32 time_limit_sec);
     void purgeTextures(bool validate);
-    LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
-    void closeHeaderEntriesFile();
+    bool mapHeaderEntries(U32 min_entries);
+    void unmapHeaderEntries();
     void readEntriesHeader();
     void setEntriesHeader();
     void writeEntriesHeader();
@@ -177,20 +191,53 @@ class LLTextureCache final : public LLWorkerThread
     void updateEntryTimeStamp(S32 idx, Entry& entry) ;
     U32 openAndReadEntries(std::vector<Entry>& entries);
     void writeEntriesAndClose(const std::vector<Entry>& entries);
-    void readEntryFromHeaderImmediately(S32& idx, Entry& entry) ;
+    Entry* getMappedEntry(S32 idx);
     void writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header = false) ;
     void removeEntry(S32 idx, Entry& entry, std::string& filename);
     void removeCachedTexture(const LLUUID& id) ;
     S32 getHeaderCacheEntry(const LLUUID& id, Entry& entry);
     S32 setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize);
-    void writeUpdatedEntries() ;
-    void updatedHeaderEntriesFile() ;
+    void flushHeaderEntries() ;
     void lockHeaders() { mHeaderMutex.lock(); }
     void unlockHeaders() { mHeaderMutex.unlock(); }
 
-    void openFastCache(bool first_time = false);
-    void closeFastCache(bool forced = false);
+    // The id -> entry index is split in shards, each with its own mutex.
+    // A lookup only ever locks the shard of the id it is after, and reads
+    // the entry itself straight from the mapped entries file while holding
+    // that lock. Anything that adds, evicts or purges entries takes
+    // mHeaderMutex first, and is the only code allowed to hold more than
+    // one shard at a time.
+    struct HeaderIndexShard;
+    HeaderIndexShard& getHeaderIndexShard(const LLUUID& id);
+    S32 findHeaderEntry(const LLUUID& id);
+    void setHeaderEntryIndex(const LLUUID& id, S32 idx);
+    void eraseHeaderEntryIndex(const LLUUID& id);
+    void lockHeaderIndex();
+    void unlockHeaderIndex();
+
+    // The fast cache keeps decoded thumbnails of cached textures, ready to
+    // be handed to GL, in tiers of increasing size. The 16px tier has one
+    // entry per header entry. The bigger tiers only keep the textures that
+    // were written last, whether or not they are still in the cache, and
+    // find them through an index rebuilt from the entries when mapped.
+    // All the tiers are memory mapped and guarded by mFastCacheMutex.
+    static const S32 sFastCacheTiers = 3;
+    struct FastCacheTier;
+    void setFastCacheTiers(S64 tiers_size);
+    void openFastCache();
+    void closeFastCache();
+    U8* getFastCacheEntry(FastCacheTier& tier, U32 entry);
     bool writeToFastCache(LLUUID image_id, S32 cache_id, LLPointer<LLImageRaw> raw, S32 discardlevel);
+    void writeFastCacheEntries(const LLUUID& id, S32 cache_id, const std::vector<U8>* entries);
+    void removeFromFastCache(const LLUUID& id);
+    static bool packFastCacheEntries(LLPointer<LLImageRaw> raw, S32 discardlevel, std::vector<U8>* entries);
+    static LLPointer<LLImageRaw> unpackFastCacheEntry(const U8* entry, S32 entry_size, S32 tier, S32& discardlevel);
+
+    // Write-behind queue. writeToCache() copies what it is given in here and
+    // returns, the cache thread writes the queue out in batches when it is
+    // not busy reading. Reads look in the queue before going to disk.
+    bool queueWrite(const LLUUID& id, U8* data, S32 datasize, S32 imagesize, LLPointer<LLImageRaw> rawimage, S32 discardlevel);
+    void flushPendingWrites();
 
 private:
     // Internal
@@ -198,8 +245,6 @@ class LLTextureCache final : public LLWorkerThread
     LLMutex mHeaderMutex;
     LLMutex mListMutex;
     LLMutex mFastCacheMutex;
-    LLAPRFile* mHeaderAPRFile;
-    LLVolatileAPRPool* mFastCachePoolp;
 
     // mLocalAPRFilePoolp is not thread safe and is meant only for workers
     // howhever mHeaderEntriesFileName is accessed not from workers' threads
@@ -223,16 +268,51 @@ class LLTextureCache final : public LLWorkerThread
     // HEADERS (Include first mip)
     std::string mHeaderEntriesFileName;
     std::string mHeaderDataFileName;
-    std::string mFastCacheFileName;
     EntriesInfo mHeaderEntriesInfo;
     std::set<S32> mFreeList; // deleted entries
     std::set<LLUUID> mLRU;
+    std::atomic<U32> mLRUTime; // entries used since then are skipped when evicting from mLRU
     typedef boost::unordered_flat_map<LLUUID, S32> id_map_t;
-    id_map_t mHeaderIDMap;
+    static const U32 sHeaderIndexShards = 16;
+    struct HeaderIndexShard
+    {
+        LLMutex mMutex;
+        id_map_t mIDMap;
+    };
+    HeaderIndexShard mHeaderIndex[sHeaderIndexShards];
 
-    LLAPRFile*   mFastCachep;
-    LLFrameTimer mFastCacheTimer;
-    U8*          mFastCachePadBuffer;
+    // texture.entries, mapped for as long as the cache is open. Only
+    // remapped (to grow it) or unmapped with every index shard locked.
+    LLMappedFile mHeaderEntriesFile;
+    U32 mHeaderEntriesCapacity;
+
+    struct PendingWrite
+    {
+        LLUUID mID;
+        S32 mImageSize = 0;
+        std::vector<U8> mData;
+        std::vector<U8> mFastCacheEntries[sFastCacheTiers]; // ready to write, empty for tiers to skip
+        bool mInFlight = false; // taken by flushPendingWrites()
+        std::atomic<bool> mCancelled = false; // removed from the cache while in flight
+    };
+    typedef boost::unordered_flat_map<LLUUID, std::shared_ptr<PendingWrite> > pending_write_map_t;
+    LLMutex mPendingWritesMutex;
+    pending_write_map_t mPendingWrites; // at most one write per texture, the one with the most data
+    LLFrameTimer mPendingWritesTimer; // since the queue was last flushed or stopped being empty
+    std::atomic<S64> mPendingWritesSavedBytes; // replaced before they were ever written
+    bool isPendingWriteEntry(const PendingWrite* write, S32 idx); // still to be written where it was given an entry
+    BOOL mWriteBehind;
+
+    struct FastCacheTier
+    {
+        std::string mFileName;
+        U32 mNumEntries = 0;
+        LLMappedFile mFile;
+        id_map_t mIDMap;        // bigger tiers only
+        U32 mNextEntry = 0;     // bigger tiers only, the next one to be replaced
+        U32 mSerial = 0;        // bigger tiers only, of the next write
+    };
+    FastCacheTier mFastCacheTiers[sFastCacheTiers];
 
     // BODIES (TEXTURES minus headers)
     std::string mTexturesDirName;
@@ -241,8 +321,6 @@ class LLTextureCache final : public LLWorkerThread
     S64 mTexturesSizeTotal;
     LLAtomicBool mDoPurge;
 
-    typedef std::map<S32, Entry> idx_entry_map_t;
-    idx_entry_map_t mUpdatedEntryMap;
     typedef std::vector<std::pair<S32, Entry> > idx_entry_vector_t;
     idx_entry_vector_t mPurgeEntryList;
 
@@ -1696,7 +1696,20 @@ bool LLTextureFetchWorker::doWork(S32 param)
                 mRequestedOffset += src_offset;
             }
 
-            U8 * buffer = (U8 *)ll_aligned_malloc_16(total_size);
+            // A body of known length arrives in one aligned block which,
+            // if it is all we have, becomes the image data as it is.
+            U8 * buffer = NULL;
+            if (0 == cur_size && 0 == src_offset)
+            {
+                size_t detached_size(0);
+                buffer = (U8 *)mHttpBufferArray->detachContiguous(&detached_size);
+                llassert(!buffer || detached_size == size_t(total_size));
+            }
+            const bool copy_body(NULL == buffer);
+            if (copy_body)
+            {
+                buffer = (U8 *)ll_aligned_malloc_16(total_size);
+            }
             if (!buffer)
             {
                 // abort. If we have no space for packet, we have not enough space to decode image
@@ -1731,7 +1744,10 @@ bool LLTextureFetchWorker::doWork(S32 param)
                 // Copy previously collected data into buffer
                 memcpy(buffer, mFormattedImage->getData(), cur_size);
             }
-            mHttpBufferArray->read(src_offset, (char *) buffer + cur_size, append_size);
+            if (copy_body)
+            {
+                mHttpBufferArray->read(src_offset, (char *) buffer + cur_size, append_size);
+            }
 
             // NOTE: setData releases current data and owns new data (buffer)
             mFormattedImage->setData(buffer, total_size);
@@ -2231,9 +2247,8 @@ S32 LLTextureFetchWorker::callbackHttpGet(LLCore::HttpResponse * response,
 #endif
         if (data_size > 0)
         {
-            // *TODO: set the formatted image data here directly to avoid the copy
-
-            // Hold on to body for later copy
+            // Hold on to body, its data goes to the formatted image
+            // in doWork(), without a copy when it is contiguous
             llassert_always(NULL == mHttpBufferArray);
             body->addRef();
             mHttpBufferArray = body;
@@ -2994,10 +3009,13 @@ bool LLTextureFetch::runCondition()
 void LLTextureFetch::commonUpdate()
 {
     LL_PROFILE_ZONE_SCOPED;
-    // Update low/high water levels based on pipelining.  We pick
-    // up setting eventually, so the semaphore/request level can
-    // fall outside the [0..HIGH_WATER] range.  Expect that.
-    if (LLAppViewer::instance()->getAppCoreHttp().isPipelined(LLAppCoreHttp::AP_TEXTURE))
+    // Update low/high water levels based on pipelining or
+    // multiplexing.  We pick up setting eventually, so the
+    // semaphore/request level can fall outside the
+    // [0..HIGH_WATER] range.  Expect that.
+    const LLAppCoreHttp & app_core_http(LLAppViewer::instance()->getAppCoreHttp());
+    if (app_core_http.isPipelined(LLAppCoreHttp::AP_TEXTURE)
+        || app_core_http.isMultiplexed(LLAppCoreHttp::AP_TEXTURE))
     {
         mHttpHighWater = HTTP_PIPE_REQUESTS_HIGH_WATER;
         mHttpLowWater = HTTP_PIPE_REQUESTS_LOW_WATER;
@@ -572,11 +572,13 @@ void LLGLTexMemBar::draw()
 
     //----------------------------------------------------------------------------
 
-    text = llformat("Textures: %d Fetch: %d(%d) Pkts:%d(%d) Cache R/W: %d/%d LFS:%d RAW:%d HTP:%d DEC:%d CRE:%d ",
+    text = llformat("Textures: %d Fetch: %d(%d) Pkts:%d(%d) Cache R/W/Q: %d/%d/%d Saved: %d KB LFS:%d RAW:%d HTP:%d DEC:%d CRE:%d ",
                     gTextureList.getNumImages(),
                     LLAppViewer::getTextureFetch()->getNumRequests(), LLAppViewer::getTextureFetch()->getNumDeletes(),
                     LLAppViewer::getTextureFetch()->mPacketCount, LLAppViewer::getTextureFetch()->mBadPacketCount,
                     LLAppViewer::getTextureCache()->getNumReads(), LLAppViewer::getTextureCache()->getNumWrites(),
+                    LLAppViewer::getTextureCache()->getNumPendingWrites(),
+                    (S32)S32Kilobytes(LLAppViewer::getTextureCache()->getPendingWritesSavedBytes()).value(),
                     LLLFSThread::sLocal->getPending(),
                     LLImageRaw::sRawImageCount,
                     LLAppViewer::getTextureFetch()->getNumHTTPRequests(),
@@ -601,7 +603,7 @@ void LLGLTexMemBar::draw()
     text = llformat("Mesh: Reqs(Tot/Htp/Big): %u/%u/%u Rtr/Err: %u/%u Cread/Cwrite: %u/%u Low/At/High: %d/%d/%d",
                     LLMeshRepository::sMeshRequestCount, LLMeshRepository::sHTTPRequestCount, LLMeshRepository::sHTTPLargeRequestCount,
                     LLMeshRepository::sHTTPRetryCount, LLMeshRepository::sHTTPErrorCount,
-                    LLMeshRepository::sCacheReads, LLMeshRepository::sCacheWrites,
+                    LLMeshRepository::sCacheReads.load(), LLMeshRepository::sCacheWrites.load(),
                     LLMeshRepoThread::sRequestLowWater, LLMeshRepoThread::sRequestWaterLevel, LLMeshRepoThread::sRequestHighWater);
     LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, v_offset + line_height*2,
                                              text_color, LLFontGL::LEFT, LLFontGL::TOP);
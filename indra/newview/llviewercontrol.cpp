@@ -334,6 +334,12 @@ static bool handleFlexLODChanged(const LLSD& newvalue)
     return true;
 }
 
+static bool handleRaycastUseBVHChanged(const LLSD& newvalue)
+{
+    LLVolume::sUseBVH = newvalue.asBoolean();
+    return true;
+}
+
 static bool handleGammaChanged(const LLSD& newvalue)
 {
     F32 gamma = (F32) newvalue.asReal();
@@ -812,6 +818,7 @@ void settings_setup_listeners()
     setting_setup_signal_listener(gSavedSettings, "RenderTerrainLODFactor", handleTerrainLODChanged);
     setting_setup_signal_listener(gSavedSettings, "RenderTreeLODFactor", handleTreeLODChanged);
     setting_setup_signal_listener(gSavedSettings, "RenderFlexTimeFactor", handleFlexLODChanged);
+    setting_setup_signal_listener(gSavedSettings, "RaycastUseBVH", handleRaycastUseBVHChanged);
     setting_setup_signal_listener(gSavedSettings, "RenderGamma", handleGammaChanged);
     setting_setup_signal_listener(gSavedSettings, "RenderFogRatio", handleFogRatioChanged);
     setting_setup_signal_listener(gSavedSettings, "RenderMaxPartCount", handleMaxPartCountChanged);
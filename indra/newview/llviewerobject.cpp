@@ -42,6 +42,7 @@
 #include "llinventory.h"
 #include "llinventorydefines.h"
 #include "llmaterialtable.h"
+#include "llmessagefield.h"
 #include "llmutelist.h"
 #include "llnamevalue.h"
 #include "llprimitive.h"
@@ -1305,19 +1306,32 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                 F32    cutoff;
                 U8     sound_flags;
 
-                mesgsys->getU32Fast( _PREHASH_ObjectData, _PREHASH_CRC, crc, block_num);
-                mesgsys->getU32Fast( _PREHASH_ObjectData, _PREHASH_ParentID, parent_id, block_num);
-                mesgsys->getUUIDFast(_PREHASH_ObjectData, _PREHASH_Sound, audio_uuid, block_num );
+                // read for every full update, so looked up by index rather than by name
+                static const LLMessageField crc_field(_PREHASH_ObjectData, _PREHASH_CRC);
+                static const LLMessageField parent_id_field(_PREHASH_ObjectData, _PREHASH_ParentID);
+                static const LLMessageField sound_field(_PREHASH_ObjectData, _PREHASH_Sound);
+                static const LLMessageField owner_id_field(_PREHASH_ObjectData, _PREHASH_OwnerID);
+                static const LLMessageField gain_field(_PREHASH_ObjectData, _PREHASH_Gain);
+                static const LLMessageField radius_field(_PREHASH_ObjectData, _PREHASH_Radius);
+                static const LLMessageField flags_field(_PREHASH_ObjectData, _PREHASH_Flags);
+                static const LLMessageField material_field(_PREHASH_ObjectData, _PREHASH_Material);
+                static const LLMessageField click_action_field(_PREHASH_ObjectData, _PREHASH_ClickAction);
+                static const LLMessageField scale_field(_PREHASH_ObjectData, _PREHASH_Scale);
+                static const LLMessageField object_data_field(_PREHASH_ObjectData, _PREHASH_ObjectData);
+
+                mesgsys->getU32Fast( crc_field, crc, block_num);
+                mesgsys->getU32Fast( parent_id_field, parent_id, block_num);
+                mesgsys->getUUIDFast(sound_field, audio_uuid, block_num );
                 // HACK: Owner id only valid if non-null sound id or particle system
-                mesgsys->getUUIDFast(_PREHASH_ObjectData, _PREHASH_OwnerID, owner_id, block_num );
-                mesgsys->getF32Fast( _PREHASH_ObjectData, _PREHASH_Gain, gain, block_num );
-                mesgsys->getF32Fast(  _PREHASH_ObjectData, _PREHASH_Radius, cutoff, block_num );
-                mesgsys->getU8Fast(  _PREHASH_ObjectData, _PREHASH_Flags, sound_flags, block_num );
-                mesgsys->getU8Fast(  _PREHASH_ObjectData, _PREHASH_Material, material, block_num );
-                mesgsys->getU8Fast(  _PREHASH_ObjectData, _PREHASH_ClickAction, click_action, block_num);
-                mesgsys->getVector3Fast(_PREHASH_ObjectData, _PREHASH_Scale, new_scale, block_num );
-                length = mesgsys->getSizeFast(_PREHASH_ObjectData, block_num, _PREHASH_ObjectData);
-                mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_ObjectData, data, length, block_num, MAX_OBJECT_BINARY_DATA_SIZE);
+                mesgsys->getUUIDFast(owner_id_field, owner_id, block_num );
+                mesgsys->getF32Fast( gain_field, gain, block_num );
+                mesgsys->getF32Fast(  radius_field, cutoff, block_num );
+                mesgsys->getU8Fast(  flags_field, sound_flags, block_num );
+                mesgsys->getU8Fast(  material_field, material, block_num );
+                mesgsys->getU8Fast(  click_action_field, click_action, block_num);
+                mesgsys->getVector3Fast(scale_field, new_scale, block_num );
+                length = mesgsys->getSizeFast(object_data_field, block_num);
+                mesgsys->getBinaryDataFast(object_data_field, data, length, block_num, MAX_OBJECT_BINARY_DATA_SIZE);
 
                 mTotalCRC = crc;
                 // Might need to update mSourceMuted here to properly pick up new radius
@@ -2623,6 +2637,31 @@ void LLViewerObject::idleUpdate(LLAgent &agent, const F64 &frame_time)
     }
 }
 
+void LLViewerObject::idleUpdateAtRest(const F64 &frame_time, F32 dt)
+{
+    if (mDead)
+    {
+        return;
+    }
+
+    // all applyAngularVelocity() does below its threshold
+    mRotTime += dt;
+
+    if (isAttachment())
+    {
+        mLastInterpUpdateSecs = (F64Seconds)frame_time;
+        return;
+    }
+
+    // all interpolateLinearMotion() does with nothing to move
+    if ((F64Seconds)frame_time - mLastMessageUpdateSecs > (F64Seconds)0.0 && dt > 0.f)
+    {
+        mLastInterpUpdateSecs = (F64Seconds)frame_time;
+    }
+
+    updateDrawable(FALSE);
+}
+
 
 // Move an object due to idle-time viewer side updates by interpolating motion
 void LLViewerObject::interpolateLinearMotion(const F64SecondsImplicit& frame_time, const F32SecondsImplicit& dt_seconds)
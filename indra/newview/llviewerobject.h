@@ -170,6 +170,9 @@ class LLViewerObject
 
     // Object create and update functions
     virtual void    idleUpdate(LLAgent &agent, const F64 &time);
+    // What idleUpdate() does for an interpolated object with no velocity, acceleration
+    // or angular velocity to apply, dt is the time dilated time since the last interpolation
+    void            idleUpdateAtRest(const F64 &time, F32 dt);
 
     // Types of media we can associate
     enum { MEDIA_NONE = 0, MEDIA_SET = 1 };
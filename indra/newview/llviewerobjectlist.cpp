@@ -29,6 +29,7 @@
 #include "llviewerobjectlist.h"
 
 #include "message.h"
+#include "llmessagefield.h"
 #include "llfasttimer.h"
 #include "llrender.h"
 #include "llwindow.h"       // decBusyCount()
@@ -84,6 +85,7 @@
 #include "llvocache.h"
 #include "llcorehttputil.h"
 #include "llstartup.h"
+#include "parallelfor.h"
 
 #include <algorithm>
 #include <iterator>
@@ -230,6 +232,12 @@ void LLViewerObjectList::setUUIDAndLocal(const LLUUID &id,
 S32 gFullObjectUpdates = 0;
 S32 gTerseObjectUpdates = 0;
 
+// Compressed updates unpacked per task, a message rarely holds more than a few dozen
+const S32 OBJECT_UPDATE_DECODE_GRAIN = 8;
+
+// Active objects gathered per task
+const S32 ACTIVE_MOTION_GATHER_GRAIN = 512;
+
 void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
                                            void** user_data,
                                            U32 i,
@@ -424,6 +432,12 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
     LLUUID      fullid;
     S32         i;
 
+    // read once per object, so looked up by index rather than by name
+    static const LLMessageField object_data(_PREHASH_ObjectData, _PREHASH_Data);
+    static const LLMessageField update_flags(_PREHASH_ObjectData, _PREHASH_UpdateFlags);
+    static const LLMessageField object_local_id(_PREHASH_ObjectData, _PREHASH_ID);
+    static const LLMessageField object_full_id(_PREHASH_ObjectData, _PREHASH_FullID);
+
     // figure out which simulator these are from and get it's index
     // Coordinates in simulators are region-local
     // Until we get region-locality working on viewer we
@@ -477,57 +491,98 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
         return;
     }
 
-    U8 compressed_dpbuffer[2048];
-    LLDataPackerBinaryBuffer compressed_dp(compressed_dpbuffer, 2048);
-    LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
-
+    // Read each object out of the message first, then unpack the compressed
+    // payloads and build the object cache entries in parallel since that
+    // only touches the updates themselves. What is left is applied in order.
+    mObjectUpdates.resize(num_objects);
     for (i = 0; i < num_objects; i++)
     {
-        BOOL justCreated = FALSE;
-        bool update_cache = false; //update object cache if it is a full-update or terse update
+        ObjectUpdate& update = mObjectUpdates[i];
+        update.mLocalID = 0;
+        update.mFullID.setNull();
+        update.mPCode = 0;
+        update.mFlags = 0;
+        update.mDataSize = 0;
+        update.mDataOffset = 0;
+        update.mCacheEntry = NULL;
 
         if (compressed)
         {
-            compressed_dp.reset();
-
-            S32 uncompressed_length = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
 #ifdef SHOW_DEBUG
-            LL_DEBUGS("ObjectUpdate") << "got binary data from message to compressed_dpbuffer" << LL_ENDL;
+            LL_DEBUGS("ObjectUpdate") << "got binary data from message to compressed data" << LL_ENDL;
 #endif
-            mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, compressed_dpbuffer, 0, i, 2048);
-            compressed_dp.assignBuffer(compressed_dpbuffer, uncompressed_length);
-
+            update.mDataSize = llclamp(mesgsys->getSizeFast(object_data, i), 0, (S32)sizeof(update.mData));
+            mesgsys->getBinaryDataFast(object_data, update.mData, 0, i, sizeof(update.mData));
             if (update_type != OUT_TERSE_IMPROVED) // OUT_FULL_COMPRESSED only?
             {
-                U32 flags = 0;
-                mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+                mesgsys->getU32Fast(update_flags, update.mFlags, i);
+            }
+        }
+        else
+        {
+            if (update_type == OUT_FULL)
+            {
+                mesgsys->getUUIDFast(object_full_id, update.mFullID, i);
+            }
+            mesgsys->getU32Fast(object_local_id, update.mLocalID, i);
+        }
+    }
 
-                compressed_dp.unpackUUID(fullid, "ID");
-                compressed_dp.unpackU32(local_id, "LocalID");
-                compressed_dp.unpackU8(pcode, "PCode");
+    if (compressed)
+    {
+        static LLCachedControl<bool> parallel_decode(gSavedSettings, "ObjectUpdateParallelDecode", true);
+        LL::parallelFor(parallel_decode ? "Parallel" : "", num_objects, OBJECT_UPDATE_DECODE_GRAIN,
+                        [this, update_type](size_t begin, size_t end)
+                        {
+                            for (size_t index = begin; index < end; ++index)
+                            {
+                                unpackCompressedUpdate(mObjectUpdates[index], update_type);
+                            }
+                        });
+    }
 
+    LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
+
+    for (i = 0; i < num_objects; i++)
+    {
+        BOOL justCreated = FALSE;
+        bool update_cache = false; //update object cache if it is a full-update or terse update
+
+        ObjectUpdate& update = mObjectUpdates[i];
+        local_id = update.mLocalID;
+        fullid = update.mFullID;
+        pcode = update.mPCode;
+
+        // positioned after the fields that were unpacked already
+        LLDataPackerBinaryBuffer compressed_dp(update.mData, update.mDataSize);
+        compressed_dp.shift(update.mDataOffset);
+
+        if (compressed)
+        {
+            if (update_type != OUT_TERSE_IMPROVED) // OUT_FULL_COMPRESSED only?
+            {
                 if (pcode == 0)
                 {
                     // object creation will fail, LLViewerObject::createObject()
                     LL_WARNS() << "Received object " << fullid
                         << " with 0 PCode. Local id: " << local_id
-                        << " Flags: " << flags
+                        << " Flags: " << update.mFlags
                         << " Region: " << regionp->getName()
                         << " Region id: " << regionp->getRegionID() << LL_ENDL;
                     recorder.objectUpdateFailure();
                     continue;
                 }
-                else if ((flags & FLAGS_TEMPORARY_ON_REZ) == 0)
+                else if (update.mCacheEntry) // (flags & FLAGS_TEMPORARY_ON_REZ) == 0
                 {
                     //send to object cache
-                    regionp->cacheFullUpdate(compressed_dp, flags);
+                    regionp->cacheFullUpdate(update.mCacheEntry, update.mFlags);
+                    update.mCacheEntry = NULL;
                     continue;
                 }
             }
             else //OUT_TERSE_IMPROVED
             {
                 update_cache = true;
-                compressed_dp.unpackU32(local_id, "LocalID");
                 getUUIDFromLocal(fullid,
                                  local_id,
                                  gMessageSystem->getSenderIP(),
@@ -543,8 +598,6 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
         }
         else if (update_type != OUT_FULL) // !compressed, !OUT_FULL ==> OUT_FULL_CACHED only?
         {
-            mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
-
             getUUIDFromLocal(fullid,
                             local_id,
                             gMessageSystem->getSenderIP(),
@@ -564,8 +617,6 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
         else // OUT_FULL only?
         {
             update_cache = true;
-            mesgsys->getUUIDFast(_PREHASH_ObjectData, _PREHASH_FullID, fullid, i);
-            mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
 #ifdef SHOW_DEBUG
             LL_DEBUGS("ObjectUpdate") << "Full Update, obj " << local_id << ", global ID " << fullid << " from " << mesgsys->getSender() << LL_ENDL;
 #endif
@@ -713,7 +764,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
             if (update_type != OUT_TERSE_IMPROVED) // OUT_FULL_COMPRESSED only?
             {
                 U32 flags = 0;
-                mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+                mesgsys->getU32Fast(update_flags, flags, i);
 
                 if(!(flags & FLAGS_TEMPORARY_ON_REZ))
                 {
@@ -739,6 +790,37 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
     LLVOAvatar::cullAvatarsByPixelArea();
 }
 
+//static
+void LLViewerObjectList::unpackCompressedUpdate(ObjectUpdate& update, const EObjectUpdateType update_type)
+{
+    LLDataPackerBinaryBuffer dp(update.mData, update.mDataSize);
+
+    if (update_type != OUT_TERSE_IMPROVED) // OUT_FULL_COMPRESSED only?
+    {
+        dp.unpackUUID(update.mFullID, "ID");
+        dp.unpackU32(update.mLocalID, "LocalID");
+        dp.unpackU8(update.mPCode, "PCode");
+        update.mDataOffset = dp.getCurrentSize();
+
+        if (update.mPCode != 0 && (update.mFlags & FLAGS_TEMPORARY_ON_REZ) == 0)
+        {
+            // goes to the object cache, see LLViewerRegion::cacheFullUpdate()
+            // Read straight after State, LLViewerObject::unpackU32() looks the
+            // offset up in a shared map and is not safe off the main thread
+            U32 crc = 0;
+            dp.shift(update.mDataOffset + sizeof(U8));
+            dp.unpackU32(crc, "CRC");
+            dp.reset();
+            update.mCacheEntry = new LLVOCacheEntry(update.mLocalID, crc, dp);
+        }
+    }
+    else //OUT_TERSE_IMPROVED
+    {
+        dp.unpackU32(update.mLocalID, "LocalID");
+        update.mDataOffset = dp.getCurrentSize();
+    }
+}
+
 void LLViewerObjectList::processCompressedObjectUpdate(LLMessageSystem *mesgsys,
                                              void **user_data,
                                              const EObjectUpdateType update_type)
@@ -764,16 +846,27 @@ void LLViewerObjectList::processCachedObjectUpdate(LLMessageSystem *mesgsys,
         return;
     }
 
+    static const LLMessageField object_id(_PREHASH_ObjectData, _PREHASH_ID);
+    static const LLMessageField object_crc(_PREHASH_ObjectData, _PREHASH_CRC);
+    static const LLMessageField update_flags(_PREHASH_ObjectData, _PREHASH_UpdateFlags);
+
+    // Read the whole message before probing the cache
+    mObjectUpdates.resize(num_objects);
+    for (S32 i = 0; i < num_objects; i++)
+    {
+        ObjectUpdate& update = mObjectUpdates[i];
+        mesgsys->getU32Fast(object_id, update.mLocalID, i);
+        mesgsys->getU32Fast(object_crc, update.mCRC, i);
+        mesgsys->getU32Fast(update_flags, update.mFlags, i);
+    }
+
     LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
 
     for (S32 i = 0; i < num_objects; i++)
     {
-        U32 id;
-        U32 crc;
-        U32 flags;
-        mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, id, i);
-        mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_CRC, crc, i);
-        mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+        const U32 id = mObjectUpdates[i].mLocalID;
+        const U32 crc = mObjectUpdates[i].mCRC;
+        const U32 flags = mObjectUpdates[i].mFlags;
 
 #ifdef SHOW_DEBUG
         LL_DEBUGS("ObjectUpdate") << "got probe for id " << id << " crc " << crc << LL_ENDL;
@@ -910,6 +1003,45 @@ void LLViewerObjectList::updateApparentAngles(LLAgent &agent)
     LLVOAvatar::cullAvatarsByPixelArea();
 }
 
+void LLViewerObjectList::ActiveMotion::resize(size_t count)
+{
+    mDt.resize(count);
+    mFlags.resize(count);
+}
+
+void LLViewerObjectList::gatherActiveMotion(LLViewerObject* const* objects, size_t begin, size_t end, F64 frame_time)
+{
+    ActiveMotion& motion = mActiveMotion;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        const LLViewerObject* objectp = objects[i];
+
+        // Same sum as LLViewerObject::idleUpdate()
+        const F32 time_dilation = objectp->mRegionp ? objectp->mRegionp->getTimeDilation() : 1.0f;
+        motion.mDt[i] = time_dilation * (F32)(frame_time - objectp->mLastInterpUpdateSecs.value());
+
+        U8 flags = 0;
+        if (objectp->getPCode() != LL_PCODE_VOLUME)
+        {
+            // LLVOVolume is the only class that keeps LLViewerObject::idleUpdate()
+            flags |= ActiveMotion::OWN_IDLE_UPDATE;
+        }
+        if (!objectp->mDead && !objectp->mStatic && LLViewerObject::sVelocityInterpolate && !objectp->isSelected())
+        {
+            flags |= ActiveMotion::INTERPOLATE;
+        }
+        // Anything applyAngularVelocity() or interpolateLinearMotion() would move
+        if (!objectp->getVelocity().isExactlyZero()
+            || !objectp->getAcceleration().isExactlyZero()
+            || objectp->getAngularVelocity().lengthSquared() > 0.00001f)
+        {
+            flags |= ActiveMotion::MOVING;
+        }
+        motion.mFlags[i] = flags;
+    }
+}
+
 void LLViewerObjectList::update(LLAgent &agent)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
@@ -1016,12 +1148,54 @@ void LLViewerObjectList::update(LLAgent &agent)
     }
     else
     {
-        for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list.begin();
-            idle_iter != idle_end; idle_iter++)
-        {
-            objectp = *idle_iter;
+        // Work out which objects move first, then only visit those that
+        // need more than the bookkeeping of an object at rest
+        static LLCachedControl<bool> parallel_gather(gSavedSettings, "ActiveObjectParallelGather", true);
+        static LLCachedControl<bool> parallel_skeletons(gSavedSettings, "AvatarParallelSkeletonUpdate", true);
+        mActiveMotion.resize(idle_count);
+        LLViewerObject* const* objects = idle_list.data();
+        LL::parallelFor(parallel_gather ? "Parallel" : "", idle_count, ACTIVE_MOTION_GATHER_GRAIN,
+                        [this, objects, frame_time](size_t begin, size_t end)
+                        {
+                            gatherActiveMotion(objects, begin, end, frame_time);
+                        });
+
+        auto idle_update = [this, &agent, frame_time](U32 i)
+        {
+            LLViewerObject* objectp = idle_list[i];
             llassert(objectp->isActive());
+            const U8 flags = mActiveMotion.mFlags[i];
+            if (flags & (ActiveMotion::OWN_IDLE_UPDATE | ActiveMotion::MOVING))
+            {
                 objectp->idleUpdate(agent, frame_time);
+            }
+            else if (flags & ActiveMotion::INTERPOLATE)
+            {
+                objectp->idleUpdateAtRest(frame_time, mActiveMotion.mDt[i]);
+            }
+            else if (!objectp->isDead())
+            {
+                objectp->updateDrawable(FALSE);
+            }
+        };
+
+        // Avatars are posed together once every object has had its turn,
+        // what reads their skeletons waits for that
+        LLVOAvatar::deferSkeletonUpdates(parallel_skeletons);
+        mIdleAfterSkeletons.clear();
+        for (U32 i = 0; i < idle_count; i++)
+        {
+            if (LLVOAvatar::readsDeferredSkeleton(idle_list[i]))
+            {
+                mIdleAfterSkeletons.push_back(i);
+                continue;
+            }
+            idle_update(i);
+        }
+        LLVOAvatar::updateDeferredSkeletons();
+        for (U32 i : mIdleAfterSkeletons)
+        {
+            idle_update(i);
         }
 
         //update flexible objects
@@ -234,6 +234,51 @@ class LLViewerObjectList
     friend class LLViewerObject;
 
 private:
+    // An object of an ObjectUpdate, ObjectUpdateCompressed,
+    // ImprovedTerseObjectUpdate or ObjectUpdateCached message, read out
+    // before it is applied
+    struct ObjectUpdate
+    {
+        U32         mLocalID;
+        LLUUID      mFullID;
+        LLPCode     mPCode;
+        U32         mFlags;
+        U32         mCRC;           // ObjectUpdateCached only
+        S32         mDataSize;      // compressed payload
+        S32         mDataOffset;    // past the fields unpacked into this
+        U8          mData[2048];
+        LLPointer<LLVOCacheEntry> mCacheEntry; // new cache entry for a cacheable full update
+    };
+
+    // Called off the main thread, only reads and writes update
+    static void unpackCompressedUpdate(ObjectUpdate& update, const EObjectUpdateType update_type);
+
+    std::vector<ObjectUpdate> mObjectUpdates; // reused for every message
+
+    // Per frame classification of the active objects, so update() only
+    // calls idleUpdate() on those that need it.  The motion state itself
+    // stays in the objects, this only holds what update() reads back
+    struct ActiveMotion
+    {
+        enum
+        {
+            OWN_IDLE_UPDATE = 1 << 0,   // not a plain volume
+            INTERPOLATE     = 1 << 1,   // velocity interpolation applies
+            MOVING          = 1 << 2,   // has velocity, acceleration or angular velocity to apply
+        };
+
+        void resize(size_t count);
+
+        std::vector<F32> mDt;           // time dilated seconds since the last interpolation
+        std::vector<U8>  mFlags;
+    };
+    ActiveMotion mActiveMotion;
+    std::vector<U32> mIdleAfterSkeletons; // indices of active objects updated after the avatars are posed
+
+    // Fills in mActiveMotion for objects[begin, end), safe to call from any thread
+    // while the objects are left alone
+    void gatherActiveMotion(LLViewerObject* const* objects, size_t begin, size_t end, F64 frame_time);
+
     static void reportObjectCostFailure(LLSD &objectList);
     void fetchObjectCostsCoro(std::string url, uuid_hash_set_t staleObjects);
 
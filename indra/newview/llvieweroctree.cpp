@@ -1310,7 +1310,7 @@ LLViewerOctreePartition::LLViewerOctreePartition() :
     center.splat(0.f);
     size.splat(1.f);
 
-    mOctree = new OctreeRoot(center,size, NULL);
+    mOctree = new OctreeRoot(center, size, NULL, &mOctreePool);
 }
 
 LLViewerOctreePartition::~LLViewerOctreePartition()
@@ -1322,6 +1322,7 @@ void LLViewerOctreePartition::cleanup()
 {
     delete mOctree;
     mOctree = nullptr;
+    mOctreePool.reset();
 }
 
 BOOL LLViewerOctreePartition::isOcclusionEnabled()
@@ -359,6 +359,7 @@ class LLViewerOctreePartition
 public:
     U32              mPartitionType;
     U32              mDrawableType;
+    LLOctreePool     mOctreePool; // nodes and element arrays of mOctree, must outlive it
     OctreeNode*      mOctree;
     LLViewerRegion*  mRegionp; // the region this partition belongs to.
     BOOL             mOcclusionEnabled; // if TRUE, occlusion culling is performed
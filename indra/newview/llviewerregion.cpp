@@ -648,7 +648,9 @@ LLViewerRegion::LLViewerRegion(const U64 &handle,
     mLegacyHttpUrl(""),
     mViewerAssetUrl(""),
     mCacheLoaded(FALSE),
+    mCacheLoading(FALSE),
     mCacheDirty(FALSE),
+    mHandshakeReplyPending(FALSE),
     mReleaseNotesRequested(FALSE),
     mCapabilitiesState(CAPABILITIES_STATE_INIT),
     mSimulatorFeaturesReceived(false),
@@ -772,6 +774,11 @@ LLViewerRegion::~LLViewerRegion()
 #endif
     std::for_each(mImpl->mObjectPartition.begin(), mImpl->mObjectPartition.end(), DeletePointer());
 
+    if (mCacheLoading && LLVOCache::instanceExists())
+    {
+        LLVOCache::instance().cancelRead(mHandle);
+    }
+
     {
         LL_RECORD_BLOCK_TIME(FTM_SAVE_REGION_CACHE);
         saveObjectCache();
@@ -817,15 +824,30 @@ void LLViewerRegion::loadObjectCache()
 
     if(LLVOCache::instanceExists())
     {
-        LLVOCache & vocache = LLVOCache::instance();
-        // Without this a "corrupted" vocache persists until a cache clear or other rewrite. Mark as dirty hereif read fails to force a rewrite.
-        mCacheDirty = !vocache.readFromCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap);
-        vocache.readGenericExtrasFromCache(mHandle, mImpl->mCacheID, mImpl->mGLTFOverridesLLSD, mImpl->mCacheMap);
+        // The file is read on the cache thread, the callback may also run right away
+        // if the region was prefetched.
+        mCacheLoading = TRUE;
+        LLVOCache::instance().readFromCache(mHandle, mImpl->mCacheID,
+            [this](bool success, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map,
+                   LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map)
+            {
+                mImpl->mCacheMap.swap(cache_entry_map);
+                mImpl->mGLTFOverridesLLSD.swap(cache_extras_entry_map);
+                onObjectCacheLoaded(success);
+            });
+    }
+}
 
-        if (mImpl->mCacheMap.empty())
-        {
-            mCacheDirty = TRUE;
-        }
+void LLViewerRegion::onObjectCacheLoaded(bool success)
+{
+    mCacheLoading = FALSE;
+
+    // Without this a "corrupted" vocache persists until a cache clear or other rewrite. Mark as dirty hereif read fails to force a rewrite.
+    mCacheDirty = !success || mImpl->mCacheMap.empty();
+
+    if (mHandshakeReplyPending)
+    {
+        sendRegionHandshakeReply();
     }
 }
 
@@ -849,8 +871,7 @@ void LLViewerRegion::saveObjectCache()
 
         LLVOCache & instance = LLVOCache::instance();
 
-        instance.writeToCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap, mCacheDirty, removal_enabled);
-        instance.writeGenericExtrasToCache(mHandle, mImpl->mCacheID, mImpl->mGLTFOverridesLLSD, mCacheDirty, removal_enabled);
+        instance.writeToCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap, mImpl->mGLTFOverridesLLSD, mCacheDirty, removal_enabled);
         mCacheDirty = FALSE;
     }
 
@@ -2870,13 +2891,22 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 
 LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags)
 {
-    eCacheUpdateResult result;
     U32 crc;
     U32 local_id;
 
     LLViewerObject::unpackU32(&dp, local_id, "LocalID");
     LLViewerObject::unpackU32(&dp, crc, "CRC");
 
+    LLPointer<LLVOCacheEntry> new_entry = new LLVOCacheEntry(local_id, crc, dp);
+    return cacheFullUpdate(new_entry, flags);
+}
+
+LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLVOCacheEntry* new_entry, U32 flags)
+{
+    eCacheUpdateResult result;
+    const U32 crc = new_entry->getCRC();
+    const U32 local_id = new_entry->getLocalID();
+
     LLVOCacheEntry* entry = getCacheEntry(local_id, false);
 
     if (entry)
@@ -2907,7 +2937,7 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerB
 #endif
 
             // Update the cache entry
-            entry->updateEntry(crc, dp);
+            entry->updateEntry(crc, *new_entry->getDP());
 
 //          decodeBoundingInfo(entry);
 
@@ -2929,7 +2959,7 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerB
         // we haven't seen this object before
         // Create new entry and add to map
         result = CACHE_UPDATE_ADDED;
-        entry = new LLVOCacheEntry(local_id, crc, dp);
+        entry = new_entry;
         record(LLStatViewer::OBJECT_CACHE_HIT_RATE, LLUnits::Ratio::fromValue(0));
 
         mImpl->mCacheMap[local_id] = entry;
@@ -3174,6 +3204,15 @@ void LLViewerRegion::dumpCache()
     {
         LL_INFOS() << "Changes " << i << " " << change_bin[i] << LL_ENDL;
     }
+    for (U32 type = 0; type < mImpl->mObjectPartition.size(); ++type)
+    {
+        const LLViewerOctreePartition* part = mImpl->mObjectPartition[type];
+        if (part)
+        {
+            LL_INFOS() << "Octree partition " << type << " nodes " << part->mOctreePool.getBytesInUse()
+                       << " bytes in use, " << part->mOctreePool.getBytesReserved() << " reserved" << LL_ENDL;
+        }
+    }
     // TODO - add overrides cache too
 }
 
@@ -3334,13 +3373,25 @@ void LLViewerRegion::unpackRegionHandshake()
 
 
     // Now that we have the name, we can load the cache file
-    // off disk.
+    // off disk. The reply waits for it since it tells the simulator
+    // whether to send cache probes.
+    mHandshakeReplyPending = TRUE;
     loadObjectCache();
+    if (!mCacheLoading && mHandshakeReplyPending)
+    {
+        sendRegionHandshakeReply();
+    }
+}
+
+void LLViewerRegion::sendRegionHandshakeReply()
+{
+    mHandshakeReplyPending = FALSE;
 
     // After loading cache, signal that simulator can start
     // sending data.
     // TODO: Send all upstream viewer->sim handshake info here.
-    LLHost host = msg->getSender();
+    LLMessageSystem *msg = gMessageSystem;
+    LLHost host = getHost();
     msg->newMessageFast(_PREHASH_RegionHandshakeReply);
     msg->nextBlockFast(_PREHASH_AgentData);
     msg->addUUIDFast(_PREHASH_AgentID, gAgent.getID());
@@ -374,6 +374,8 @@ class LLViewerRegion final : public LLCapabilityProvider // implements this inte
     // handle a full update message
     eCacheUpdateResult cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags);
     eCacheUpdateResult cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinaryBuffer &dp, U32 flags);
+    // new_entry holds the update, it is added to the cache if the object is not there yet
+    eCacheUpdateResult cacheFullUpdate(LLVOCacheEntry* new_entry, U32 flags);
 
     void cacheFullUpdateGLTFOverride(const LLGLTFOverrideCacheEntry &override_data);
 
@@ -493,6 +495,8 @@ class LLViewerRegion final : public LLCapabilityProvider // implements this inte
     void decodeBoundingInfo(LLVOCacheEntry* entry);
     bool isNonCacheableObjectCreated(U32 local_id);
     void setGodnames();
+    void onObjectCacheLoaded(bool success);
+    void sendRegionHandshakeReply();
 
 public:
     void applyCacheMiscExtras(LLViewerObject* obj);
@@ -624,7 +628,9 @@ class LLViewerRegion final : public LLCapabilityProvider // implements this inte
     // Regions can have order 10,000 objects, so assume
     // a structure of size 2^14 = 16,000
     BOOL                                    mCacheLoaded;
+    BOOL                                    mCacheLoading;  // read queued on the object cache thread
     BOOL                                    mCacheDirty;
+    BOOL                                    mHandshakeReplyPending;
     BOOL    mAlive;                 // can become false if circuit disconnects
     BOOL    mSimulatorFeaturesReceived;
     BOOL    mReleaseNotesRequested;
@@ -1194,8 +1194,7 @@ void LLViewerFetchedTexture::loadFromFastCache()
         {
             if (mBoostLevel == LLGLTexture::BOOST_ICON)
             {
-                // Shouldn't do anything usefull since texures in fast cache are 16x16,
-                // it is here in case fast cache changes.
+                // Fast cache textures can be up to 256x256
                 S32 expected_width = mKnownDrawWidth > 0 ? mKnownDrawWidth : DEFAULT_ICON_DIMENSIONS;
                 S32 expected_height = mKnownDrawHeight > 0 ? mKnownDrawHeight : DEFAULT_ICON_DIMENSIONS;
                 if (mRawImage && (mRawImage->getWidth() > expected_width || mRawImage->getHeight() > expected_height))
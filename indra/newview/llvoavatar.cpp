@@ -129,6 +129,7 @@
 #include "llskinningutil.h"
 
 #include "llperfstats.h"
+#include "parallelfor.h"
 
 #include "llsidepanelappearance.h"
 #include "llviewermenufile.h"
@@ -225,6 +226,9 @@ const F32 MAX_TEXTURE_WAIT_TIME_SEC = 60;
 
 const S32 MIN_NONTUNED_AVS = 5;
 
+// avatars each thread poses at a time in updateDeferredSkeletons()
+const S32 DEFERRED_SKELETON_GRAIN = 4;
+
 enum ERenderName
 {
     RENDER_NAME_NEVER,
@@ -639,6 +643,8 @@ F32 LLVOAvatar::sGreyUpdateTime = 0.f;
 LLPointer<LLViewerTexture> LLVOAvatar::sCloudTexture = NULL;
 std::vector<LLUUID> LLVOAvatar::sAVsIgnoringARTLimit;
 S32 LLVOAvatar::sAvatarsNearby = 0;
+bool LLVOAvatar::sDeferSkeletonUpdates = false;
+std::vector<LLPointer<LLVOAvatar> > LLVOAvatar::sDeferredSkeletons;
 
 //-----------------------------------------------------------------------------
 // Helper functions
@@ -695,6 +701,9 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
     mVisibilityRank(0),
     mNeedsSkin(FALSE),
     mLastSkinTime(0.f),
+    mSkeletonUpdateDeferred(false),
+    mDeferredDetailedUpdate(false),
+    mDeferredSitOnGround(false),
     mUpdatePeriod(1),
     mOverallAppearance(AOA_INVISIBLE),
     mVisualComplexityStale(true),
@@ -884,6 +893,9 @@ void LLVOAvatar::markDead()
     }
     mVoiceVisualizer->markDead();
     LLLoadedCallbackEntry::cleanUpCallbackList(&mCallbackTextureList) ;
+    // still listed in sDeferredSkeletons if posing was deferred, which skips the dead
+    cancelDeferredBlend();
+    mSkeletonUpdateDeferred = false;
     LLViewerObject::markDead();
 }
 
@@ -2677,7 +2689,19 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
     // store off last frame's root position to be consistent with camera position
     mLastRootPos = mRoot->getWorldPosition();
     BOOL detailed_update = updateCharacter(agent);
+    if (mSkeletonUpdateDeferred)
+    {
+        // finished by updateDeferredSkeletons() once posed
+        mDeferredDetailedUpdate = detailed_update;
+        return;
+    }
 
+    idleUpdateAfterCharacter(detailed_update);
+}
+
+void LLVOAvatar::idleUpdateAfterCharacter(bool detailed_update)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
     static LLUICachedControl<bool> visualizers_in_calls("ShowVoiceVisualizersInCalls", false);
     bool voice_enabled = (visualizers_in_calls || LLVoiceClient::getInstance()->inProximalChannel()) &&
                          LLVoiceClient::getInstance()->getVoiceEnabled(mID);
@@ -4914,43 +4938,50 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     mSpeed = speed;
 
     // update animations
+    const bool defer_skeleton = sDeferSkeletonUpdates && !isSelf();
     if (!visible && !isSelf()) // NOTE: never do a "hidden update" for self avatar as it interrupts controller processing
     {
         updateMotions(LLCharacter::HIDDEN_UPDATE);
     }
     else if (mSpecialRenderMode == 1) // Animation Preview
     {
-        updateMotions(LLCharacter::FORCE_UPDATE);
+        updateMotions(LLCharacter::FORCE_UPDATE, defer_skeleton);
     }
     else
     {
         // Might be better to do HIDDEN_UPDATE if cloud
-        updateMotions(LLCharacter::NORMAL_UPDATE);
+        updateMotions(LLCharacter::NORMAL_UPDATE, defer_skeleton);
     }
 
     // Special handling for sitting on ground.
-    if (!getParent() && (isSitting() || was_sit_ground_constrained))
-    {
+    const bool sit_on_ground = !getParent() && (isSitting() || was_sit_ground_constrained);
 
-        F32 off_z = LLVector3d(getHoverOffset()).mdV[VZ];
-        if (off_z != 0.0)
+    if (defer_skeleton)
+    {
+        // the rest needs the new pose, see updateDeferredSkeletons()
+        mDeferredSitOnGround = sit_on_ground;
+        if (!mSkeletonUpdateDeferred)
         {
-            LLVector3 pos = mRoot->getWorldPosition();
-            pos.mV[VZ] += off_z;
-            mRoot->touch();
-            // SL-315
-            mRoot->setWorldPosition(pos);
+            mSkeletonUpdateDeferred = true;
+            sDeferredSkeletons.push_back(this);
         }
     }
+    else
+    {
+        if (sit_on_ground)
+        {
+            updateSitOnGroundOffset();
+        }
 
-    // update head position
-    updateHeadOffset();
+        // update head position
+        updateHeadOffset();
 
-    // Generate footstep sounds when feet hit the ground
-    updateFootstepSounds();
+        // Generate footstep sounds when feet hit the ground
+        updateFootstepSounds();
 
-    // Update child joints as needed.
-    mRoot->updateWorldMatrixChildren();
+        // Update child joints as needed.
+        mRoot->updateWorldMatrixChildren();
+    }
 
     if (visible)
     {
@@ -4961,6 +4992,100 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     return visible;
 }
 
+//-----------------------------------------------------------------------------
+// updateSitOnGroundOffset()
+//-----------------------------------------------------------------------------
+void LLVOAvatar::updateSitOnGroundOffset()
+{
+    F32 off_z = LLVector3d(getHoverOffset()).mdV[VZ];
+    if (off_z != 0.0)
+    {
+        LLVector3 pos = mRoot->getWorldPosition();
+        pos.mV[VZ] += off_z;
+        mRoot->touch();
+        // SL-315
+        mRoot->setWorldPosition(pos);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// updateDeferredSkeletons()
+//-----------------------------------------------------------------------------
+// static
+void LLVOAvatar::updateDeferredSkeletons()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    sDeferSkeletonUpdates = false;
+    if (sDeferredSkeletons.empty())
+    {
+        return;
+    }
+
+    // Blending and the world matrices only touch each avatar's own motion
+    // controller and joints, so avatars can be posed side by side
+    LLPointer<LLVOAvatar>* avatars = sDeferredSkeletons.data();
+    LL::parallelFor("Parallel", sDeferredSkeletons.size(), DEFERRED_SKELETON_GRAIN,
+                    [avatars](size_t begin, size_t end)
+                    {
+                        for (size_t i = begin; i < end; ++i)
+                        {
+                            LLVOAvatar* avatar = avatars[i];
+                            if (!avatar->isDead())
+                            {
+                                avatar->applyDeferredBlend();
+                                if (avatar->mDeferredSitOnGround)
+                                {
+                                    avatar->updateSitOnGroundOffset();
+                                }
+                                avatar->mRoot->updateWorldMatrixChildren();
+                            }
+                        }
+                    });
+
+    // What is left talks to the rest of the viewer
+    for (LLVOAvatar* avatar : sDeferredSkeletons)
+    {
+        avatar->mSkeletonUpdateDeferred = false;
+        if (!avatar->isDead())
+        {
+            avatar->updateHeadOffset();
+            avatar->updateFootstepSounds();
+            avatar->idleUpdateAfterCharacter(avatar->mDeferredDetailedUpdate);
+        }
+    }
+    sDeferredSkeletons.clear();
+}
+
+//-----------------------------------------------------------------------------
+// readsDeferredSkeleton()
+//-----------------------------------------------------------------------------
+// static
+bool LLVOAvatar::readsDeferredSkeleton(LLViewerObject* objectp)
+{
+    if (!sDeferSkeletonUpdates)
+    {
+        return false;
+    }
+
+    const LLVOAvatar* avatar = NULL;
+    if (objectp->isAvatar())
+    {
+        // animated objects worn by someone follow their attachment point
+        avatar = static_cast<LLVOAvatar*>(objectp)->getAttachedAvatar();
+    }
+    else
+    {
+        avatar = objectp->getAvatar();
+        if (!avatar)
+        {
+            avatar = objectp->getControlAvatar();
+        }
+    }
+
+    // self is never deferred
+    return avatar && !avatar->isSelf();
+}
+
 //-----------------------------------------------------------------------------
 // updateHeadOffset()
 //-----------------------------------------------------------------------------
@@ -359,6 +359,26 @@ class LLVOAvatar :
 
     LLVector3 idleCalcNameTagPosition(const LLVector3 &root_pos_last);
 
+    // While deferral is on, updateCharacter() leaves applying the pose of
+    // avatars other than self, and everything that reads it, to
+    // updateDeferredSkeletons(), which poses them all in parallel
+    static void     deferSkeletonUpdates(bool defer) { sDeferSkeletonUpdates = defer; }
+    static void     updateDeferredSkeletons();
+    // True for attachments and animated objects whose idle update reads the
+    // skeleton of an avatar that is being posed later, they go after
+    // updateDeferredSkeletons()
+    static bool     readsDeferredSkeleton(LLViewerObject* objectp);
+
+private:
+    void            idleUpdateAfterCharacter(bool detailed_update);
+    void            updateSitOnGroundOffset();
+
+    static bool     sDeferSkeletonUpdates;
+    static std::vector<LLPointer<LLVOAvatar> > sDeferredSkeletons;
+    bool            mSkeletonUpdateDeferred;
+    bool            mDeferredDetailedUpdate;
+    bool            mDeferredSitOnGround;
+
     //--------------------------------------------------------------------
     // Static preferences (controlled by user settings/menus)
     //--------------------------------------------------------------------
@@ -33,6 +33,8 @@
 #include "llviewerregion.h"
 #include "llagentcamera.h"
 #include "llsdserialize.h"
+#include "llmappedfile.h"
+#include "threadpool.h"
 #include "llworld.h" // For LLWorld::getInstance()
 //static variables
 U32 LLVOCacheEntry::sMinFrameRange = 0;
@@ -42,7 +44,6 @@ F32 LLVOCacheEntry::sFrontPixelThreshold = 1.0f;
 F32 LLVOCacheEntry::sRearPixelThreshold = 1.0f;
 BOOL LLVOCachePartition::sNeedsOcclusionCheck = FALSE;
 
-const S32 ENTRY_HEADER_SIZE = 6 * sizeof(S32);
 const S32 MAX_ENTRY_BODY_SIZE = 10000;
 
 BOOL check_read(LLAPRFile* apr_file, void* src, S32 n_bytes)
@@ -55,10 +56,6 @@ BOOL check_write(LLAPRFile* apr_file, void* src, S32 n_bytes)
     return apr_file->write(src, n_bytes) == n_bytes ;
 }
 
-// Material Override Cache needs a version label, so we can upgrade this later.
-const std::string LLGLTFOverrideCacheEntry::VERSION_LABEL = {"GLTFCacheVer"};
-const int LLGLTFOverrideCacheEntry::VERSION = 1;
-
 bool LLGLTFOverrideCacheEntry::fromLLSD(const LLSD& data)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
@@ -192,71 +189,23 @@ LLVOCacheEntry::LLVOCacheEntry()
     mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
+LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, S32 hit_count, S32 dupe_count, S32 crc_change_count, const U8* data, S32 size)
 :   LLViewerOctreeEntryData(LLViewerOctreeEntry::LLVOCACHEENTRY),
-    mBuffer(NULL),
+    mLocalID(local_id),
+    mCRC(crc),
     mUpdateFlags(-1),
+    mHitCount(hit_count),
+    mDupeCount(dupe_count),
+    mCRCChangeCount(crc_change_count),
     mState(INACTIVE),
     mSceneContrib(0.f),
     mValid(FALSE),
     mParentID(0),
     mBSphereRadius(-1.0f)
 {
-    S32 size = -1;
-    BOOL success;
-    static U8 data_buffer[ENTRY_HEADER_SIZE];
-
-    mDP.assignBuffer(mBuffer, 0);
-
-    success = check_read(apr_file, (void *)data_buffer, ENTRY_HEADER_SIZE);
-    if (success)
-    {
-        memcpy(&mLocalID, data_buffer, sizeof(U32));
-        memcpy(&mCRC, data_buffer + sizeof(U32), sizeof(U32));
-        memcpy(&mHitCount, data_buffer + (2 * sizeof(U32)), sizeof(S32));
-        memcpy(&mDupeCount, data_buffer + (3 * sizeof(U32)), sizeof(S32));
-        memcpy(&mCRCChangeCount, data_buffer + (4 * sizeof(U32)), sizeof(S32));
-        memcpy(&size, data_buffer + (5 * sizeof(U32)), sizeof(S32));
-
-        // Corruption in the cache entries
-        if ((size > MAX_ENTRY_BODY_SIZE) || (size < 1))
-        {
-            // We've got a bogus size, skip reading it.
-            // We won't bother seeking, because the rest of this file
-            // is likely bogus, and will be tossed anyway.
-            LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
-            success = FALSE;
-        }
-    }
-    if(success && size > 0)
-    {
-        mBuffer = new U8[size];
-        success = check_read(apr_file, mBuffer, size);
-
-        if(success)
-        {
-            mDP.assignBuffer(mBuffer, size);
-        }
-        else
-        {
-            // Improve logging around vocache
-            LL_WARNS() << "Error loading cache entry for " << mLocalID << ", size " << size << " aborting!" << LL_ENDL;
-            delete[] mBuffer ;
-            mBuffer = NULL ;
-        }
-    }
-
-    if(!success)
-    {
-        mLocalID = 0;
-        mCRC = 0;
-        mHitCount = 0;
-        mDupeCount = 0;
-        mCRCChangeCount = 0;
-        mBuffer = NULL;
-        mEntry = NULL;
-        mState = INACTIVE;
-    }
+    mBuffer = new U8[size];
+    memcpy(mBuffer, data, size);
+    mDP.assignBuffer(mBuffer, size);
 }
 
 LLVOCacheEntry::~LLVOCacheEntry()
@@ -430,27 +379,6 @@ void LLVOCacheEntry::dump() const
         << LL_ENDL;
 }
 
-S32 LLVOCacheEntry::writeToBuffer(U8 *data_buffer) const
-{
-    S32 size = mDP.getBufferSize();
-
-    if (size > MAX_ENTRY_BODY_SIZE)
-    {
-        LL_WARNS() << "Failed to write entry with size above allowed limit: " << size << LL_ENDL;
-        return 0;
-    }
-
-    memcpy(data_buffer, &mLocalID, sizeof(U32));
-    memcpy(data_buffer + sizeof(U32), &mCRC, sizeof(U32));
-    memcpy(data_buffer + (2 * sizeof(U32)), &mHitCount, sizeof(S32));
-    memcpy(data_buffer + (3 * sizeof(U32)), &mDupeCount, sizeof(S32));
-    memcpy(data_buffer + (4 * sizeof(U32)), &mCRCChangeCount, sizeof(S32));
-    memcpy(data_buffer + (5 * sizeof(U32)), &size, sizeof(S32));
-    memcpy(data_buffer + ENTRY_HEADER_SIZE, (void*)mBuffer, size);
-
-    return ENTRY_HEADER_SIZE + size;
-}
-
 #ifndef LL_TEST
 //static
 void LLVOCacheEntry::updateDebugSettings()
@@ -1128,9 +1056,86 @@ void LLVOCachePartition::removeOccluder(LLVOCacheGroup* group)
 //-------------------------------------------------------------------
 // Format strings used to construct filename for the object cache
 static const char OBJECT_CACHE_FILENAME[] = "objects_%d_%d.slc";
-static const char OBJECT_CACHE_EXTRAS_FILENAME[] = "objects_%d_%d_extras.slec";
+
+// Region file layout:
+//   RegionFileHeader
+//   entry bodies and the GLTF overrides as binary LLSD, in no particular order
+//   RegionIndexRecord[mNumEntries] at mIndexOffset
+// A rewrite appends the bodies and overrides that changed plus a new index after the
+// existing data, then rewrites the header. An interrupted write leaves the previous
+// index in place. Once the data left behind outweighs the live data the file is
+// written again from scratch.
+static const char REGION_FILE_MAGIC[4] = { 'S', 'L', 'V', 'C' };
+const U32 REGION_FILE_VERSION = 1;
+
+struct RegionFileHeader
+{
+    char mMagic[4];
+    U32  mVersion;
+    U8   mCacheID[UUID_BYTES];
+    U32  mNumEntries;
+    U32  mIndexOffset;
+    U32  mDeadBytes;    // superseded data in front of the index
+    U32  mReserved;
+};
+
+struct RegionIndexRecord
+{
+    U32 mLocalID = 0;
+    U32 mCRC = 0;
+    S32 mHitCount = 0;
+    S32 mDupeCount = 0;
+    S32 mCRCChangeCount = 0;
+    U32 mBodyOffset = 0;
+    U32 mBodySize = 0;
+    U32 mExtrasOffset = 0;
+    U32 mExtrasSize = 0;    // 0 if the object has no GLTF overrides
+};
+
+// What writeToCache() hands to the cache thread, offsets of mBody and
+// mExtras are into mData.
+struct LLVOCache::RegionSnapshot
+{
+    struct Entry
+    {
+        RegionIndexRecord mRecord;
+        size_t mBody = 0;
+        size_t mExtras = 0;
+    };
+    std::vector<Entry> mEntries;
+    std::vector<U8> mData;
+};
+
+static bool read_region_file_header(const LLMappedFile& file, RegionFileHeader& header)
+{
+    if (!file.isMapped() || file.getSize() < sizeof(RegionFileHeader))
+    {
+        return false;
+    }
+    memcpy(&header, file.getData(), sizeof(RegionFileHeader));
+
+    if (memcmp(header.mMagic, REGION_FILE_MAGIC, sizeof(REGION_FILE_MAGIC)) || header.mVersion != REGION_FILE_VERSION)
+    {
+        LL_WARNS() << "Unexpected object cache file format, version " << header.mVersion << LL_ENDL;
+        return false;
+    }
+    return header.mIndexOffset >= sizeof(RegionFileHeader)
+        && (U64)header.mIndexOffset + (U64)header.mNumEntries * sizeof(RegionIndexRecord) <= file.getSize();
+}
+
+static bool check_region_record(const RegionIndexRecord& record, U32 data_end)
+{
+    if (!record.mLocalID || record.mBodySize < 1 || record.mBodySize > MAX_ENTRY_BODY_SIZE
+        || record.mBodyOffset < sizeof(RegionFileHeader) || (U64)record.mBodyOffset + record.mBodySize > data_end)
+    {
+        return false;
+    }
+    return !record.mExtrasSize
+        || (record.mExtrasOffset >= sizeof(RegionFileHeader) && (U64)record.mExtrasOffset + record.mExtrasSize <= data_end);
+}
 
 const U32 MAX_NUM_OBJECT_ENTRIES = 128 ;
+const U32 MAX_PREFETCHED_REGIONS = 9 ; // a region and its neighbors
 const U32 MIN_ENTRIES_TO_PURGE = 16 ;
 const U32 INVALID_TIME = 0 ;
 const char* object_cache_dirname = "objectcache";
@@ -1142,22 +1147,33 @@ LLVOCache::LLVOCache(bool read_only) :
     mReadOnly(read_only),
     mNumEntries(0),
     mCacheSize(1),
-    mEnabled(true)
+    mEnabled(true),
+    mReadSerial(0)
 {
 #ifndef LL_TEST
     mEnabled = gSavedSettings.getBOOL("ObjectCacheEnabled");
 #endif
     mLocalAPRFilePoolp = new LLVolatileAPRPool("VOCache Pool") ;
+    mThreadAPRFilePoolp = new LLVolatileAPRPool("VOCache Thread Pool") ;
 }
 
 LLVOCache::~LLVOCache()
 {
+    if (mThreadPool)
+    {
+        // finishes the queued writes
+        mThreadPool->close();
+        mThreadPool.reset();
+    }
+    mPendingReads.clear();
+
     if(mEnabled)
     {
         writeCacheHeader();
         clearCacheInMemory();
     }
     delete mLocalAPRFilePoolp;
+    delete mThreadAPRFilePoolp;
 }
 
 void LLVOCache::setDirNames(ELLPath location)
@@ -1215,6 +1231,15 @@ void LLVOCache::initCache(ELLPath location, U32 size, U32 cache_version)
             removeCache();
         }
     }
+
+#ifndef LL_TEST
+    // A single thread keeps the reads and writes of a region file in order. It is shut down
+    // by the destructor rather than on application shutdown so the last writes still go out.
+    mThreadPool = std::make_unique<LL::ThreadPool>("VOCache", 1, 1024 * 1024, false);
+    mThreadPool->start();
+    mWorkQueue = LL::WorkQueue::getInstance("VOCache");
+    mMainQueue = LL::WorkQueue::getInstance("mainloop");
+#endif
 }
 
 void LLVOCache::removeCache(ELLPath location, bool started)
@@ -1313,6 +1338,19 @@ void LLVOCache::removeEntry(U64 handle)
 
 void LLVOCache::clearCacheInMemory()
 {
+    for (pending_read_map_t::iterator iter = mPendingReads.begin(); iter != mPendingReads.end();)
+    {
+        // reads a region is waiting on still complete
+        if (iter->second->mCallback)
+        {
+            ++iter;
+        }
+        else
+        {
+            iter = mPendingReads.erase(iter);
+        }
+    }
+
     if(!mHeaderEntryQueue.empty())
     {
         for(header_entry_queue_t::iterator iter = mHeaderEntryQueue.begin(); iter != mHeaderEntryQueue.end(); ++iter)
@@ -1337,15 +1375,6 @@ void LLVOCache::getObjectCacheFilename(U64 handle, std::string& filename)
     return ;
 }
 
-std::string LLVOCache::getObjectCacheExtrasFilename(U64 handle)
-{
-    U32 region_x, region_y;
-
-    grid_from_region_handle(handle, &region_x, &region_y);
-    return gDirUtilp->getExpandedFilename(LL_PATH_CACHE, object_cache_dirname,
-               llformat(OBJECT_CACHE_EXTRAS_FILENAME, region_x, region_y));
-}
-
 void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 {
     if(mReadOnly)
@@ -1357,13 +1386,15 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
     std::string filename;
     getObjectCacheFilename(entry->mHandle, filename);
     LL_WARNS("GLTF", "VOCache") << "Removing object cache for handle " << entry->mHandle << "Filename: " << filename << LL_ENDL;
-    LLAPRFile::remove(filename, mLocalAPRFilePoolp);
+    dropPrefetch(entry->mHandle);
 
-    // Note: `removeFromCache` should take responsibility for cleaning up all cache artefacts specfic to the handle/entry.
-    // as such this now includes the generic extras
-    filename = getObjectCacheExtrasFilename(entry->mHandle);
-    LL_WARNS("GLTF", "VOCache") << "Removing generic extras for handle " << entry->mHandle << "Filename: " << filename << LL_ENDL;
-    LLFile::remove(filename);
+    // queued behind any pending write of the file
+    LLVolatileAPRPool* pool = mThreadAPRFilePoolp;
+    LL::WorkQueue::ptr_t work_queue = mWorkQueue.lock();
+    if (!work_queue || !work_queue->post([filename, pool]() { LLAPRFile::remove(filename, pool); }))
+    {
+        LLAPRFile::remove(filename, mLocalAPRFilePoolp);
+    }
 
     entry->mTime = INVALID_TIME ;
     updateEntry(entry) ; //update the head file.
@@ -1512,205 +1543,251 @@ BOOL LLVOCache::updateEntry(const HeaderEntryInfo* entry)
     return check_write(&apr_file, (void*)entry, sizeof(HeaderEntryInfo)) ;
 }
 
-// we now return bool to trigger dirty cache
-// this in turn forces a rewrite after a partial read due to corruption.
-bool LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+//static
+void LLVOCache::readRegionFile(const std::string& filename, RegionData& data)
 {
-    if(!mEnabled)
-    {
-        LL_WARNS() << "Not reading cache for handle " << handle << "): Cache is currently disabled." << LL_ENDL;
-        return true; // no problem we're just read only
-    }
-    llassert_always(mInitialized);
+    LL_PROFILE_ZONE_SCOPED;
 
-    handle_entry_map_t::iterator iter = mHandleEntryMap.find(handle) ;
-    if(iter == mHandleEntryMap.end()) //no cache
+    // The entries are copied straight out of the mapped file, no per entry reads
+    LLMappedFile file;
+    RegionFileHeader header;
+    if (!file.map(filename) || !read_region_file_header(file, header))
     {
-        LL_WARNS() << "No handle map entry for " << handle << LL_ENDL;
-        return false; // arguably no a problem, but we'll mark this as dirty anyway.
+        return;
     }
+    memcpy(data.mCacheID.mData, header.mCacheID, UUID_BYTES);
+    data.mExpectedEntries = header.mNumEntries;
+    data.mSuccess = true;
 
-    bool success = true ;
-    S32 num_entries = 0 ; // lifted out of inner loop.
-    std::string filename; // lifted out of loop
+    const U8* buffer = file.getData();
+    for (U32 i = 0; i < header.mNumEntries; i++)
     {
-        LLUUID cache_id;
-        getObjectCacheFilename(handle, filename);
-        LLAPRFile apr_file(filename, APR_READ|APR_BINARY, mLocalAPRFilePoolp);
+        RegionIndexRecord record;
+        memcpy(&record, buffer + header.mIndexOffset + i * sizeof(RegionIndexRecord), sizeof(RegionIndexRecord));
+        if (!check_region_record(record, header.mIndexOffset))
+        {
+            LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
+            data.mSuccess = false;
+            break;
+        }
 
-        success = check_read(&apr_file, cache_id.mData, UUID_BYTES);
+        data.mEntries[record.mLocalID] = new LLVOCacheEntry(record.mLocalID, record.mCRC, record.mHitCount, record.mDupeCount,
+                                                            record.mCRCChangeCount, buffer + record.mBodyOffset, record.mBodySize);
 
-        if(success)
+        if (record.mExtrasSize)
         {
-            if(cache_id != id)
-            {
-                LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
-                success = false ;
-            }
-
-            if(success)
+            LLSD entry_llsd;
+            LLGLTFOverrideCacheEntry entry;
+            if (LLSDSerialize::fromBinary(entry_llsd, buffer + record.mExtrasOffset, record.mExtrasSize) == LLSDParser::PARSE_FAILURE || !entry.fromLLSD(entry_llsd))
             {
-                success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-
-                if(success)
-                {
-                    for (S32 i = 0; i < num_entries && apr_file.eof() != APR_EOF; i++)
-                    {
-                        LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(&apr_file);
-                        if (!entry->getLocalID())
-                        {
-                            LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
-                            success = false ;
-                            break ;
-                        }
-                        cache_entry_map[entry->getLocalID()] = entry;
-                    }
-                }
+                // Drop the object along with its overrides so the simulator sends both again
+                LL_WARNS("GLTF") << "Failed reading overrides of " << record.mLocalID << " from " << filename << LL_ENDL;
+                data.mEntries.erase(record.mLocalID);
+                data.mSuccess = false;
+                continue;
             }
+            data.mOverrides[record.mLocalID] = entry;
         }
     }
-
-    if(!success)
-    {
-        if(cache_entry_map.empty())
-        {
-            removeEntry(iter->second) ;
-        }
-    }
-
-    LL_DEBUGS("GLTF", "VOCache") << "Read " << cache_entry_map.size() << " entries from object cache " << filename << ", expected " << num_entries << ", success=" << (success?"True":"False") << LL_ENDL;
-    return success;
 }
 
-// We now pass in the cache entry map, so that we can remove entries from extras that are no longer in the primary cache.
-void LLVOCache::readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+void LLVOCache::readFromCache(U64 handle, const LLUUID& id, read_callback_t callback)
 {
-    int loaded= 0;
-    int discarded = 0;
-    // get ViewerRegion pointer from handle
-    LLViewerRegion* pRegion = LLWorld::getInstance()->getRegionFromHandle(handle);
     if(!mEnabled)
     {
         LL_WARNS() << "Not reading cache for handle " << handle << "): Cache is currently disabled." << LL_ENDL;
-        return ;
+        RegionData data;
+        callback(true, data.mEntries, data.mOverrides); // no problem we're just read only
+        return;
     }
     llassert_always(mInitialized);
 
-    handle_entry_map_t::iterator iter = mHandleEntryMap.find(handle) ;
-    if(iter == mHandleEntryMap.end()) //no cache
+    if(mHandleEntryMap.find(handle) == mHandleEntryMap.end()) //no cache
     {
         LL_WARNS() << "No handle map entry for " << handle << LL_ENDL;
+        RegionData data;
+        callback(false, data.mEntries, data.mOverrides); // arguably no a problem, but we'll mark this as dirty anyway.
         return;
     }
 
-    std::string filename(getObjectCacheExtrasFilename(handle));
-    llifstream in(filename, std::ios::in | std::ios::binary);
+    std::shared_ptr<PendingRead> request;
+    pending_read_map_t::iterator iter = mPendingReads.find(handle);
+    if (iter != mPendingReads.end())
+    {
+        // prefetched, or still being read
+        request = iter->second;
+    }
+    else
+    {
+        request = std::make_shared<PendingRead>();
+        mPendingReads[handle] = request;
+    }
+    request->mCallback = callback;
+    request->mCacheID = id;
 
-    std::string line;
-    std::getline(in, line);
-    if(!in.good())
+    if (request->mData)
     {
-        LL_WARNS() << "Failed reading extras cache for handle " << handle << LL_ENDL;
-        in.close();
-        removeGenericExtrasForHandle(handle);
-        return;
+        finishRead(handle, request);
     }
-    // file formats need versions, let's add one. legacy cache files will be considered version 0
-    // This will make it easier to upgrade/revise later.
-    int versionNumber=0;
-    if (line.compare(0, LLGLTFOverrideCacheEntry::VERSION_LABEL.length(), LLGLTFOverrideCacheEntry::VERSION_LABEL) == 0)
+    else if (iter == mPendingReads.end())
     {
-        std::string versionStr = line.substr(LLGLTFOverrideCacheEntry::VERSION_LABEL.length()+1); // skip the version label and ':'
-        versionNumber = std::stol(versionStr);
+        startRead(handle, request);
     }
-    // For future versions we may call a legacy handler here, but realistically we'll just consider this cache out of date.
-    // The important thing is to make sure it gets removed.
-    if(versionNumber != LLGLTFOverrideCacheEntry::VERSION)
+}
+
+void LLVOCache::prefetch(U64 handle)
+{
+    if (!mEnabled || !mInitialized || !mThreadPool
+        || mHandleEntryMap.find(handle) == mHandleEntryMap.end()
+        || mPendingReads.find(handle) != mPendingReads.end())
     {
-        LL_WARNS() << "Unexpected version number " << versionNumber << " for extras cache for handle " << handle << LL_ENDL;
-        in.close();
-        removeGenericExtrasForHandle(handle);
         return;
     }
 
-    LL_DEBUGS("VOCache") << "Reading extras cache for handle " << handle << ", version " << versionNumber << LL_ENDL;
-    std::getline(in, line);
-    if(!LLUUID::validate(line))
+    LL_DEBUGS("VOCache") << "Prefetching object cache for handle " << handle << LL_ENDL;
+    std::shared_ptr<PendingRead> request = std::make_shared<PendingRead>();
+    mPendingReads[handle] = request;
+    startRead(handle, request);
+}
+
+void LLVOCache::cancelRead(U64 handle)
+{
+    pending_read_map_t::iterator iter = mPendingReads.find(handle);
+    if (iter != mPendingReads.end())
     {
-        LL_WARNS() << "Failed reading extras cache for handle" << handle << ". invalid uuid line: '" << line << "'" << LL_ENDL;
-        in.close();
-        removeGenericExtrasForHandle(handle);
-        return;
+        // keep whatever was read for the next region with this handle
+        iter->second->mCallback = nullptr;
+        trimPrefetches();
     }
+}
+
+void LLVOCache::startRead(U64 handle, const std::shared_ptr<PendingRead>& request)
+{
+    request->mSerial = ++mReadSerial;
 
-    LLUUID cache_id(line);
-    if(cache_id != id)
+    std::string filename;
+    getObjectCacheFilename(handle, filename);
+
+    LL::WorkQueue::ptr_t main_queue = mMainQueue.lock();
+    if (main_queue && main_queue->postTo(mWorkQueue,
+            // on the cache thread
+            [filename]()
+            {
+                std::shared_ptr<RegionData> data = std::make_shared<RegionData>();
+                readRegionFile(filename, *data);
+                return data;
+            },
+            // back on the main thread
+            [handle, request](std::shared_ptr<RegionData> data)
+            {
+                if (LLVOCache::instanceExists())
+                {
+                    LLVOCache::instance().onReadDone(handle, request, data);
+                }
+            }))
     {
-        // if the cache id doesn't match the expected region we should just kill the file.
-        LL_WARNS() << "Cache ID doesn't match for this region, deleting it" << LL_ENDL;
-        in.close();
-        removeGenericExtrasForHandle(handle);
         return;
     }
 
-    U32 num_entries;  // if removal was enabled during write num_entries might be wrong
-    std::getline(in, line);
-    if(!in.good())
+    // no cache thread
+    std::shared_ptr<RegionData> data = std::make_shared<RegionData>();
+    readRegionFile(filename, *data);
+    onReadDone(handle, request, data);
+}
+
+void LLVOCache::onReadDone(U64 handle, const std::shared_ptr<PendingRead>& request, const std::shared_ptr<RegionData>& data)
+{
+    pending_read_map_t::iterator iter = mPendingReads.find(handle);
+    if (iter == mPendingReads.end() || iter->second != request)
     {
-        LL_WARNS() << "Failed reading extras cache for handle " << handle << LL_ENDL;
-        in.close();
-        removeGenericExtrasForHandle(handle);
+        // a prefetch of a file that was written or removed since, the data is stale
         return;
     }
-    try
+
+    request->mData = data;
+    if (request->mCallback)
     {
-        num_entries = std::stol(line);
+        finishRead(handle, request);
     }
-    catch(const std::logic_error&)  // either invalid_argument or out_of_range
+    else
     {
-        LL_WARNS() << "Failed reading extras cache for handle " << handle << ". unreadable num_entries" << LL_ENDL;
-        in.close();
-        removeGenericExtrasForHandle(handle);
-        return;
+        trimPrefetches();
     }
+}
 
-    LL_DEBUGS("GLTF") << "Beginning reading extras cache for handle " << handle << " from " << getObjectCacheExtrasFilename(handle) << LL_ENDL;
+// we now return false to trigger dirty cache
+// this in turn forces a rewrite after a partial read due to corruption.
+void LLVOCache::finishRead(U64 handle, std::shared_ptr<PendingRead> request)
+{
+    mPendingReads.erase(handle);
 
-    LLSD entry_llsd;
-    for (U32 i = 0; i < num_entries && !in.eof(); i++)
+    RegionData& data = *request->mData;
+    bool success = data.mSuccess;
+    if (success && data.mCacheID != request->mCacheID)
     {
-        static const U32 max_size = 4096;
-        bool success = LLSDSerialize::deserialize(entry_llsd, in, max_size);
-        // check bool(in) this time since eof is not a failure condition here
-        if(!success || !in)
+        LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
+        data.mEntries.clear();
+        data.mOverrides.clear();
+        success = false;
+    }
+
+    if (!success && data.mEntries.empty())
+    {
+        removeEntry(handle);
+    }
+
+    // attempt to backfill a null objectId, though these shouldn't be in the persisted cache really
+    LLViewerRegion* pRegion = LLWorld::getInstance()->getRegionFromHandle(handle);
+    if (pRegion)
+    {
+        for (auto& [local_id, entry] : data.mOverrides)
         {
-            LL_WARNS() << "Failed reading extras cache for handle " << handle << ", entry number " << i << " cache patrtial load only." << LL_ENDL;
-            in.close();
-            removeGenericExtrasForHandle(handle);
-            break;
+            if (entry.mObjectId.isNull())
+            {
+                gObjectList.getUUIDFromLocal(entry.mObjectId, local_id, pRegion->getHost().getAddress(), pRegion->getHost().getPort());
+            }
         }
+    }
+
+    LL_DEBUGS("GLTF", "VOCache") << "Read " << data.mEntries.size() << " entries and " << data.mOverrides.size() << " overrides from object cache for handle "
+                                 << handle << ", expected " << data.mExpectedEntries << ", success=" << (success?"True":"False") << LL_ENDL;
+
+    request->mCallback(success, data.mEntries, data.mOverrides);
+}
 
-        LLGLTFOverrideCacheEntry entry;
-        entry.fromLLSD(entry_llsd);
-        U32 local_id = entry_llsd["local_id"].asInteger();
-        // only add entries that exist in the primary cache
-        // this is a self-healing test that avoids us polluting the cache with entries that are no longer valid based on the main cache.
-        if(cache_entry_map.find(local_id)!= cache_entry_map.end())
+void LLVOCache::trimPrefetches()
+{
+    while (true)
+    {
+        U32 unclaimed = 0;
+        pending_read_map_t::iterator oldest = mPendingReads.end();
+        for (pending_read_map_t::iterator iter = mPendingReads.begin(); iter != mPendingReads.end(); ++iter)
         {
-            // attempt to backfill a null objectId, though these shouldn't be in the persisted cache really
-            if(entry.mObjectId.isNull() && pRegion)
+            if (iter->second->mData && !iter->second->mCallback)
             {
-                gObjectList.getUUIDFromLocal( entry.mObjectId, local_id, pRegion->getHost().getAddress(), pRegion->getHost().getPort() );
+                unclaimed++;
+                if (oldest == mPendingReads.end() || iter->second->mSerial < oldest->second->mSerial)
+                {
+                    oldest = iter;
+                }
             }
-            cache_extras_entry_map[local_id] = entry;
-            loaded++;
         }
-        else
+
+        if (unclaimed <= MAX_PREFETCHED_REGIONS)
         {
-            discarded++;
+            return;
         }
+        mPendingReads.erase(oldest);
+    }
+}
+
+void LLVOCache::dropPrefetch(U64 handle)
+{
+    pending_read_map_t::iterator iter = mPendingReads.find(handle);
+    if (iter != mPendingReads.end() && !iter->second->mCallback)
+    {
+        mPendingReads.erase(iter);
     }
-    LL_DEBUGS("GLTF") << "Completed reading extras cache for handle " << handle << ", " << loaded << " loaded, " << discarded << " discarded" << LL_ENDL;
 }
 
 void LLVOCache::purgeEntries(U32 size)
@@ -1728,7 +1805,8 @@ void LLVOCache::purgeEntries(U32 size)
     mNumEntries = mHandleEntryMap.size() ;
 }
 
-void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled)
+void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map,
+                             const LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map, BOOL dirty_cache, bool removal_enabled)
 {
     std::string filename;
     getObjectCacheFilename(handle, filename);
@@ -1786,197 +1864,234 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
         return ; //nothing changed, no need to update.
     }
 
-    //write to cache file
-    bool success = true ;
+    // get ViewerRegion pointer from handle
+    LLViewerRegion* pRegion = LLWorld::getInstance()->getRegionFromHandle(handle);
+
+    // Copy everything that goes into the file, the entries keep changing while it is written
+    std::shared_ptr<RegionSnapshot> snapshot = std::make_shared<RegionSnapshot>();
+    snapshot->mEntries.reserve(cache_entry_map.size());
+    for (const auto& [local_id, cache_entry] : cache_entry_map)
     {
-        std::string filename;
-        getObjectCacheFilename(handle, filename);
-        LLAPRFile apr_file(filename, APR_FOPEN_CREATE|APR_FOPEN_WRITE|APR_FOPEN_BINARY|APR_FOPEN_TRUNCATE, mLocalAPRFilePoolp);
+        if (removal_enabled && !cache_entry->isValid())
+        {
+            continue;
+        }
 
-        success = check_write(&apr_file, (void*)id.mData, UUID_BYTES);
+        S32 size = cache_entry->getBufferSize();
+        if (size < 1 || size > MAX_ENTRY_BODY_SIZE)
+        {
+            LL_WARNS() << "Failed to write entry " << local_id << " with size outside the allowed limit: " << size << LL_ENDL;
+            continue;
+        }
 
-        if(success)
+        RegionSnapshot::Entry snapshot_entry;
+        RegionIndexRecord& record = snapshot_entry.mRecord;
+        record.mLocalID = local_id;
+        record.mCRC = cache_entry->getCRC();
+        record.mHitCount = cache_entry->getHitCount();
+        record.mDupeCount = cache_entry->getDupeCount();
+        record.mCRCChangeCount = cache_entry->getCRCChangeCount();
+        record.mBodySize = size;
+        snapshot_entry.mBody = snapshot->mData.size();
+        snapshot->mData.insert(snapshot->mData.end(), cache_entry->getBuffer(), cache_entry->getBuffer() + size);
+
+        LLVOCacheEntry::vocache_gltf_overrides_map_t::const_iterator extras_iter = cache_extras_entry_map.find(local_id);
+        // Only write out GLTFOverrides that we can actually apply again on import.
+        // worst case we have an extra cache miss.
+        if (extras_iter != cache_extras_entry_map.end()
+            && extras_iter->second.mSides.size() > 0
+            && extras_iter->second.mSides.size() == extras_iter->second.mGLTFMaterial.size())
         {
-            S32 num_entries = cache_entry_map.size(); // if removal is enabled num_entries might be wrong
-            success = check_write(&apr_file, &num_entries, sizeof(S32));
-            if (success)
+            const LLGLTFOverrideCacheEntry& override_entry = extras_iter->second;
+            LLSD entry_llsd = override_entry.toLLSD();
+            entry_llsd["local_id"] = (S32)local_id;
+            // Note: A null mObjectId is valid when in memory as we might have a data race between GLTF of the object itself.
+            if (override_entry.mObjectId.isNull() && pRegion)
             {
-                const S32 buffer_size = 32768; //should be large enough for couple MAX_ENTRY_BODY_SIZE
-                U8 data_buffer[buffer_size]; // generaly entries are fairly small, so collect them and drop onto disk in one go
-                S32 size_in_buffer = 0;
-
-                // This can have a lot of entries, so might be better to dump them into buffer first and write in one go.
-                for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
-                {
-                    if (!removal_enabled || iter->second->isValid())
-                    {
-                        S32 size = iter->second->writeToBuffer(data_buffer + size_in_buffer);
-
-                        if (size > ENTRY_HEADER_SIZE) // body is minimum of 1
-                        {
-                            size_in_buffer += size;
-                        }
-                        else
-                        {
-                            LL_WARNS() << "Failed to write cache entry to buffer for " << filename << ", entry number " << iter->second->getLocalID() << LL_ENDL;
-                            success = false;
-                            break;
-                        }
-
-                        // Make sure we have space in buffer for next element
-                        if (buffer_size - size_in_buffer < MAX_ENTRY_BODY_SIZE + ENTRY_HEADER_SIZE)
-                        {
-                            success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
-                            size_in_buffer = 0;
-                            if (!success)
-                            {
-                                LL_WARNS() << "Failed to write cache to disk " << filename << LL_ENDL;
-                                break;
-                            }
-                        }
-                    }
-                }
-
-                if (success && size_in_buffer > 0)
-                {
-                    // final write
-                    success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
-                    if(!success)
-                    {
-                        LL_WARNS() << "Failed to write cache entry to disk " << filename << LL_ENDL;
-                    }
-                    size_in_buffer = 0;
-                }
-                LL_DEBUGS("VOCache") << "Wrote " << num_entries << " entries to the primary VOCache file " << filename << ". success = " << (success ? "True":"False") << LL_ENDL;
+                LLUUID object_id;
+                gObjectList.getUUIDFromLocal(object_id, local_id, pRegion->getHost().getAddress(), pRegion->getHost().getPort());
+                entry_llsd["object_id"] = object_id;
             }
+
+            std::ostringstream out;
+            LLSDSerialize::toBinary(entry_llsd, out);
+            const std::string& blob = out.str();
+            record.mExtrasSize = (U32)blob.size();
+            snapshot_entry.mExtras = snapshot->mData.size();
+            snapshot->mData.insert(snapshot->mData.end(), blob.begin(), blob.end());
         }
-    }
 
-    if(!success)
-    {
-        removeEntry(entry) ;
+        snapshot->mEntries.push_back(snapshot_entry);
     }
 
-    return ;
-}
+    // a prefetch of the file would be stale now
+    dropPrefetch(handle);
 
-void LLVOCache::removeGenericExtrasForHandle(U64 handle)
-{
-    if(mReadOnly)
+    LLVolatileAPRPool* pool = mThreadAPRFilePoolp;
+    LL::WorkQueue::ptr_t main_queue = mMainQueue.lock();
+    if (main_queue && main_queue->postTo(mWorkQueue,
+            // on the cache thread
+            [filename, id, snapshot, pool]()
+            {
+                return writeRegionFile(filename, id, *snapshot, pool);
+            },
+            // back on the main thread
+            [handle](bool success)
+            {
+                if (!success && LLVOCache::instanceExists())
+                {
+                    LLVOCache::instance().removeEntry(handle);
+                }
+            }))
     {
-        LL_WARNS() << "Not removing cache for handle " << handle << ": Cache is currently in read-only mode." << LL_ENDL;
-        return ;
+        return;
     }
 
-    // NOTE: when removing the extras, we must also remove the objects so the simulator will send us a full upddate with the valid overrides
-    auto* entry = mHandleEntryMap[handle];
-    if (entry)
+    // no cache thread
+    if (!writeRegionFile(filename, id, *snapshot, mLocalAPRFilePoolp))
     {
         removeEntry(entry);
     }
-    else
-    {
-        //shouldn't happen, but if it does, we should remove the extras file since it's orphaned
-        LL_WARNS("GLTF", "VOCache") << "Removing generic extras for handle " << handle << "Filename: " << getObjectCacheExtrasFilename(handle) << LL_ENDL;
-        LLFile::remove(getObjectCacheExtrasFilename(handle));
-    }
 }
 
-void LLVOCache::writeGenericExtrasToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map, BOOL dirty_cache, bool removal_enabled)
+//static
+bool LLVOCache::writeRegionFile(const std::string& filename, const LLUUID& id, const RegionSnapshot& snapshot, LLVolatileAPRPool* pool)
 {
-    if(!mEnabled)
-    {
-        LL_WARNS() << "Not writing extras cache for handle " << handle << "): Cache is currently disabled." << LL_ENDL;
-        return;
-    }
-    llassert_always(mInitialized);
+    LL_PROFILE_ZONE_SCOPED;
 
-    if(mReadOnly)
+    std::vector<RegionIndexRecord> records;
+    records.reserve(snapshot.mEntries.size());
+    for (const RegionSnapshot::Entry& snapshot_entry : snapshot.mEntries)
     {
-        LL_WARNS() << "Not writing extras cache for handle " << handle << "): Cache is currently in read-only mode." << LL_ENDL;
-        return;
+        records.push_back(snapshot_entry.mRecord);
     }
 
-    // <FS:Beq> FIRE-33808 - Material Override Cache causes long delays
-    std::string filename = getObjectCacheExtrasFilename(handle);
-    // </FS:Beq>
-    llofstream out(filename, std::ios::out | std::ios::binary);
-    if(!out.good())
+    // Bodies and overrides that did not change since the last write stay where they are,
+    // offset 0 marks the ones that need writing.
+    U32 old_end = 0;
+    U64 reused_bytes = 0;
     {
-        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
-        removeGenericExtrasForHandle(handle);
-        return;
-    }
-    // It is good practice to version file formats so let's add one.
-    // legacy versions will be treated as version 0.
-    out << LLGLTFOverrideCacheEntry::VERSION_LABEL << ":" << LLGLTFOverrideCacheEntry::VERSION << '\n';
+        LLMappedFile file;
+        RegionFileHeader old_header;
+        if (file.map(filename) && read_region_file_header(file, old_header)
+            && !memcmp(old_header.mCacheID, id.mData, UUID_BYTES) && file.getSize() < S32_MAX)
+        {
+            old_end = (U32)file.getSize();
 
-    out << id << '\n';
-    if(!out.good())
-    {
-        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
-        removeGenericExtrasForHandle(handle);
-        return;
+            const U8* data = file.getData();
+            std::unordered_map<U32, RegionIndexRecord> old_records;
+            old_records.reserve(old_header.mNumEntries);
+            for (U32 i = 0; i < old_header.mNumEntries; i++)
+            {
+                RegionIndexRecord record;
+                memcpy(&record, data + old_header.mIndexOffset + i * sizeof(RegionIndexRecord), sizeof(RegionIndexRecord));
+                if (check_region_record(record, old_header.mIndexOffset))
+                {
+                    old_records[record.mLocalID] = record;
+                }
+            }
+
+            for (size_t i = 0; i < records.size(); i++)
+            {
+                std::unordered_map<U32, RegionIndexRecord>::const_iterator old_iter = old_records.find(records[i].mLocalID);
+                if (old_iter == old_records.end())
+                {
+                    continue;
+                }
+                const RegionIndexRecord& old_record = old_iter->second;
+                if (old_record.mBodySize == records[i].mBodySize
+                    && !memcmp(data + old_record.mBodyOffset, &snapshot.mData[snapshot.mEntries[i].mBody], records[i].mBodySize))
+                {
+                    records[i].mBodyOffset = old_record.mBodyOffset;
+                    reused_bytes += records[i].mBodySize;
+                }
+                if (records[i].mExtrasSize && old_record.mExtrasSize == records[i].mExtrasSize
+                    && !memcmp(data + old_record.mExtrasOffset, &snapshot.mData[snapshot.mEntries[i].mExtras], records[i].mExtrasSize))
+                {
+                    records[i].mExtrasOffset = old_record.mExtrasOffset;
+                    reused_bytes += records[i].mExtrasSize;
+                }
+            }
+        }
     }
-    // Because we don't write out all the entries we need to record a placeholder and rewrite this later
-    auto num_entries_placeholder = out.tellp();
-    out << std::setw(10) << std::setfill('0') << 0 << '\n';
-    if(!out.good())
+    U64 live_bytes = 0;
+    for (const RegionIndexRecord& record : records)
     {
-        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
-        removeGenericExtrasForHandle(handle);
-        return;
+        live_bytes += record.mBodySize + record.mExtrasSize;
     }
 
-    // get ViewerRegion pointer from handle
-    LLViewerRegion* pRegion = LLWorld::getInstance()->getRegionFromHandle(handle);
+    // Everything in front of the new index that is not reused is dead, the old indexes included
+    U64 dead_bytes = old_end ? old_end - sizeof(RegionFileHeader) - reused_bytes : 0;
+    bool compact = !old_end || dead_bytes > live_bytes;
+    if (compact)
+    {
+        for (RegionIndexRecord& record : records)
+        {
+            record.mBodyOffset = 0;
+            record.mExtrasOffset = 0;
+        }
+        dead_bytes = 0;
+    }
 
-    U32 num_entries = 0;
-    U32 inmem_entries = 0;
-    U32 skipped = 0;
-    inmem_entries = cache_extras_entry_map.size();
-    for (auto [local_id, entry] : cache_extras_entry_map)
+    U32 data_start = compact ? (U32)sizeof(RegionFileHeader) : old_end;
+    std::vector<U8> buffer;
+    buffer.reserve(live_bytes - (compact ? 0 : reused_bytes) + records.size() * sizeof(RegionIndexRecord));
+    for (size_t i = 0; i < records.size(); i++)
     {
-        // Only write out GLTFOverrides that we can actually apply again on import.
-        // worst case we have an extra cache miss.
-        // Note: A null mObjectId is valid when in memory as we might have a data race between GLTF of the object itself.
-        // This remains a valid state to persist as it is consistent with the localid checks on import with the main cache.
-        // the mObjectId will be updated if/when the local object is updated from the gObject list (due to full update)
-        if(entry.mObjectId.isNull() && pRegion)
+        const U8* source = snapshot.mData.data();
+        if (!records[i].mBodyOffset)
+        {
+            records[i].mBodyOffset = data_start + (U32)buffer.size();
+            source += snapshot.mEntries[i].mBody;
+            buffer.insert(buffer.end(), source, source + records[i].mBodySize);
+        }
+        if (records[i].mExtrasSize && !records[i].mExtrasOffset)
         {
-            gObjectList.getUUIDFromLocal( entry.mObjectId, local_id, pRegion->getHost().getAddress(), pRegion->getHost().getPort() );
+            records[i].mExtrasOffset = data_start + (U32)buffer.size();
+            source = snapshot.mData.data() + snapshot.mEntries[i].mExtras;
+            buffer.insert(buffer.end(), source, source + records[i].mExtrasSize);
         }
+    }
+
+    RegionFileHeader header{};
+    memcpy(header.mMagic, REGION_FILE_MAGIC, sizeof(REGION_FILE_MAGIC));
+    header.mVersion = REGION_FILE_VERSION;
+    memcpy(header.mCacheID, id.mData, UUID_BYTES);
+    header.mNumEntries = (U32)records.size();
+    header.mIndexOffset = data_start + (U32)buffer.size();
+    header.mDeadBytes = (U32)dead_bytes;
+
+    const U8* index = reinterpret_cast<const U8*>(records.data());
+    buffer.insert(buffer.end(), index, index + records.size() * sizeof(RegionIndexRecord));
 
-        if( entry.mSides.size() > 0 &&
-            entry.mSides.size() == entry.mGLTFMaterial.size()
-          )
+    //write to cache file
+    bool success = (U64)data_start + buffer.size() < S32_MAX; // LLAPRFile offsets are S32
+    if (success)
+    {
+        // The header goes last, until then it points at the previous index or, when
+        // the file was truncated, it is zeroed and the file is discarded on read.
+        RegionFileHeader placeholder{};
+        LLAPRFile apr_file(filename, compact ? APR_FOPEN_CREATE|APR_FOPEN_WRITE|APR_FOPEN_BINARY|APR_FOPEN_TRUNCATE : APR_FOPEN_WRITE|APR_FOPEN_BINARY,
+                           pool);
+        if (compact)
         {
-            LLSD entry_llsd = entry.toLLSD();
-            entry_llsd["local_id"] = (S32)local_id;
-            LLSDSerialize::serialize(entry_llsd, out, LLSDSerialize::LLSD_XML);
-            out << '\n';
-            if(!out.good())
-            {
-                // We're not in a good place when this happens so we might as well nuke the file.
-                LL_WARNS() << "Failed writing extras cache for handle " << handle << ". Corrupted cache file " << filename << " removed." << LL_ENDL;
-                removeGenericExtrasForHandle(handle);
-                return;
-            }
-            num_entries++;
+            success = check_write(&apr_file, &placeholder, sizeof(RegionFileHeader));
         }
         else
         {
-            skipped++;
+            success = apr_file.seek(APR_SET, old_end) == (S32)old_end;
         }
+        success = success && check_write(&apr_file, buffer.data(), (S32)buffer.size());
+        success = success && apr_file.seek(APR_SET, 0) == 0 && check_write(&apr_file, &header, sizeof(RegionFileHeader));
     }
-    // Rewrite the placeholder
-    out.seekp(num_entries_placeholder);
-    out << std::setw(10) << std::setfill('0') << num_entries << '\n';
-    if(!out.good())
+
+    if(!success)
     {
-        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
-        removeGenericExtrasForHandle(handle);
-        return;
+        LL_WARNS() << "Failed to write cache to disk " << filename << LL_ENDL;
+        return false;
     }
-    LL_DEBUGS("GLTF") << "Completed writing extras cache for handle " << handle << ", " << num_entries << " entries. Total in RAM: " << inmem_entries << " skipped (no persist): " << skipped << LL_ENDL;
+
+    LL_DEBUGS("VOCache") << "Wrote " << records.size() << " entries to the VOCache file " << filename << ", "
+                         << (compact ? "compacted" : "appended") << " " << buffer.size() << " bytes, " << dead_bytes << " dead bytes" << LL_ENDL;
+    return true;
 }
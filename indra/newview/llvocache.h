@@ -33,7 +33,10 @@
 #include "llvieweroctree.h"
 #include "llapr.h"
 #include "llgltfmaterial.h"
+#include "threadpool_fwd.h"
 
+#include <functional>
+#include <memory>
 #include <unordered_map>
 
 //---------------------------------------------------------------------------
@@ -43,8 +46,6 @@ class LLCamera;
 class LLGLTFOverrideCacheEntry
 {
 public:
-    static const std::string VERSION_LABEL;
-    static const int VERSION;
     bool fromLLSD(const LLSD& data);
     LLSD toLLSD() const;
 
@@ -102,7 +103,7 @@ class LLVOCacheEntry final
     ~LLVOCacheEntry();
 public:
     LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-    LLVOCacheEntry(LLAPRFile* apr_file);
+    LLVOCacheEntry(U32 local_id, U32 crc, S32 hit_count, S32 dupe_count, S32 crc_change_count, const U8* data, S32 size);
     LLVOCacheEntry();
 
     void updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp);
@@ -119,13 +120,15 @@ class LLVOCacheEntry final
     U32 getCRC() const              { return mCRC; }
     S32 getHitCount() const         { return mHitCount; }
     S32 getCRCChangeCount() const   { return mCRCChangeCount; }
+    S32 getDupeCount() const        { return mDupeCount; }
 
     void calcSceneContribution(const LLVector4a& camera_origin, bool needs_update, U32 last_update, F32 dist_threshold);
     void setSceneContribution(F32 scene_contrib) {mSceneContrib = scene_contrib;}
     F32 getSceneContribution() const             { return mSceneContrib;}
 
     void dump() const;
-    S32 writeToBuffer(U8 *data_buffer) const;
+    const U8* getBuffer() const     { return mDP.getBuffer(); }
+    S32 getBufferSize() const       { return mDP.getBufferSize(); }
     LLDataPackerBinaryBuffer *getDP() const;
     void recordHit();
     void recordDupe() { mDupeCount++; }
@@ -246,7 +249,8 @@ class LLVOCachePartition final : public LLViewerOctreePartition
 };
 
 //
-//Note: LLVOCache is not thread-safe
+//Note: LLVOCache is only used from the main thread, the region files are
+//read and written on its own thread.
 //
 class LLVOCache final : public LLParamSingleton<LLVOCache>
 {
@@ -286,17 +290,29 @@ class LLVOCache final : public LLParamSingleton<LLVOCache>
     typedef std::map<U64, HeaderEntryInfo*> handle_entry_map_t;
 
 public:
+    typedef std::function<void(bool success, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map,
+                               LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map)> read_callback_t;
+
     // We need this init to be separate from constructor, since we might construct cache, purge it, then init.
     void initCache(ELLPath location, U32 size, U32 cache_version);
     void removeCache(ELLPath location, bool started = false) ;
 
-    bool readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
-    void readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map);
+    // Region files hold the object entries and their GLTF overrides. The file is read on the
+    // cache thread and callback gets the contents on the main thread, or right away if the
+    // region was prefetched. success is false if the file was missing or corrupted so the
+    // caller marks the region dirty and it gets rewritten.
+    void readFromCache(U64 handle, const LLUUID& id, read_callback_t callback);
+
+    // Forget the callback of a pending read, what was read is kept as a prefetch
+    void cancelRead(U64 handle);
+
+    // Start reading a region file before the region asks for it, e.g. for a neighbor
+    void prefetch(U64 handle);
 
-    void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled);
-    void writeGenericExtrasToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map, BOOL dirty_cache, bool removal_enabled);
+    // Copies the entries, the file is written on the cache thread
+    void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map,
+                      const LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map, BOOL dirty_cache, bool removal_enabled);
     void removeEntry(U64 handle) ;
-    void removeGenericExtrasForHandle(U64 handle);
 
     U32 getCacheEntries() { return mNumEntries; }
     U32 getCacheEntriesMax() { return mCacheSize; }
@@ -305,7 +321,6 @@ class LLVOCache final : public LLParamSingleton<LLVOCache>
     void setDirNames(ELLPath location);
     // determine the cache filename for the region from the region handle
     void getObjectCacheFilename(U64 handle, std::string& filename);
-    std::string getObjectCacheExtrasFilename(U64 handle);
     void removeFromCache(HeaderEntryInfo* entry);
     void readCacheHeader();
     void writeCacheHeader();
@@ -315,6 +330,36 @@ class LLVOCache final : public LLParamSingleton<LLVOCache>
     void purgeEntries(U32 size);
     BOOL updateEntry(const HeaderEntryInfo* entry);
 
+    // Contents of a region file, filled in on the cache thread
+    struct RegionData
+    {
+        LLUUID mCacheID;
+        bool   mSuccess = false;
+        U32    mExpectedEntries = 0;
+        LLVOCacheEntry::vocache_entry_map_t          mEntries;
+        LLVOCacheEntry::vocache_gltf_overrides_map_t mOverrides;
+    };
+    struct RegionSnapshot;
+
+    struct PendingRead
+    {
+        std::shared_ptr<RegionData> mData;      // null while the file is being read
+        read_callback_t             mCallback;  // empty for a prefetch nobody asked for yet
+        LLUUID                      mCacheID;
+        U32                         mSerial = 0;
+    };
+    typedef std::map<U64, std::shared_ptr<PendingRead> > pending_read_map_t;
+
+    void startRead(U64 handle, const std::shared_ptr<PendingRead>& request);
+    void onReadDone(U64 handle, const std::shared_ptr<PendingRead>& request, const std::shared_ptr<RegionData>& data);
+    void finishRead(U64 handle, std::shared_ptr<PendingRead> request);
+    void trimPrefetches();
+    void dropPrefetch(U64 handle);
+
+    // run on the cache thread
+    static void readRegionFile(const std::string& filename, RegionData& data);
+    static bool writeRegionFile(const std::string& filename, const LLUUID& id, const RegionSnapshot& snapshot, LLVolatileAPRPool* pool);
+
 private:
     bool                 mEnabled;
     bool                 mInitialized ;
@@ -325,8 +370,15 @@ class LLVOCache final : public LLParamSingleton<LLVOCache>
     std::string          mHeaderFileName ;
     std::string          mObjectCacheDirName;
     LLVolatileAPRPool*   mLocalAPRFilePoolp ;
+    LLVolatileAPRPool*   mThreadAPRFilePoolp ; // only used on the cache thread
     header_entry_queue_t mHeaderEntryQueue;
     handle_entry_map_t   mHandleEntryMap;
+
+    std::unique_ptr<LL::ThreadPool> mThreadPool;
+    LL::WorkQueue::weak_t mWorkQueue;
+    LL::WorkQueue::weak_t mMainQueue;
+    pending_read_map_t   mPendingReads;
+    U32                  mReadSerial;
 };
 
 #endif
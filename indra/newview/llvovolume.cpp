@@ -5073,10 +5073,19 @@ void LLRiggedVolume::update(
 
             }
 
+            // the BVH bounds the old positions
+            dst_face.destroyBVH();
             if (rebuild_face_octrees)
             {
                 dst_face.destroyOctree();
-                dst_face.createOctree();
+                if (LLVolume::sUseBVH)
+                {
+                    dst_face.createBVH();
+                }
+                else
+                {
+                    dst_face.createOctree();
+                }
             }
         }
     }
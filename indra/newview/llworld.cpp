@@ -218,6 +218,14 @@ LLViewerRegion* LLWorld::addRegion(const U64 &region_handle, const LLHost &host)
     mActiveRegionList.push_back(regionp);
     mCulledRegionList.push_back(regionp);
 
+    // Read the object cache while the circuit comes up, the region asks for it
+    // once the handshake arrives.
+    bool prefetch_cache = LLVOCache::instanceExists();
+    if (prefetch_cache)
+    {
+        LLVOCache::instance().prefetch(region_handle);
+    }
+
 
     // Find all the adjacent regions, and attach them.
     // Generate handles for all of the adjacent regions, and attach them in the correct way.
@@ -249,6 +257,11 @@ LLViewerRegion* LLWorld::addRegion(const U64 &region_handle, const LLHost &host)
                 //LL_INFOS() << "Connecting " << region_x << ":" << region_y << " -> " << adj_x << ":" << adj_y << LL_ENDL;
                 regionp->connectNeighbor(neighborp, dir);
             }
+            else if (prefetch_cache)
+            {
+                // likely to be enabled next, only reads regions that are in the cache
+                LLVOCache::instance().prefetch(adj_handle);
+            }
         }
         else // Unconventional region size
         {
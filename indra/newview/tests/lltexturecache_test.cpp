@@ -0,0 +1,72 @@
+/**
+ * @file lltexturecache_test.cpp
+ * @brief Tests for the LLTextureCache header entry time stamps
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../lltexturecache.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+    struct LLTextureCacheTimeStampData
+    {
+        // what a read hit at now leaves in the entry
+        U32 readEntry(U32 entry_time, U32 now, U32 lru_time)
+        {
+            return LLTextureCache::needsTimeStamp(entry_time, now, lru_time) ? now : entry_time;
+        }
+    };
+    typedef test_group<LLTextureCacheTimeStampData> LLTextureCacheTimeStampTest_factory;
+    typedef LLTextureCacheTimeStampTest_factory::object LLTextureCacheTimeStampTest_t;
+    LLTextureCacheTimeStampTest_factory tf("LLTextureCache time stamps");
+
+    template<> template<>
+    void LLTextureCacheTimeStampTest_t::test<1>()
+    {
+        set_test_name("recent read hits do not restamp");
+
+        const U32 lru_time = 1000;
+        ensure("fresh stamp kept", !LLTextureCache::needsTimeStamp(1001, 1002, lru_time));
+        ensure("stale stamp renewed",
+               LLTextureCache::needsTimeStamp(1001, 1001 + LLTextureCache::sTimeStampGranularity, lru_time));
+    }
+
+    template<> template<>
+    void LLTextureCacheTimeStampTest_t::test<2>()
+    {
+        set_test_name("an entry read just before a purge survives it");
+
+        // stamped a little before the LRU was built, well within the granularity
+        const U32 lru_time = 1000;
+        const U32 entry_time = readEntry(990, 1005, lru_time);
+        ensure_equals("restamped", entry_time, 1005U);
+        ensure("not evicted", !LLTextureCache::isEvictableFromLRU(entry_time, lru_time));
+
+        // the same entry left alone goes
+        ensure("unread entry evicted", LLTextureCache::isEvictableFromLRU(990, lru_time));
+    }
+}
@@ -93,7 +93,7 @@ namespace tut
             ll_init_apr();
 
             const bool READ_ONLY = false;
-            const U32 INDRA_OBJECT_CACHE_VERSION = 15; // see LLAppViewer::getObjectCacheVersion()
+            const U32 INDRA_OBJECT_CACHE_VERSION = 18; // see LLAppViewer::getObjectCacheVersion()
             const U32 CACHE_NUMBER_OF_REGIONS = 128;   // see setting CacheNumberOfRegionsForObjects
 
             LLVOCache &instance = LLVOCache::initParamSingleton(READ_ONLY);
@@ -136,11 +136,19 @@ namespace tut
     template<> template<>
     void vocacheTestObject::test<2>()
     {
-        LLVOCacheEntry::vocache_gltf_overrides_map_t extras;
-
         U64 region_handle = to_region_handle(140, 81);
         LLUUID region_id = LLUUID::generateNewID();
 
-        LLVOCache::instance().readGenericExtrasFromCache(region_handle, region_id, extras);
+        // without a cache thread the callback runs right away
+        bool called = false;
+        LLVOCache::instance().readFromCache(region_handle, region_id,
+            [&called](bool success, LLVOCacheEntry::vocache_entry_map_t& entries, LLVOCacheEntry::vocache_gltf_overrides_map_t& extras)
+            {
+                called = true;
+                ensure("uncached region is dirty", !success);
+                ensure("no entries", entries.empty());
+                ensure("no overrides", extras.empty());
+            });
+        ensure("callback called", called);
     }
 }
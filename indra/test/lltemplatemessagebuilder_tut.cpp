@@ -32,6 +32,7 @@
 #include "llapr.h"
 #include "llmessagetemplate.h"
 #include "llmath.h"
+#include "llmessagefield.h"
 #include "llquaternion.h"
 #include "lltemplatemessagebuilder.h"
 #include "lltemplatemessagereader.h"
@@ -973,5 +974,146 @@ namespace tut
         ensure_equals("Ensure unchanged buffer ", strlen(outBuffer), 0);
         delete reader;
     }
-}
 
+    template<> template<>
+    void LLTemplateMessageBuilderTestObject::test<46>()
+        // LLMessageField reads match reads by name
+    {
+        LLMessageTemplate messageTemplate = defaultTemplate();
+        LLMessageBlock* block = defaultBlock(MVT_U32, 4);
+        block->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_VARIABLE, 1);
+        messageTemplate.addBlock(block);
+        LLTemplateMessageBuilder* builder = defaultBuilder(messageTemplate);
+        for (U32 i = 0; i < 3; ++i)
+        {
+            if (i)
+            {
+                builder->nextBlock(_PREHASH_Test0);
+            }
+            builder->addU32(_PREHASH_Test0, 0xbbbbbbb0 + i);
+            builder->addString(_PREHASH_Test1, std::string(i + 1, 'a'));
+        }
+        LLTemplateMessageReader* reader = setReader(messageTemplate, builder);
+
+        static const LLMessageField number(_PREHASH_Test0, _PREHASH_Test0);
+        static const LLMessageField text(_PREHASH_Test0, _PREHASH_Test1);
+        ensure_equals("Ensure block count", reader->getNumberOfBlocks(_PREHASH_Test0), 3);
+        for (S32 i = 0; i < 3; ++i)
+        {
+            U32 byName, byField;
+            reader->getU32(_PREHASH_Test0, _PREHASH_Test0, byName, i);
+            reader->getU32(number, byField, i);
+            ensure_equals("Ensure U32 by name", byName, (U32)(0xbbbbbbb0 + i));
+            ensure_equals("Ensure U32 by field", byField, byName);
+
+            std::string outValue;
+            reader->getString(text, outValue, i);
+            ensure_equals("Ensure String by field", outValue, std::string(i + 1, 'a'));
+            ensure_equals("Ensure size by field", reader->getSize(text, i), i + 2);
+        }
+        ensure_equals("Ensure missing block", reader->getSize(number, 3), LL_BLOCK_NOT_IN_MESSAGE);
+        static const LLMessageField missing(_PREHASH_Test0, _PREHASH_Test2);
+        ensure_equals("Ensure missing variable", reader->getSize(missing, 0), LL_VARIABLE_NOT_IN_BLOCK);
+        delete reader;
+
+        // the same field read from a template with another layout
+        LLMessageTemplate otherTemplate = defaultTemplate();
+        otherTemplate.addBlock(createBlock(const_cast<char*>(_PREHASH_Test1), MVT_U8, 1, MBT_SINGLE));
+        block = createBlock(const_cast<char*>(_PREHASH_Test0), MVT_U8, 1, MBT_SINGLE);
+        block->addVariable(const_cast<char*>(_PREHASH_Test2), MVT_U8, 1);
+        block->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_VARIABLE, 1);
+        otherTemplate.addBlock(block);
+        builder = defaultBuilder(otherTemplate, const_cast<char*>(_PREHASH_Test1));
+        builder->addU8(_PREHASH_Test0, 1);
+        builder->nextBlock(_PREHASH_Test0);
+        builder->addU8(_PREHASH_Test0, 2);
+        builder->addU8(_PREHASH_Test2, 3);
+        builder->addString(_PREHASH_Test1, "other");
+        reader = setReader(otherTemplate, builder);
+        std::string outValue;
+        reader->getString(text, outValue);
+        ensure_equals("Ensure String from other template", outValue, std::string("other"));
+        delete reader;
+    }
+
+    template<> template<>
+    void LLTemplateMessageBuilderTestObject::test<47>()
+        // copyToBuilder copies every block
+    {
+        LLMessageTemplate messageTemplate = defaultTemplate();
+        LLMessageBlock* block = defaultBlock(MVT_U32, 4);
+        block->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_VARIABLE, 1);
+        messageTemplate.addBlock(block);
+        LLTemplateMessageBuilder* builder = defaultBuilder(messageTemplate);
+        builder->addU32(_PREHASH_Test0, 1);
+        builder->addString(_PREHASH_Test1, "one");
+        builder->nextBlock(_PREHASH_Test0);
+        builder->addU32(_PREHASH_Test0, 2);
+        builder->addString(_PREHASH_Test1, "two");
+        LLTemplateMessageReader* reader = setReader(messageTemplate, builder);
+
+        builder = new LLTemplateMessageBuilder(nameMap);
+        builder->newMessage(_PREHASH_TestMessage);
+        reader->copyToBuilder(*builder);
+        delete reader;
+        reader = setReader(messageTemplate, builder);
+
+        U32 outValue;
+        std::string outString;
+        ensure_equals("Ensure block count", reader->getNumberOfBlocks(_PREHASH_Test0), 2);
+        reader->getU32(_PREHASH_Test0, _PREHASH_Test0, outValue, 1);
+        reader->getString(_PREHASH_Test0, _PREHASH_Test1, outString, 1);
+        ensure_equals("Ensure copied U32", outValue, (U32)2);
+        ensure_equals("Ensure copied String", outString, std::string("two"));
+        delete reader;
+    }
+
+    template<> template<>
+    void LLTemplateMessageBuilderTestObject::test<48>()
+        // readMessage uses a message decoded by decodeMessage
+    {
+        LLMessageTemplate messageTemplate = defaultTemplate();
+        LLMessageBlock* block = defaultBlock(MVT_U32, 4);
+        block->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_VARIABLE, 1);
+        messageTemplate.addBlock(block);
+        LLTemplateMessageBuilder* builder = defaultBuilder(messageTemplate);
+        builder->addU32(_PREHASH_Test0, 0xaaaaaaaa);
+        builder->addString(_PREHASH_Test1, "decoded");
+        numberMap[1] = &messageTemplate;
+        U8 buffer[1024];
+        memset(buffer, 0, LL_PACKET_ID_SIZE);
+        S32 builtSize = builder->buildMessage(buffer, sizeof(buffer), 0);
+        delete builder;
+
+        LLTemplateMessageReader reader(numberMap);
+        LLTemplateMessageReader::DecodedMessage decoded;
+        LLMessageTemplate* templatep = reader.findTemplate(buffer, builtSize);
+        ensure("Ensure template found", templatep == &messageTemplate);
+        ensure("Ensure decoded", LLTemplateMessageReader::decodeMessage(buffer, builtSize, templatep, decoded));
+
+        // change the packet, so reads show which copy was used
+        U8 changed[1024];
+        memcpy(changed, buffer, builtSize);
+        changed[builtSize - 2] = 'X';
+
+        reader.clearMessage();
+        reader.setPredecoded(decoded);
+        reader.validateMessage(changed, builtSize, LLHost());
+        reader.readMessage(changed, LLHost());
+        U32 outValue;
+        std::string outString;
+        reader.getU32(_PREHASH_Test0, _PREHASH_Test0, outValue);
+        reader.getString(_PREHASH_Test0, _PREHASH_Test1, outString);
+        ensure_equals("Ensure predecoded U32", outValue, (U32)0xaaaaaaaa);
+        ensure_equals("Ensure predecoded String", outString, std::string("decoded"));
+
+        // clearMessage drops it, and each readMessage uses it once
+        ensure("Ensure decoded again", LLTemplateMessageReader::decodeMessage(buffer, builtSize, templatep, decoded));
+        reader.setPredecoded(decoded);
+        reader.clearMessage();
+        reader.validateMessage(changed, builtSize, LLHost());
+        reader.readMessage(changed, LLHost());
+        reader.getString(_PREHASH_Test0, _PREHASH_Test1, outString);
+        ensure_equals("Ensure String read from packet", outString, std::string("decodeX"));
+    }
+}